@@ -277,6 +277,54 @@ public:
      */
     status_t receiveMessage(InputMessage* msg);
 
+    /* Send several messages to the other endpoint, in order, with as few system calls as possible.
+     *
+     * |outSentCount| is set to the number of messages that were sent. If the channel becomes full,
+     * the messages that follow the sent ones are guaranteed not to have been sent at all.
+     *
+     * Return OK if all the messages were sent.
+     * Otherwise, return the error that sendMessage would return for the first message that could
+     * not be sent.
+     */
+    status_t sendMessages(const InputMessage* msgs, size_t count, size_t* outSentCount);
+
+    /* Receive the messages sent by the other endpoint with a single system call.
+     *
+     * Up to |capacity| messages are stored in |msgs|, and |outCount| is set to their number. Fewer
+     * messages than are available may be returned, so call this again until it returns
+     * WOULD_BLOCK to drain the channel.
+     *
+     * Return OK if at least one message was received. If a message that follows them is invalid,
+     * the error is returned by the next call instead.
+     * Return WOULD_BLOCK if there is no message present.
+     * Return DEAD_OBJECT if the channel's peer has been closed.
+     * Other errors probably indicate that the channel is broken.
+     */
+    status_t receiveMessages(InputMessage* msgs, size_t capacity, size_t* outCount);
+
+    /* Allows the compact encoding for the MOTION messages sent to the other endpoint.
+     *
+     * A compact message only carries the axes that are present in each pointer, and leaves out the
+     * fields and axis values that did not change since the previous compact message. Since compact
+     * messages are encoded against each other, they are only sent once the InputChannel object
+     * that reads them asks for them with requestCompactMotionEncoding. The request is handled when
+     * this channel receives it.
+     */
+    void setCompactMotionEncodingAllowed(bool allowed);
+
+    /* Asks the other endpoint to send compact MOTION messages, if it allows them.
+     *
+     * Only this object can decode the compact messages that follow, so any other InputChannel
+     * object that takes over reading the connection, such as a duplicate, must request them again
+     * before it receives anything.
+     *
+     * Return OK on success, or the error that sendMessage would return.
+     */
+    status_t requestCompactMotionEncoding();
+
+    /* Tells whether the other endpoint requested compact MOTION messages, and they are allowed. */
+    bool isCompactMotionEncodingEnabled() const { return mCompactMotionEncoding; }
+
     /* Tells whether there is a message in the channel available to be received.
      *
      * This is only a performance hint and may return false negative results. Clients should not
@@ -328,6 +376,29 @@ private:
                                                 android::base::unique_fd fd, sp<IBinder> token);
 
     InputChannel(const std::string name, android::base::unique_fd fd, sp<IBinder> token);
+
+    // Sends up to MAX_MESSAGES_PER_SEND messages with sendmmsg, and adds the number of messages
+    // that were sent to |outSentCount|.
+    status_t sendMessageChunk(const InputMessage* msgs, size_t count, size_t* outSentCount);
+    // Handles a request for the compact encoding received with |length| bytes. Returns false if
+    // |msg| is not such a request.
+    bool handleCompactMotionRequest(const InputMessage& msg, size_t length);
+    bool shouldUseCompactEncoding(const InputMessage& msg) const;
+    // Decodes a message that was received with |length| bytes, in place.
+    status_t decodeMessage(InputMessage* msg, size_t length);
+
+    bool mCompactMotionEncodingAllowed = false;
+    bool mCompactMotionEncoding = false;
+    // The last compact MOTION messages sent and received, that the next ones are encoded against.
+    InputMessage mSendReference{};
+    InputMessage mReceiveReference{};
+    // The error of a message that receiveMessages received after valid ones, returned by the next
+    // receive call.
+    status_t mPendingReceiveError = OK;
+    // The sanitized and compact copies of the messages being sent by sendMessages, reused across
+    // calls.
+    std::vector<InputMessage> mSendCleanMessages;
+    std::vector<InputMessage> mSendCompactMessages;
 };
 
 /*
@@ -412,6 +483,25 @@ public:
      */
     status_t publishTouchModeEvent(uint32_t seq, int32_t eventId, bool isInTouchMode);
 
+    /* Starts a batch of events. Until endBatch is called, the publish methods check the events
+     * and hold on to them rather than writing each one to the input channel. They return OK
+     * unless the event itself is invalid.
+     */
+    void beginBatch();
+
+    /* Ends the batch, and writes the events published since beginBatch to the input channel, in
+     * order, with as few system calls as possible.
+     *
+     * |outPublishedCount| is set to the number of events that were written. The events that
+     * follow them were not written at all, and can be published again later.
+     *
+     * Returns OK if all the events were written.
+     * Returns WOULD_BLOCK if the channel became full.
+     * Returns DEAD_OBJECT if the channel's peer has been closed.
+     * Other errors probably indicate that the channel is broken.
+     */
+    status_t endBatch(size_t* outPublishedCount);
+
     struct Finished {
         uint32_t seq;
         bool handled;
@@ -449,6 +539,12 @@ public:
 private:
     std::shared_ptr<InputChannel> mChannel;
     InputVerifier mInputVerifier;
+
+    // Messages published since beginBatch, if a batch is in progress.
+    bool mBatching = false;
+    std::vector<InputMessage> mBatch;
+
+    status_t sendMessage(const InputMessage& msg);
 };
 
 /*
@@ -543,6 +639,13 @@ private:
     // call to consume and that still needs to be handled.
     bool mMsgDeferred;
 
+    // Messages that were read from the channel together with an earlier message, and that have
+    // not been handled yet. They are mReceivedMessages[mNextReceivedMessage] up to, but not
+    // including, mReceivedMessages[mReceivedMessageCount].
+    std::vector<InputMessage> mReceivedMessages;
+    size_t mReceivedMessageCount = 0;
+    size_t mNextReceivedMessage = 0;
+
     // Batched motion events per device and source.
     struct Batch {
         std::vector<InputMessage> samples;
@@ -653,6 +756,7 @@ private:
     // will be raised for that connection, and no further events will be posted to that channel.
     std::unordered_map<uint32_t /*seq*/, nsecs_t /*consumeTime*/> mConsumeTimes;
 
+    status_t receiveMessage(InputMessage* msg);
     status_t consumeBatch(InputEventFactoryInterface* factory,
             nsecs_t frameTime, uint32_t* outSeq, InputEvent** outEvent);
     status_t consumeSamples(InputEventFactoryInterface* factory,
@@ -667,6 +771,8 @@ private:
 
     nsecs_t getConsumeTime(uint32_t seq) const;
     void popConsumeTime(uint32_t seq);
+    InputMessage createFinishedMessage(uint32_t seq, bool handled) const;
+    void onFinishedSignalSent(uint32_t seq);
     status_t sendUnchainedFinishedSignal(uint32_t seq, bool handled);
 
     static void rewriteMessage(TouchState& state, InputMessage& msg);
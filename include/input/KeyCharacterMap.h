@@ -29,6 +29,8 @@
 #include <utils/Tokenizer.h>
 #include <utils/Unicode.h>
 #include <map>
+#include <span>
+#include <vector>
 
 // Maximum number of keys supported by KeyCharacterMaps
 #define MAX_KEYS 8192
@@ -82,6 +84,13 @@ public:
                                                                        const char* contents,
                                                                        Format format);
 
+    /* Loads a key character map from its compiled form, as written by writeCompiled. */
+    static base::Result<std::shared_ptr<KeyCharacterMap>> loadCompiled(
+            const std::string& filename, std::span<const int32_t> words);
+
+    /* Appends the compiled form of this key character map, see KeyMapCache. */
+    void writeCompiled(std::vector<int32_t>& out) const;
+
     const std::string getLoadFileName() const;
 
     /* Combines this key character map with the provided overlay. */
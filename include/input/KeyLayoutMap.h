@@ -23,6 +23,8 @@
 #include <utils/Errors.h>
 #include <utils/Tokenizer.h>
 #include <set>
+#include <span>
+#include <vector>
 
 namespace android {
 
@@ -67,6 +69,12 @@ public:
                                                             const char* contents = nullptr);
     static base::Result<std::shared_ptr<KeyLayoutMap>> loadContents(const std::string& filename,
                                                                     const char* contents);
+    /* Loads a key layout map from its compiled form, as written by writeCompiled. */
+    static base::Result<std::shared_ptr<KeyLayoutMap>> loadCompiled(
+            const std::string& filename, std::span<const int32_t> words);
+
+    /* Appends the compiled form of this key layout map, see KeyMapCache. */
+    void writeCompiled(std::vector<int32_t>& out) const;
 
     status_t mapKey(int32_t scanCode, int32_t usageCode,
             int32_t* outKeyCode, uint32_t* outFlags) const;
@@ -84,6 +92,8 @@ public:
 
 private:
     static base::Result<std::shared_ptr<KeyLayoutMap>> load(Tokenizer* tokenizer);
+    static base::Result<std::shared_ptr<KeyLayoutMap>> finishLoading(
+            std::shared_ptr<KeyLayoutMap> map, const std::string& filename);
 
     struct Key {
         int32_t keyCode;
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/mapped_file.h>
+#include <android-base/result.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace android {
+
+class KeyCharacterMap;
+class KeyLayoutMap;
+
+/**
+ * On-disk cache of compiled key layout (.kl) and key character map (.kcm) files.
+ *
+ * The same handful of text files is tokenized and parsed again for every keyboard that is added.
+ * The compiled form of a file is a flat array of 32-bit words that is mapped into memory and
+ * decoded straight into the map, without going through the tokenizer.
+ *
+ * Cache entries are keyed by the path of the text file, and record the size, modification time,
+ * inode and a hash of the contents of the file they were compiled from, as well as the build
+ * fingerprint. An entry that does not match the current text file or build, was written by another
+ * version of the format, or fails its checksum is ignored, and the text file is parsed and compiled
+ * again. Entries are written to a temporary file and renamed
+ * into place, so concurrent readers never observe a partially written entry.
+ *
+ * Thread safe.
+ */
+class KeyMapCache {
+public:
+    // Bumped whenever the compiled form of either map changes.
+    static constexpr uint32_t VERSION = 2;
+
+    struct Stats {
+        // Loads that were served from a compiled entry.
+        size_t hits = 0;
+        // Loads that had to parse the text file.
+        size_t misses = 0;
+        // Compiled entries that could not be written.
+        size_t writeFailures = 0;
+    };
+
+    /* Bounds checked cursor over the words of a compiled key map. */
+    class Reader {
+    public:
+        explicit Reader(std::span<const int32_t> words) : mWords(words) {}
+
+        /* Returns false if there are no words left. */
+        bool read(int32_t& outValue);
+        bool readString(std::string& outValue);
+        bool isAtEnd() const { return mPosition == mWords.size(); }
+
+    private:
+        std::span<const int32_t> mWords;
+        size_t mPosition = 0;
+    };
+
+    static void writeString(const std::string& value, std::vector<int32_t>& out);
+
+    /* Creates a cache that keeps its entries in the given directory, which must already exist. */
+    explicit KeyMapCache(std::string directory);
+
+    base::Result<std::shared_ptr<KeyLayoutMap>> loadKeyLayout(const std::string& filename);
+
+    /* Loads a key character map in the BASE format. */
+    base::Result<std::shared_ptr<KeyCharacterMap>> loadKeyCharacterMap(
+            const std::string& filename);
+
+    Stats getStats() const;
+
+private:
+    enum class Kind : uint32_t {
+        KEY_LAYOUT = 1,
+        KEY_CHARACTER_MAP = 2,
+    };
+
+    struct Source {
+        uint64_t size;
+        int64_t modificationTimeNs;
+        uint64_t inode;
+        uint64_t contentHash;
+    };
+
+    const std::string mDirectory;
+    const uint64_t mBuildHash;
+
+    std::atomic<size_t> mHits = 0;
+    std::atomic<size_t> mMisses = 0;
+    std::atomic<size_t> mWriteFailures = 0;
+
+    template <typename T, typename LoadCompiled, typename LoadText>
+    base::Result<std::shared_ptr<T>> load(const std::string& filename, Kind kind,
+                                          LoadCompiled loadCompiled, LoadText loadText);
+
+    static std::optional<Source> examineSource(const std::string& filename);
+    std::string getEntryPath(const std::string& filename, Kind kind) const;
+
+    /* Maps the entry of the given text file, or returns nullptr if there is no valid entry. */
+    std::unique_ptr<base::MappedFile> mapEntry(const std::string& filename, const Source& source,
+                                               Kind kind, std::span<const int32_t>& outWords) const;
+    bool writeEntry(const std::string& filename, const Source& source, Kind kind,
+                    const std::vector<int32_t>& words) const;
+};
+
+} // namespace android
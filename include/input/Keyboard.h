@@ -26,6 +26,7 @@ namespace android {
 
 class KeyLayoutMap;
 class KeyCharacterMap;
+class KeyMapCache;
 
 /**
  * Loads the key layout map and key character map for a keyboard device.
@@ -41,8 +42,9 @@ public:
     KeyMap();
     ~KeyMap();
 
+    /* Loads the key maps of the device, through the given cache if it is not null. */
     status_t load(const InputDeviceIdentifier& deviceIdenfier,
-            const PropertyMap* deviceConfiguration);
+            const PropertyMap* deviceConfiguration, KeyMapCache* cache = nullptr);
 
     inline bool haveKeyLayout() const {
         return !keyLayoutFile.empty();
@@ -57,10 +59,12 @@ public:
     }
 
 private:
-    bool probeKeyMap(const InputDeviceIdentifier& deviceIdentifier, const std::string& name);
-    status_t loadKeyLayout(const InputDeviceIdentifier& deviceIdentifier, const std::string& name);
+    bool probeKeyMap(const InputDeviceIdentifier& deviceIdentifier, const std::string& name,
+                     KeyMapCache* cache);
+    status_t loadKeyLayout(const InputDeviceIdentifier& deviceIdentifier, const std::string& name,
+                           KeyMapCache* cache);
     status_t loadKeyCharacterMap(const InputDeviceIdentifier& deviceIdentifier,
-                                 const std::string& name);
+                                 const std::string& name, KeyMapCache* cache);
 };
 
 /**
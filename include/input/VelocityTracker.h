@@ -18,10 +18,11 @@
 
 #include <android/os/IInputConstants.h>
 #include <input/Input.h>
-#include <input/RingBuffer.h>
 #include <utils/BitSet.h>
 #include <utils/Timers.h>
+#include <array>
 #include <map>
+#include <optional>
 #include <set>
 
 namespace android {
@@ -148,9 +149,16 @@ protected:
 public:
     virtual ~VelocityTrackerStrategy() { }
 
+    // Velocities indexed by pointer id.
+    using PointerVelocities = std::array<std::optional<float>, MAX_POINTER_ID + 1>;
+
     virtual void clearPointer(int32_t pointerId) = 0;
     virtual void addMovement(nsecs_t eventTime, int32_t pointerId, float position) = 0;
     virtual std::optional<float> getVelocity(int32_t pointerId) const = 0;
+
+    // Computes the velocities of all the given pointers at once. Strategies that can share work
+    // between pointers override this, the default implementation calls getVelocity for each.
+    virtual void getVelocities(BitSet32 pointerIdBits, PointerVelocities& outVelocities) const;
 };
 
 /**
@@ -165,16 +173,37 @@ public:
     void clearPointer(int32_t pointerId) override;
 
 protected:
-    struct Movement {
-        nsecs_t eventTime;
-        float position;
-    };
-
     // Number of samples to keep.
     // If different strategies would like to maintain different history size, we can make this a
     // protected const field.
     static constexpr uint32_t HISTORY_SIZE = 20;
 
+    /**
+     * The latest movements of a pointer, in a ring of HISTORY_SIZE entries. The times and the
+     * positions are kept in separate arrays, so that they can be copied out in bulk.
+     */
+    struct Movements {
+        std::array<nsecs_t, HISTORY_SIZE> eventTimes;
+        std::array<float, HISTORY_SIZE> positions;
+        // Index of the oldest movement in the arrays.
+        uint32_t start = 0;
+        uint32_t size = 0;
+
+        // Accessors for the i-th oldest movement.
+        nsecs_t getEventTime(uint32_t i) const { return eventTimes[(start + i) % HISTORY_SIZE]; }
+        float getPosition(uint32_t i) const { return positions[(start + i) % HISTORY_SIZE]; }
+
+        void pushBack(nsecs_t eventTime, float position);
+        void popBack() { size--; }
+        void popFront() {
+            start = (start + 1) % HISTORY_SIZE;
+            size--;
+        }
+    };
+
+    // Returns the movements of the pointer, or nullptr if it has none.
+    const Movements* getMovements(int32_t pointerId) const;
+
     /**
      * Duration, in nanoseconds, since the latest movement where a movement may be considered for
      * velocity calculation.
@@ -185,7 +214,9 @@ protected:
      * addition of a new movement.
      */
     const bool mMaintainHorizonDuringAdd;
-    std::map<int32_t /*pointerId*/, RingBuffer<Movement>> mMovements;
+    // The pointers that have movements.
+    BitSet32 mPointerIdBits;
+    std::array<Movements, MAX_POINTER_ID + 1> mMovements;
 };
 
 /*
@@ -213,6 +244,7 @@ public:
     ~LeastSquaresVelocityTrackerStrategy() override;
 
     std::optional<float> getVelocity(int32_t pointerId) const override;
+    void getVelocities(BitSet32 pointerIdBits, PointerVelocities& outVelocities) const override;
 
 private:
     // Sample horizon.
@@ -222,12 +254,11 @@ private:
 
     float chooseWeight(int32_t pointerId, uint32_t index) const;
     /**
-     * An optimized least-squares solver for degree 2 and no weight (i.e. `Weighting.NONE`).
-     * The provided container of movements shall NOT be empty, and shall have the movements in
-     * chronological order.
+     * An optimized least-squares solver for degree 2 and no weight (i.e. `Weighting.NONE`), for
+     * several pointers at once. The given pointers shall all have at least 3 movements.
      */
-    std::optional<float> solveUnweightedLeastSquaresDeg2(
-            const RingBuffer<Movement>& movements) const;
+    void solveUnweightedLeastSquaresDeg2(const int32_t* pointerIds, size_t count,
+                                         PointerVelocities& outVelocities) const;
 
     const uint32_t mDegree;
     const Weighting mWeighting;
@@ -288,8 +319,14 @@ public:
     ~ImpulseVelocityTrackerStrategy() override;
 
     std::optional<float> getVelocity(int32_t pointerId) const override;
+    void getVelocities(BitSet32 pointerIdBits, PointerVelocities& outVelocities) const override;
 
 private:
+    // Computes the velocities of several pointers at once. The given pointers shall all have
+    // movements.
+    void computeVelocities(const int32_t* pointerIds, size_t count,
+                           PointerVelocities& outVelocities) const;
+
     // Sample horizon.
     // We don't use too much history by default since we want to react to quick
     // changes in direction.
@@ -103,6 +103,7 @@ BufferQueueCore::BufferQueueCore()
         mUnusedSlots(),
         mActiveBuffers(),
         mDequeueCondition(),
+        mDequeueWaiterCount(0),
         mDequeueBufferCannotBlock(false),
         mQueueBufferCanDrop(false),
         mLegacyBufferDrop(true),
@@ -363,6 +364,26 @@ bool BufferQueueCore::adjustAvailableSlotsLocked(int delta) {
     return true;
 }
 
+void BufferQueueCore::signalDequeueConditionLocked() const {
+    if (mDequeueWaiterCount > 0) {
+        mDequeueCondition.notify_all();
+    }
+}
+
+bool BufferQueueCore::waitForDequeueConditionLocked(std::unique_lock<std::mutex>& lock,
+                                                    nsecs_t timeout) const {
+    mDequeueWaiterCount++;
+    bool signaled = true;
+    if (timeout >= 0) {
+        signaled = mDequeueCondition.wait_for(lock, std::chrono::nanoseconds(timeout)) ==
+                std::cv_status::no_timeout;
+    } else {
+        mDequeueCondition.wait(lock);
+    }
+    mDequeueWaiterCount--;
+    return signaled;
+}
+
 void BufferQueueCore::waitWhileAllocatingLocked(std::unique_lock<std::mutex>& lock) const {
     ATRACE_CALL();
     while (mIsAllocating) {
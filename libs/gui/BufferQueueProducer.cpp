@@ -199,7 +199,7 @@ status_t BufferQueueProducer::setMaxDequeuedBufferCount(int maxDequeuedBuffers,
         if (delta < 0) {
             listener = mCore->mConsumerListener;
         }
-        mCore->mDequeueCondition.notify_all();
+        mCore->signalDequeueConditionLocked();
     } // Autolock scope
 
     // Call back without lock held
@@ -251,7 +251,7 @@ status_t BufferQueueProducer::setAsyncMode(bool async) {
         }
         mCore->mAsyncMode = async;
         VALIDATE_CONSISTENCY();
-        mCore->mDequeueCondition.notify_all();
+        mCore->signalDequeueConditionLocked();
         if (delta < 0) {
             listener = mCore->mConsumerListener;
         }
@@ -373,14 +373,8 @@ status_t BufferQueueProducer::waitForFreeSlotThenRelock(FreeSlotCaller caller,
                     (acquiredCount <= mCore->mMaxAcquiredBufferCount)) {
                 return WOULD_BLOCK;
             }
-            if (mDequeueTimeout >= 0) {
-                std::cv_status result = mCore->mDequeueCondition.wait_for(lock,
-                        std::chrono::nanoseconds(mDequeueTimeout));
-                if (result == std::cv_status::timeout) {
-                    return TIMED_OUT;
-                }
-            } else {
-                mCore->mDequeueCondition.wait(lock);
+            if (!mCore->waitForDequeueConditionLocked(lock, mDequeueTimeout)) {
+                return TIMED_OUT;
             }
         }
     } // while (tryAgain)
@@ -702,7 +696,7 @@ status_t BufferQueueProducer::detachBuffer(int slot) {
         mCore->mActiveBuffers.erase(slot);
         mCore->mFreeSlots.insert(slot);
         mCore->clearBufferSlotLocked(slot);
-        mCore->mDequeueCondition.notify_all();
+        mCore->signalDequeueConditionLocked();
         VALIDATE_CONSISTENCY();
     }
 
@@ -1042,7 +1036,7 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         }
 
         mCore->mBufferHasBeenQueued = true;
-        mCore->mDequeueCondition.notify_all();
+        mCore->signalDequeueConditionLocked();
         mCore->mLastQueuedSlot = slot;
 
         output->width = mCore->mDefaultWidth;
@@ -1175,7 +1169,7 @@ status_t BufferQueueProducer::cancelBuffer(int slot, const sp<Fence>& fence) {
             bufferId = gb->getId();
         }
         mSlots[slot].mFence = fence;
-        mCore->mDequeueCondition.notify_all();
+        mCore->signalDequeueConditionLocked();
         listener = mCore->mConsumerListener;
         VALIDATE_CONSISTENCY();
     }
@@ -1408,7 +1402,7 @@ status_t BufferQueueProducer::disconnect(int api, DisconnectMode mode) {
                     mCore->mConnectedApi = BufferQueueCore::NO_CONNECTED_API;
                     mCore->mConnectedPid = -1;
                     mCore->mSidebandStream.clear();
-                    mCore->mDequeueCondition.notify_all();
+                    mCore->signalDequeueConditionLocked();
                     mCore->mAutoPrerotation = false;
                     listener = mCore->mConsumerListener;
                 } else if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
@@ -61,7 +61,7 @@ public:
     virtual ~BpSurfaceComposer();
 
     status_t setTransactionState(
-            const FrameTimelineInfo& frameTimelineInfo, Vector<ComposerState>& state,
+            const FrameTimelineInfo& frameTimelineInfo, std::span<ComposerState> state,
             const Vector<DisplayState>& displays, uint32_t flags, const sp<IBinder>& applyToken,
             InputWindowCommands commands, int64_t desiredPresentTime, bool isAutoTimestamp,
             const std::vector<client_cache_t>& uncacheBuffers, bool hasListenerCallbacks,
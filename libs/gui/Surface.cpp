@@ -802,7 +802,8 @@ int Surface::dequeueBuffers(std::vector<BatchBuffer>* buffers) {
     for (const auto& output : dequeueOutput) {
         // Collect slots that needs requesting buffer
         sp<GraphicBuffer>& gbuf(mSlots[output.slot].buffer);
-        if ((result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) || gbuf == nullptr) {
+        if ((output.result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) ||
+            gbuf == nullptr) {
             if (mReportRemovedBuffers && (gbuf != nullptr)) {
                 mRemovedBuffers.push_back(gbuf);
             }
@@ -910,6 +911,7 @@ int Surface::cancelBuffers(const std::vector<BatchBuffer>& buffers) {
         return INVALID_OPERATION;
     }
 
+    Mutex::Autolock lock(mMutex);
     size_t numBuffers = buffers.size();
     std::vector<CancelBufferInput> cancelBufferInputs(numBuffers);
     std::vector<status_t> cancelBufferOutputs;
@@ -1185,6 +1187,8 @@ int Surface::queueBuffers(const std::vector<BatchQueuedBuffer>& buffers) {
         getQueueBufferInputLocked(
                 buffers[batchIdx].buffer, buffers[batchIdx].fenceFd, buffers[batchIdx].timestamp,
                 &input);
+        applyGrallocMetadataLocked(buffers[batchIdx].buffer, input);
+        input.slot = i;
         bufferFences[batchIdx] = input.fence;
         queueBufferInputs[batchIdx] = input;
     }
@@ -1195,11 +1199,16 @@ int Surface::queueBuffers(const std::vector<BatchQueuedBuffer>& buffers) {
     if (err != OK)  {
         ALOGE("%s: error queuing buffer, %d", __FUNCTION__, err);
     }
-
+    // A failed transaction may return fewer outputs than buffers, or none at all.
+    queueBufferOutputs.resize(numBuffers);
 
     for (size_t batchIdx = 0; batchIdx < numBuffers; batchIdx++) {
-        onBufferQueuedLocked(bufferSlots[batchIdx], bufferFences[batchIdx],
-                queueBufferOutputs[batchIdx]);
+        const IGraphicBufferProducer::QueueBufferOutput& output = queueBufferOutputs[batchIdx];
+        if (err == OK && output.result != OK) {
+            ALOGE("%s: error queuing buffer %zu, %d", __FUNCTION__, batchIdx, output.result);
+            err = output.result;
+        }
+        onBufferQueuedLocked(bufferSlots[batchIdx], bufferFences[batchIdx], output);
     }
 
     return err;
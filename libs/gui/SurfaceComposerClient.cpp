@@ -19,6 +19,7 @@
 #include <semaphore.h>
 #include <stdint.h>
 #include <sys/types.h>
+#include <algorithm>
 
 #include <android/gui/BnWindowInfosReportedListener.h>
 #include <android/gui/DisplayState.h>
@@ -704,6 +705,49 @@ void removeDeadBufferCallback(void* /*context*/, uint64_t graphicBufferId) {
 
 // ---------------------------------------------------------------------------
 
+std::vector<size_t>::iterator SurfaceComposerClient::ComposerStates::lowerBound(
+        const sp<IBinder>& handle) {
+    return std::lower_bound(mSortedIndices.begin(), mSortedIndices.end(), handle.get(),
+                            [this](size_t index, IBinder* key) {
+                                return mHandles[index].get() < key;
+                            });
+}
+
+ComposerState* SurfaceComposerClient::ComposerStates::find(const sp<IBinder>& handle) {
+    const auto it = lowerBound(handle);
+    if (it == mSortedIndices.end() || mHandles[*it] != handle) {
+        return nullptr;
+    }
+    return &mStates[*it];
+}
+
+ComposerState& SurfaceComposerClient::ComposerStates::operator[](const sp<IBinder>& handle) {
+    ComposerState* state = find(handle);
+    return state != nullptr ? *state : add(handle, ComposerState());
+}
+
+ComposerState& SurfaceComposerClient::ComposerStates::add(const sp<IBinder>& handle,
+                                                          ComposerState&& state) {
+    mSortedIndices.insert(lowerBound(handle), mStates.size());
+    mHandles.push_back(handle);
+    return mStates.emplace_back(std::move(state));
+}
+
+void SurfaceComposerClient::ComposerStates::clear() {
+    // The vectors keep their capacity for the next states.
+    mHandles.clear();
+    mStates.clear();
+    mSortedIndices.clear();
+}
+
+void SurfaceComposerClient::ComposerStates::reserve(size_t size) {
+    mHandles.reserve(size);
+    mStates.reserve(size);
+    mSortedIndices.reserve(size);
+}
+
+// ---------------------------------------------------------------------------
+
 SurfaceComposerClient::Transaction::Transaction() {
     mId = generateId();
 }
@@ -727,7 +771,7 @@ SurfaceComposerClient::Transaction::Transaction(const Transaction& other)
 
 void SurfaceComposerClient::Transaction::sanitize(int pid, int uid) {
     uint32_t permissions = LayerStatePermissions::getTransactionPermissions(pid, uid);
-    for (auto & [handle, composerState] : mComposerStates) {
+    for (ComposerState& composerState : mComposerStates.states()) {
         composerState.state.sanitize(permissions);
     }
     if (!mInputWindowCommands.empty() &&
@@ -807,7 +851,7 @@ status_t SurfaceComposerClient::Transaction::readFromParcel(const Parcel* parcel
     if (count > parcel->dataSize()) {
         return BAD_VALUE;
     }
-    std::unordered_map<sp<IBinder>, ComposerState, IBinderHash> composerStates;
+    ComposerStates composerStates;
     composerStates.reserve(count);
     for (size_t i = 0; i < count; i++) {
         sp<IBinder> surfaceControlHandle;
@@ -817,7 +861,7 @@ status_t SurfaceComposerClient::Transaction::readFromParcel(const Parcel* parcel
         if (composerState.read(*parcel) == BAD_VALUE) {
             return BAD_VALUE;
         }
-        composerStates[surfaceControlHandle] = composerState;
+        composerStates[surfaceControlHandle] = std::move(composerState);
     }
 
     InputWindowCommands inputWindowCommands;
@@ -855,7 +899,7 @@ status_t SurfaceComposerClient::Transaction::readFromParcel(const Parcel* parcel
     mFrameTimelineInfo = frameTimelineInfo;
     mDisplayStates = displayStates;
     mListenerCallbacks = listenerCallbacks;
-    mComposerStates = composerStates;
+    mComposerStates = std::move(composerStates);
     mInputWindowCommands = inputWindowCommands;
     mApplyToken = applyToken;
     mUncacheBuffers = std::move(uncacheBuffers);
@@ -963,14 +1007,16 @@ SurfaceComposerClient::Transaction& SurfaceComposerClient::Transaction::merge(Tr
     }
     mMergedTransactionIds.insert(mMergedTransactionIds.begin(), other.mId);
 
-    for (auto const& [handle, composerState] : other.mComposerStates) {
-        if (mComposerStates.count(handle) == 0) {
-            mComposerStates[handle] = composerState;
+    // The states of other are moved rather than copied, since other is cleared.
+    for (auto&& [handle, composerState] : other.mComposerStates) {
+        ComposerState* current = mComposerStates.find(handle);
+        if (current == nullptr) {
+            mComposerStates.add(handle, std::move(composerState));
         } else {
             if (composerState.state.what & layer_state_t::eBufferChanged) {
-                releaseBufferIfOverwriting(mComposerStates[handle].state);
+                releaseBufferIfOverwriting(current->state);
             }
-            mComposerStates[handle].state.merge(composerState.state);
+            current->state.merge(composerState.state);
         }
     }
 
@@ -1071,8 +1117,8 @@ void SurfaceComposerClient::Transaction::cacheBuffers() {
     }
 
     size_t count = 0;
-    for (auto& [handle, cs] : mComposerStates) {
-        layer_state_t* s = &(mComposerStates[handle].state);
+    for (ComposerState& cs : mComposerStates.states()) {
+        layer_state_t* s = &cs.state;
         if (!(s->what & layer_state_t::eBufferChanged)) {
             continue;
         } else if (s->bufferData &&
@@ -1161,8 +1207,9 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous, bool oneWay
         return mStatus;
     }
 
-    std::shared_ptr<SyncCallback> syncCallback = std::make_shared<SyncCallback>();
+    std::shared_ptr<SyncCallback> syncCallback;
     if (synchronous) {
+        syncCallback = std::make_shared<SyncCallback>();
         syncCallback->init();
         addTransactionCommittedCallback(SyncCallback::getCallback(syncCallback),
                                         /*callbackContext=*/nullptr);
@@ -1197,14 +1244,9 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous, bool oneWay
 
     cacheBuffers();
 
-    Vector<ComposerState> composerStates;
     Vector<DisplayState> displayStates;
     uint32_t flags = 0;
 
-    for (auto const& kv : mComposerStates) {
-        composerStates.add(kv.second);
-    }
-
     displayStates = std::move(mDisplayStates);
 
     if (mAnimation) {
@@ -1231,10 +1273,11 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous, bool oneWay
     sp<IBinder> applyToken = mApplyToken ? mApplyToken : getDefaultApplyToken();
 
     sp<ISurfaceComposer> sf(ComposerService::getComposerService());
-    sf->setTransactionState(mFrameTimelineInfo, composerStates, displayStates, flags, applyToken,
-                            mInputWindowCommands, mDesiredPresentTime, mIsAutoTimestamp,
-                            mUncacheBuffers, hasListenerCallbacks, listenerCallbacks, mId,
-                            mMergedTransactionIds);
+    // The states are sent from their storage, which clear() keeps for the next transaction.
+    sf->setTransactionState(mFrameTimelineInfo, mComposerStates.states(), displayStates, flags,
+                            applyToken, mInputWindowCommands, mDesiredPresentTime,
+                            mIsAutoTimestamp, mUncacheBuffers, hasListenerCallbacks,
+                            listenerCallbacks, mId, mMergedTransactionIds);
     mId = generateId();
 
     // Clear the current states and flags
@@ -1336,17 +1379,18 @@ void SurfaceComposerClient::Transaction::setEarlyWakeupEnd() {
 layer_state_t* SurfaceComposerClient::Transaction::getLayerState(const sp<SurfaceControl>& sc) {
     auto handle = sc->getLayerStateHandle();
 
-    if (mComposerStates.count(handle) == 0) {
+    ComposerState* composerState = mComposerStates.find(handle);
+    if (composerState == nullptr) {
         // we don't have it, add an initialized layer_state to our list
         ComposerState s;
 
         s.state.surface = handle;
         s.state.layerId = sc->getLayerId();
 
-        mComposerStates[handle] = s;
+        composerState = &mComposerStates.add(handle, std::move(s));
     }
 
-    return &(mComposerStates[handle].state);
+    return &composerState->state;
 }
 
 void SurfaceComposerClient::Transaction::registerSurfaceControlForCallback(
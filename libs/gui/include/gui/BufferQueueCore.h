@@ -123,6 +123,17 @@ private:
     // minimum possible without discarding data.
     void discardFreeBuffersLocked();
 
+    // signalDequeueConditionLocked wakes up the producers waiting on
+    // mDequeueCondition, if any. Broadcasting the condition makes a system
+    // call even when no thread waits, and the buffer transitions of every
+    // frame broadcast it while holding mMutex.
+    void signalDequeueConditionLocked() const;
+
+    // waitForDequeueConditionLocked waits on mDequeueCondition, for at most
+    // timeout if it is not negative. Returns false if the wait timed out.
+    bool waitForDequeueConditionLocked(std::unique_lock<std::mutex>& lock,
+                                       nsecs_t timeout) const;
+
     // If delta is positive, makes more slots available. If negative, takes
     // away slots. Returns false if the request can't be met.
     bool adjustAvailableSlotsLocked(int delta);
@@ -219,6 +230,10 @@ private:
     // synchronous mode.
     mutable std::condition_variable mDequeueCondition;
 
+    // mDequeueWaiterCount is the number of producer threads waiting on
+    // mDequeueCondition.
+    mutable int mDequeueWaiterCount;
+
     // mDequeueBufferCannotBlock indicates whether dequeueBuffer is allowed to
     // block. This flag is set during connect when both the producer and
     // consumer are controlled by the application.
@@ -49,6 +49,7 @@
 #include <utils/Vector.h>
 
 #include <optional>
+#include <span>
 #include <unordered_set>
 #include <vector>
 
@@ -112,7 +113,7 @@ public:
 
     /* open/close transactions. requires ACCESS_SURFACE_FLINGER permission */
     virtual status_t setTransactionState(
-            const FrameTimelineInfo& frameTimelineInfo, Vector<ComposerState>& state,
+            const FrameTimelineInfo& frameTimelineInfo, std::span<ComposerState> state,
             const Vector<DisplayState>& displays, uint32_t flags, const sp<IBinder>& applyToken,
             InputWindowCommands inputWindowCommands, int64_t desiredPresentTime,
             bool isAutoTimestamp, const std::vector<client_cache_t>& uncacheBuffer,
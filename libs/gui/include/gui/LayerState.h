@@ -218,6 +218,10 @@ struct layer_state_t {
         eExtendedRangeBrightnessChanged = 0x10000'00000000,
     };
 
+    // The version of the parcel format of write and read, which only holds the fields of the
+    // changes in what. Bump it whenever the fields written for a change are modified.
+    static constexpr uint32_t PARCEL_FORMAT_VERSION = 2;
+
     layer_state_t();
 
     void merge(const layer_state_t& other);
@@ -19,9 +19,12 @@
 #include <stdint.h>
 #include <sys/types.h>
 #include <set>
+#include <span>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <binder/IBinder.h>
 
@@ -418,6 +421,65 @@ public:
         std::unordered_set<sp<SurfaceControl>, SCHash> surfaceControls;
     };
 
+    // The layer states of a transaction by layer handle, in the order they were added. The states
+    // are stored in a flat layout that keeps its storage when it is cleared, so that a reused
+    // transaction does not allocate to look up, merge and apply its states.
+    class ComposerStates {
+    public:
+        // Iterates over the (handle, state) pairs, which are returned by value and refer to the
+        // stored handle and state.
+        template <typename State>
+        class Iterator {
+        public:
+            Iterator(const sp<IBinder>* handle, State* state) : mHandle(handle), mState(state) {}
+
+            std::pair<const sp<IBinder>&, State&> operator*() const { return {*mHandle, *mState}; }
+            Iterator& operator++() {
+                mHandle++;
+                mState++;
+                return *this;
+            }
+            bool operator!=(const Iterator& other) const { return mState != other.mState; }
+
+        private:
+            const sp<IBinder>* mHandle;
+            State* mState;
+        };
+
+        // Returns the state of the handle, or null if the handle has no state.
+        ComposerState* find(const sp<IBinder>& handle);
+        // Returns the state of the handle, adding it if the handle has no state.
+        ComposerState& operator[](const sp<IBinder>& handle);
+        // Adds the state of a handle that has no state. The returned state, like the ones returned
+        // by find, is valid until the next state is added.
+        ComposerState& add(const sp<IBinder>& handle, ComposerState&& state);
+        void clear();
+        void reserve(size_t size);
+
+        size_t size() const { return mStates.size(); }
+        bool empty() const { return mStates.empty(); }
+        // The states alone, contiguous and in the order they were added.
+        std::span<ComposerState> states() { return mStates; }
+
+        Iterator<ComposerState> begin() { return {mHandles.data(), mStates.data()}; }
+        Iterator<ComposerState> end() {
+            return {mHandles.data() + size(), mStates.data() + size()};
+        }
+        Iterator<const ComposerState> begin() const { return {mHandles.data(), mStates.data()}; }
+        Iterator<const ComposerState> end() const {
+            return {mHandles.data() + size(), mStates.data() + size()};
+        }
+
+    private:
+        std::vector<size_t>::iterator lowerBound(const sp<IBinder>& handle);
+
+        // The handles and their states, at the same indices.
+        std::vector<sp<IBinder>> mHandles;
+        std::vector<ComposerState> mStates;
+        // The indices of the entries, sorted by handle.
+        std::vector<size_t> mSortedIndices;
+    };
+
     struct PresentationCallbackRAII : public RefBase {
         sp<TransactionCompletedListener> mTcl;
         int mId;
@@ -433,7 +495,7 @@ public:
         static void mergeFrameTimelineInfo(FrameTimelineInfo& t, const FrameTimelineInfo& other);
 
     protected:
-        std::unordered_map<sp<IBinder>, ComposerState, IBinderHash> mComposerStates;
+        ComposerStates mComposerStates;
         SortedVector<DisplayState> mDisplayStates;
         std::unordered_map<sp<ITransactionCompletedListener>, CallbackInfo, TCLHash>
                 mListenerCallbacks;
@@ -23,6 +23,7 @@
 #include <android/gui/IDisplayEventConnection.h>
 #include <android/gui/ISurfaceComposer.h>
 #include <android/hardware/configstore/1.0/ISurfaceFlingerConfigs.h>
+#include <binder/Binder.h>
 #include <binder/ProcessState.h>
 #include <configstore/Utils.h>
 #include <gui/AidlStatusUtil.h>
@@ -42,6 +43,7 @@
 #include <utils/Errors.h>
 #include <utils/String8.h>
 
+#include <atomic>
 #include <limits>
 #include <thread>
 
@@ -635,7 +637,7 @@ public:
     }
 
     status_t setTransactionState(
-            const FrameTimelineInfo& /*frameTimelineInfo*/, Vector<ComposerState>& /*state*/,
+            const FrameTimelineInfo& /*frameTimelineInfo*/, std::span<ComposerState> /*state*/,
             const Vector<DisplayState>& /*displays*/, uint32_t /*flags*/,
             const sp<IBinder>& /*applyToken*/, InputWindowCommands /*inputWindowCommands*/,
             int64_t /*desiredPresentTime*/, bool /*isAutoTimestamp*/,
@@ -2214,4 +2216,83 @@ TEST_F(SurfaceTest, BatchIllegalOperations) {
     ASSERT_EQ(NO_ERROR, surface->disconnect(NATIVE_WINDOW_API_CPU));
 }
 
+// Hands the transactions of a BpGraphicBufferProducer to a producer in this process, the way the
+// binder driver would hand them to a remote one, and counts the round trips.
+class CountingProducerBinder : public BBinder {
+public:
+    explicit CountingProducerBinder(const sp<IGraphicBufferProducer>& producer)
+          : mProducer(IInterface::asBinder(producer)) {}
+
+    status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply,
+                        uint32_t flags) override {
+        mTransactionCount++;
+        return mProducer->transact(code, data, reply, flags);
+    }
+
+    int getTransactionCount() const { return mTransactionCount; }
+
+private:
+    const sp<IBinder> mProducer;
+    std::atomic<int> mTransactionCount = 0;
+};
+
+TEST_F(SurfaceTest, BatchOperations_OneRoundTripPerBatch) {
+    const int BUFFER_COUNT = 16;
+    const int BATCH_SIZE = 8;
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+    ASSERT_EQ(NO_ERROR, consumer->consumerConnect(sp<MockConsumer>::make(), false));
+
+    sp<CountingProducerBinder> binder = sp<CountingProducerBinder>::make(producer);
+    sp<IGraphicBufferProducer> remoteProducer = interface_cast<IGraphicBufferProducer>(binder);
+    ASSERT_NE(producer, remoteProducer);
+    sp<Surface> surface = sp<Surface>::make(remoteProducer);
+    sp<ANativeWindow> window(surface);
+    ASSERT_EQ(OK, surface->connect(NATIVE_WINDOW_API_CPU, sp<StubProducerListener>::make(),
+                                   /*reportBufferRemoval*/ false));
+    ASSERT_EQ(NO_ERROR, native_window_set_buffer_count(window.get(), BUFFER_COUNT));
+
+    auto produceFrame = [&](uint32_t size) {
+        ASSERT_EQ(NO_ERROR, native_window_set_buffers_dimensions(window.get(), size, size));
+        std::vector<Surface::BatchBuffer> buffers(BATCH_SIZE);
+        ASSERT_EQ(NO_ERROR, surface->dequeueBuffers(&buffers));
+        std::vector<Surface::BatchQueuedBuffer> queuedBuffers(BATCH_SIZE);
+        for (size_t i = 0; i < BATCH_SIZE; i++) {
+            ASSERT_EQ(static_cast<int>(size), buffers[i].buffer->width);
+            queuedBuffers[i].buffer = buffers[i].buffer;
+            queuedBuffers[i].fenceFd = buffers[i].fenceFd;
+            queuedBuffers[i].timestamp = NATIVE_WINDOW_TIMESTAMP_AUTO;
+        }
+        ASSERT_EQ(NO_ERROR, surface->queueBuffers(queuedBuffers));
+
+        for (size_t i = 0; i < BATCH_SIZE; i++) {
+            BufferItem item;
+            ASSERT_EQ(NO_ERROR, consumer->acquireBuffer(&item, 0));
+            ASSERT_EQ(NO_ERROR, consumer->releaseBuffer(item.mSlot, item.mFrameNumber,
+                                                        EGL_NO_DISPLAY, EGL_NO_SYNC_KHR,
+                                                        Fence::NO_FENCE));
+        }
+    };
+
+    // The first frame also requests the allocated buffers.
+    int transactionCount = binder->getTransactionCount();
+    ASSERT_NO_FATAL_FAILURE(produceFrame(32));
+    EXPECT_EQ(3, binder->getTransactionCount() - transactionCount);
+
+    // Once the slots hold buffers, a frame dequeues and queues them in a round trip each.
+    for (int frame = 0; frame < 3; frame++) {
+        transactionCount = binder->getTransactionCount();
+        ASSERT_NO_FATAL_FAILURE(produceFrame(32));
+        EXPECT_EQ(2, binder->getTransactionCount() - transactionCount);
+    }
+
+    // Buffers reallocated in slots that held buffers are requested again.
+    transactionCount = binder->getTransactionCount();
+    ASSERT_NO_FATAL_FAILURE(produceFrame(64));
+    EXPECT_EQ(3, binder->getTransactionCount() - transactionCount);
+
+    ASSERT_EQ(NO_ERROR, surface->disconnect(NATIVE_WINDOW_API_CPU));
+}
+
 } // namespace android
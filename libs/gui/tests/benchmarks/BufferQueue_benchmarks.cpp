@@ -0,0 +1,197 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/logging.h>
+#include <cutils/native_handle.h>
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/IConsumerListener.h>
+#include <gui/IProducerListener.h>
+#include <ui/GraphicBuffer.h>
+#include <utils/Timers.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+constexpr uint32_t WIDTH = 64;
+constexpr uint32_t HEIGHT = 64;
+constexpr PixelFormat FORMAT = PIXEL_FORMAT_RGBA_8888;
+constexpr uint64_t USAGE = GraphicBuffer::USAGE_SW_WRITE_OFTEN;
+
+// Counts the frames made available to the consumer, so that a consumer thread can wait for them.
+class FrameCounter : public BnConsumerListener {
+public:
+    void onFrameAvailable(const BufferItem& /*item*/) override {
+        std::scoped_lock lock(mLock);
+        mAvailableFrames++;
+        mCondition.notify_one();
+    }
+    void onBuffersReleased() override {}
+    void onSidebandStreamChanged() override {}
+
+    // Returns false once stop is called and no frame is left.
+    bool waitForFrame() {
+        std::unique_lock lock(mLock);
+        mCondition.wait(lock, [this] { return mAvailableFrames > 0 || mStopped; });
+        if (mAvailableFrames == 0) {
+            return false;
+        }
+        mAvailableFrames--;
+        return true;
+    }
+
+    void stop() {
+        std::scoped_lock lock(mLock);
+        mStopped = true;
+        mCondition.notify_one();
+    }
+
+private:
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    int mAvailableFrames = 0;
+    bool mStopped = false;
+};
+
+/**
+ * A BufferQueue whose slots hold buffers that wrap empty native handles, so that no frame goes
+ * through gralloc and the benchmarks measure the slot bookkeeping alone.
+ */
+class StubBufferQueue {
+public:
+    explicit StubBufferQueue(int bufferCount) : mListener(sp<FrameCounter>::make()) {
+        BufferQueue::createBufferQueue(&mProducer, &mConsumer);
+        CHECK_EQ(OK, mConsumer->consumerConnect(mListener, /*controlledByApp=*/false));
+        CHECK_EQ(OK, mConsumer->setDefaultBufferSize(WIDTH, HEIGHT));
+        CHECK_EQ(OK, mConsumer->setDefaultBufferFormat(FORMAT));
+        IGraphicBufferProducer::QueueBufferOutput output;
+        CHECK_EQ(OK,
+                 mProducer->connect(sp<StubProducerListener>::make(), NATIVE_WINDOW_API_CPU,
+                                    /*producerControlledByApp=*/false, &output));
+        CHECK_EQ(OK, mProducer->setMaxDequeuedBufferCount(bufferCount - 1));
+
+        // Attaching the buffers up front keeps dequeueBuffer from ever allocating.
+        for (int i = 0; i < bufferCount; i++) {
+            native_handle_t* handle = native_handle_create(/*numFds=*/0, /*numInts=*/0);
+            mHandles.push_back(handle);
+            sp<GraphicBuffer> buffer =
+                    sp<GraphicBuffer>::make(handle, GraphicBuffer::WRAP_HANDLE, WIDTH, HEIGHT,
+                                            FORMAT, /*layerCount=*/1, USAGE, /*stride=*/WIDTH);
+            int slot;
+            CHECK_GE(mProducer->attachBuffer(&slot, buffer), 0);
+            CHECK_EQ(OK, mProducer->cancelBuffer(slot, Fence::NO_FENCE));
+        }
+    }
+
+    ~StubBufferQueue() {
+        mProducer->disconnect(NATIVE_WINDOW_API_CPU);
+        mConsumer->consumerDisconnect();
+        // The GraphicBuffers do not own the wrapped handles.
+        mProducer.clear();
+        mConsumer.clear();
+        for (native_handle_t* handle : mHandles) {
+            native_handle_delete(handle);
+        }
+    }
+
+    void produceFrame() {
+        int slot;
+        sp<Fence> fence;
+        const status_t result = mProducer->dequeueBuffer(&slot, &fence, WIDTH, HEIGHT, FORMAT,
+                                                         USAGE, nullptr, nullptr);
+        CHECK_GE(result, 0);
+        CHECK_EQ(0, result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION);
+        // The timestamp is the time the frame is queued, from which the latency is measured.
+        IGraphicBufferProducer::QueueBufferInput input(systemTime(), /*isAutoTimestamp=*/false,
+                                                       HAL_DATASPACE_UNKNOWN,
+                                                       Rect(WIDTH, HEIGHT),
+                                                       NATIVE_WINDOW_SCALING_MODE_FREEZE,
+                                                       /*transform=*/0, Fence::NO_FENCE);
+        IGraphicBufferProducer::QueueBufferOutput output;
+        CHECK_EQ(OK, mProducer->queueBuffer(slot, input, &output));
+    }
+
+    // Returns the time the consumed frame spent in the queue.
+    nsecs_t consumeFrame() {
+        BufferItem item;
+        CHECK_EQ(OK, mConsumer->acquireBuffer(&item, /*presentWhen=*/0));
+        const nsecs_t latency = systemTime() - item.mTimestamp;
+        CHECK_GE(mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber, Fence::NO_FENCE), 0);
+        return latency;
+    }
+
+    FrameCounter& getListener() { return *mListener; }
+
+private:
+    sp<FrameCounter> mListener;
+    sp<IGraphicBufferProducer> mProducer;
+    sp<IGraphicBufferConsumer> mConsumer;
+    std::vector<native_handle_t*> mHandles;
+};
+
+/**
+ * The cost of one frame going through the queue, when the producer and the consumer share a
+ * thread and so never wait for each other.
+ */
+void BM_BufferQueue_frameCycle(benchmark::State& state) {
+    StubBufferQueue queue(/*bufferCount=*/3);
+    for (auto _ : state) {
+        queue.produceFrame();
+        benchmark::DoNotOptimize(queue.consumeFrame());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BufferQueue_frameCycle);
+
+/**
+ * The throughput of a producer that is only limited by a consumer on another thread, with the
+ * average time the frames spend queued. The argument is the number of buffers.
+ */
+void BM_BufferQueue_producerConsumer(benchmark::State& state) {
+    StubBufferQueue queue(state.range(0));
+    nsecs_t totalLatency = 0;
+    int64_t consumedFrames = 0;
+    std::thread consumer([&] {
+        while (queue.getListener().waitForFrame()) {
+            totalLatency += queue.consumeFrame();
+            consumedFrames++;
+        }
+    });
+
+    for (auto _ : state) {
+        queue.produceFrame();
+    }
+    queue.getListener().stop();
+    consumer.join();
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["latency_us"] = consumedFrames > 0
+            ? static_cast<double>(totalLatency) / 1000.0 / static_cast<double>(consumedFrames)
+            : 0.0;
+}
+BENCHMARK(BM_BufferQueue_producerConsumer)->Arg(2)->Arg(3)->Arg(4)->UseRealTime();
+
+} // namespace
+
+} // namespace android
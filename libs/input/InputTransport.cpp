@@ -11,6 +11,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <poll.h>
+#include <stddef.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -141,6 +142,12 @@ static const nsecs_t RESAMPLE_MAX_DELTA = 20 * NANOS_PER_MS;
 // far into the future.  This time is further bounded by 50% of the last time delta.
 static const nsecs_t RESAMPLE_MAX_PREDICTION = 8 * NANOS_PER_MS;
 
+// Maximum number of messages read from the socket with a single system call.
+static const size_t MAX_MESSAGES_PER_RECEIVE = 16;
+
+// Maximum number of messages written to the socket with a single system call.
+static const size_t MAX_MESSAGES_PER_SEND = 16;
+
 /**
  * System property for enabling / disabling touch resampling.
  * Resampling extrapolates / interpolates the reported touch event coordinates to better
@@ -183,6 +190,244 @@ static bool shouldResampleTool(ToolType toolType) {
     return toolType == ToolType::FINGER || toolType == ToolType::UNKNOWN;
 }
 
+static status_t sendErrorToStatus(int error) {
+    if (error == EAGAIN || error == EWOULDBLOCK) {
+        return WOULD_BLOCK;
+    }
+    if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
+        return DEAD_OBJECT;
+    }
+    return -error;
+}
+
+static status_t receiveErrorToStatus(int error) {
+    if (error == EAGAIN || error == EWOULDBLOCK) {
+        return WOULD_BLOCK;
+    }
+    if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED) {
+        return DEAD_OBJECT;
+    }
+    return -error;
+}
+
+// --- Compact motion encoding ---
+
+// MOTION messages sent with the compact encoding carry this type in their header instead of
+// InputMessage::Type::MOTION. It is outside of the range of InputMessage::Type, so that receivers
+// can tell the two encodings apart.
+static constexpr uint32_t COMPACT_MOTION_TYPE =
+        0x80000000u | static_cast<uint32_t>(InputMessage::Type::MOTION);
+
+// A receiver sends a header with this type to ask the sender to use the compact encoding for the
+// MOTION messages that follow. The sender handles it inside InputChannel, so it is never returned
+// as a message.
+static constexpr uint32_t COMPACT_MOTION_REQUEST_TYPE =
+        0x40000000u | static_cast<uint32_t>(InputMessage::Type::MOTION);
+
+// The fields of a MOTION message that come before the pointers are compared as 32 bit words
+// against the reference message, and only the words that changed are sent.
+static constexpr size_t MOTION_FIELDS_SIZE = offsetof(InputMessage::Body::Motion, pointers);
+static constexpr size_t MOTION_FIELD_WORDS = MOTION_FIELDS_SIZE / sizeof(uint32_t);
+static_assert(MOTION_FIELDS_SIZE % sizeof(uint32_t) == 0);
+static_assert(MOTION_FIELD_WORDS <= 64, "The changed motion fields must fit in a 64 bit mask");
+
+// Each pointer is sent with a mask of the axis values that follow it. This bit of the mask holds
+// isResampled instead.
+static constexpr uint32_t COMPACT_RESAMPLED_BIT = 1u << 31;
+static_assert(PointerCoords::MAX_AXES < 31);
+
+static constexpr size_t MAX_COMPACT_POINTER_SIZE = 2 * sizeof(int32_t) + sizeof(uint64_t) +
+        sizeof(uint32_t) + PointerCoords::MAX_AXES * sizeof(float);
+static constexpr size_t MAX_COMPACT_MOTION_SIZE = sizeof(InputMessage::Header) +
+        sizeof(uint32_t) + sizeof(uint64_t) + MOTION_FIELDS_SIZE +
+        MAX_POINTERS * MAX_COMPACT_POINTER_SIZE;
+static_assert(MAX_COMPACT_MOTION_SIZE <= sizeof(InputMessage),
+              "Compact messages must fit in the buffers they are received in");
+
+namespace {
+
+class CompactWriter {
+public:
+    explicit CompactWriter(uint8_t* data) : mData(data) {}
+
+    template <typename T>
+    void write(const T& value) {
+        memcpy(mData + mSize, &value, sizeof(T));
+        mSize += sizeof(T);
+    }
+
+    size_t size() const { return mSize; }
+
+private:
+    uint8_t* const mData;
+    size_t mSize = 0;
+};
+
+class CompactReader {
+public:
+    CompactReader(const uint8_t* data, size_t size) : mData(data), mSize(size) {}
+
+    template <typename T>
+    bool read(T* outValue) {
+        if (mSize - mOffset < sizeof(T)) {
+            return false;
+        }
+        memcpy(outValue, mData + mOffset, sizeof(T));
+        mOffset += sizeof(T);
+        return true;
+    }
+
+    bool atEnd() const { return mOffset == mSize; }
+
+private:
+    const uint8_t* const mData;
+    const size_t mSize;
+    size_t mOffset = 0;
+};
+
+bool hasReferencePointer(const InputMessage& reference, size_t index, uint64_t bits) {
+    return index < reference.body.motion.pointerCount &&
+            reference.body.motion.pointers[index].coords.bits == bits;
+}
+
+/**
+ * Encodes the sanitized MOTION message |msg| against |reference|, the previous message encoded on
+ * the channel. Returns the number of bytes written to |out|, at most MAX_COMPACT_MOTION_SIZE.
+ */
+size_t encodeCompactMotion(const InputMessage& msg, const InputMessage& reference, uint8_t* out) {
+    CompactWriter writer(out);
+    writer.write(COMPACT_MOTION_TYPE);
+    writer.write(msg.header.seq);
+    writer.write(reference.header.seq);
+
+    const uint8_t* fields = reinterpret_cast<const uint8_t*>(&msg.body.motion);
+    const uint8_t* referenceFields = reinterpret_cast<const uint8_t*>(&reference.body.motion);
+    uint64_t changedWords = 0;
+    for (size_t i = 0; i < MOTION_FIELD_WORDS; i++) {
+        const size_t offset = i * sizeof(uint32_t);
+        if (memcmp(fields + offset, referenceFields + offset, sizeof(uint32_t)) != 0) {
+            changedWords |= uint64_t(1) << i;
+        }
+    }
+    writer.write(changedWords);
+    for (size_t i = 0; i < MOTION_FIELD_WORDS; i++) {
+        if (changedWords & (uint64_t(1) << i)) {
+            uint32_t word;
+            memcpy(&word, fields + i * sizeof(uint32_t), sizeof(uint32_t));
+            writer.write(word);
+        }
+    }
+
+    for (size_t i = 0; i < msg.body.motion.pointerCount; i++) {
+        const InputMessage::Body::Motion::Pointer& pointer = msg.body.motion.pointers[i];
+        writer.write(pointer.properties.id);
+        writer.write(static_cast<int32_t>(pointer.properties.toolType));
+        writer.write(pointer.coords.bits);
+
+        const uint32_t valueCount = BitSet64::count(pointer.coords.bits);
+        const bool hasReference = hasReferencePointer(reference, i, pointer.coords.bits);
+        uint32_t sentValues = 0;
+        for (uint32_t j = 0; j < valueCount; j++) {
+            if (!hasReference ||
+                memcmp(&pointer.coords.values[j],
+                       &reference.body.motion.pointers[i].coords.values[j], sizeof(float)) != 0) {
+                sentValues |= 1u << j;
+            }
+        }
+        writer.write(sentValues | (pointer.coords.isResampled ? COMPACT_RESAMPLED_BIT : 0));
+        for (uint32_t j = 0; j < valueCount; j++) {
+            if (sentValues & (1u << j)) {
+                writer.write(pointer.coords.values[j]);
+            }
+        }
+    }
+    return writer.size();
+}
+
+/**
+ * Decodes the |size| bytes of a compact MOTION message in |data| against |reference|, the previous
+ * compact message received on the channel. Returns false if the message is malformed, or if it was
+ * encoded against another reference.
+ */
+bool decodeCompactMotion(const uint8_t* data, size_t size, const InputMessage& reference,
+                         InputMessage* outMsg) {
+    CompactReader reader(data, size);
+    uint32_t type;
+    uint32_t seq;
+    uint32_t referenceSeq;
+    uint64_t changedWords;
+    if (!reader.read(&type) || !reader.read(&seq) || !reader.read(&referenceSeq) ||
+        !reader.read(&changedWords)) {
+        return false;
+    }
+    if (referenceSeq != reference.header.seq) {
+        ALOGE("Received compact MOTION encoded against seq=%" PRIu32 ", expected seq=%" PRIu32,
+              referenceSeq, reference.header.seq);
+        return false;
+    }
+    if ((changedWords >> MOTION_FIELD_WORDS) != 0) {
+        return false;
+    }
+
+    outMsg->header.type = InputMessage::Type::MOTION;
+    outMsg->header.seq = seq;
+    uint8_t* fields = reinterpret_cast<uint8_t*>(&outMsg->body.motion);
+    const uint8_t* referenceFields = reinterpret_cast<const uint8_t*>(&reference.body.motion);
+    for (size_t i = 0; i < MOTION_FIELD_WORDS; i++) {
+        const size_t offset = i * sizeof(uint32_t);
+        uint32_t word;
+        if (changedWords & (uint64_t(1) << i)) {
+            if (!reader.read(&word)) {
+                return false;
+            }
+        } else {
+            memcpy(&word, referenceFields + offset, sizeof(uint32_t));
+        }
+        memcpy(fields + offset, &word, sizeof(uint32_t));
+    }
+
+    const uint32_t pointerCount = outMsg->body.motion.pointerCount;
+    if (pointerCount == 0 || pointerCount > MAX_POINTERS) {
+        return false;
+    }
+    memset(&outMsg->body.motion.pointers[0], 0,
+           pointerCount * sizeof(InputMessage::Body::Motion::Pointer));
+    for (size_t i = 0; i < pointerCount; i++) {
+        InputMessage::Body::Motion::Pointer& pointer = outMsg->body.motion.pointers[i];
+        int32_t toolType;
+        uint32_t sentValues;
+        if (!reader.read(&pointer.properties.id) || !reader.read(&toolType) ||
+            !reader.read(&pointer.coords.bits) || !reader.read(&sentValues)) {
+            return false;
+        }
+        pointer.properties.toolType = static_cast<ToolType>(toolType);
+        pointer.coords.isResampled = (sentValues & COMPACT_RESAMPLED_BIT) != 0;
+        sentValues &= ~COMPACT_RESAMPLED_BIT;
+
+        const uint32_t valueCount = BitSet64::count(pointer.coords.bits);
+        if (valueCount > PointerCoords::MAX_AXES) {
+            return false;
+        }
+        const uint32_t allValues = (1u << valueCount) - 1;
+        const bool hasReference = hasReferencePointer(reference, i, pointer.coords.bits);
+        if ((sentValues & ~allValues) != 0 || (!hasReference && sentValues != allValues)) {
+            return false;
+        }
+        for (uint32_t j = 0; j < valueCount; j++) {
+            if (sentValues & (1u << j)) {
+                if (!reader.read(&pointer.coords.values[j])) {
+                    return false;
+                }
+            } else {
+                pointer.coords.values[j] = reference.body.motion.pointers[i].coords.values[j];
+            }
+        }
+    }
+    return reader.atEnd();
+}
+
+} // namespace
+
 // --- InputMessage ---
 
 bool InputMessage::isValid(size_t actualSize) const {
@@ -465,25 +710,27 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
                    StringPrintf("sendMessage(inputChannel=%s, seq=0x%" PRIx32 ", type=0x%" PRIx32
                                 ")",
                                 name.c_str(), msg->header.seq, msg->header.type));
-    const size_t msgLength = msg->size();
     InputMessage cleanMsg;
     msg->getSanitizedCopy(&cleanMsg);
+    const void* data = &cleanMsg;
+    size_t msgLength = msg->size();
+    InputMessage compactMsg;
+    const bool compact = shouldUseCompactEncoding(cleanMsg);
+    if (compact) {
+        msgLength = encodeCompactMotion(cleanMsg, mSendReference,
+                                        reinterpret_cast<uint8_t*>(&compactMsg));
+        data = &compactMsg;
+    }
     ssize_t nWrite;
     do {
-        nWrite = ::send(getFd(), &cleanMsg, msgLength, MSG_DONTWAIT | MSG_NOSIGNAL);
+        nWrite = ::send(getFd(), data, msgLength, MSG_DONTWAIT | MSG_NOSIGNAL);
     } while (nWrite == -1 && errno == EINTR);
 
     if (nWrite < 0) {
         int error = errno;
         ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ error sending message of type %s, %s",
                  name.c_str(), ftl::enum_string(msg->header.type).c_str(), strerror(error));
-        if (error == EAGAIN || error == EWOULDBLOCK) {
-            return WOULD_BLOCK;
-        }
-        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
-            return DEAD_OBJECT;
-        }
-        return -error;
+        return sendErrorToStatus(error);
     }
 
     if (size_t(nWrite) != msgLength) {
@@ -493,6 +740,10 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
         return DEAD_OBJECT;
     }
 
+    if (compact) {
+        memcpy(&mSendReference, &cleanMsg, cleanMsg.size());
+    }
+
     ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ sent message of type %s", name.c_str(),
              ftl::enum_string(msg->header.type).c_str());
 
@@ -500,22 +751,20 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
 }
 
 status_t InputChannel::receiveMessage(InputMessage* msg) {
+    if (mPendingReceiveError != OK) {
+        return std::exchange(mPendingReceiveError, OK);
+    }
     ssize_t nRead;
     do {
         nRead = ::recv(getFd(), msg, sizeof(InputMessage), MSG_DONTWAIT);
-    } while (nRead == -1 && errno == EINTR);
+    } while ((nRead == -1 && errno == EINTR) ||
+             (nRead > 0 && handleCompactMotionRequest(*msg, nRead)));
 
     if (nRead < 0) {
         int error = errno;
         ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ receive message failed, errno=%d",
                  name.c_str(), errno);
-        if (error == EAGAIN || error == EWOULDBLOCK) {
-            return WOULD_BLOCK;
-        }
-        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED) {
-            return DEAD_OBJECT;
-        }
-        return -error;
+        return receiveErrorToStatus(error);
     }
 
     if (nRead == 0) { // check for EOF
@@ -524,9 +773,8 @@ status_t InputChannel::receiveMessage(InputMessage* msg) {
         return DEAD_OBJECT;
     }
 
-    if (!msg->isValid(nRead)) {
-        ALOGE("channel '%s' ~ received invalid message of size %zd", name.c_str(), nRead);
-        return BAD_VALUE;
+    if (status_t status = decodeMessage(msg, nRead); status != OK) {
+        return status;
     }
 
     ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ received message of type %s", name.c_str(),
@@ -541,6 +789,238 @@ status_t InputChannel::receiveMessage(InputMessage* msg) {
     return OK;
 }
 
+status_t InputChannel::sendMessages(const InputMessage* msgs, size_t count,
+                                    size_t* outSentCount) {
+    ATRACE_NAME_IF(ATRACE_ENABLED(),
+                   StringPrintf("sendMessages(inputChannel=%s, count=%zu)", name.c_str(), count));
+    *outSentCount = 0;
+    status_t status = OK;
+    while (status == OK && *outSentCount < count) {
+        const size_t chunkSize = std::min(count - *outSentCount, MAX_MESSAGES_PER_SEND);
+        status = sendMessageChunk(msgs + *outSentCount, chunkSize, outSentCount);
+    }
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES && status == OK, "channel '%s' ~ sent %zu messages",
+             name.c_str(), count);
+    return status;
+}
+
+status_t InputChannel::sendMessageChunk(const InputMessage* msgs, size_t count,
+                                        size_t* outSentCount) {
+    // The scratch buffers only grow, so they stop allocating once they reach the chunk size.
+    if (mSendCleanMessages.size() < count) {
+        mSendCleanMessages.resize(count);
+    }
+    if (mCompactMotionEncoding && mSendCompactMessages.size() < count) {
+        mSendCompactMessages.resize(count);
+    }
+    std::array<iovec, MAX_MESSAGES_PER_SEND> iovs;
+    std::array<mmsghdr, MAX_MESSAGES_PER_SEND> headers;
+    // Each compact message is encoded against the previous one in the chunk.
+    const InputMessage* reference = &mSendReference;
+    for (size_t i = 0; i < count; i++) {
+        InputMessage& cleanMsg = mSendCleanMessages[i];
+        msgs[i].getSanitizedCopy(&cleanMsg);
+        iovs[i].iov_base = &cleanMsg;
+        iovs[i].iov_len = msgs[i].size();
+        if (shouldUseCompactEncoding(cleanMsg)) {
+            iovs[i].iov_base = &mSendCompactMessages[i];
+            iovs[i].iov_len =
+                    encodeCompactMotion(cleanMsg, *reference,
+                                        reinterpret_cast<uint8_t*>(&mSendCompactMessages[i]));
+            reference = &cleanMsg;
+        }
+        headers[i].msg_hdr = {};
+        headers[i].msg_hdr.msg_iov = &iovs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // sendmmsg stops at the first message that cannot be sent, and reports the error on the next
+    // call if no message could be sent at all.
+    status_t status = OK;
+    size_t sentCount = 0;
+    while (status == OK && sentCount < count) {
+        int nSent;
+        do {
+            nSent = ::sendmmsg(getFd(), &headers[sentCount], count - sentCount,
+                               MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (nSent == -1 && errno == EINTR);
+
+        if (nSent < 0) {
+            int error = errno;
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                     "channel '%s' ~ error sending message of type %s, %s, after sending %zu "
+                     "messages",
+                     name.c_str(), ftl::enum_string(msgs[sentCount].header.type).c_str(),
+                     strerror(error), *outSentCount + sentCount);
+            status = sendErrorToStatus(error);
+            break;
+        }
+
+        for (int i = 0; i < nSent; i++) {
+            if (headers[sentCount].msg_len != iovs[sentCount].iov_len) {
+                ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                         "channel '%s' ~ error sending message type %s, send was incomplete",
+                         name.c_str(), ftl::enum_string(msgs[sentCount].header.type).c_str());
+                status = DEAD_OBJECT;
+                break;
+            }
+            sentCount++;
+        }
+    }
+
+    // The next compact message is encoded against the last one that was actually sent.
+    for (size_t i = sentCount; i > 0; i--) {
+        if (iovs[i - 1].iov_base != &mSendCleanMessages[i - 1]) {
+            memcpy(&mSendReference, &mSendCleanMessages[i - 1], mSendCleanMessages[i - 1].size());
+            break;
+        }
+    }
+    *outSentCount += sentCount;
+    return status;
+}
+
+status_t InputChannel::receiveMessages(InputMessage* msgs, size_t capacity, size_t* outCount) {
+    *outCount = 0;
+    if (mPendingReceiveError != OK) {
+        return std::exchange(mPendingReceiveError, OK);
+    }
+    const size_t maxCount = std::min(capacity, MAX_MESSAGES_PER_RECEIVE);
+    std::array<iovec, MAX_MESSAGES_PER_RECEIVE> iovs;
+    std::array<mmsghdr, MAX_MESSAGES_PER_RECEIVE> headers;
+    for (size_t i = 0; i < maxCount; i++) {
+        iovs[i].iov_base = &msgs[i];
+        iovs[i].iov_len = sizeof(InputMessage);
+        headers[i].msg_hdr = {};
+        headers[i].msg_hdr.msg_iov = &iovs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int nRead;
+    do {
+        nRead = ::recvmmsg(getFd(), headers.data(), maxCount, MSG_DONTWAIT, /*timeout=*/nullptr);
+    } while (nRead == -1 && errno == EINTR);
+
+    if (nRead < 0) {
+        int error = errno;
+        ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ receive messages failed, errno=%d",
+                 name.c_str(), errno);
+        return receiveErrorToStatus(error);
+    }
+
+    bool peerClosed = nRead == 0;
+    for (int i = 0; i < nRead; i++) {
+        const size_t length = headers[i].msg_len;
+        if (length == 0) {
+            // The peer was closed. Return the messages that were received before that.
+            peerClosed = true;
+            break;
+        }
+        if (handleCompactMotionRequest(msgs[i], length)) {
+            continue;
+        }
+        if (status_t status = decodeMessage(&msgs[i], length); status != OK) {
+            if (*outCount == 0) {
+                return status;
+            }
+            // Deliver the valid messages that came before, and report the error on the next call.
+            mPendingReceiveError = status;
+            break;
+        }
+        if (*outCount != size_t(i)) {
+            msgs[*outCount] = msgs[i];
+        }
+        (*outCount)++;
+    }
+
+    if (*outCount == 0 && !peerClosed && mPendingReceiveError == OK) {
+        // Only requests were received, look for messages after them.
+        return receiveMessages(msgs, capacity, outCount);
+    }
+    if (*outCount == 0) {
+        ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                 "channel '%s' ~ receive messages failed because peer was closed", name.c_str());
+        return DEAD_OBJECT;
+    }
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ received %zu messages", name.c_str(),
+             *outCount);
+    if (ATRACE_ENABLED()) {
+        std::string message = StringPrintf("receiveMessages(inputChannel=%s, count=%zu)",
+                                           name.c_str(), *outCount);
+        ATRACE_NAME(message.c_str());
+    }
+    return OK;
+}
+
+void InputChannel::setCompactMotionEncodingAllowed(bool allowed) {
+    mCompactMotionEncodingAllowed = allowed;
+    if (!allowed) {
+        mCompactMotionEncoding = false;
+    }
+}
+
+status_t InputChannel::requestCompactMotionEncoding() {
+    const uint32_t request[] = {COMPACT_MOTION_REQUEST_TYPE, /*seq=*/0};
+    static_assert(sizeof(request) == sizeof(InputMessage::Header));
+    ssize_t nWrite;
+    do {
+        nWrite = ::send(getFd(), request, sizeof(request), MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (nWrite == -1 && errno == EINTR);
+
+    if (nWrite < 0) {
+        int error = errno;
+        ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ error requesting compact encoding, %s",
+                 name.c_str(), strerror(error));
+        return sendErrorToStatus(error);
+    }
+    if (size_t(nWrite) != sizeof(request)) {
+        return DEAD_OBJECT;
+    }
+    // The sender encodes the first compact message after the request against an empty reference.
+    mReceiveReference = {};
+    return OK;
+}
+
+bool InputChannel::handleCompactMotionRequest(const InputMessage& msg, size_t length) {
+    if (static_cast<uint32_t>(msg.header.type) != COMPACT_MOTION_REQUEST_TYPE ||
+        length != sizeof(InputMessage::Header)) {
+        return false;
+    }
+    // The receiver starts over from an empty reference, whatever it was sent before.
+    mCompactMotionEncoding = mCompactMotionEncodingAllowed;
+    mSendReference = {};
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ compact encoding requested, %s", name.c_str(),
+             mCompactMotionEncoding ? "enabled" : "not allowed");
+    return true;
+}
+
+bool InputChannel::shouldUseCompactEncoding(const InputMessage& msg) const {
+    return mCompactMotionEncoding && msg.header.type == InputMessage::Type::MOTION &&
+            msg.body.motion.pointerCount > 0 && msg.body.motion.pointerCount <= MAX_POINTERS;
+}
+
+status_t InputChannel::decodeMessage(InputMessage* msg, size_t length) {
+    if (static_cast<uint32_t>(msg->header.type) == COMPACT_MOTION_TYPE) {
+        // Decoding writes to the buffer the message was received in.
+        std::array<uint8_t, sizeof(InputMessage)> data;
+        memcpy(data.data(), msg, length);
+        if (!decodeCompactMotion(data.data(), length, mReceiveReference, msg)) {
+            ALOGE("channel '%s' ~ received invalid compact message of size %zu", name.c_str(),
+                  length);
+            return BAD_VALUE;
+        }
+        memcpy(&mReceiveReference, msg, msg->size());
+        return OK;
+    }
+
+    if (!msg->isValid(length)) {
+        ALOGE("channel '%s' ~ received invalid message of size %zu", name.c_str(), length);
+        return BAD_VALUE;
+    }
+    return OK;
+}
+
 bool InputChannel::probablyHasInput() const {
     struct pollfd pfds = {.fd = fd.get(), .events = POLLIN};
     if (::poll(&pfds, /*nfds=*/1, /*timeout=*/0) <= 0) {
@@ -642,7 +1122,7 @@ status_t InputPublisher::publishKeyEvent(uint32_t seq, int32_t eventId, int32_t
     msg.body.key.repeatCount = repeatCount;
     msg.body.key.downTime = downTime;
     msg.body.key.eventTime = eventTime;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishMotionEvent(
@@ -732,7 +1212,7 @@ status_t InputPublisher::publishMotionEvent(
         msg.body.motion.pointers[i].coords = pointerCoords[i];
     }
 
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool hasFocus) {
@@ -747,7 +1227,7 @@ status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool h
     msg.header.seq = seq;
     msg.body.focus.eventId = eventId;
     msg.body.focus.hasFocus = hasFocus;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishCaptureEvent(uint32_t seq, int32_t eventId,
@@ -764,7 +1244,7 @@ status_t InputPublisher::publishCaptureEvent(uint32_t seq, int32_t eventId,
     msg.header.seq = seq;
     msg.body.capture.eventId = eventId;
     msg.body.capture.pointerCaptureEnabled = pointerCaptureEnabled;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishDragEvent(uint32_t seq, int32_t eventId, float x, float y,
@@ -783,7 +1263,7 @@ status_t InputPublisher::publishDragEvent(uint32_t seq, int32_t eventId, float x
     msg.body.drag.isExiting = isExiting;
     msg.body.drag.x = x;
     msg.body.drag.y = y;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bool isInTouchMode) {
@@ -799,6 +1279,29 @@ status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bo
     msg.header.seq = seq;
     msg.body.touchMode.eventId = eventId;
     msg.body.touchMode.isInTouchMode = isInTouchMode;
+    return sendMessage(msg);
+}
+
+void InputPublisher::beginBatch() {
+    LOG_ALWAYS_FATAL_IF(mBatching, "channel '%s' publisher ~ batch already started",
+                        mChannel->getName().c_str());
+    mBatching = true;
+}
+
+status_t InputPublisher::endBatch(size_t* outPublishedCount) {
+    LOG_ALWAYS_FATAL_IF(!mBatching, "channel '%s' publisher ~ no batch to end",
+                        mChannel->getName().c_str());
+    mBatching = false;
+    status_t result = mChannel->sendMessages(mBatch.data(), mBatch.size(), outPublishedCount);
+    mBatch.clear();
+    return result;
+}
+
+status_t InputPublisher::sendMessage(const InputMessage& msg) {
+    if (mBatching) {
+        mBatch.push_back(msg);
+        return OK;
+    }
     return mChannel->sendMessage(&msg);
 }
 
@@ -845,7 +1348,17 @@ InputConsumer::InputConsumer(const std::shared_ptr<InputChannel>& channel)
 
 InputConsumer::InputConsumer(const std::shared_ptr<InputChannel>& channel,
                              bool enableTouchResampling)
-      : mResampleTouch(enableTouchResampling), mChannel(channel), mMsgDeferred(false) {}
+      : mResampleTouch(enableTouchResampling), mChannel(channel), mMsgDeferred(false) {
+    if (input_flags::compact_input_message_encoding()) {
+        // This consumer reads every message of the channel from now on, so it can decode the
+        // compact messages, which are encoded against each other.
+        if (status_t status = mChannel->requestCompactMotionEncoding(); status != OK) {
+            ALOGD_IF(DEBUG_TRANSPORT_CONSUMER,
+                     "channel '%s' consumer ~ could not request compact encoding, status=%s",
+                     mChannel->getName().c_str(), statusToString(status).c_str());
+        }
+    }
+}
 
 InputConsumer::~InputConsumer() {
 }
@@ -872,7 +1385,7 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
             mMsgDeferred = false;
         } else {
             // Receive a fresh message.
-            status_t result = mChannel->receiveMessage(&mMsg);
+            status_t result = receiveMessage(&mMsg);
             if (result == OK) {
                 const auto [_, inserted] =
                         mConsumeTimes.emplace(mMsg.header.seq, systemTime(SYSTEM_TIME_MONOTONIC));
@@ -1027,6 +1540,25 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
     return OK;
 }
 
+status_t InputConsumer::receiveMessage(InputMessage* msg) {
+    if (mNextReceivedMessage == mReceivedMessageCount) {
+        // Read all the messages that are already in the channel with a single system call, as
+        // high rate devices tend to produce several samples between two calls to consume.
+        mReceivedMessages.resize(MAX_MESSAGES_PER_RECEIVE);
+        mNextReceivedMessage = 0;
+        mReceivedMessageCount = 0;
+        status_t result = mChannel->receiveMessages(mReceivedMessages.data(),
+                                                    mReceivedMessages.size(),
+                                                    &mReceivedMessageCount);
+        if (result != OK) {
+            mReceivedMessageCount = 0;
+            return result;
+        }
+    }
+    *msg = mReceivedMessages[mNextReceivedMessage++];
+    return OK;
+}
+
 status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
         nsecs_t frameTime, uint32_t* outSeq, InputEvent** outEvent) {
     status_t result;
@@ -1354,13 +1886,26 @@ status_t InputConsumer::sendFinishedSignal(uint32_t seq, bool handled) {
                  mSeqChains.erase(mSeqChains.begin() + i);
              }
         }
-        status_t status = OK;
-        while (!status && chainIndex > 0) {
-            chainIndex--;
-            status = sendUnchainedFinishedSignal(chainSeqs[chainIndex], handled);
-        }
-        if (status) {
+        if (chainIndex > 0) {
+            // Send the signals for the chain, and then for the last message in the batch, with a
+            // single system call.
+            const size_t chainLength = chainIndex;
+            std::vector<InputMessage> msgs(chainLength + 1);
+            for (size_t i = 0; i < chainLength; i++) {
+                msgs[i] = createFinishedMessage(chainSeqs[chainLength - 1 - i], handled);
+            }
+            msgs[chainLength] = createFinishedMessage(seq, handled);
+            size_t sentCount = 0;
+            status_t status = mChannel->sendMessages(msgs.data(), msgs.size(), &sentCount);
+            for (size_t i = 0; i < sentCount; i++) {
+                onFinishedSignalSent(msgs[i].header.seq);
+            }
+            if (status == OK || sentCount >= chainLength) {
+                return status;
+            }
+
             // An error occurred so at least one signal was not sent, reconstruct the chain.
+            chainIndex = chainLength - 1 - sentCount;
             for (;;) {
                 SeqChain seqChain;
                 seqChain.seq = chainIndex != 0 ? chainSeqs[chainIndex - 1] : seq;
@@ -1407,21 +1952,30 @@ void InputConsumer::popConsumeTime(uint32_t seq) {
     mConsumeTimes.erase(seq);
 }
 
-status_t InputConsumer::sendUnchainedFinishedSignal(uint32_t seq, bool handled) {
+InputMessage InputConsumer::createFinishedMessage(uint32_t seq, bool handled) const {
     InputMessage msg;
     msg.header.type = InputMessage::Type::FINISHED;
     msg.header.seq = seq;
     msg.body.finished.handled = handled;
     msg.body.finished.consumeTime = getConsumeTime(seq);
+    return msg;
+}
+
+void InputConsumer::onFinishedSignalSent(uint32_t seq) {
+    // Remove the consume time once the socket write succeeded. We will not need to ack this
+    // message anymore. If the socket write did not succeed, we will try again and will still
+    // need consume time.
+    popConsumeTime(seq);
+
+    // Trace the event processing timeline - event was just finished
+    ATRACE_ASYNC_END("InputConsumer processing", /*cookie=*/seq);
+}
+
+status_t InputConsumer::sendUnchainedFinishedSignal(uint32_t seq, bool handled) {
+    const InputMessage msg = createFinishedMessage(seq, handled);
     status_t result = mChannel->sendMessage(&msg);
     if (result == OK) {
-        // Remove the consume time if the socket write succeeded. We will not need to ack this
-        // message anymore. If the socket write did not succeed, we will try again and will still
-        // need consume time.
-        popConsumeTime(seq);
-
-        // Trace the event processing timeline - event was just finished
-        ATRACE_ASYNC_END("InputConsumer processing", /*cookie=*/seq);
+        onFinishedSignalSent(seq);
     }
     return result;
 }
@@ -1441,7 +1995,8 @@ int32_t InputConsumer::getPendingBatchSource() const {
 }
 
 bool InputConsumer::probablyHasInput() const {
-    return hasPendingBatch() || mChannel->probablyHasInput();
+    return hasPendingBatch() || mNextReceivedMessage < mReceivedMessageCount ||
+            mChannel->probablyHasInput();
 }
 
 ssize_t InputConsumer::findBatch(int32_t deviceId, int32_t source) const {
@@ -1561,6 +2116,8 @@ std::string InputConsumer::dump() const {
     if (mMsgDeferred) {
         out = out + "mMsg : " + ftl::enum_string(mMsg.header.type) + "\n";
     }
+    out += android::base::StringPrintf("Received messages not yet handled: %zu\n",
+                                       mReceivedMessageCount - mNextReceivedMessage);
     out += "Batches:\n";
     for (const Batch& batch : mBatches) {
         out += "    Batch:\n";
@@ -26,6 +26,7 @@
 #include <attestation/HmacKeyManager.h>
 #include <input/InputEventLabels.h>
 #include <input/KeyCharacterMap.h>
+#include <input/KeyMapCache.h>
 #include <input/Keyboard.h>
 
 #include <gui/constants.h>
@@ -130,6 +131,89 @@ base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::loadContents(
     return Errorf("Load KeyCharacterMap failed {}.", status);
 }
 
+base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::loadCompiled(
+        const std::string& filename, std::span<const int32_t> words) {
+    std::shared_ptr<KeyCharacterMap> map =
+            std::shared_ptr<KeyCharacterMap>(new KeyCharacterMap(filename));
+    KeyMapCache::Reader reader(words);
+    const auto readKeys = [&reader, &map]() {
+        int32_t type;
+        int32_t numKeys;
+        if (!reader.read(type) || !reader.read(numKeys) || numKeys > MAX_KEYS) {
+            return false;
+        }
+        map->mType = static_cast<KeyboardType>(type);
+        for (int32_t i = 0; i < numKeys; i++) {
+            int32_t keyCode;
+            int32_t label;
+            int32_t number;
+            int32_t numBehaviors;
+            if (!reader.read(keyCode) || !reader.read(label) || !reader.read(number) ||
+                !reader.read(numBehaviors)) {
+                return false;
+            }
+            Key key{.label = static_cast<char16_t>(label), .number = static_cast<char16_t>(number)};
+            for (int32_t j = 0; j < numBehaviors; j++) {
+                Behavior behavior;
+                int32_t character;
+                if (!reader.read(behavior.metaState) || !reader.read(character) ||
+                    !reader.read(behavior.fallbackKeyCode) ||
+                    !reader.read(behavior.replacementKeyCode)) {
+                    return false;
+                }
+                behavior.character = static_cast<char16_t>(character);
+                key.behaviors.push_back(behavior);
+            }
+            map->mKeys.emplace(keyCode, std::move(key));
+        }
+        return true;
+    };
+    const auto readKeyCodes = [&reader](std::map<int32_t, int32_t>& keyCodes) {
+        int32_t count;
+        if (!reader.read(count)) {
+            return false;
+        }
+        for (int32_t i = 0; i < count; i++) {
+            int32_t code;
+            int32_t keyCode;
+            if (!reader.read(code) || !reader.read(keyCode)) {
+                return false;
+            }
+            keyCodes.emplace(code, keyCode);
+        }
+        return true;
+    };
+
+    if (!readKeys() || !readKeyCodes(map->mKeysByScanCode) ||
+        !readKeyCodes(map->mKeysByUsageCode) || !reader.isAtEnd()) {
+        ALOGE("Compiled key character map for %s is malformed.", filename.c_str());
+        return Errorf("Compiled key character map for {} is malformed.", filename);
+    }
+    return map;
+}
+
+void KeyCharacterMap::writeCompiled(std::vector<int32_t>& out) const {
+    // Only what the parser produces is compiled. Key remappings and overlays are applied at
+    // runtime, on top of the loaded map.
+    out.push_back(static_cast<int32_t>(mType));
+    out.push_back(mKeys.size());
+    for (const auto& [keyCode, key] : mKeys) {
+        out.insert(out.end(),
+                   {keyCode, key.label, key.number, static_cast<int32_t>(key.behaviors.size())});
+        for (const Behavior& behavior : key.behaviors) {
+            out.insert(out.end(),
+                       {behavior.metaState, behavior.character, behavior.fallbackKeyCode,
+                        behavior.replacementKeyCode});
+        }
+    }
+    for (const auto* keyCodes : {&mKeysByScanCode, &mKeysByUsageCode}) {
+        out.push_back(keyCodes->size());
+        for (const auto& [code, keyCode] : *keyCodes) {
+            out.insert(out.end(), {code, keyCode});
+        }
+    }
+}
+
 status_t KeyCharacterMap::load(Tokenizer* tokenizer, Format format) {
     status_t status = OK;
 #if DEBUG_PARSER_PERFORMANCE
@@ -21,6 +21,7 @@
 #include <ftl/enum.h>
 #include <input/InputEventLabels.h>
 #include <input/KeyLayoutMap.h>
+#include <input/KeyMapCache.h>
 #include <input/Keyboard.h>
 #include <log/log.h>
 #include <utils/Errors.h>
@@ -30,6 +31,7 @@
 #include <vintf/KernelConfigs.h>
 #endif
 
+#include <algorithm>
 #include <cstdlib>
 #include <string_view>
 #include <unordered_map>
@@ -153,14 +155,18 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string
     if (!ret.ok()) {
         return ret;
     }
-    const std::shared_ptr<KeyLayoutMap>& map = *ret;
+    return finishLoading(*ret, filename);
+}
+
+base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::finishLoading(
+        std::shared_ptr<KeyLayoutMap> map, const std::string& filename) {
     LOG_ALWAYS_FATAL_IF(map == nullptr, "Returned map should not be null if there's no error");
     if (!kernelConfigsArePresent(map->mRequiredKernelConfigs)) {
         ALOGI("Not loading %s because the required kernel configs are not set", filename.c_str());
         return Errorf("Missing kernel config");
     }
     map->mLoadFileName = filename;
-    return ret;
+    return map;
 }
 
 base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(Tokenizer* tokenizer) {
@@ -188,6 +194,142 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(Tokenizer* tokeni
     return Errorf("Load KeyLayoutMap failed {}.", status);
 }
 
+base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::loadCompiled(
+        const std::string& filename, std::span<const int32_t> words) {
+    std::shared_ptr<KeyLayoutMap> map = std::shared_ptr<KeyLayoutMap>(new KeyLayoutMap());
+    KeyMapCache::Reader reader(words);
+    const auto readKeys = [&reader](std::unordered_map<int32_t, Key>& keys) {
+        int32_t count;
+        if (!reader.read(count)) {
+            return false;
+        }
+        for (int32_t i = 0; i < count; i++) {
+            int32_t code;
+            int32_t keyCode;
+            int32_t flags;
+            if (!reader.read(code) || !reader.read(keyCode) || !reader.read(flags)) {
+                return false;
+            }
+            keys.emplace(code, Key{.keyCode = keyCode, .flags = static_cast<uint32_t>(flags)});
+        }
+        return true;
+    };
+    const auto readLeds = [&reader](std::unordered_map<int32_t, Led>& leds) {
+        int32_t count;
+        if (!reader.read(count)) {
+            return false;
+        }
+        for (int32_t i = 0; i < count; i++) {
+            int32_t code;
+            int32_t ledCode;
+            if (!reader.read(code) || !reader.read(ledCode)) {
+                return false;
+            }
+            leds.emplace(code, Led{.ledCode = ledCode});
+        }
+        return true;
+    };
+    const auto readAxes = [&reader](std::unordered_map<int32_t, AxisInfo>& axes) {
+        int32_t count;
+        if (!reader.read(count)) {
+            return false;
+        }
+        for (int32_t i = 0; i < count; i++) {
+            int32_t scanCode;
+            int32_t mode;
+            AxisInfo axis;
+            if (!reader.read(scanCode) || !reader.read(mode) || !reader.read(axis.axis) ||
+                !reader.read(axis.highAxis) || !reader.read(axis.splitValue) ||
+                !reader.read(axis.flatOverride)) {
+                return false;
+            }
+            if (mode < AxisInfo::MODE_NORMAL || mode > AxisInfo::MODE_SPLIT) {
+                return false;
+            }
+            axis.mode = static_cast<AxisInfo::Mode>(mode);
+            axes.emplace(scanCode, axis);
+        }
+        return true;
+    };
+    const auto readSensors = [&reader](std::unordered_map<int32_t, Sensor>& sensors) {
+        int32_t count;
+        if (!reader.read(count)) {
+            return false;
+        }
+        for (int32_t i = 0; i < count; i++) {
+            int32_t absCode;
+            int32_t sensorType;
+            int32_t sensorDataIndex;
+            if (!reader.read(absCode) || !reader.read(sensorType) ||
+                !reader.read(sensorDataIndex)) {
+                return false;
+            }
+            const Sensor sensor{.sensorType = static_cast<InputDeviceSensorType>(sensorType),
+                                .sensorDataIndex = sensorDataIndex};
+            if (std::none_of(SENSOR_LIST.begin(), SENSOR_LIST.end(), [&sensor](const auto& pair) {
+                    return pair.second == sensor.sensorType;
+                })) {
+                return false;
+            }
+            sensors.emplace(absCode, sensor);
+        }
+        return true;
+    };
+    const auto readKernelConfigs = [&reader](std::set<std::string>& configs) {
+        int32_t count;
+        if (!reader.read(count)) {
+            return false;
+        }
+        for (int32_t i = 0; i < count; i++) {
+            std::string config;
+            if (!reader.readString(config)) {
+                return false;
+            }
+            configs.insert(std::move(config));
+        }
+        return true;
+    };
+
+    if (!readKeys(map->mKeysByScanCode) || !readKeys(map->mKeysByUsageCode) ||
+        !readAxes(map->mAxes) || !readLeds(map->mLedsByScanCode) ||
+        !readLeds(map->mLedsByUsageCode) || !readSensors(map->mSensorsByAbsCode) ||
+        !readKernelConfigs(map->mRequiredKernelConfigs) || !reader.isAtEnd()) {
+        ALOGE("Compiled key layout map for %s is malformed.", filename.c_str());
+        return Errorf("Compiled key layout map for {} is malformed.", filename);
+    }
+    return finishLoading(std::move(map), filename);
+}
+
+void KeyLayoutMap::writeCompiled(std::vector<int32_t>& out) const {
+    for (const auto* keys : {&mKeysByScanCode, &mKeysByUsageCode}) {
+        out.push_back(keys->size());
+        for (const auto& [code, key] : *keys) {
+            out.insert(out.end(), {code, key.keyCode, static_cast<int32_t>(key.flags)});
+        }
+    }
+    out.push_back(mAxes.size());
+    for (const auto& [scanCode, axis] : mAxes) {
+        out.insert(out.end(),
+                   {scanCode, static_cast<int32_t>(axis.mode), axis.axis, axis.highAxis,
+                    axis.splitValue, axis.flatOverride});
+    }
+    for (const auto* leds : {&mLedsByScanCode, &mLedsByUsageCode}) {
+        out.push_back(leds->size());
+        for (const auto& [code, led] : *leds) {
+            out.insert(out.end(), {code, led.ledCode});
+        }
+    }
+    out.push_back(mSensorsByAbsCode.size());
+    for (const auto& [absCode, sensor] : mSensorsByAbsCode) {
+        out.insert(out.end(),
+                   {absCode, static_cast<int32_t>(sensor.sensorType), sensor.sensorDataIndex});
+    }
+    out.push_back(mRequiredKernelConfigs.size());
+    for (const std::string& config : mRequiredKernelConfigs) {
+        KeyMapCache::writeString(config, out);
+    }
+}
+
 status_t KeyLayoutMap::mapKey(int32_t scanCode, int32_t usageCode,
         int32_t* outKeyCode, uint32_t* outFlags) const {
     const Key* key = getKey(scanCode, usageCode);
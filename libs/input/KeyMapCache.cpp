@@ -0,0 +1,257 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "KeyMapCache"
+
+#include <input/KeyMapCache.h>
+
+#include <android-base/file.h>
+#include <android-base/properties.h>
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <input/KeyCharacterMap.h>
+#include <input/KeyLayoutMap.h>
+#include <log/log.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cinttypes>
+#include <cstring>
+
+using android::base::StringPrintf;
+
+namespace android {
+
+namespace {
+
+constexpr uint32_t ENTRY_MAGIC = 0x434d4b49; // 'IKMC'
+
+// Header at the start of every entry file. It is followed by numWords 32-bit words.
+struct EntryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t kind;
+    uint32_t numWords;
+    uint64_t pathHash;
+    uint64_t sourceSize;
+    int64_t sourceModificationTimeNs;
+    uint64_t sourceInode;
+    // Hash of the contents of the text file the entry was compiled from.
+    uint64_t sourceHash;
+    // Hash of the fingerprint of the build that compiled the entry.
+    uint64_t buildHash;
+    uint64_t checksum;
+};
+static_assert(sizeof(EntryHeader) % alignof(int32_t) == 0);
+
+// FNV-1a, which is stable across builds unlike std::hash.
+uint64_t hashBytes(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3;
+    }
+    return hash;
+}
+
+uint64_t hashBuildFingerprint() {
+    const std::string fingerprint = base::GetProperty("ro.build.fingerprint", "");
+    return hashBytes(fingerprint.data(), fingerprint.size());
+}
+
+} // namespace
+
+// --- KeyMapCache::Reader ---
+
+bool KeyMapCache::Reader::read(int32_t& outValue) {
+    if (mPosition == mWords.size()) {
+        return false;
+    }
+    outValue = mWords[mPosition++];
+    return true;
+}
+
+bool KeyMapCache::Reader::readString(std::string& outValue) {
+    int32_t length;
+    if (!read(length) || length < 0) {
+        return false;
+    }
+    const size_t numWords = (static_cast<size_t>(length) + sizeof(int32_t) - 1) / sizeof(int32_t);
+    if (numWords > mWords.size() - mPosition) {
+        return false;
+    }
+    outValue.assign(reinterpret_cast<const char*>(mWords.data() + mPosition), length);
+    mPosition += numWords;
+    return true;
+}
+
+// --- KeyMapCache ---
+
+void KeyMapCache::writeString(const std::string& value, std::vector<int32_t>& out) {
+    out.push_back(value.size());
+    const size_t position = out.size();
+    out.resize(position + (value.size() + sizeof(int32_t) - 1) / sizeof(int32_t));
+    memcpy(out.data() + position, value.data(), value.size());
+}
+
+KeyMapCache::KeyMapCache(std::string directory)
+      : mDirectory(std::move(directory)), mBuildHash(hashBuildFingerprint()) {}
+
+template <typename T, typename LoadCompiled, typename LoadText>
+base::Result<std::shared_ptr<T>> KeyMapCache::load(const std::string& filename, Kind kind,
+                                                   LoadCompiled loadCompiled, LoadText loadText) {
+    // The source is examined before the text file is read, so that an entry compiled from a file
+    // that changed in the meantime does not match the new file.
+    const std::optional<Source> source = examineSource(filename);
+    if (source) {
+        std::span<const int32_t> words;
+        std::unique_ptr<base::MappedFile> entry = mapEntry(filename, *source, kind, words);
+        if (entry != nullptr) {
+            base::Result<std::shared_ptr<T>> ret = loadCompiled(filename, words);
+            if (ret.ok()) {
+                mHits++;
+                return ret;
+            }
+        }
+    }
+
+    mMisses++;
+    base::Result<std::shared_ptr<T>> ret = loadText(filename);
+    if (ret.ok() && source) {
+        std::vector<int32_t> words;
+        (*ret)->writeCompiled(words);
+        if (!writeEntry(filename, *source, kind, words)) {
+            mWriteFailures++;
+        }
+    }
+    return ret;
+}
+
+base::Result<std::shared_ptr<KeyLayoutMap>> KeyMapCache::loadKeyLayout(
+        const std::string& filename) {
+    return load<KeyLayoutMap>(filename, Kind::KEY_LAYOUT, &KeyLayoutMap::loadCompiled,
+                              [](const std::string& path) {
+                                  return KeyLayoutMap::load(path);
+                              });
+}
+
+base::Result<std::shared_ptr<KeyCharacterMap>> KeyMapCache::loadKeyCharacterMap(
+        const std::string& filename) {
+    return load<KeyCharacterMap>(filename, Kind::KEY_CHARACTER_MAP,
+                                 &KeyCharacterMap::loadCompiled,
+                                 [](const std::string& path) {
+                                     return KeyCharacterMap::load(path,
+                                                                  KeyCharacterMap::Format::BASE);
+                                 });
+}
+
+KeyMapCache::Stats KeyMapCache::getStats() const {
+    return {.hits = mHits, .misses = mMisses, .writeFailures = mWriteFailures};
+}
+
+std::optional<KeyMapCache::Source> KeyMapCache::examineSource(const std::string& filename) {
+    struct stat st;
+    std::string contents;
+    if (stat(filename.c_str(), &st) != 0 || !base::ReadFileToString(filename, &contents)) {
+        return std::nullopt;
+    }
+    // Hashing the contents is much cheaper than parsing them, and catches the edits that keep the
+    // size and modification time of the file.
+    return Source{.size = static_cast<uint64_t>(st.st_size),
+                  .modificationTimeNs =
+                          static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL +
+                          st.st_mtim.tv_nsec,
+                  .inode = static_cast<uint64_t>(st.st_ino),
+                  .contentHash = hashBytes(contents.data(), contents.size())};
+}
+
+std::string KeyMapCache::getEntryPath(const std::string& filename, Kind kind) const {
+    return StringPrintf("%s/%016" PRIx64 ".%s", mDirectory.c_str(),
+                        hashBytes(filename.data(), filename.size()),
+                        kind == Kind::KEY_LAYOUT ? "klc" : "kcmc");
+}
+
+std::unique_ptr<base::MappedFile> KeyMapCache::mapEntry(const std::string& filename,
+                                                        const Source& source, Kind kind,
+                                                        std::span<const int32_t>& outWords) const {
+    base::unique_fd fd(open(getEntryPath(filename, kind).c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(EntryHeader)) {
+        return nullptr;
+    }
+    std::unique_ptr<base::MappedFile> entry =
+            base::MappedFile::FromFd(fd, /*offset=*/0, st.st_size, PROT_READ);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+
+    EntryHeader header;
+    memcpy(&header, entry->data(), sizeof(header));
+    const size_t numWords = (entry->size() - sizeof(EntryHeader)) / sizeof(int32_t);
+    if (header.magic != ENTRY_MAGIC || header.version != VERSION ||
+        header.kind != static_cast<uint32_t>(kind) || header.numWords != numWords ||
+        header.pathHash != hashBytes(filename.data(), filename.size()) ||
+        header.sourceSize != source.size ||
+        header.sourceModificationTimeNs != source.modificationTimeNs ||
+        header.sourceInode != source.inode || header.sourceHash != source.contentHash ||
+        header.buildHash != mBuildHash) {
+        return nullptr;
+    }
+    const char* data = entry->data() + sizeof(EntryHeader);
+    if (header.checksum != hashBytes(data, numWords * sizeof(int32_t))) {
+        ALOGW("Ignoring corrupt key map cache entry for %s.", filename.c_str());
+        return nullptr;
+    }
+    outWords = std::span<const int32_t>(reinterpret_cast<const int32_t*>(data), numWords);
+    return entry;
+}
+
+bool KeyMapCache::writeEntry(const std::string& filename, const Source& source, Kind kind,
+                             const std::vector<int32_t>& words) const {
+    const std::string path = getEntryPath(filename, kind);
+    std::string temporaryPath = path + ".XXXXXX";
+    base::unique_fd fd(mkostemp(temporaryPath.data(), O_CLOEXEC));
+    if (fd < 0) {
+        ALOGW("Could not create key map cache entry %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    const EntryHeader header{
+            .magic = ENTRY_MAGIC,
+            .version = VERSION,
+            .kind = static_cast<uint32_t>(kind),
+            .numWords = static_cast<uint32_t>(words.size()),
+            .pathHash = hashBytes(filename.data(), filename.size()),
+            .sourceSize = source.size,
+            .sourceModificationTimeNs = source.modificationTimeNs,
+            .sourceInode = source.inode,
+            .sourceHash = source.contentHash,
+            .buildHash = mBuildHash,
+            .checksum = hashBytes(words.data(), words.size() * sizeof(int32_t)),
+    };
+    if (!base::WriteFully(fd, &header, sizeof(header)) ||
+        !base::WriteFully(fd, words.data(), words.size() * sizeof(int32_t)) ||
+        rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        ALOGW("Could not write key map cache entry %s: %s", path.c_str(), strerror(errno));
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace android
@@ -25,6 +25,7 @@
 #include <input/InputEventLabels.h>
 #include <input/KeyCharacterMap.h>
 #include <input/KeyLayoutMap.h>
+#include <input/KeyMapCache.h>
 #include <input/Keyboard.h>
 #include <log/log.h>
 #include <utils/Errors.h>
@@ -47,13 +48,13 @@ KeyMap::~KeyMap() {
 }
 
 status_t KeyMap::load(const InputDeviceIdentifier& deviceIdentifier,
-        const PropertyMap* deviceConfiguration) {
+        const PropertyMap* deviceConfiguration, KeyMapCache* cache) {
     // Use the configured key layout if available.
     if (deviceConfiguration) {
         std::optional<std::string> keyLayoutName =
                 deviceConfiguration->getString("keyboard.layout");
         if (keyLayoutName.has_value()) {
-            status_t status = loadKeyLayout(deviceIdentifier, *keyLayoutName);
+            status_t status = loadKeyLayout(deviceIdentifier, *keyLayoutName, cache);
             if (status == NAME_NOT_FOUND) {
                 ALOGE("Configuration for keyboard device '%s' requested keyboard layout '%s' but "
                       "it was not found.",
@@ -64,7 +65,7 @@ status_t KeyMap::load(const InputDeviceIdentifier& deviceIdentifier,
         std::optional<std::string> keyCharacterMapName =
                 deviceConfiguration->getString("keyboard.characterMap");
         if (keyCharacterMapName.has_value()) {
-            status_t status = loadKeyCharacterMap(deviceIdentifier, *keyCharacterMapName);
+            status_t status = loadKeyCharacterMap(deviceIdentifier, *keyCharacterMapName, cache);
             if (status == NAME_NOT_FOUND) {
                 ALOGE("Configuration for keyboard device '%s' requested keyboard character "
                       "map '%s' but it was not found.",
@@ -78,19 +79,19 @@ status_t KeyMap::load(const InputDeviceIdentifier& deviceIdentifier,
     }
 
     // Try searching by device identifier.
-    if (probeKeyMap(deviceIdentifier, "")) {
+    if (probeKeyMap(deviceIdentifier, "", cache)) {
         return OK;
     }
 
     // Fall back on the Generic key map.
     // TODO Apply some additional heuristics here to figure out what kind of
     //      generic key map to use (US English, etc.) for typical external keyboards.
-    if (probeKeyMap(deviceIdentifier, "Generic")) {
+    if (probeKeyMap(deviceIdentifier, "Generic", cache)) {
         return OK;
     }
 
     // Try the Virtual key map as a last resort.
-    if (probeKeyMap(deviceIdentifier, "Virtual")) {
+    if (probeKeyMap(deviceIdentifier, "Virtual", cache)) {
         return OK;
     }
 
@@ -101,24 +102,27 @@ status_t KeyMap::load(const InputDeviceIdentifier& deviceIdentifier,
 }
 
 bool KeyMap::probeKeyMap(const InputDeviceIdentifier& deviceIdentifier,
-        const std::string& keyMapName) {
+        const std::string& keyMapName, KeyMapCache* cache) {
     if (!haveKeyLayout()) {
-        loadKeyLayout(deviceIdentifier, keyMapName);
+        loadKeyLayout(deviceIdentifier, keyMapName, cache);
     }
     if (!haveKeyCharacterMap()) {
-        loadKeyCharacterMap(deviceIdentifier, keyMapName);
+        loadKeyCharacterMap(deviceIdentifier, keyMapName, cache);
     }
     return isComplete();
 }
 
 status_t KeyMap::loadKeyLayout(const InputDeviceIdentifier& deviceIdentifier,
-        const std::string& name) {
+        const std::string& name, KeyMapCache* cache) {
     std::string path(getPath(deviceIdentifier, name, InputDeviceConfigurationFileType::KEY_LAYOUT));
     if (path.empty()) {
         return NAME_NOT_FOUND;
     }
 
-    base::Result<std::shared_ptr<KeyLayoutMap>> ret = KeyLayoutMap::load(path);
+    const auto loadKeyLayoutMap = [cache](const std::string& filename) {
+        return cache != nullptr ? cache->loadKeyLayout(filename) : KeyLayoutMap::load(filename);
+    };
+    base::Result<std::shared_ptr<KeyLayoutMap>> ret = loadKeyLayoutMap(path);
     if (ret.ok()) {
         keyLayoutMap = *ret;
         keyLayoutFile = path;
@@ -132,7 +136,7 @@ status_t KeyMap::loadKeyLayout(const InputDeviceIdentifier& deviceIdentifier,
                                                                   InputDeviceConfigurationFileType::
                                                                           KEY_LAYOUT,
                                                                   "_fallback"));
-    ret = KeyLayoutMap::load(fallbackPath);
+    ret = loadKeyLayoutMap(fallbackPath);
     if (!ret.ok()) {
         return ret.error().code();
     }
@@ -142,15 +146,16 @@ status_t KeyMap::loadKeyLayout(const InputDeviceIdentifier& deviceIdentifier,
 }
 
 status_t KeyMap::loadKeyCharacterMap(const InputDeviceIdentifier& deviceIdentifier,
-        const std::string& name) {
+        const std::string& name, KeyMapCache* cache) {
     std::string path =
             getPath(deviceIdentifier, name, InputDeviceConfigurationFileType::KEY_CHARACTER_MAP);
     if (path.empty()) {
         return NAME_NOT_FOUND;
     }
 
-    base::Result<std::shared_ptr<KeyCharacterMap>> ret =
-            KeyCharacterMap::load(path, KeyCharacterMap::Format::BASE);
+    base::Result<std::shared_ptr<KeyCharacterMap>> ret = cache != nullptr
+            ? cache->loadKeyCharacterMap(path)
+            : KeyCharacterMap::load(path, KeyCharacterMap::Format::BASE);
     if (!ret.ok()) {
         return ret.error().code();
     }
@@ -21,6 +21,7 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <math.h>
+#include <algorithm>
 #include <array>
 #include <optional>
 
@@ -76,6 +77,11 @@ static const std::set<int32_t> PLANAR_AXES = {AMOTION_EVENT_AXIS_X, AMOTION_EVEN
 // Axes whose motion values are differential values (i.e. deltas).
 static const std::set<int32_t> DIFFERENTIAL_AXES = {AMOTION_EVENT_AXIS_SCROLL};
 
+// Number of pointers whose velocities are computed together by the batched solvers. The samples
+// of a batch are laid out with the pointers as the innermost dimension, so each pointer is a lane
+// of loops that the compiler can vectorize without reordering any of the floating point sums.
+static constexpr size_t BATCH_SIZE = 4;
+
 // Threshold for determining that a pointer has stopped moving.
 // Some input devices do not send ACTION_MOVE events in the case where a pointer has
 // stopped.  We need to detect this case so that we can accurately predict the
@@ -368,11 +374,13 @@ std::optional<float> VelocityTracker::getVelocity(int32_t axis, int32_t pointerI
 VelocityTracker::ComputedVelocity VelocityTracker::getComputedVelocity(int32_t units,
                                                                        float maxVelocity) {
     ComputedVelocity computedVelocity;
-    for (const auto& [axis, _] : mConfiguredStrategies) {
+    VelocityTrackerStrategy::PointerVelocities velocities;
+    for (const auto& [axis, strategy] : mConfiguredStrategies) {
+        strategy->getVelocities(mCurrentPointerIdBits, velocities);
         BitSet32 copyIdBits = BitSet32(mCurrentPointerIdBits);
         while (!copyIdBits.isEmpty()) {
             uint32_t id = copyIdBits.clearFirstMarkedBit();
-            std::optional<float> velocity = getVelocity(axis, id);
+            const std::optional<float>& velocity = velocities[id];
             if (velocity) {
                 float adjustedVelocity =
                         std::clamp(*velocity * units / 1000, -maxVelocity, maxVelocity);
@@ -383,21 +391,54 @@ VelocityTracker::ComputedVelocity VelocityTracker::getComputedVelocity(int32_t u
     return computedVelocity;
 }
 
+// --- VelocityTrackerStrategy ---
+
+void VelocityTrackerStrategy::getVelocities(BitSet32 pointerIdBits,
+                                            PointerVelocities& outVelocities) const {
+    while (!pointerIdBits.isEmpty()) {
+        const uint32_t id = pointerIdBits.clearFirstMarkedBit();
+        outVelocities[id] = getVelocity(id);
+    }
+}
+
+// --- AccumulatingVelocityTrackerStrategy ---
+
 AccumulatingVelocityTrackerStrategy::AccumulatingVelocityTrackerStrategy(
         nsecs_t horizonNanos, bool maintainHorizonDuringAdd)
       : mHorizonNanos(horizonNanos), mMaintainHorizonDuringAdd(maintainHorizonDuringAdd) {}
 
+void AccumulatingVelocityTrackerStrategy::Movements::pushBack(nsecs_t eventTime, float position) {
+    const uint32_t index = (start + size) % HISTORY_SIZE;
+    eventTimes[index] = eventTime;
+    positions[index] = position;
+    if (size < HISTORY_SIZE) {
+        size++;
+    } else {
+        // Overwrote the oldest movement.
+        start = (start + 1) % HISTORY_SIZE;
+    }
+}
+
+const AccumulatingVelocityTrackerStrategy::Movements*
+AccumulatingVelocityTrackerStrategy::getMovements(int32_t pointerId) const {
+    return mPointerIdBits.hasBit(pointerId) ? &mMovements[pointerId] : nullptr;
+}
+
 void AccumulatingVelocityTrackerStrategy::clearPointer(int32_t pointerId) {
-    mMovements.erase(pointerId);
+    mPointerIdBits.clearBit(pointerId);
 }
 
 void AccumulatingVelocityTrackerStrategy::addMovement(nsecs_t eventTime, int32_t pointerId,
                                                       float position) {
-    auto [ringBufferIt, _] = mMovements.try_emplace(pointerId, HISTORY_SIZE);
-    RingBuffer<Movement>& movements = ringBufferIt->second;
-    const size_t size = movements.size();
+    Movements& movements = mMovements[pointerId];
+    if (!mPointerIdBits.hasBit(pointerId)) {
+        movements.start = 0;
+        movements.size = 0;
+        mPointerIdBits.markBit(pointerId);
+    }
+    const size_t size = movements.size;
 
-    if (size != 0 && movements[size - 1].eventTime == eventTime) {
+    if (size != 0 && movements.getEventTime(size - 1) == eventTime) {
         // When ACTION_POINTER_DOWN happens, we will first receive ACTION_MOVE with the coordinates
         // of the existing pointers, and then ACTION_POINTER_DOWN with the coordinates that include
         // the new pointer. If the eventtimes for both events are identical, just update the data
@@ -407,13 +448,13 @@ void AccumulatingVelocityTrackerStrategy::addMovement(nsecs_t eventTime, int32_t
         movements.popBack();
     }
 
-    movements.pushBack({eventTime, position});
+    movements.pushBack(eventTime, position);
 
     // Clear movements that do not fall within `mHorizonNanos` of the latest movement.
     // Note that, if in the future we decide to use more movements (i.e. increase HISTORY_SIZE),
     // we can consider making this step binary-search based, which will give us some improvement.
     if (mMaintainHorizonDuringAdd) {
-        while (eventTime - movements[0].eventTime > mHorizonNanos) {
+        while (eventTime - movements.getEventTime(0) > mHorizonNanos) {
             movements.popFront();
         }
     }
@@ -600,59 +641,77 @@ static std::optional<float> solveLeastSquares(const std::vector<float>& x,
  * Optimized unweighted second-order least squares fit. About 2x speed improvement compared to
  * the default implementation
  */
-std::optional<float> LeastSquaresVelocityTrackerStrategy::solveUnweightedLeastSquaresDeg2(
-        const RingBuffer<Movement>& movements) const {
-    // Solving y = a*x^2 + b*x + c, where
+void LeastSquaresVelocityTrackerStrategy::solveUnweightedLeastSquaresDeg2(
+        const int32_t* pointerIds, size_t count, PointerVelocities& outVelocities) const {
+    // Solving y = a*x^2 + b*x + c for each pointer, where
     //      - "x" is age (i.e. duration since latest movement) of the movemnets
     //      - "y" is positions of the movements.
-    float sxi = 0, sxiyi = 0, syi = 0, sxi2 = 0, sxi3 = 0, sxi2yi = 0, sxi4 = 0;
-
-    const size_t count = movements.size();
-    const Movement& newestMovement = movements[count - 1];
-    for (size_t i = 0; i < count; i++) {
-        const Movement& movement = movements[i];
-        nsecs_t age = newestMovement.eventTime - movement.eventTime;
-        float xi = -age * SECONDS_PER_NANO;
-        float yi = movement.position;
-
-        float xi2 = xi*xi;
-        float xi3 = xi2*xi;
-        float xi4 = xi3*xi;
-        float xiyi = xi*yi;
-        float xi2yi = xi2*yi;
-
-        sxi += xi;
-        sxi2 += xi2;
-        sxiyi += xiyi;
-        sxi2yi += xi2yi;
-        syi += yi;
-        sxi3 += xi3;
-        sxi4 += xi4;
+    // Pointers with fewer movements are padded with zeros, which do not change their sums.
+    float x[HISTORY_SIZE][BATCH_SIZE] = {};
+    float y[HISTORY_SIZE][BATCH_SIZE] = {};
+    float n[BATCH_SIZE] = {};
+    uint32_t maxSize = 0;
+    for (size_t p = 0; p < count; p++) {
+        const Movements& movements = mMovements[pointerIds[p]];
+        const nsecs_t newestEventTime = movements.getEventTime(movements.size - 1);
+        for (uint32_t i = 0; i < movements.size; i++) {
+            nsecs_t age = newestEventTime - movements.getEventTime(i);
+            x[i][p] = -age * SECONDS_PER_NANO;
+            y[i][p] = movements.getPosition(i);
+        }
+        n[p] = movements.size;
+        maxSize = std::max(maxSize, movements.size);
     }
 
-    float Sxx = sxi2 - sxi*sxi / count;
-    float Sxy = sxiyi - sxi*syi / count;
-    float Sxx2 = sxi3 - sxi*sxi2 / count;
-    float Sx2y = sxi2yi - sxi2*syi / count;
-    float Sx2x2 = sxi4 - sxi2*sxi2 / count;
-
-    float denominator = Sxx*Sx2x2 - Sxx2*Sxx2;
-    if (denominator == 0) {
-        ALOGW("division by 0 when computing velocity, Sxx=%f, Sx2x2=%f, Sxx2=%f", Sxx, Sx2x2, Sxx2);
-        return std::nullopt;
+    float sxi[BATCH_SIZE] = {}, sxiyi[BATCH_SIZE] = {}, syi[BATCH_SIZE] = {},
+          sxi2[BATCH_SIZE] = {}, sxi3[BATCH_SIZE] = {}, sxi2yi[BATCH_SIZE] = {},
+          sxi4[BATCH_SIZE] = {};
+    for (uint32_t i = 0; i < maxSize; i++) {
+        for (size_t p = 0; p < BATCH_SIZE; p++) {
+            float xi = x[i][p];
+            float yi = y[i][p];
+
+            float xi2 = xi*xi;
+            float xi3 = xi2*xi;
+            float xi4 = xi3*xi;
+            float xiyi = xi*yi;
+            float xi2yi = xi2*yi;
+
+            sxi[p] += xi;
+            sxi2[p] += xi2;
+            sxiyi[p] += xiyi;
+            sxi2yi[p] += xi2yi;
+            syi[p] += yi;
+            sxi3[p] += xi3;
+            sxi4[p] += xi4;
+        }
     }
 
-    return (Sxy * Sx2x2 - Sx2y * Sxx2) / denominator;
+    for (size_t p = 0; p < count; p++) {
+        float Sxx = sxi2[p] - sxi[p]*sxi[p] / n[p];
+        float Sxy = sxiyi[p] - sxi[p]*syi[p] / n[p];
+        float Sxx2 = sxi3[p] - sxi[p]*sxi2[p] / n[p];
+        float Sx2y = sxi2yi[p] - sxi2[p]*syi[p] / n[p];
+        float Sx2x2 = sxi4[p] - sxi2[p]*sxi2[p] / n[p];
+
+        float denominator = Sxx*Sx2x2 - Sxx2*Sxx2;
+        if (denominator == 0) {
+            ALOGW("division by 0 when computing velocity, Sxx=%f, Sx2x2=%f, Sxx2=%f", Sxx, Sx2x2,
+                  Sxx2);
+            outVelocities[pointerIds[p]] = std::nullopt;
+            continue;
+        }
+        outVelocities[pointerIds[p]] = (Sxy * Sx2x2 - Sx2y * Sxx2) / denominator;
+    }
 }
 
 std::optional<float> LeastSquaresVelocityTrackerStrategy::getVelocity(int32_t pointerId) const {
-    const auto movementIt = mMovements.find(pointerId);
-    if (movementIt == mMovements.end()) {
+    const Movements* movements = getMovements(pointerId);
+    if (movements == nullptr) {
         return std::nullopt; // no data
     }
 
-    const RingBuffer<Movement>& movements = movementIt->second;
-    const size_t size = movements.size();
+    const size_t size = movements->size;
     if (size == 0) {
         return std::nullopt; // no data
     }
@@ -668,7 +727,9 @@ std::optional<float> LeastSquaresVelocityTrackerStrategy::getVelocity(int32_t po
 
     if (degree == 2 && mWeighting == Weighting::NONE) {
         // Optimize unweighted, quadratic polynomial fit
-        return solveUnweightedLeastSquaresDeg2(movements);
+        PointerVelocities velocities;
+        solveUnweightedLeastSquaresDeg2(&pointerId, /*count=*/1, velocities);
+        return velocities[pointerId];
     }
 
     // Iterate over movement samples in reverse time order and collect samples.
@@ -676,11 +737,10 @@ std::optional<float> LeastSquaresVelocityTrackerStrategy::getVelocity(int32_t po
     std::vector<float> w;
     std::vector<float> time;
 
-    const Movement& newestMovement = movements[size - 1];
+    const nsecs_t newestEventTime = movements->getEventTime(size - 1);
     for (ssize_t i = size - 1; i >= 0; i--) {
-        const Movement& movement = movements[i];
-        nsecs_t age = newestMovement.eventTime - movement.eventTime;
-        positions.push_back(movement.position);
+        nsecs_t age = newestEventTime - movements->getEventTime(i);
+        positions.push_back(movements->getPosition(i));
         w.push_back(chooseWeight(pointerId, i));
         time.push_back(-age * 0.000000001f);
     }
@@ -689,9 +749,37 @@ std::optional<float> LeastSquaresVelocityTrackerStrategy::getVelocity(int32_t po
     return solveLeastSquares(time, positions, w, degree + 1);
 }
 
+void LeastSquaresVelocityTrackerStrategy::getVelocities(BitSet32 pointerIdBits,
+                                                        PointerVelocities& outVelocities) const {
+    if (mDegree != 2 || mWeighting != Weighting::NONE) {
+        VelocityTrackerStrategy::getVelocities(pointerIdBits, outVelocities);
+        return;
+    }
+
+    // Pointers with less than 3 movements are fitted with a lower degree, one at a time.
+    std::array<int32_t, BATCH_SIZE> batch;
+    size_t batchSize = 0;
+    while (!pointerIdBits.isEmpty()) {
+        const int32_t id = pointerIdBits.clearFirstMarkedBit();
+        const Movements* movements = getMovements(id);
+        if (movements == nullptr || movements->size < 3) {
+            outVelocities[id] = getVelocity(id);
+            continue;
+        }
+        batch[batchSize++] = id;
+        if (batchSize == BATCH_SIZE) {
+            solveUnweightedLeastSquaresDeg2(batch.data(), batchSize, outVelocities);
+            batchSize = 0;
+        }
+    }
+    if (batchSize > 0) {
+        solveUnweightedLeastSquaresDeg2(batch.data(), batchSize, outVelocities);
+    }
+}
+
 float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint32_t index) const {
-    const RingBuffer<Movement>& movements = mMovements.at(pointerId);
-    const size_t size = movements.size();
+    const Movements& movements = mMovements[pointerId];
+    const size_t size = movements.size;
     switch (mWeighting) {
         case Weighting::DELTA: {
             // Weight points based on how much time elapsed between them and the next
@@ -702,7 +790,8 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint3
                 return 1.0f;
             }
             float deltaMillis =
-                    (movements[index + 1].eventTime - movements[index].eventTime) * 0.000001f;
+                    (movements.getEventTime(index + 1) - movements.getEventTime(index)) *
+                    0.000001f;
             if (deltaMillis < 0) {
                 return 0.5f;
             }
@@ -719,7 +808,7 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint3
             //   age 50ms: 1.0
             //   age 60ms: 0.5
             float ageMillis =
-                    (movements[size - 1].eventTime - movements[index].eventTime) * 0.000001f;
+                    (movements.getEventTime(size - 1) - movements.getEventTime(index)) * 0.000001f;
             if (ageMillis < 0) {
                 return 0.5f;
             }
@@ -741,7 +830,7 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint3
             //   age  50ms: 1.0
             //   age 100ms: 0.5
             float ageMillis =
-                    (movements[size - 1].eventTime - movements[index].eventTime) * 0.000001f;
+                    (movements.getEventTime(size - 1) - movements.getEventTime(index)) * 0.000001f;
             if (ageMillis < 50) {
                 return 1.0f;
             }
@@ -843,25 +932,21 @@ LegacyVelocityTrackerStrategy::~LegacyVelocityTrackerStrategy() {
 }
 
 std::optional<float> LegacyVelocityTrackerStrategy::getVelocity(int32_t pointerId) const {
-    const auto movementIt = mMovements.find(pointerId);
-    if (movementIt == mMovements.end()) {
+    const Movements* movements = getMovements(pointerId);
+    if (movements == nullptr) {
         return std::nullopt; // no data
     }
 
-    const RingBuffer<Movement>& movements = movementIt->second;
-    const size_t size = movements.size();
+    const size_t size = movements->size;
     if (size == 0) {
         return std::nullopt; // no data
     }
 
-    const Movement& newestMovement = movements[size - 1];
-
     // Find the oldest sample that contains the pointer and that is not older than HORIZON.
-    nsecs_t minTime = newestMovement.eventTime - HORIZON;
+    nsecs_t minTime = movements->getEventTime(size - 1) - HORIZON;
     uint32_t oldestIndex = size - 1;
     for (ssize_t i = size - 1; i >= 0; i--) {
-        const Movement& nextOldestMovement = movements[i];
-        if (nextOldestMovement.eventTime < minTime) {
+        if (movements->getEventTime(i) < minTime) {
             break;
         }
         oldestIndex = i;
@@ -880,19 +965,18 @@ std::optional<float> LegacyVelocityTrackerStrategy::getVelocity(int32_t pointerI
     // the hardware or driver reports them irregularly or in bursts.
     float accumV = 0;
     uint32_t samplesUsed = 0;
-    const Movement& oldestMovement = movements[oldestIndex];
-    float oldestPosition = oldestMovement.position;
+    const nsecs_t oldestEventTime = movements->getEventTime(oldestIndex);
+    float oldestPosition = movements->getPosition(oldestIndex);
     nsecs_t lastDuration = 0;
 
     for (size_t i = oldestIndex; i < size; i++) {
-        const Movement& movement = movements[i];
-        nsecs_t duration = movement.eventTime - oldestMovement.eventTime;
+        nsecs_t duration = movements->getEventTime(i) - oldestEventTime;
 
         // If the duration between samples is small, we may significantly overestimate
         // the velocity.  Consequently, we impose a minimum duration constraint on the
         // samples that we include in the calculation.
         if (duration >= MIN_DURATION) {
-            float position = movement.position;
+            float position = movements->getPosition(i);
             float scale = 1000000000.0f / duration; // one over time delta in seconds
             float v = (position - oldestPosition) * scale;
             accumV = (accumV * lastDuration + v * duration) / (duration + lastDuration);
@@ -991,35 +1075,63 @@ static float kineticEnergyToVelocity(float work) {
     return (work < 0 ? -1.0 : 1.0) * sqrtf(fabsf(work)) * sqrt2;
 }
 
-std::optional<float> ImpulseVelocityTrackerStrategy::getVelocity(int32_t pointerId) const {
-    const auto movementIt = mMovements.find(pointerId);
-    if (movementIt == mMovements.end()) {
-        return std::nullopt; // no data
+void ImpulseVelocityTrackerStrategy::computeVelocities(const int32_t* pointerIds, size_t count,
+                                                       PointerVelocities& outVelocities) const {
+    // Segment i of a pointer goes from its movement i to movement i + 1. Pointers with fewer
+    // segments are padded with segments that are ignored.
+    float deltas[HISTORY_SIZE][BATCH_SIZE] = {};
+    float durations[HISTORY_SIZE][BATCH_SIZE];
+    uint32_t segmentCounts[BATCH_SIZE] = {};
+    uint32_t maxSegmentCount = 0;
+    for (auto& segmentDurations : durations) {
+        std::fill(std::begin(segmentDurations), std::end(segmentDurations), 1.0f);
+    }
+    for (size_t p = 0; p < count; p++) {
+        const Movements& movements = mMovements[pointerIds[p]];
+        for (uint32_t i = 0; i + 1 < movements.size; i++) {
+            const float position = movements.getPosition(i);
+            const float nextPosition = movements.getPosition(i + 1);
+            deltas[i][p] = mDeltaValues ? nextPosition : nextPosition - position;
+            durations[i][p] = SECONDS_PER_NANO *
+                    (movements.getEventTime(i + 1) - movements.getEventTime(i));
+        }
+        segmentCounts[p] = movements.size - 1;
+        maxSegmentCount = std::max(maxSegmentCount, segmentCounts[p]);
     }
 
-    const RingBuffer<Movement>& movements = movementIt->second;
-    const size_t size = movements.size();
-    if (size == 0) {
-        return std::nullopt; // no data
+    float work[BATCH_SIZE] = {};
+    for (uint32_t i = 0; i < maxSegmentCount; i++) {
+        for (size_t p = 0; p < BATCH_SIZE; p++) {
+            float vprev = kineticEnergyToVelocity(work[p]);
+            float vcurr = deltas[i][p] / durations[i][p];
+            float segmentWork = work[p] + (vcurr - vprev) * fabsf(vcurr);
+            if (i == 0) {
+                segmentWork *= 0.5; // initial condition, case 2) above
+            }
+            work[p] = i < segmentCounts[p] ? segmentWork : work[p];
+        }
     }
 
-    float work = 0;
-    for (size_t i = 0; i < size - 1; i++) {
-        const Movement& mvt = movements[i];
-        const Movement& nextMvt = movements[i + 1];
+    for (size_t p = 0; p < count; p++) {
+        const float velocity = kineticEnergyToVelocity(work[p]);
+        ALOGD_IF(DEBUG_STRATEGY, "velocity: %.1f", velocity);
+        outVelocities[pointerIds[p]] = velocity;
+    }
+}
 
-        float vprev = kineticEnergyToVelocity(work);
-        float delta = mDeltaValues ? nextMvt.position : nextMvt.position - mvt.position;
-        float vcurr = delta / (SECONDS_PER_NANO * (nextMvt.eventTime - mvt.eventTime));
-        work += (vcurr - vprev) * fabsf(vcurr);
+std::optional<float> ImpulseVelocityTrackerStrategy::getVelocity(int32_t pointerId) const {
+    const Movements* movements = getMovements(pointerId);
+    if (movements == nullptr) {
+        return std::nullopt; // no data
+    }
 
-        if (i == 0) {
-            work *= 0.5; // initial condition, case 2) above
-        }
+    const size_t size = movements->size;
+    if (size == 0) {
+        return std::nullopt; // no data
     }
 
-    const float velocity = kineticEnergyToVelocity(work);
-    ALOGD_IF(DEBUG_STRATEGY, "velocity: %.1f", velocity);
+    PointerVelocities velocities;
+    computeVelocities(&pointerId, /*count=*/1, velocities);
 
     if (DEBUG_IMPULSE) {
         // TODO(b/134179997): delete this block once the switch to 'impulse' is complete.
@@ -1027,8 +1139,8 @@ std::optional<float> ImpulseVelocityTrackerStrategy::getVelocity(int32_t pointer
         // X axis chosen arbitrarily for velocity comparisons.
         VelocityTracker lsq2(VelocityTracker::Strategy::LSQ2);
         for (size_t i = 0; i < size; i++) {
-            const Movement& mvt = movements[i];
-            lsq2.addMovement(mvt.eventTime, pointerId, AMOTION_EVENT_AXIS_X, mvt.position);
+            lsq2.addMovement(movements->getEventTime(i), pointerId, AMOTION_EVENT_AXIS_X,
+                             movements->getPosition(i));
         }
         std::optional<float> v = lsq2.getVelocity(AMOTION_EVENT_AXIS_X, pointerId);
         if (v) {
@@ -1037,7 +1149,28 @@ std::optional<float> ImpulseVelocityTrackerStrategy::getVelocity(int32_t pointer
             ALOGD("lsq2 velocity: could not compute velocity");
         }
     }
-    return velocity;
+    return velocities[pointerId];
+}
+
+void ImpulseVelocityTrackerStrategy::getVelocities(BitSet32 pointerIdBits,
+                                                   PointerVelocities& outVelocities) const {
+    std::array<int32_t, BATCH_SIZE> batch;
+    size_t batchSize = 0;
+    while (!pointerIdBits.isEmpty()) {
+        const int32_t id = pointerIdBits.clearFirstMarkedBit();
+        if (getMovements(id) == nullptr) {
+            outVelocities[id] = std::nullopt; // no data
+            continue;
+        }
+        batch[batchSize++] = id;
+        if (batchSize == BATCH_SIZE) {
+            computeVelocities(batch.data(), batchSize, outVelocities);
+            batchSize = 0;
+        }
+    }
+    if (batchSize > 0) {
+        computeVelocities(batch.data(), batchSize, outVelocities);
+    }
 }
 
 } // namespace android
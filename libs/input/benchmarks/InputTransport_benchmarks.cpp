@@ -0,0 +1,199 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <input/InputTransport.h>
+#include <sys/socket.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+namespace {
+
+constexpr int32_t DEVICE_ID = 1;
+
+struct ChannelPair {
+    std::unique_ptr<InputPublisher> publisher;
+    std::unique_ptr<InputConsumer> consumer;
+};
+
+ChannelPair createChannelPair() {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel);
+    LOG_ALWAYS_FATAL_IF(result != OK, "Failed to open the channel pair");
+    return {std::make_unique<InputPublisher>(std::move(serverChannel)),
+            std::make_unique<InputConsumer>(std::move(clientChannel))};
+}
+
+status_t publishMove(InputPublisher& publisher, uint32_t seq, nsecs_t eventTime) {
+    PointerProperties properties;
+    properties.clear();
+    properties.id = 0;
+    properties.toolType = ToolType::FINGER;
+    PointerCoords coords;
+    coords.clear();
+    coords.setAxisValue(AMOTION_EVENT_AXIS_X, 100 + seq % 100);
+    coords.setAxisValue(AMOTION_EVENT_AXIS_Y, 200 + seq % 100);
+    ui::Transform identityTransform;
+    return publisher.publishMotionEvent(seq, InputEvent::nextId(), DEVICE_ID,
+                                        AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT,
+                                        INVALID_HMAC, AMOTION_EVENT_ACTION_MOVE,
+                                        /*actionButton=*/0, /*flags=*/0,
+                                        AMOTION_EVENT_EDGE_FLAG_NONE, AMETA_NONE,
+                                        /*buttonState=*/0, MotionClassification::NONE,
+                                        identityTransform, /*xPrecision=*/0, /*yPrecision=*/0,
+                                        AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                        AMOTION_EVENT_INVALID_CURSOR_POSITION, identityTransform,
+                                        /*downTime=*/0, eventTime, /*pointerCount=*/1, &properties,
+                                        &coords);
+}
+
+/**
+ * Consume a burst of samples that was published with one of the benchmarks below, and deliver the
+ * finished signals back to the publisher, as an app and the dispatcher do for a high rate
+ * touchscreen. The burst size is the benchmark argument, and is kept small enough for the burst to
+ * fit in the socket buffer.
+ */
+void consumeBurst(benchmark::State& state, ChannelPair& pair) {
+    PreallocatedInputEventFactory eventFactory;
+    InputEvent* event;
+    uint32_t consumeSeq;
+    status_t status = pair.consumer->consume(&eventFactory, /*consumeBatches=*/true,
+                                             /*frameTime=*/-1, &consumeSeq, &event);
+    if (status != OK) {
+        state.SkipWithError("Failed to consume the burst");
+        return;
+    }
+    pair.consumer->sendFinishedSignal(consumeSeq, /*handled=*/true);
+    for (int64_t i = 0; i < state.range(0); i++) {
+        if (!pair.publisher->receiveConsumerResponse().ok()) {
+            state.SkipWithError("Missing finished signal");
+            return;
+        }
+    }
+}
+
+void benchmarkPublishUnbatched(benchmark::State& state) {
+    ChannelPair pair = createChannelPair();
+    uint32_t seq = 1;
+    for (auto _ : state) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            publishMove(*pair.publisher, seq++, systemTime(SYSTEM_TIME_MONOTONIC));
+        }
+        consumeBurst(state, pair);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(benchmarkPublishUnbatched)->RangeMultiplier(2)->Range(1, 16);
+
+void benchmarkPublishBatched(benchmark::State& state) {
+    ChannelPair pair = createChannelPair();
+    uint32_t seq = 1;
+    for (auto _ : state) {
+        pair.publisher->beginBatch();
+        for (int64_t i = 0; i < state.range(0); i++) {
+            publishMove(*pair.publisher, seq++, systemTime(SYSTEM_TIME_MONOTONIC));
+        }
+        size_t publishedCount;
+        if (pair.publisher->endBatch(&publishedCount) != OK) {
+            state.SkipWithError("Failed to publish the burst");
+            break;
+        }
+        consumeBurst(state, pair);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(benchmarkPublishBatched)->RangeMultiplier(2)->Range(1, 16);
+
+/**
+ * Send and receive a stream of samples through the channel directly, with the full or the compact
+ * encoding for MOTION messages. The arguments are whether the compact encoding is enabled, and the
+ * number of pointers with all the axes of a stylus.
+ */
+void benchmarkSendReceiveMotion(benchmark::State& state) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel);
+    LOG_ALWAYS_FATAL_IF(result != OK, "Failed to open the channel pair");
+    if (state.range(0) != 0) {
+        serverChannel->setCompactMotionEncodingAllowed(true);
+        clientChannel->requestCompactMotionEncoding();
+        InputMessage request;
+        // Let the server channel handle the request, which is not returned as a message.
+        serverChannel->receiveMessage(&request);
+        LOG_ALWAYS_FATAL_IF(!serverChannel->isCompactMotionEncodingEnabled(),
+                            "Failed to enable the compact encoding");
+    }
+
+    InputMessage msg = {};
+    msg.header.type = InputMessage::Type::MOTION;
+    msg.body.motion.deviceId = DEVICE_ID;
+    msg.body.motion.source = AINPUT_SOURCE_STYLUS;
+    msg.body.motion.action = AMOTION_EVENT_ACTION_MOVE;
+    msg.body.motion.pointerCount = state.range(1);
+    for (uint32_t i = 0; i < msg.body.motion.pointerCount; i++) {
+        msg.body.motion.pointers[i].properties.id = i;
+        msg.body.motion.pointers[i].properties.toolType = ToolType::STYLUS;
+        msg.body.motion.pointers[i].coords.clear();
+    }
+
+    uint32_t seq = 1;
+    const auto updateSample = [&msg, &seq]() {
+        msg.header.seq = seq;
+        msg.body.motion.eventId = seq;
+        msg.body.motion.eventTime = seq * 4'000'000;
+        for (uint32_t i = 0; i < msg.body.motion.pointerCount; i++) {
+            PointerCoords& coords = msg.body.motion.pointers[i].coords;
+            coords.setAxisValue(AMOTION_EVENT_AXIS_X, 100 + seq % 500 + i);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_Y, 200 + seq % 300 + i);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, (seq % 100) / 100.0f);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_TILT, 0.5f);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, 1.0f);
+            coords.setAxisValue(AMOTION_EVENT_AXIS_DISTANCE, 0);
+        }
+        seq++;
+    };
+
+    // Measure the size of a sample on the socket, once there is a previous one to encode against.
+    InputMessage receivedMsg;
+    ssize_t bytes = 0;
+    for (int i = 0; i < 2; i++) {
+        updateSample();
+        serverChannel->sendMessage(&msg);
+        bytes = ::recv(clientChannel->getFd(), &receivedMsg, sizeof(receivedMsg),
+                       MSG_PEEK | MSG_DONTWAIT);
+        clientChannel->receiveMessage(&receivedMsg);
+    }
+
+    for (auto _ : state) {
+        updateSample();
+        if (serverChannel->sendMessage(&msg) != OK) {
+            state.SkipWithError("Failed to send the message");
+            break;
+        }
+        if (clientChannel->receiveMessage(&receivedMsg) != OK) {
+            state.SkipWithError("Failed to receive the message");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes_per_message"] = bytes;
+}
+BENCHMARK(benchmarkSendReceiveMotion)->ArgsProduct({{0, 1}, {1, 5, 10}});
+
+} // namespace
+
+} // namespace android
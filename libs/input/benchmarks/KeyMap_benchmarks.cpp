@@ -0,0 +1,126 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/stringprintf.h>
+#include <input/KeyCharacterMap.h>
+#include <input/KeyLayoutMap.h>
+#include <input/KeyMapCache.h>
+
+using android::base::StringAppendF;
+
+namespace android {
+
+namespace {
+
+// A full keyboard layout, about the size of Generic.kl.
+std::string createKeyLayout() {
+    std::string contents;
+    for (int32_t scanCode = 1; scanCode <= 400; scanCode++) {
+        StringAppendF(&contents, "key %d %c\n", scanCode, 'A' + scanCode % 26);
+    }
+    for (int32_t usage = 0; usage < 40; usage++) {
+        StringAppendF(&contents, "key usage 0x%06x %d\n", 0x0c0100 + usage, usage % 10);
+    }
+    contents += "axis 0x00 X\naxis 0x01 Y\naxis 0x02 split 0x7f GAS BRAKE flat 5\n";
+    contents += "led 0x00 NUM_LOCK\nled 0x01 CAPS_LOCK\nled 0x02 SCROLL_LOCK\n";
+    return contents;
+}
+
+// A full keyboard character map, with the letters and digits of Generic.kcm.
+std::string createKeyCharacterMap() {
+    std::string contents = "type FULL\n";
+    for (char letter = 'A'; letter <= 'Z'; letter++) {
+        StringAppendF(&contents,
+                      "key %c {\n    label: '%c'\n    base: '%c'\n    shift, capslock: '%c'\n"
+                      "    shift+capslock: '%c'\n}\n",
+                      letter, letter, letter - 'A' + 'a', letter, letter - 'A' + 'a');
+    }
+    for (char digit = '0'; digit <= '9'; digit++) {
+        StringAppendF(&contents,
+                      "key %c {\n    label: '%c'\n    base: '%c'\n    shift: '%c'\n"
+                      "    ctrl, alt, meta: none\n}\n",
+                      digit, digit, digit, 'a' + digit - '0');
+    }
+    return contents;
+}
+
+class KeyMapFiles {
+public:
+    KeyMapFiles()
+          : mKeyLayoutPath(std::string(mSourceDir.path) + "/keyboard.kl"),
+            mKeyCharacterMapPath(std::string(mSourceDir.path) + "/keyboard.kcm") {
+        CHECK(base::WriteStringToFile(createKeyLayout(), mKeyLayoutPath));
+        CHECK(base::WriteStringToFile(createKeyCharacterMap(), mKeyCharacterMapPath));
+    }
+
+    const std::string& getKeyLayoutPath() const { return mKeyLayoutPath; }
+    const std::string& getKeyCharacterMapPath() const { return mKeyCharacterMapPath; }
+
+private:
+    base::TemporaryDir mSourceDir;
+    const std::string mKeyLayoutPath;
+    const std::string mKeyCharacterMapPath;
+};
+
+/**
+ * The time spent loading the key maps when a keyboard is added, by parsing the text files.
+ */
+void benchmarkLoadKeyMapsFromText(benchmark::State& state) {
+    KeyMapFiles files;
+    for (auto _ : state) {
+        base::Result<std::shared_ptr<KeyLayoutMap>> keyLayout =
+                KeyLayoutMap::load(files.getKeyLayoutPath());
+        base::Result<std::shared_ptr<KeyCharacterMap>> keyCharacterMap =
+                KeyCharacterMap::load(files.getKeyCharacterMapPath(),
+                                      KeyCharacterMap::Format::BASE);
+        CHECK(keyLayout.ok() && keyCharacterMap.ok());
+        benchmark::DoNotOptimize(keyLayout);
+        benchmark::DoNotOptimize(keyCharacterMap);
+    }
+}
+BENCHMARK(benchmarkLoadKeyMapsFromText);
+
+/**
+ * The time spent loading the key maps when a keyboard is added, from the compiled cache entries.
+ */
+void benchmarkLoadKeyMapsFromCache(benchmark::State& state) {
+    KeyMapFiles files;
+    base::TemporaryDir cacheDir;
+    KeyMapCache cache(cacheDir.path);
+    // Compile the entries outside of the measured loop.
+    CHECK(cache.loadKeyLayout(files.getKeyLayoutPath()).ok());
+    CHECK(cache.loadKeyCharacterMap(files.getKeyCharacterMapPath()).ok());
+
+    for (auto _ : state) {
+        base::Result<std::shared_ptr<KeyLayoutMap>> keyLayout =
+                cache.loadKeyLayout(files.getKeyLayoutPath());
+        base::Result<std::shared_ptr<KeyCharacterMap>> keyCharacterMap =
+                cache.loadKeyCharacterMap(files.getKeyCharacterMapPath());
+        CHECK(keyLayout.ok() && keyCharacterMap.ok());
+        benchmark::DoNotOptimize(keyLayout);
+        benchmark::DoNotOptimize(keyCharacterMap);
+    }
+    CHECK_EQ(cache.getStats().misses, 2u);
+}
+BENCHMARK(benchmarkLoadKeyMapsFromCache);
+
+} // namespace
+
+} // namespace android
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <input/VelocityTracker.h>
+
+#include <limits>
+
+namespace android {
+
+namespace {
+
+constexpr nsecs_t SAMPLE_INTERVAL = 8'000'000; // 8 ms
+
+// Fill the tracker with a fling of the given number of pointers, with more samples than the
+// strategies keep.
+void addFling(VelocityTracker& tracker, int32_t pointerCount) {
+    for (int32_t i = 0; i < 30; i++) {
+        const nsecs_t eventTime = 1'000'000'000 + i * SAMPLE_INTERVAL;
+        for (int32_t id = 0; id < pointerCount; id++) {
+            tracker.addMovement(eventTime, id, AMOTION_EVENT_AXIS_X, 100 * id + 2.5f * i * i);
+            tracker.addMovement(eventTime, id, AMOTION_EVENT_AXIS_Y, 200 * id + 10.0f * i);
+        }
+    }
+}
+
+/**
+ * The time to compute the velocity of one pointer on one axis, for each strategy. The argument is
+ * the strategy.
+ */
+void benchmarkGetVelocity(benchmark::State& state) {
+    VelocityTracker tracker(static_cast<VelocityTracker::Strategy>(state.range(0)));
+    addFling(tracker, /*pointerCount=*/1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tracker.getVelocity(AMOTION_EVENT_AXIS_X, /*pointerId=*/0));
+    }
+}
+BENCHMARK(benchmarkGetVelocity)
+        ->ArgName("strategy")
+        ->DenseRange(static_cast<int64_t>(VelocityTracker::Strategy::MIN),
+                     static_cast<int64_t>(VelocityTracker::Strategy::MAX));
+
+/**
+ * The time to compute the velocities of all the pointers on all the axes at once, as apps do when a
+ * fling ends. The arguments are the strategy and the number of pointers.
+ */
+void benchmarkGetComputedVelocity(benchmark::State& state) {
+    VelocityTracker tracker(static_cast<VelocityTracker::Strategy>(state.range(0)));
+    addFling(tracker, state.range(1));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                tracker.getComputedVelocity(/*units=*/1000, std::numeric_limits<float>::max()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(benchmarkGetComputedVelocity)
+        ->ArgNames({"strategy", "pointers"})
+        ->ArgsProduct({{static_cast<int64_t>(VelocityTracker::Strategy::IMPULSE),
+                        static_cast<int64_t>(VelocityTracker::Strategy::LSQ2)},
+                       {1, 2, 5, 10}});
+
+} // namespace
+
+} // namespace android
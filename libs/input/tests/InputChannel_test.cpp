@@ -21,6 +21,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
+#include <sys/socket.h>
 
 #include <binder/Binder.h>
 #include <binder/Parcel.h>
@@ -45,6 +46,57 @@ bool operator==(const InputChannel& left, const InputChannel& right) {
     return left.getName() == right.getName() &&
             left.getConnectionToken() == right.getConnectionToken() && lhs.st_ino == rhs.st_ino;
 }
+
+InputMessage createMotionMessage(uint32_t seq, size_t pointerCount, float x, float y) {
+    InputMessage msg = {};
+    msg.header.type = InputMessage::Type::MOTION;
+    msg.header.seq = seq;
+    msg.body.motion.eventId = seq;
+    msg.body.motion.eventTime = seq * 1000;
+    msg.body.motion.deviceId = 1;
+    msg.body.motion.source = AINPUT_SOURCE_TOUCHSCREEN;
+    msg.body.motion.action = AMOTION_EVENT_ACTION_MOVE;
+    msg.body.motion.dsdx = 1;
+    msg.body.motion.dsdy = 1;
+    msg.body.motion.pointerCount = pointerCount;
+    for (size_t i = 0; i < pointerCount; i++) {
+        msg.body.motion.pointers[i].properties.id = i;
+        msg.body.motion.pointers[i].properties.toolType = ToolType::FINGER;
+        PointerCoords& coords = msg.body.motion.pointers[i].coords;
+        coords.clear();
+        coords.setAxisValue(AMOTION_EVENT_AXIS_X, x + i);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_Y, y + i);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 0.5);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_SIZE, 0.25);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, 10);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, 8);
+    }
+    return msg;
+}
+
+// Lets |server| send compact MOTION messages to |client|.
+void enableCompactMotionEncoding(InputChannel& server, InputChannel& client) {
+    server.setCompactMotionEncodingAllowed(true);
+    ASSERT_EQ(OK, client.requestCompactMotionEncoding());
+    InputMessage msg;
+    ASSERT_EQ(WOULD_BLOCK, server.receiveMessage(&msg)) << "the request should not be returned";
+    ASSERT_TRUE(server.isCompactMotionEncodingEnabled());
+}
+
+// The size of the next message in the channel, as sent on the socket.
+ssize_t peekMessageSize(const InputChannel& channel) {
+    InputMessage msg;
+    return ::recv(channel.getFd(), &msg, sizeof(msg), MSG_PEEK | MSG_DONTWAIT);
+}
+
+void assertMessagesEqual(const InputMessage& expected, const InputMessage& actual) {
+    InputMessage cleanExpected, cleanActual;
+    expected.getSanitizedCopy(&cleanExpected);
+    actual.getSanitizedCopy(&cleanActual);
+    ASSERT_EQ(cleanExpected.size(), cleanActual.size());
+    ASSERT_EQ(0, memcmp(&cleanExpected, &cleanActual, cleanExpected.size()));
+}
+
 } // namespace
 
 class InputChannelTest : public testing::Test {
@@ -228,6 +280,292 @@ TEST_F(InputChannelTest, SendAndReceive_MotionClassification) {
     }
 }
 
+TEST_F(InputChannelTest, SendAndReceiveMessages_PreservesOrder) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    std::array<InputMessage, 4> serverMsgs;
+    for (size_t i = 0; i < serverMsgs.size(); i++) {
+        serverMsgs[i] = {};
+        serverMsgs[i].header.type = InputMessage::Type::FOCUS;
+        serverMsgs[i].header.seq = i + 1;
+        serverMsgs[i].body.focus.hasFocus = i % 2 == 0;
+    }
+    size_t sentCount = 0;
+    EXPECT_EQ(OK, serverChannel->sendMessages(serverMsgs.data(), serverMsgs.size(), &sentCount))
+            << "server channel should be able to send all the messages at once";
+    EXPECT_EQ(serverMsgs.size(), sentCount);
+
+    std::array<InputMessage, 8> clientMsgs;
+    size_t receivedCount = 0;
+    EXPECT_EQ(OK,
+              clientChannel->receiveMessages(clientMsgs.data(), clientMsgs.size(), &receivedCount))
+            << "client channel should be able to receive all the messages at once";
+    ASSERT_EQ(serverMsgs.size(), receivedCount);
+    for (size_t i = 0; i < receivedCount; i++) {
+        EXPECT_EQ(InputMessage::Type::FOCUS, clientMsgs[i].header.type);
+        EXPECT_EQ(serverMsgs[i].header.seq, clientMsgs[i].header.seq);
+        EXPECT_EQ(serverMsgs[i].body.focus.hasFocus, clientMsgs[i].body.focus.hasFocus);
+    }
+
+    EXPECT_EQ(WOULD_BLOCK,
+              clientChannel->receiveMessages(clientMsgs.data(), clientMsgs.size(), &receivedCount))
+            << "receiveMessages should have returned WOULD_BLOCK once the channel is empty";
+}
+
+TEST_F(InputChannelTest, SendMessages_WhenChannelIsFull_ReportsTheMessagesThatWereSent) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    // Far more motion events than the socket buffer can hold.
+    std::vector<InputMessage> msgs(1000);
+    for (size_t i = 0; i < msgs.size(); i++) {
+        msgs[i] = {};
+        msgs[i].header.type = InputMessage::Type::MOTION;
+        msgs[i].header.seq = i + 1;
+        msgs[i].body.motion.pointerCount = 1;
+    }
+    size_t sentCount = 0;
+    EXPECT_EQ(WOULD_BLOCK, serverChannel->sendMessages(msgs.data(), msgs.size(), &sentCount));
+    ASSERT_GT(sentCount, 0u);
+    ASSERT_LT(sentCount, msgs.size());
+
+    // Everything that was reported as sent can be read back in order.
+    InputMessage msg;
+    for (size_t i = 0; i < sentCount; i++) {
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&msg));
+        ASSERT_EQ(i + 1, msg.header.seq);
+    }
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&msg));
+}
+
+TEST_F(InputChannelTest, ReceiveMessages_WhenPeerClosed_ReturnsAnError) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    serverChannel.reset(); // close server channel
+
+    std::array<InputMessage, 2> msgs;
+    size_t receivedCount = 0;
+    EXPECT_EQ(DEAD_OBJECT, clientChannel->receiveMessages(msgs.data(), msgs.size(), &receivedCount))
+            << "receiveMessages should have returned DEAD_OBJECT";
+    EXPECT_EQ(0u, receivedCount);
+}
+
+TEST_F(InputChannelTest, ReceiveMessages_InvalidMessageAfterValidOnes_ReportsErrorOnNextCall) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    InputMessage serverMsg = {};
+    serverMsg.header.type = InputMessage::Type::FOCUS;
+    serverMsg.header.seq = 1;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&serverMsg));
+    // Too short to be any message.
+    const uint32_t invalidData = 0;
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(invalidData)),
+              ::send(serverChannel->getFd(), &invalidData, sizeof(invalidData), MSG_DONTWAIT));
+
+    std::array<InputMessage, 4> clientMsgs;
+    size_t receivedCount = 0;
+    ASSERT_EQ(OK,
+              clientChannel->receiveMessages(clientMsgs.data(), clientMsgs.size(),
+                                             &receivedCount));
+    ASSERT_EQ(1u, receivedCount);
+    EXPECT_EQ(1u, clientMsgs[0].header.seq);
+
+    EXPECT_EQ(BAD_VALUE,
+              clientChannel->receiveMessages(clientMsgs.data(), clientMsgs.size(),
+                                             &receivedCount));
+    EXPECT_EQ(0u, receivedCount);
+}
+
+TEST_F(InputChannelTest, SendAndReceive_CompactMotion_RoundTrip) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+    ASSERT_NO_FATAL_FAILURE(enableCompactMotionEncoding(*serverChannel, *clientChannel));
+
+    std::vector<InputMessage> msgs;
+    msgs.push_back(createMotionMessage(/*seq=*/1, /*pointerCount=*/1, 10, 20));
+    // Only the coordinates change
+    msgs.push_back(createMotionMessage(/*seq=*/2, /*pointerCount=*/1, 11, 20));
+    // A pointer is added
+    msgs.push_back(createMotionMessage(/*seq=*/3, /*pointerCount=*/2, 11, 21));
+    // Other messages don't affect the encoding
+    InputMessage focusMsg = {};
+    focusMsg.header.type = InputMessage::Type::FOCUS;
+    focusMsg.header.seq = 4;
+    msgs.push_back(focusMsg);
+    // Axes are added, and the sample is resampled
+    msgs.push_back(createMotionMessage(/*seq=*/5, /*pointerCount=*/2, 12, 21));
+    msgs.back().body.motion.pointers[1].coords.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, 1.5);
+    msgs.back().body.motion.pointers[1].coords.isResampled = true;
+    // The pointer is removed, and other fields change
+    msgs.push_back(createMotionMessage(/*seq=*/6, /*pointerCount=*/1, 12, 22));
+    msgs.back().body.motion.action = AMOTION_EVENT_ACTION_UP;
+    msgs.back().body.motion.classification = MotionClassification::DEEP_PRESS;
+
+    for (const InputMessage& msg : msgs) {
+        ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+        InputMessage receivedMsg;
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&receivedMsg));
+        ASSERT_NO_FATAL_FAILURE(assertMessagesEqual(msg, receivedMsg)) << "seq=" << msg.header.seq;
+    }
+}
+
+TEST_F(InputChannelTest, SendAndReceiveMessages_CompactMotion_RoundTrip) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+    ASSERT_NO_FATAL_FAILURE(enableCompactMotionEncoding(*serverChannel, *clientChannel));
+
+    std::array<InputMessage, 8> msgs;
+    for (size_t i = 0; i < msgs.size(); i++) {
+        msgs[i] = createMotionMessage(/*seq=*/i + 1, /*pointerCount=*/3, 10 + i, 20 - i);
+    }
+    size_t sentCount = 0;
+    ASSERT_EQ(OK, serverChannel->sendMessages(msgs.data(), msgs.size(), &sentCount));
+    ASSERT_EQ(msgs.size(), sentCount);
+
+    std::array<InputMessage, 8> receivedMsgs;
+    size_t receivedCount = 0;
+    ASSERT_EQ(OK,
+              clientChannel->receiveMessages(receivedMsgs.data(), receivedMsgs.size(),
+                                             &receivedCount));
+    ASSERT_EQ(msgs.size(), receivedCount);
+    for (size_t i = 0; i < receivedCount; i++) {
+        ASSERT_NO_FATAL_FAILURE(assertMessagesEqual(msgs[i], receivedMsgs[i])) << "index=" << i;
+    }
+
+    // Messages sent one at a time are encoded against the last message of the batch.
+    InputMessage msg = createMotionMessage(/*seq=*/9, /*pointerCount=*/3, 30, 40);
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    InputMessage receivedMsg;
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&receivedMsg));
+    ASSERT_NO_FATAL_FAILURE(assertMessagesEqual(msg, receivedMsg));
+}
+
+TEST_F(InputChannelTest, SendMessages_LargerThanOneWrite_CompactMotion_RoundTrip) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+    ASSERT_NO_FATAL_FAILURE(enableCompactMotionEncoding(*serverChannel, *clientChannel));
+
+    // More messages than a single sendmmsg call writes, so that the batch is split in chunks that
+    // are each encoded against the end of the previous one.
+    std::vector<InputMessage> msgs;
+    for (size_t i = 0; i < 40; i++) {
+        msgs.push_back(createMotionMessage(/*seq=*/i + 1, /*pointerCount=*/2, 10 + i, 20 + i));
+    }
+    size_t sentCount = 0;
+    ASSERT_EQ(OK, serverChannel->sendMessages(msgs.data(), msgs.size(), &sentCount));
+    ASSERT_EQ(msgs.size(), sentCount);
+
+    InputMessage receivedMsg;
+    for (const InputMessage& msg : msgs) {
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&receivedMsg));
+        ASSERT_NO_FATAL_FAILURE(assertMessagesEqual(msg, receivedMsg)) << "seq=" << msg.header.seq;
+    }
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&receivedMsg));
+}
+
+TEST_F(InputChannelTest, CompactMotion_OnlySendsWhatChanged) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    const InputMessage first = createMotionMessage(/*seq=*/1, /*pointerCount=*/2, 10, 20);
+    const InputMessage second = createMotionMessage(/*seq=*/2, /*pointerCount=*/2, 11, 20);
+    InputMessage receivedMsg;
+
+    ASSERT_EQ(OK, serverChannel->sendMessage(&first));
+    const ssize_t fullSize = peekMessageSize(*clientChannel);
+    ASSERT_EQ(static_cast<ssize_t>(first.size()), fullSize);
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&receivedMsg));
+
+    ASSERT_NO_FATAL_FAILURE(enableCompactMotionEncoding(*serverChannel, *clientChannel));
+    // Without a previous message, only the axes that are present are sent.
+    ASSERT_EQ(OK, serverChannel->sendMessage(&first));
+    const ssize_t firstCompactSize = peekMessageSize(*clientChannel);
+    EXPECT_LT(firstCompactSize, fullSize);
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&receivedMsg));
+
+    // The next sample only carries its id, time and the X coordinates.
+    ASSERT_EQ(OK, serverChannel->sendMessage(&second));
+    const ssize_t secondCompactSize = peekMessageSize(*clientChannel);
+    EXPECT_LT(secondCompactSize, fullSize / 4);
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&receivedMsg));
+    ASSERT_NO_FATAL_FAILURE(assertMessagesEqual(second, receivedMsg));
+}
+
+TEST_F(InputChannelTest, CompactMotion_WhenReceivedOnAnotherChannel_ReturnsAnError) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+    ASSERT_NO_FATAL_FAILURE(enableCompactMotionEncoding(*serverChannel, *clientChannel));
+
+    const InputMessage first = createMotionMessage(/*seq=*/1, /*pointerCount=*/1, 10, 20);
+    const InputMessage second = createMotionMessage(/*seq=*/2, /*pointerCount=*/1, 11, 20);
+    InputMessage receivedMsg;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&first));
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&receivedMsg));
+
+    // The duplicated channel has not received the message that the next one is encoded against.
+    std::unique_ptr<InputChannel> dupChannel = clientChannel->dup();
+    ASSERT_EQ(OK, serverChannel->sendMessage(&second));
+    EXPECT_EQ(BAD_VALUE, dupChannel->receiveMessage(&receivedMsg));
+}
+
+TEST_F(InputChannelTest, CompactMotion_WhenRequestedByDuplicatedChannel_DecodesOnIt) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+    ASSERT_NO_FATAL_FAILURE(enableCompactMotionEncoding(*serverChannel, *clientChannel));
+
+    const InputMessage first = createMotionMessage(/*seq=*/1, /*pointerCount=*/1, 10, 20);
+    const InputMessage second = createMotionMessage(/*seq=*/2, /*pointerCount=*/1, 11, 20);
+    InputMessage receivedMsg;
+    ASSERT_EQ(OK, serverChannel->sendMessage(&first));
+    ASSERT_EQ(OK, clientChannel->receiveMessage(&receivedMsg));
+
+    // The server starts over from an empty reference when the duplicate takes over.
+    std::unique_ptr<InputChannel> dupChannel = clientChannel->dup();
+    ASSERT_NO_FATAL_FAILURE(enableCompactMotionEncoding(*serverChannel, *dupChannel));
+    ASSERT_EQ(OK, serverChannel->sendMessage(&second));
+    ASSERT_EQ(OK, dupChannel->receiveMessage(&receivedMsg));
+    ASSERT_NO_FATAL_FAILURE(assertMessagesEqual(second, receivedMsg));
+}
+
+TEST_F(InputChannelTest, CompactMotion_WhenNotAllowed_IgnoresTheRequest) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    ASSERT_EQ(OK, clientChannel->requestCompactMotionEncoding());
+    InputMessage msg;
+    ASSERT_EQ(WOULD_BLOCK, serverChannel->receiveMessage(&msg));
+    EXPECT_FALSE(serverChannel->isCompactMotionEncodingEnabled());
+
+    msg = createMotionMessage(/*seq=*/1, /*pointerCount=*/1, 10, 20);
+    ASSERT_EQ(OK, serverChannel->sendMessage(&msg));
+    EXPECT_EQ(static_cast<ssize_t>(msg.size()), peekMessageSize(*clientChannel));
+}
+
 TEST_F(InputChannelTest, DuplicateChannelAndAssertEqual) {
     std::unique_ptr<InputChannel> serverChannel, clientChannel;
 
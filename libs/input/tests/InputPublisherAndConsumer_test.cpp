@@ -245,7 +245,6 @@ protected:
     void publishAndConsumeMotionEvent(int32_t action, nsecs_t downTime,
                                       const std::vector<Pointer>& pointers);
 
-private:
     // The sequence number to use when publishing the next event
     uint32_t mSeq = 1;
 };
@@ -670,6 +669,51 @@ TEST_F(InputPublisherAndConsumerTest,
             << "publisher publishMotionEvent should return BAD_VALUE";
 }
 
+TEST_F(InputPublisherAndConsumerTest, PublishBatch_EndToEnd) {
+    const nsecs_t downTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    publishAndConsumeMotionDown(downTime);
+
+    // Publish several moves with a single system call.
+    const std::vector<Pointer> pointers = {Pointer{.id = 0, .x = 20, .y = 30}};
+    std::vector<PublishMotionArgs> moves;
+    for (size_t i = 0; i < 3; i++) {
+        moves.emplace_back(AMOTION_EVENT_ACTION_MOVE, downTime, pointers, mSeq++);
+    }
+    const nsecs_t publishTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    mPublisher->beginBatch();
+    for (const PublishMotionArgs& move : moves) {
+        ASSERT_NO_FATAL_FAILURE(publishMotionEvent(*mPublisher, move));
+    }
+    size_t publishedCount = 0;
+    ASSERT_EQ(OK, mPublisher->endBatch(&publishedCount));
+    ASSERT_EQ(moves.size(), publishedCount);
+
+    // The consumer batches all the samples into a single event.
+    uint32_t consumeSeq;
+    InputEvent* event;
+    status_t status =
+            mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq, &event);
+    ASSERT_EQ(OK, status) << "consumer consume should return OK";
+    ASSERT_TRUE(event != nullptr) << "consumer should have returned non-NULL event";
+    ASSERT_EQ(InputEventType::MOTION, event->getType());
+    EXPECT_EQ(moves.back().seq, consumeSeq);
+    EXPECT_EQ(moves.size() - 1, static_cast<MotionEvent*>(event)->getHistorySize());
+
+    // Finishing the event finishes every sample, in the order they were published.
+    ASSERT_EQ(OK, mConsumer->sendFinishedSignal(consumeSeq, false));
+    for (const PublishMotionArgs& move : moves) {
+        Result<InputPublisher::ConsumerResponse> result = mPublisher->receiveConsumerResponse();
+        ASSERT_TRUE(result.ok()) << "receiveConsumerResponse should return OK";
+        ASSERT_TRUE(std::holds_alternative<InputPublisher::Finished>(*result));
+        const InputPublisher::Finished& finish = std::get<InputPublisher::Finished>(*result);
+        EXPECT_EQ(move.seq, finish.seq);
+        EXPECT_GE(finish.consumeTime, publishTime);
+    }
+
+    // Provide a consistent input stream - cancel the gesture that was started above
+    publishAndConsumeMotionEvent(AMOTION_EVENT_ACTION_CANCEL, downTime, pointers);
+}
+
 TEST_F(InputPublisherAndConsumerTest, PublishMultipleEvents_EndToEnd) {
     const nsecs_t downTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <android/keycodes.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <input/InputEventLabels.h>
+#include <input/KeyCharacterMap.h>
+#include <input/KeyLayoutMap.h>
+#include <input/KeyMapCache.h>
+#include <sys/stat.h>
+
+#include <filesystem>
+
+namespace android {
+
+namespace {
+
+constexpr const char* KEY_LAYOUT = "key 30 A\n"
+                                   "key 48 B VIRTUAL\n"
+                                   "key usage 0x0c0067 WINDOW\n"
+                                   "axis 0x00 X\n"
+                                   "axis 0x01 invert Y\n"
+                                   "axis 0x02 split 0x7f GAS BRAKE flat 5\n"
+                                   "led 0x00 NUM_LOCK\n"
+                                   "led usage 0x080002 CAPS_LOCK\n"
+                                   "sensor 0x03 ACCELEROMETER Z\n";
+
+constexpr const char* KEY_CHARACTER_MAP = "type FULL\n"
+                                          "map key 16 Q\n"
+                                          "map key usage 0x070014 Q\n"
+                                          "key A {\n"
+                                          "    label: 'A'\n"
+                                          "    base: 'a'\n"
+                                          "    shift, capslock: 'A'\n"
+                                          "    ctrl: fallback MENU\n"
+                                          "}\n";
+
+} // namespace
+
+// --- KeyMapCacheTest ---
+
+class KeyMapCacheTest : public testing::Test {
+protected:
+    base::TemporaryDir mSourceDir;
+    base::TemporaryDir mCacheDir;
+    KeyMapCache mCache{mCacheDir.path};
+
+    std::string writeSource(const std::string& name, const std::string& contents) {
+        const std::string path = std::string(mSourceDir.path) + "/" + name;
+        EXPECT_TRUE(base::WriteStringToFile(contents, path));
+        return path;
+    }
+
+    std::vector<std::filesystem::path> getEntries() const {
+        std::vector<std::filesystem::path> entries;
+        for (const auto& entry : std::filesystem::directory_iterator(mCacheDir.path)) {
+            entries.push_back(entry.path());
+        }
+        return entries;
+    }
+};
+
+TEST_F(KeyMapCacheTest, CompiledKeyLayout_MapsLikeTheTextFile) {
+    const std::string path = writeSource("test.kl", KEY_LAYOUT);
+    base::Result<std::shared_ptr<KeyLayoutMap>> parsed = mCache.loadKeyLayout(path);
+    ASSERT_TRUE(parsed.ok());
+    base::Result<std::shared_ptr<KeyLayoutMap>> compiled = mCache.loadKeyLayout(path);
+    ASSERT_TRUE(compiled.ok());
+    ASSERT_EQ(1u, mCache.getStats().hits);
+    ASSERT_EQ(1u, mCache.getStats().misses);
+    ASSERT_EQ(path, (*compiled)->getLoadFileName());
+
+    const std::vector<std::pair<int32_t, int32_t>> keys = {{30, 0}, {48, 0}, {0, 0x0c0067}, {1, 0}};
+    for (const auto& [scanCode, usageCode] : keys) {
+        int32_t parsedKeyCode, compiledKeyCode;
+        uint32_t parsedFlags, compiledFlags;
+        ASSERT_EQ((*parsed)->mapKey(scanCode, usageCode, &parsedKeyCode, &parsedFlags),
+                  (*compiled)->mapKey(scanCode, usageCode, &compiledKeyCode, &compiledFlags));
+        ASSERT_EQ(parsedKeyCode, compiledKeyCode);
+        ASSERT_EQ(parsedFlags, compiledFlags);
+    }
+    for (int32_t scanCode : {0x00, 0x01, 0x02, 0x03}) {
+        std::optional<AxisInfo> parsedAxis = (*parsed)->mapAxis(scanCode);
+        std::optional<AxisInfo> compiledAxis = (*compiled)->mapAxis(scanCode);
+        ASSERT_EQ(parsedAxis.has_value(), compiledAxis.has_value());
+        if (parsedAxis) {
+            ASSERT_EQ(parsedAxis->mode, compiledAxis->mode);
+            ASSERT_EQ(parsedAxis->axis, compiledAxis->axis);
+            ASSERT_EQ(parsedAxis->highAxis, compiledAxis->highAxis);
+            ASSERT_EQ(parsedAxis->splitValue, compiledAxis->splitValue);
+            ASSERT_EQ(parsedAxis->flatOverride, compiledAxis->flatOverride);
+        }
+    }
+    ASSERT_EQ((*parsed)->findScanCodeForLed(ALED_NUM_LOCK),
+              (*compiled)->findScanCodeForLed(ALED_NUM_LOCK));
+    ASSERT_EQ((*parsed)->findUsageCodeForLed(ALED_CAPS_LOCK),
+              (*compiled)->findUsageCodeForLed(ALED_CAPS_LOCK));
+    base::Result<std::pair<InputDeviceSensorType, int32_t>> sensor = (*compiled)->mapSensor(0x03);
+    ASSERT_TRUE(sensor.ok());
+    ASSERT_EQ((*parsed)->mapSensor(0x03).value(), *sensor);
+}
+
+TEST_F(KeyMapCacheTest, CompiledKeyCharacterMap_EqualsTheTextFile) {
+    const std::string path = writeSource("test.kcm", KEY_CHARACTER_MAP);
+    base::Result<std::shared_ptr<KeyCharacterMap>> parsed = mCache.loadKeyCharacterMap(path);
+    ASSERT_TRUE(parsed.ok());
+    base::Result<std::shared_ptr<KeyCharacterMap>> compiled = mCache.loadKeyCharacterMap(path);
+    ASSERT_TRUE(compiled.ok());
+    ASSERT_EQ(1u, mCache.getStats().hits);
+
+    ASSERT_EQ(**parsed, **compiled);
+    ASSERT_EQ(u'A', (*compiled)->getCharacter(AKEYCODE_A, AMETA_SHIFT_ON));
+}
+
+TEST_F(KeyMapCacheTest, ModifiedTextFile_IsParsedAgain) {
+    const std::string path = writeSource("test.kcm", KEY_CHARACTER_MAP);
+    ASSERT_TRUE(mCache.loadKeyCharacterMap(path).ok());
+
+    writeSource("test.kcm", "type NUMERIC\n");
+    // Make sure the modification time changes, even on file systems with coarse timestamps.
+    const timespec times[2] = {{.tv_sec = 0, .tv_nsec = UTIME_OMIT}, {.tv_sec = 1, .tv_nsec = 0}};
+    ASSERT_EQ(0, utimensat(AT_FDCWD, path.c_str(), times, 0));
+
+    base::Result<std::shared_ptr<KeyCharacterMap>> map = mCache.loadKeyCharacterMap(path);
+    ASSERT_TRUE(map.ok());
+    ASSERT_EQ(KeyCharacterMap::KeyboardType::NUMERIC, (*map)->getKeyboardType());
+    ASSERT_EQ(0u, mCache.getStats().hits);
+    ASSERT_EQ(2u, mCache.getStats().misses);
+}
+
+TEST_F(KeyMapCacheTest, TextFileEditedInPlace_IsParsedAgain) {
+    const std::string path = writeSource("test.kcm", "type NUMERIC\n");
+    ASSERT_TRUE(mCache.loadKeyCharacterMap(path).ok());
+    struct stat before;
+    ASSERT_EQ(0, stat(path.c_str(), &before));
+
+    // Same size, same inode, and the modification time is restored.
+    writeSource("test.kcm", "type FULL   \n");
+    const timespec times[2] = {{.tv_sec = 0, .tv_nsec = UTIME_OMIT}, before.st_mtim};
+    ASSERT_EQ(0, utimensat(AT_FDCWD, path.c_str(), times, 0));
+    struct stat after;
+    ASSERT_EQ(0, stat(path.c_str(), &after));
+    ASSERT_EQ(before.st_size, after.st_size);
+    ASSERT_EQ(before.st_ino, after.st_ino);
+
+    base::Result<std::shared_ptr<KeyCharacterMap>> map = mCache.loadKeyCharacterMap(path);
+    ASSERT_TRUE(map.ok());
+    ASSERT_EQ(KeyCharacterMap::KeyboardType::FULL, (*map)->getKeyboardType());
+    ASSERT_EQ(0u, mCache.getStats().hits);
+}
+
+TEST_F(KeyMapCacheTest, CorruptEntry_IsIgnored) {
+    const std::string path = writeSource("test.kl", KEY_LAYOUT);
+    ASSERT_TRUE(mCache.loadKeyLayout(path).ok());
+    const std::vector<std::filesystem::path> entries = getEntries();
+    ASSERT_EQ(1u, entries.size());
+
+    std::string entry;
+    ASSERT_TRUE(base::ReadFileToString(entries[0], &entry));
+    entry.back() ^= 0xff;
+    ASSERT_TRUE(base::WriteStringToFile(entry, entries[0]));
+
+    ASSERT_TRUE(mCache.loadKeyLayout(path).ok());
+    ASSERT_EQ(0u, mCache.getStats().hits);
+    // The entry is compiled again, so the next load is a hit.
+    ASSERT_TRUE(mCache.loadKeyLayout(path).ok());
+    ASSERT_EQ(1u, mCache.getStats().hits);
+}
+
+TEST_F(KeyMapCacheTest, MissingCacheDirectory_FallsBackToTheTextFile) {
+    KeyMapCache cache(std::string(mCacheDir.path) + "/missing");
+    const std::string path = writeSource("test.kl", KEY_LAYOUT);
+    ASSERT_TRUE(cache.loadKeyLayout(path).ok());
+    ASSERT_EQ(1u, cache.getStats().writeFailures);
+}
+
+} // namespace android
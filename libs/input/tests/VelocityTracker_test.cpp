@@ -23,6 +23,7 @@
 
 #include <android-base/stringprintf.h>
 #include <attestation/HmacKeyManager.h>
+#include <ftl/enum.h>
 #include <gtest/gtest.h>
 #include <gui/constants.h>
 #include <input/VelocityTracker.h>
@@ -440,6 +441,45 @@ TEST_F(VelocityTrackerTest, TestGetComputedVelocity) {
     EXPECT_FALSE(computedVelocity.getVelocity(AMOTION_EVENT_AXIS_SCROLL, DEFAULT_POINTER_ID));
 }
 
+TEST_F(VelocityTrackerTest, TestGetComputedVelocity_MatchesGetVelocity_ForManyPointers) {
+    const std::vector<VelocityTracker::Strategy> strategies = {
+            VelocityTracker::Strategy::IMPULSE,     VelocityTracker::Strategy::LSQ1,
+            VelocityTracker::Strategy::LSQ2,        VelocityTracker::Strategy::LSQ3,
+            VelocityTracker::Strategy::WLSQ2_DELTA, VelocityTracker::Strategy::INT2,
+            VelocityTracker::Strategy::LEGACY,
+    };
+    const float maxFloat = std::numeric_limits<float>::max();
+    // More pointers than are computed together, with a different number of movements each.
+    const int32_t pointerCount = 6;
+    for (VelocityTracker::Strategy strategy : strategies) {
+        SCOPED_TRACE(ftl::enum_string(strategy));
+        VelocityTracker vt(strategy);
+        for (int32_t i = 0; i < 10; i++) {
+            const nsecs_t eventTime = 1'000'000'000 + i * 8'000'000;
+            for (int32_t id = 0; id < pointerCount; id++) {
+                if (i < id) {
+                    continue;
+                }
+                vt.addMovement(eventTime, id, AMOTION_EVENT_AXIS_X, 100 * id + i * i);
+                vt.addMovement(eventTime, id, AMOTION_EVENT_AXIS_Y, 200 * id - 3 * i);
+            }
+        }
+
+        VelocityTracker::ComputedVelocity computedVelocity =
+                vt.getComputedVelocity(/*units=*/1000, maxFloat);
+        for (int32_t axis : {AMOTION_EVENT_AXIS_X, AMOTION_EVENT_AXIS_Y}) {
+            for (int32_t id = 0; id < pointerCount; id++) {
+                std::optional<float> velocity = vt.getVelocity(axis, id);
+                std::optional<float> computed = computedVelocity.getVelocity(axis, id);
+                ASSERT_EQ(velocity.has_value(), computed.has_value()) << "id=" << id;
+                if (velocity) {
+                    EXPECT_EQ(*velocity * 1000 / 1000, *computed) << "id=" << id;
+                }
+            }
+        }
+    }
+}
+
 TEST_F(VelocityTrackerTest, TestApiInteractionsWithNoMotionEvents) {
     VelocityTracker vt(VelocityTracker::Strategy::DEFAULT);
 
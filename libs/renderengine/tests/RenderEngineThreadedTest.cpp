@@ -48,6 +48,17 @@ TEST_F(RenderEngineThreadedTest, dump) {
     mThreadedRE->dump(testString);
 }
 
+TEST_F(RenderEngineThreadedTest, dump_includesTaskLatencies) {
+    EXPECT_CALL(*mRenderEngine, getContextPriority()).WillOnce(Return(1));
+    mThreadedRE->getContextPriority();
+
+    std::string result;
+    EXPECT_CALL(*mRenderEngine, dump(_));
+    mThreadedRE->dump(result);
+    EXPECT_THAT(result, testing::HasSubstr("getContextPriority queued:"));
+    EXPECT_THAT(result, testing::HasSubstr("getContextPriority executed:"));
+}
+
 TEST_F(RenderEngineThreadedTest, primeCache) {
     EXPECT_CALL(*mRenderEngine, primeCache(false));
     mThreadedRE->primeCache(false);
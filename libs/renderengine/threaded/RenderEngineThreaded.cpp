@@ -18,6 +18,7 @@
 
 #include "RenderEngineThreaded.h"
 
+#include <inttypes.h>
 #include <sched.h>
 #include <chrono>
 #include <future>
@@ -96,33 +97,82 @@ void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_S
     }
     mInitializedCondition.notify_all();
 
+    std::vector<Task> tasks;
     while (mRunning) {
-        const auto getNextTask = [this]() -> std::optional<Work> {
-            std::scoped_lock lock(mThreadMutex);
-            if (!mFunctionCalls.empty()) {
-                Work task = mFunctionCalls.front();
-                mFunctionCalls.pop();
-                return std::make_optional<Work>(task);
-            }
-            return std::nullopt;
-        };
-
-        const auto task = getNextTask();
-
-        if (task) {
-            (*task)(*mRenderEngine);
+        {
+            std::unique_lock<std::mutex> lock(mThreadMutex);
+            mThreadWaiting = true;
+            mCondition.wait(lock, [this]() REQUIRES(mThreadMutex) {
+                return !mRunning || !mFunctionCalls.empty();
+            });
+            mThreadWaiting = false;
+            // Take all the queued tasks at once, so that a burst of them, such as the texture
+            // maps and unmaps of a frame, costs one lock and one wake-up.
+            std::swap(tasks, mFunctionCalls);
         }
 
-        std::unique_lock<std::mutex> lock(mThreadMutex);
-        mCondition.wait(lock, [this]() REQUIRES(mThreadMutex) {
-            return !mRunning || !mFunctionCalls.empty();
-        });
+        for (Task& task : tasks) {
+            const nsecs_t startTime = systemTime();
+            task.work(*mRenderEngine);
+            // Release what the task holds as soon as it ran, as when tasks ran one at a time.
+            task.work = nullptr;
+
+            TaskLatencies& latencies = mTaskLatencies[task.name];
+            latencies.queued.add(startTime - task.queueTime);
+            latencies.executed.add(systemTime() - startTime);
+        }
+        tasks.clear();
     }
 
     // we must release the RenderEngine on the thread that created it
     mRenderEngine.reset();
 }
 
+void RenderEngineThreaded::pushTask(const char* name, Work&& work) const {
+    bool threadWaiting;
+    {
+        std::lock_guard lock(mThreadMutex);
+        mFunctionCalls.push_back(
+                {.name = name, .queueTime = systemTime(), .work = std::move(work)});
+        threadWaiting = mThreadWaiting;
+    }
+    // Notifying makes a system call, which is wasted while the thread is busy with other tasks.
+    if (threadWaiting) {
+        mCondition.notify_one();
+    }
+}
+
+void RenderEngineThreaded::LatencyHistogram::add(nsecs_t duration) {
+    nsecs_t limit = 16'000;
+    size_t bucket = 0;
+    while (bucket < kNumBuckets - 1 && duration >= limit) {
+        limit *= 4;
+        bucket++;
+    }
+    counts[bucket]++;
+}
+
+void RenderEngineThreaded::LatencyHistogram::dump(std::string& result) const {
+    nsecs_t limit = 16'000;
+    for (size_t bucket = 0; bucket < kNumBuckets - 1; bucket++) {
+        base::StringAppendF(&result, " <%" PRId64 "us:%" PRIu64, ns2us(limit), counts[bucket]);
+        limit *= 4;
+    }
+    base::StringAppendF(&result, " >=%" PRId64 "us:%" PRIu64 "\n", ns2us(limit / 4),
+                        counts[kNumBuckets - 1]);
+}
+
+void RenderEngineThreaded::dumpTaskLatencies(std::string& result) const {
+    result.append("RenderEngineThreaded task latencies:\n");
+    for (const auto& [name, latencies] : mTaskLatencies) {
+        base::StringAppendF(&result, "  %.*s queued:", static_cast<int>(name.size()), name.data());
+        latencies.queued.dump(result);
+        base::StringAppendF(&result, "  %.*s executed:", static_cast<int>(name.size()),
+                            name.data());
+        latencies.executed.dump(result);
+    }
+}
+
 void RenderEngineThreaded::waitUntilInitialized() const {
     if (!mIsInitialized) {
         std::unique_lock<std::mutex> lock(mInitializedMutex);
@@ -136,24 +186,20 @@ std::future<void> RenderEngineThreaded::primeCache(bool shouldPrimeUltraHDR) {
     ATRACE_CALL();
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push(
-                [resultPromise, shouldPrimeUltraHDR](renderengine::RenderEngine& instance) {
-                    ATRACE_NAME("REThreaded::primeCache");
-                    if (setSchedFifo(false) != NO_ERROR) {
-                        ALOGW("Couldn't set SCHED_OTHER for primeCache");
-                    }
-
-                    instance.primeCache(shouldPrimeUltraHDR);
-                    resultPromise->set_value();
-
-                    if (setSchedFifo(true) != NO_ERROR) {
-                        ALOGW("Couldn't set SCHED_FIFO for primeCache");
-                    }
-                });
-    }
-    mCondition.notify_one();
+    pushTask("primeCache",
+             [resultPromise, shouldPrimeUltraHDR](renderengine::RenderEngine& instance) {
+                 ATRACE_NAME("REThreaded::primeCache");
+                 if (setSchedFifo(false) != NO_ERROR) {
+                     ALOGW("Couldn't set SCHED_OTHER for primeCache");
+                 }
+
+                 instance.primeCache(shouldPrimeUltraHDR);
+                 resultPromise->set_value();
+
+                 if (setSchedFifo(true) != NO_ERROR) {
+                     ALOGW("Couldn't set SCHED_FIFO for primeCache");
+                 }
+             });
 
     return resultFuture;
 }
@@ -161,16 +207,13 @@ std::future<void> RenderEngineThreaded::primeCache(bool shouldPrimeUltraHDR) {
 void RenderEngineThreaded::dump(std::string& result) {
     std::promise<std::string> resultPromise;
     std::future<std::string> resultFuture = resultPromise.get_future();
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&resultPromise, &result](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::dump");
-            std::string localResult = result;
-            instance.dump(localResult);
-            resultPromise.set_value(std::move(localResult));
-        });
-    }
-    mCondition.notify_one();
+    pushTask("dump", [this, &resultPromise, &result](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::dump");
+        std::string localResult = result;
+        instance.dump(localResult);
+        dumpTaskLatencies(localResult);
+        resultPromise.set_value(std::move(localResult));
+    });
     // Note: This is an rvalue.
     result.assign(resultFuture.get());
 }
@@ -180,29 +223,21 @@ void RenderEngineThreaded::mapExternalTextureBuffer(const sp<GraphicBuffer>& buf
     ATRACE_CALL();
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([=](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::mapExternalTextureBuffer");
-            instance.mapExternalTextureBuffer(buffer, isRenderable);
-        });
-    }
-    mCondition.notify_one();
+    pushTask("mapExternalTextureBuffer", [=](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::mapExternalTextureBuffer");
+        instance.mapExternalTextureBuffer(buffer, isRenderable);
+    });
 }
 
 void RenderEngineThreaded::unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer) {
     ATRACE_CALL();
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push(
-                [=, buffer = std::move(buffer)](renderengine::RenderEngine& instance) mutable {
-                    ATRACE_NAME("REThreaded::unmapExternalTextureBuffer");
-                    instance.unmapExternalTextureBuffer(std::move(buffer));
-                });
-    }
-    mCondition.notify_one();
+    pushTask("unmapExternalTextureBuffer",
+             [=, buffer = std::move(buffer)](renderengine::RenderEngine& instance) mutable {
+                 ATRACE_NAME("REThreaded::unmapExternalTextureBuffer");
+                 instance.unmapExternalTextureBuffer(std::move(buffer));
+             });
 }
 
 size_t RenderEngineThreaded::getMaxTextureSize() const {
@@ -227,15 +262,11 @@ void RenderEngineThreaded::cleanupPostRender() {
 
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([=](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::cleanupPostRender");
-            instance.cleanupPostRender();
-        });
-        mNeedsPostRenderCleanup = false;
-    }
-    mCondition.notify_one();
+    pushTask("cleanupPostRender", [=](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::cleanupPostRender");
+        instance.cleanupPostRender();
+    });
+    mNeedsPostRenderCleanup = false;
 }
 
 bool RenderEngineThreaded::canSkipPostRenderCleanup() const {
@@ -257,33 +288,25 @@ ftl::Future<FenceResult> RenderEngineThreaded::drawLayers(
     const auto resultPromise = std::make_shared<std::promise<FenceResult>>();
     std::future<FenceResult> resultFuture = resultPromise->get_future();
     int fd = bufferFence.release();
-    {
-        std::lock_guard lock(mThreadMutex);
-        mNeedsPostRenderCleanup = true;
-        mFunctionCalls.push(
-                [resultPromise, display, layers, buffer, fd](renderengine::RenderEngine& instance) {
-                    ATRACE_NAME("REThreaded::drawLayers");
-                    instance.updateProtectedContext(layers, buffer);
-                    instance.drawLayersInternal(std::move(resultPromise), display, layers, buffer,
-                                                base::unique_fd(fd));
-                });
-    }
-    mCondition.notify_one();
+    mNeedsPostRenderCleanup = true;
+    pushTask("drawLayers",
+             [resultPromise, display, layers, buffer, fd](renderengine::RenderEngine& instance) {
+                 ATRACE_NAME("REThreaded::drawLayers");
+                 instance.updateProtectedContext(layers, buffer);
+                 instance.drawLayersInternal(std::move(resultPromise), display, layers, buffer,
+                                             base::unique_fd(fd));
+             });
     return resultFuture;
 }
 
 int RenderEngineThreaded::getContextPriority() {
     std::promise<int> resultPromise;
     std::future<int> resultFuture = resultPromise.get_future();
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&resultPromise](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::getContextPriority");
-            int priority = instance.getContextPriority();
-            resultPromise.set_value(priority);
-        });
-    }
-    mCondition.notify_one();
+    pushTask("getContextPriority", [&resultPromise](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::getContextPriority");
+        int priority = instance.getContextPriority();
+        resultPromise.set_value(priority);
+    });
     return resultFuture.get();
 }
 
@@ -295,41 +318,28 @@ bool RenderEngineThreaded::supportsBackgroundBlur() {
 void RenderEngineThreaded::onActiveDisplaySizeChanged(ui::Size size) {
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([size](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::onActiveDisplaySizeChanged");
-            instance.onActiveDisplaySizeChanged(size);
-        });
-    }
-    mCondition.notify_one();
+    pushTask("onActiveDisplaySizeChanged", [size](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::onActiveDisplaySizeChanged");
+        instance.onActiveDisplaySizeChanged(size);
+    });
 }
 
 std::optional<pid_t> RenderEngineThreaded::getRenderEngineTid() const {
     std::promise<pid_t> tidPromise;
     std::future<pid_t> tidFuture = tidPromise.get_future();
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&tidPromise](renderengine::RenderEngine& instance) {
-            tidPromise.set_value(gettid());
-        });
-    }
-
-    mCondition.notify_one();
+    pushTask("getRenderEngineTid", [&tidPromise](renderengine::RenderEngine& instance) {
+        tidPromise.set_value(gettid());
+    });
     return std::make_optional(tidFuture.get());
 }
 
 void RenderEngineThreaded::setEnableTracing(bool tracingEnabled) {
     // This function is designed so it can run asynchronously, so we do not need to wait
     // for the futures.
-    {
-        std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([tracingEnabled](renderengine::RenderEngine& instance) {
-            ATRACE_NAME("REThreaded::setEnableTracing");
-            instance.setEnableTracing(tracingEnabled);
-        });
-    }
-    mCondition.notify_one();
+    pushTask("setEnableTracing", [tracingEnabled](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::setEnableTracing");
+        instance.setEnableTracing(tracingEnabled);
+    });
 }
 } // namespace threaded
 } // namespace renderengine
@@ -17,10 +17,14 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <utils/Timers.h>
+#include <array>
 #include <condition_variable>
+#include <map>
 #include <mutex>
-#include <queue>
+#include <string_view>
 #include <thread>
+#include <vector>
 
 #include "renderengine/RenderEngine.h"
 
@@ -73,10 +77,17 @@ protected:
                             base::unique_fd&& bufferFence) override;
 
 private:
+    using Work = std::function<void(renderengine::RenderEngine&)>;
+
     void threadMain(CreateInstanceFactory factory);
     void waitUntilInitialized() const;
     static status_t setSchedFifo(bool enabled);
 
+    // Queues work for the RenderEngine thread, and only wakes it up if it is waiting. name must
+    // be a string literal, and identifies the task in the latency statistics of dump().
+    void pushTask(const char* name, Work&& work) const;
+    void dumpTaskLatencies(std::string& result) const;
+
     // No-op. This method is only called on leaf implementations of RenderEngine.
     void useProtectedContext(bool) override {}
 
@@ -90,9 +101,34 @@ private:
     std::atomic<bool> mRunning = true;
     std::atomic<bool> mNeedsPostRenderCleanup = false;
 
-    using Work = std::function<void(renderengine::RenderEngine&)>;
-    mutable std::queue<Work> mFunctionCalls GUARDED_BY(mThreadMutex);
+    struct Task {
+        const char* name;
+        nsecs_t queueTime;
+        Work work;
+    };
+    // The RenderEngine thread swaps the pending tasks with the ones it just ran and runs them
+    // all, so both vectors keep their capacity and growing the queue does not allocate. The
+    // std::function of a task still allocates when its captures don't fit inline.
+    mutable std::vector<Task> mFunctionCalls GUARDED_BY(mThreadMutex);
     mutable std::condition_variable mCondition;
+    // Whether the RenderEngine thread waits on mCondition.
+    mutable bool mThreadWaiting GUARDED_BY(mThreadMutex) = false;
+
+    // Counts of durations, in buckets whose limits grow by powers of 4 from 16us.
+    struct LatencyHistogram {
+        static constexpr size_t kNumBuckets = 7;
+        std::array<uint64_t, kNumBuckets> counts{};
+
+        void add(nsecs_t duration);
+        void dump(std::string& result) const;
+    };
+    struct TaskLatencies {
+        // From the time the task is queued to the time it starts.
+        LatencyHistogram queued;
+        LatencyHistogram executed;
+    };
+    // Only accessed on the RenderEngine thread.
+    std::map<std::string_view, TaskLatencies> mTaskLatencies;
 
     // Used to allow select thread safe methods to be accessed without requiring the
     // method to be invoked on the RenderEngine thread
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <math/mat4.h>
+#include <shaders/shaders.h>
+
+#include <vector>
+
+namespace android {
+
+namespace {
+
+// The dataspaces that RenderEngine composes layers from and to.
+constexpr ui::Dataspace kDataspaces[] = {
+        ui::Dataspace::V0_SRGB,       ui::Dataspace::V0_SRGB_LINEAR,
+        ui::Dataspace::DISPLAY_P3,    ui::Dataspace::DISPLAY_BT2020,
+        ui::Dataspace::BT2020_PQ,     ui::Dataspace::BT2020_ITU_PQ,
+        ui::Dataspace::BT2020_HLG,    ui::Dataspace::V0_SCRGB_LINEAR,
+};
+
+constexpr ui::Dataspace kFakeOutputDataspaces[] = {
+        ui::Dataspace::UNKNOWN,
+        static_cast<ui::Dataspace>(ui::Dataspace::STANDARD_BT709 |
+                                   ui::Dataspace::TRANSFER_GAMMA2_2 | ui::Dataspace::RANGE_FULL),
+};
+
+// Every combination of the dataspaces above, with and without premultiplied alpha.
+std::vector<shaders::LinearEffect> createLinearEffects() {
+    std::vector<shaders::LinearEffect> effects;
+    for (ui::Dataspace inputDataspace : kDataspaces) {
+        for (ui::Dataspace outputDataspace : kDataspaces) {
+            for (ui::Dataspace fakeOutputDataspace : kFakeOutputDataspaces) {
+                for (bool undoPremultipliedAlpha : {false, true}) {
+                    effects.push_back({.inputDataspace = inputDataspace,
+                                       .outputDataspace = outputDataspace,
+                                       .undoPremultipliedAlpha = undoPremultipliedAlpha,
+                                       .fakeOutputDataspace = fakeOutputDataspace});
+                }
+            }
+        }
+    }
+    return effects;
+}
+
+/**
+ * The time spent generating the SkSL of every effect for the first time. This runs a single
+ * iteration, since the SkSL of the effects is cached afterwards, so it must run first.
+ */
+void BM_buildLinearEffectSkSL_firstBuild(benchmark::State& state) {
+    const std::vector<shaders::LinearEffect> effects = createLinearEffects();
+    for (auto _ : state) {
+        for (const shaders::LinearEffect& effect : effects) {
+            benchmark::DoNotOptimize(shaders::buildLinearEffectSkSL(effect));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * effects.size());
+}
+BENCHMARK(BM_buildLinearEffectSkSL_firstBuild)->Iterations(1);
+
+/**
+ * The time spent getting the SkSL of every effect once it was generated, as when the layers of a
+ * frame change between HDR and SDR content.
+ */
+void BM_buildLinearEffectSkSL_cached(benchmark::State& state) {
+    const std::vector<shaders::LinearEffect> effects = createLinearEffects();
+    for (auto _ : state) {
+        for (const shaders::LinearEffect& effect : effects) {
+            benchmark::DoNotOptimize(shaders::buildLinearEffectSkSL(effect));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * effects.size());
+}
+BENCHMARK(BM_buildLinearEffectSkSL_cached);
+
+/**
+ * The time spent building the uniforms of every effect, which happens for each HDR layer drawn.
+ */
+void BM_buildLinearEffectUniforms(benchmark::State& state) {
+    const std::vector<shaders::LinearEffect> effects = createLinearEffects();
+    const mat4 colorTransform = mat4::scale(vec4(0.9f, 0.9f, 0.9f, 1.f));
+    for (auto _ : state) {
+        for (const shaders::LinearEffect& effect : effects) {
+            benchmark::DoNotOptimize(
+                    shaders::buildLinearEffectUniforms(effect, colorTransform,
+                                                       /*maxDisplayLuminance=*/1000.f,
+                                                       /*currentDisplayLuminanceNits=*/500.f,
+                                                       /*maxLuminance=*/4000.f));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * effects.size());
+}
+BENCHMARK(BM_buildLinearEffectUniforms);
+
+} // namespace
+
+} // namespace android
@@ -18,8 +18,12 @@
 
 #include <tonemap/tonemap.h>
 
+#include <array>
 #include <cmath>
+#include <mutex>
 #include <optional>
+#include <string_view>
+#include <unordered_map>
 
 #include <math/mat4.h>
 #include <system/graphics-base-v1.0.h>
@@ -33,8 +37,9 @@ aidl::android::hardware::graphics::common::Dataspace toAidlDataspace(ui::Dataspa
     return static_cast<aidl::android::hardware::graphics::common::Dataspace>(dataspace);
 }
 
-void generateXYZTransforms(std::string& shader) {
-    shader.append(R"(
+// The fragments that make up the SkSL of a LinearEffect.
+
+constexpr std::string_view kXYZTransforms = R"(
         uniform float3x3 in_rgbToXyz;
         uniform float3x3 in_xyzToSrcRgb;
         uniform float4x4 in_colorTransform;
@@ -49,7 +54,106 @@ void generateXYZTransforms(std::string& shader) {
         float3 ApplyColorTransform(float3 rgb) {
             return (in_colorTransform * float4(rgb, 1.0)).rgb;
         }
-    )");
+    )";
+
+constexpr std::string_view kScaleLuminanceHLG = R"(
+                float3 ScaleLuminance(float3 xyz) {
+                    return xyz * 264.96;
+                }
+            )";
+
+constexpr std::string_view kScaleLuminance = R"(
+                float3 ScaleLuminance(float3 xyz) {
+                    return xyz * 203.0;
+                }
+            )";
+
+constexpr std::string_view kNormalizeLuminanceToPQ = R"(
+                float3 NormalizeLuminance(float3 xyz) {
+                    return xyz / 203.0;
+                }
+            )";
+
+constexpr std::string_view kNormalizeLuminanceHLGToHLG = R"(
+                            float3 NormalizeLuminance(float3 xyz) {
+                                return xyz / 264.96;
+                            }
+                        )";
+
+constexpr std::string_view kNormalizeLuminanceToHLG = R"(
+                            float3 NormalizeLuminance(float3 xyz) {
+                                float ootfGain = pow(xyz.y / 1000.0, -0.2 / 1.2);
+                                return xyz * ootfGain / 264.96;
+                            }
+                        )";
+
+constexpr std::string_view kNormalizeLuminanceHDRToSDR = R"(
+                        float3 NormalizeLuminance(float3 xyz) {
+                            return xyz / in_libtonemap_displayMaxLuminance;
+                        }
+                    )";
+
+constexpr std::string_view kNormalizeLuminance = R"(
+                        float3 NormalizeLuminance(float3 xyz) {
+                            return xyz / 203.0;
+                        }
+                    )";
+
+constexpr std::string_view kOOTF = R"(
+            float3 OOTF(float3 linearRGB) {
+                float3 scaledLinearRGB = ScaleLuminance(linearRGB);
+                float3 scaledXYZ = ToXYZ(scaledLinearRGB);
+
+                float gain = libtonemap_LookupTonemapGain(ToSrcRGB(scaledXYZ), scaledXYZ);
+
+                return NormalizeLuminance(scaledXYZ * gain);
+            }
+        )";
+
+constexpr std::string_view kOETF = R"(
+        float3 OETF(float3 linear) {
+            return sign(linear) * pow(abs(linear), float3(1.0 / 2.2));
+        }
+    )";
+
+constexpr std::string_view kColorFilterMain = R"(
+                half4 main(half4 inputColor) {
+                    float4 c = float4(inputColor);
+            )";
+
+constexpr std::string_view kShaderMain = R"(
+                uniform shader child;
+                half4 main(float2 xy) {
+                    float4 c = float4(child.eval(xy));
+            )";
+
+constexpr std::string_view kUndoPremultipliedAlpha = R"(
+            c.rgb = c.rgb / (c.a + 0.0019);
+        )";
+
+constexpr std::string_view kApplyLinearTransforms = R"(
+        c.rgb = ApplyColorTransform(OOTF(toLinearSrgb(c.rgb)));
+    )";
+
+constexpr std::string_view kApplyCustomOETF = R"(
+            c.rgb = OETF(c.rgb);
+        )";
+
+constexpr std::string_view kApplyOETF = R"(
+            c.rgb = fromLinearSrgb(c.rgb);
+        )";
+
+constexpr std::string_view kRedoPremultipliedAlpha = R"(
+            c.rgb = c.rgb * (c.a + 0.0019);
+        )";
+
+constexpr std::string_view kReturn = R"(
+            return c;
+        }
+    )";
+
+void generateXYZTransforms(std::string& shader) {
+    shader.append(kXYZTransforms);
 }
 
 // Conversion from relative light to absolute light
@@ -60,18 +164,10 @@ void generateLuminanceScalesForOOTF(ui::Dataspace inputDataspace, std::string& s
             // BT. 2408 says that a signal level of 0.75 == 203 nits for HLG, but that's after
             // applying OOTF. But we haven't applied OOTF yet, so we need to scale by a different
             // constant instead.
-            shader.append(R"(
-                float3 ScaleLuminance(float3 xyz) {
-                    return xyz * 264.96;
-                }
-            )");
+            shader.append(kScaleLuminanceHLG);
             break;
         default:
-            shader.append(R"(
-                float3 ScaleLuminance(float3 xyz) {
-                    return xyz * 203.0;
-                }
-            )");
+            shader.append(kScaleLuminance);
             break;
     }
 }
@@ -82,20 +178,12 @@ static void generateLuminanceNormalizationForOOTF(ui::Dataspace inputDataspace,
                                                   std::string& shader) {
     switch (outputDataspace & HAL_DATASPACE_TRANSFER_MASK) {
         case HAL_DATASPACE_TRANSFER_ST2084:
-            shader.append(R"(
-                float3 NormalizeLuminance(float3 xyz) {
-                    return xyz / 203.0;
-                }
-            )");
+            shader.append(kNormalizeLuminanceToPQ);
             break;
         case HAL_DATASPACE_TRANSFER_HLG:
             switch (inputDataspace & HAL_DATASPACE_TRANSFER_MASK) {
                 case HAL_DATASPACE_TRANSFER_HLG:
-                    shader.append(R"(
-                            float3 NormalizeLuminance(float3 xyz) {
-                                return xyz / 264.96;
-                            }
-                        )");
+                    shader.append(kNormalizeLuminanceHLGToHLG);
                     break;
                 default:
                     // Transcoding to HLG requires applying the inverse OOTF
@@ -107,12 +195,7 @@ static void generateLuminanceNormalizationForOOTF(ui::Dataspace inputDataspace,
                     // rather than 203 nits, because 203 nits == OOTF(invOETF(0.75)), so even though
                     // we originally scaled by 203 nits we need to re-normalize to 264.96 nits when
                     // converting to the correct brightness range.
-                    shader.append(R"(
-                            float3 NormalizeLuminance(float3 xyz) {
-                                float ootfGain = pow(xyz.y / 1000.0, -0.2 / 1.2);
-                                return xyz * ootfGain / 264.96;
-                            }
-                        )");
+                    shader.append(kNormalizeLuminanceToHLG);
                     break;
             }
             break;
@@ -122,20 +205,12 @@ static void generateLuminanceNormalizationForOOTF(ui::Dataspace inputDataspace,
                 case HAL_DATASPACE_TRANSFER_ST2084:
                     // libtonemap outputs a range [0, in_libtonemap_displayMaxLuminance], so
                     // normalize back to [0, 1] when the output is SDR.
-                    shader.append(R"(
-                        float3 NormalizeLuminance(float3 xyz) {
-                            return xyz / in_libtonemap_displayMaxLuminance;
-                        }
-                    )");
+                    shader.append(kNormalizeLuminanceHDRToSDR);
                     break;
                 default:
                     // Otherwise normalize back down to the range [0, 1]
                     // TODO: get this working for extended range outputs
-                    shader.append(R"(
-                        float3 NormalizeLuminance(float3 xyz) {
-                            return xyz / 203.0;
-                        }
-                    )");
+                    shader.append(kNormalizeLuminance);
                     break;
             }
     }
@@ -153,71 +228,38 @@ void generateOOTF(ui::Dataspace inputDataspace, ui::Dataspace outputDataspace,
 
     // Some tonemappers operate on CIE luminance, other tonemappers operate on linear rgb
     // luminance in the source gamut.
-    shader.append(R"(
-            float3 OOTF(float3 linearRGB) {
-                float3 scaledLinearRGB = ScaleLuminance(linearRGB);
-                float3 scaledXYZ = ToXYZ(scaledLinearRGB);
-
-                float gain = libtonemap_LookupTonemapGain(ToSrcRGB(scaledXYZ), scaledXYZ);
-
-                return NormalizeLuminance(scaledXYZ * gain);
-            }
-        )");
+    shader.append(kOOTF);
 }
 
 void generateOETF(std::string& shader) {
     // Only support gamma 2.2 for now
-    shader.append(R"(
-        float3 OETF(float3 linear) {
-            return sign(linear) * pow(abs(linear), float3(1.0 / 2.2));
-        }
-    )");
+    shader.append(kOETF);
 }
 
 void generateEffectiveOOTF(bool undoPremultipliedAlpha, LinearEffect::SkSLType type,
                            bool needsCustomOETF, std::string& shader) {
     switch (type) {
         case LinearEffect::SkSLType::ColorFilter:
-            shader.append(R"(
-                half4 main(half4 inputColor) {
-                    float4 c = float4(inputColor);
-            )");
+            shader.append(kColorFilterMain);
             break;
         case LinearEffect::SkSLType::Shader:
-            shader.append(R"(
-                uniform shader child;
-                half4 main(float2 xy) {
-                    float4 c = float4(child.eval(xy));
-            )");
+            shader.append(kShaderMain);
             break;
     }
     if (undoPremultipliedAlpha) {
-        shader.append(R"(
-            c.rgb = c.rgb / (c.a + 0.0019);
-        )");
+        shader.append(kUndoPremultipliedAlpha);
     }
     // We are using linear sRGB as a working space, with 1.0 == 203 nits
-    shader.append(R"(
-        c.rgb = ApplyColorTransform(OOTF(toLinearSrgb(c.rgb)));
-    )");
+    shader.append(kApplyLinearTransforms);
     if (needsCustomOETF) {
-        shader.append(R"(
-            c.rgb = OETF(c.rgb);
-        )");
+        shader.append(kApplyCustomOETF);
     } else {
-        shader.append(R"(
-            c.rgb = fromLinearSrgb(c.rgb);
-        )");
+        shader.append(kApplyOETF);
     }
     if (undoPremultipliedAlpha) {
-        shader.append(R"(
-            c.rgb = c.rgb * (c.a + 0.0019);
-        )");
+        shader.append(kRedoPremultipliedAlpha);
     }
-    shader.append(R"(
-            return c;
-        }
-    )");
+    shader.append(kReturn);
 }
 
 template <typename T, std::enable_if_t<std::is_trivially_copyable<T>::value, bool> = true>
@@ -228,9 +270,7 @@ std::vector<uint8_t> buildUniformValue(T value) {
     return result;
 }
 
-} // namespace
-
-std::string buildLinearEffectSkSL(const LinearEffect& linearEffect) {
+std::string generateLinearEffectSkSL(const LinearEffect& linearEffect) {
     std::string shaderString;
     generateXYZTransforms(shaderString);
     generateOOTF(linearEffect.inputDataspace, linearEffect.outputDataspace, shaderString);
@@ -245,6 +285,44 @@ std::string buildLinearEffectSkSL(const LinearEffect& linearEffect) {
     return shaderString;
 }
 
+// Unlike LinearEffect's operator==, this compares the type too, which selects the entry point of
+// the SkSL.
+struct SkSLKey {
+    LinearEffect effect;
+
+    bool operator==(const SkSLKey& other) const {
+        return effect == other.effect && effect.type == other.effect.type;
+    }
+};
+
+struct SkSLKeyHasher {
+    size_t operator()(const SkSLKey& key) const {
+        return LinearEffectHasher::HashCombine(LinearEffectHasher{}(key.effect), key.effect.type);
+    }
+};
+
+// Dataspaces are arbitrary values, so the cache is bounded. Devices only use a few dozen effects.
+constexpr size_t kMaxCachedSkSL = 256;
+
+} // namespace
+
+std::string buildLinearEffectSkSL(const LinearEffect& linearEffect) {
+    // The tone mapper is chosen once per process, so the SkSL of an effect never changes and is
+    // only generated the first time the effect is used.
+    static std::mutex sMutex;
+    static auto& sCache = *new std::unordered_map<SkSLKey, std::string, SkSLKeyHasher>();
+
+    std::lock_guard lock(sMutex);
+    const SkSLKey key{linearEffect};
+    if (const auto it = sCache.find(key); it != sCache.end()) {
+        return it->second;
+    }
+    if (sCache.size() >= kMaxCachedSkSL) {
+        sCache.clear();
+    }
+    return sCache.emplace(key, generateLinearEffectSkSL(linearEffect)).first->second;
+}
+
 ColorSpace toColorSpace(ui::Dataspace dataspace) {
     switch (dataspace & HAL_DATASPACE_STANDARD_MASK) {
         case HAL_DATASPACE_STANDARD_BT709:
@@ -271,31 +349,63 @@ ColorSpace toColorSpace(ui::Dataspace dataspace) {
     }
 }
 
+namespace {
+
+// The gamut conversions of a dataspace standard.
+struct GamutMatrices {
+    // To the linear RGB of the standard, from XYZ.
+    mat3 xyzToRgb;
+    // To linear extended sRGB, from the linear RGB of the standard.
+    mat4 rgbToExtendedSrgb;
+    mat4 xyzToRgb4;
+};
+
+constexpr size_t kNumStandards = (HAL_DATASPACE_STANDARD_MASK >> HAL_DATASPACE_STANDARD_SHIFT) + 1;
+
+// Building a ColorSpace computes its matrices, so they are computed once for every standard.
+const GamutMatrices& getGamutMatrices(ui::Dataspace dataspace) {
+    static const auto sMatrices = [] {
+        const mat4 xyzToExtendedSrgb(ColorSpace::linearExtendedSRGB().getXYZtoRGB());
+        std::array<GamutMatrices, kNumStandards> matrices;
+        for (size_t i = 0; i < kNumStandards; i++) {
+            const ColorSpace colorSpace =
+                    toColorSpace(static_cast<ui::Dataspace>(i << HAL_DATASPACE_STANDARD_SHIFT));
+            matrices[i] = {.xyzToRgb = colorSpace.getXYZtoRGB(),
+                           .rgbToExtendedSrgb = xyzToExtendedSrgb * mat4(colorSpace.getRGBtoXYZ()),
+                           .xyzToRgb4 = mat4(colorSpace.getXYZtoRGB())};
+        }
+        return matrices;
+    }();
+    return sMatrices[(dataspace & HAL_DATASPACE_STANDARD_MASK) >> HAL_DATASPACE_STANDARD_SHIFT];
+}
+
+} // namespace
+
 // Generates a list of uniforms to set on the LinearEffect shader above.
 std::vector<tonemap::ShaderUniform> buildLinearEffectUniforms(
         const LinearEffect& linearEffect, const mat4& colorTransform, float maxDisplayLuminance,
         float currentDisplayLuminanceNits, float maxLuminance, AHardwareBuffer* buffer,
         aidl::android::hardware::graphics::composer3::RenderIntent renderIntent) {
-    std::vector<tonemap::ShaderUniform> uniforms;
+    static const std::vector<uint8_t> sRgbToXyz =
+            buildUniformValue<mat3>(ColorSpace::linearExtendedSRGB().getRGBtoXYZ());
 
-    auto inputColorSpace = toColorSpace(linearEffect.inputDataspace);
-    auto outputColorSpace = toColorSpace(linearEffect.outputDataspace);
+    const GamutMatrices& inputMatrices = getGamutMatrices(linearEffect.inputDataspace);
+    const GamutMatrices& outputMatrices = getGamutMatrices(linearEffect.outputDataspace);
 
-    uniforms.push_back(
-            {.name = "in_rgbToXyz",
-             .value = buildUniformValue<mat3>(ColorSpace::linearExtendedSRGB().getRGBtoXYZ())});
+    std::vector<tonemap::ShaderUniform> uniforms;
+    uniforms.reserve(8);
+    uniforms.push_back({.name = "in_rgbToXyz", .value = sRgbToXyz});
     uniforms.push_back({.name = "in_xyzToSrcRgb",
-                        .value = buildUniformValue<mat3>(inputColorSpace.getXYZtoRGB())});
+                        .value = buildUniformValue<mat3>(inputMatrices.xyzToRgb)});
     // Transforms xyz colors to linear source colors, then applies the color transform, then
     // transforms to linear extended RGB for skia to color manage.
     uniforms.push_back({.name = "in_colorTransform",
                         .value = buildUniformValue<mat4>(
-                                mat4(ColorSpace::linearExtendedSRGB().getXYZtoRGB()) *
                                 // TODO: the color transform ideally should be applied
                                 // in the source colorspace, but doing that breaks
                                 // renderengine tests
-                                mat4(outputColorSpace.getRGBtoXYZ()) * colorTransform *
-                                mat4(outputColorSpace.getXYZtoRGB()))});
+                                outputMatrices.rgbToExtendedSrgb * colorTransform *
+                                outputMatrices.xyzToRgb4)});
 
     tonemap::Metadata metadata{.displayMaxLuminance = maxDisplayLuminance,
                                // If the input luminance is unknown, use display luminance (aka,
@@ -309,8 +419,8 @@ std::vector<tonemap::ShaderUniform> buildLinearEffectUniforms(
                                .buffer = buffer,
                                .renderIntent = renderIntent};
 
-    for (const auto uniform : tonemap::getToneMapper()->generateShaderSkSLUniforms(metadata)) {
-        uniforms.push_back(uniform);
+    for (auto& uniform : tonemap::getToneMapper()->generateShaderSkSLUniforms(metadata)) {
+        uniforms.push_back(std::move(uniform));
     }
 
     return uniforms;
@@ -26,6 +26,7 @@ namespace android {
 
 using testing::Contains;
 using testing::HasSubstr;
+using testing::Not;
 
 struct ShadersTest : public ::testing::Test {};
 
@@ -49,6 +50,25 @@ std::vector<uint8_t> buildUniformValue(T value) {
 
 } // namespace
 
+TEST_F(ShadersTest, buildLinearEffectSkSL_isCachedPerType) {
+    const shaders::LinearEffect shader{.inputDataspace = ui::Dataspace::BT2020_PQ,
+                                       .outputDataspace = ui::Dataspace::DISPLAY_P3,
+                                       .undoPremultipliedAlpha = true,
+                                       .type = shaders::LinearEffect::Shader};
+    const shaders::LinearEffect colorFilter{.inputDataspace = ui::Dataspace::BT2020_PQ,
+                                            .outputDataspace = ui::Dataspace::DISPLAY_P3,
+                                            .undoPremultipliedAlpha = true,
+                                            .type = shaders::LinearEffect::ColorFilter};
+
+    const std::string shaderSkSL = shaders::buildLinearEffectSkSL(shader);
+    const std::string colorFilterSkSL = shaders::buildLinearEffectSkSL(colorFilter);
+    EXPECT_THAT(shaderSkSL, HasSubstr("uniform shader child;"));
+    EXPECT_THAT(colorFilterSkSL, HasSubstr("half4 main(half4 inputColor)"));
+    EXPECT_THAT(colorFilterSkSL, Not(HasSubstr("uniform shader child;")));
+    EXPECT_EQ(shaderSkSL, shaders::buildLinearEffectSkSL(shader));
+    EXPECT_EQ(colorFilterSkSL, shaders::buildLinearEffectSkSL(colorFilter));
+}
+
 TEST_F(ShadersTest, buildLinearEffectUniforms_selectsNoOpGamutMatrices) {
     shaders::LinearEffect effect =
             shaders::LinearEffect{.inputDataspace = ui::Dataspace::V0_SRGB_LINEAR,
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <tonemap/tonemap.h>
+
+#include <random>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+using aidl::android::hardware::graphics::common::Dataspace;
+
+// The pixels of a 512x512 thumbnail.
+constexpr size_t kNumPixels = 512 * 512;
+
+const tonemap::Metadata kMetadata{.displayMaxLuminance = 500.f,
+                                  .contentMaxLuminance = 4000.f,
+                                  .currentDisplayLuminance = 300.f};
+
+// Linear colors spread over the luminance range of PQ content, in nits.
+struct Pixels {
+    Pixels() {
+        std::mt19937 random(0);
+        std::uniform_real_distribution<float> distribution(0.f, 1.f);
+        for (size_t i = 0; i < kNumPixels; i++) {
+            // Most of the pixels of HDR content are much darker than its peak.
+            const float peak = 10000.f * std::pow(distribution(random), 4.f);
+            const vec3 linearRGB(peak, peak * distribution(random), peak * distribution(random));
+            const float y = 0.2627f * linearRGB.r + 0.678f * linearRGB.g + 0.0593f * linearRGB.b;
+            colors.push_back({.linearRGB = linearRGB, .xyz = vec3(y)});
+            r.push_back(linearRGB.r);
+            g.push_back(linearRGB.g);
+            b.push_back(linearRGB.b);
+            this->y.push_back(y);
+        }
+    }
+
+    std::vector<tonemap::Color> colors;
+    std::vector<float> r;
+    std::vector<float> g;
+    std::vector<float> b;
+    std::vector<float> y;
+};
+
+const Pixels& getPixels() {
+    static const Pixels sPixels;
+    return sPixels;
+}
+
+// Reports the megapixels tonemapped per second.
+void setPixelRate(benchmark::State& state) {
+    state.counters["MP"] =
+            benchmark::Counter(static_cast<double>(state.iterations() * kNumPixels) / 1e6,
+                               benchmark::Counter::kIsRate);
+}
+
+// The argument is the transfer function of the source, which is tonemapped to SDR.
+void BM_lookupTonemapGain(benchmark::State& state) {
+    const Dataspace source = static_cast<Dataspace>(state.range(0));
+    const Pixels& pixels = getPixels();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                tonemap::getToneMapper()->lookupTonemapGain(source, Dataspace::TRANSFER_SRGB,
+                                                           pixels.colors, kMetadata));
+    }
+    setPixelRate(state);
+}
+BENCHMARK(BM_lookupTonemapGain)
+        ->Arg(static_cast<int64_t>(Dataspace::TRANSFER_ST2084))
+        ->Arg(static_cast<int64_t>(Dataspace::TRANSFER_HLG));
+
+// The arguments are the transfer function of the source, which is tonemapped to SDR, and the
+// GainMode.
+void BM_lookupTonemapGains(benchmark::State& state) {
+    const Dataspace source = static_cast<Dataspace>(state.range(0));
+    const tonemap::GainMode mode = static_cast<tonemap::GainMode>(state.range(1));
+    const Pixels& pixels = getPixels();
+    const tonemap::PlanarColors colors{.r = pixels.r, .g = pixels.g, .b = pixels.b, .y = pixels.y};
+    std::vector<float> gains(kNumPixels);
+    for (auto _ : state) {
+        tonemap::getToneMapper()->lookupTonemapGains(source, Dataspace::TRANSFER_SRGB, colors,
+                                                    kMetadata, gains, mode);
+        benchmark::DoNotOptimize(gains.data());
+        benchmark::ClobberMemory();
+    }
+    setPixelRate(state);
+}
+BENCHMARK(BM_lookupTonemapGains)
+        ->ArgsProduct({{static_cast<int64_t>(Dataspace::TRANSFER_ST2084),
+                        static_cast<int64_t>(Dataspace::TRANSFER_HLG)},
+                       {static_cast<int64_t>(tonemap::GainMode::Exact),
+                        static_cast<int64_t>(tonemap::GainMode::Table)}});
+
+} // namespace
+
+} // namespace android
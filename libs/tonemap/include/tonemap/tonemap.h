@@ -21,6 +21,7 @@
 #include <android/hardware_buffer.h>
 #include <math/vec3.h>
 
+#include <span>
 #include <string>
 #include <vector>
 
@@ -83,6 +84,25 @@ struct Color {
     vec3 xyz;
 };
 
+// Colors stored as one array per channel, for computing the gains of many colors at once.
+struct PlanarColors {
+    // RGB colors in linear space
+    std::span<const float> r;
+    std::span<const float> g;
+    std::span<const float> b;
+    // The Y channel of the CIE 1931 XYZ representation of the colors
+    std::span<const float> y;
+};
+
+// How ToneMapper::lookupTonemapGains() computes the gains.
+enum class GainMode {
+    // Evaluates the tonemapping curve for each color.
+    Exact,
+    // Interpolates the gains from a table of the tonemapping curve, which is built once per call.
+    // The gain of each color of at least 1 nit is within 2% of the exact gain.
+    Table,
+};
+
 class ToneMapper {
 public:
     virtual ~ToneMapper() {}
@@ -148,6 +168,17 @@ public:
             aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
             aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
             const std::vector<Color>& colors, const Metadata& metadata) = 0;
+
+    // Batch implementation of lookupTonemapGain() above, which writes the gain of each color into
+    // gains. Each channel of colors must hold at least gains.size() colors, although tonemappers
+    // may only read the channels that their curve depends on.
+    //
+    // The table mode is meant for large batches, such as the pixels of a screenshot.
+    virtual void lookupTonemapGains(
+            aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+            aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+            const PlanarColors& colors, const Metadata& metadata, std::span<float> gains,
+            GainMode mode = GainMode::Exact) = 0;
 };
 
 // Retrieves a tonemapper instance.
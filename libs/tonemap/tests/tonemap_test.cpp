@@ -85,4 +85,89 @@ TEST_F(TonemapTest, generateTonemapGainShaderSkSL_containsEntryPointForHLG) {
     EXPECT_THAT(shader, HasSubstr("float libtonemap_LookupTonemapGain(vec3 linearRGB, vec3 xyz)"));
 }
 
+namespace {
+
+// Gray colors from black up to brighter than the PQ range, plus a color with a negative channel.
+struct TestColors {
+    TestColors() {
+        for (float nits = 0.f; nits < 12000.f; nits = nits < 1.f ? nits + 0.25f : nits * 1.05f) {
+            add(nits, nits, nits);
+        }
+        add(-1.f, 2.f, 0.5f);
+    }
+
+    void add(float r, float g, float b) {
+        const vec3 linearRGB(r, g, b);
+        const vec3 xyz = vec3(0.2126f * r + 0.7152f * g + 0.0722f * b);
+        colors.push_back({.linearRGB = linearRGB, .xyz = xyz});
+        red.push_back(r);
+        green.push_back(g);
+        blue.push_back(b);
+        y.push_back(xyz.y);
+    }
+
+    tonemap::PlanarColors planar() const {
+        return {.r = red, .g = green, .b = blue, .y = y};
+    }
+
+    std::vector<tonemap::Color> colors;
+    std::vector<float> red;
+    std::vector<float> green;
+    std::vector<float> blue;
+    std::vector<float> y;
+};
+
+constexpr aidl::android::hardware::graphics::common::Dataspace kTransfers[] = {
+        aidl::android::hardware::graphics::common::Dataspace::TRANSFER_SRGB,
+        aidl::android::hardware::graphics::common::Dataspace::TRANSFER_ST2084,
+        aidl::android::hardware::graphics::common::Dataspace::TRANSFER_HLG,
+};
+
+} // namespace
+
+TEST_F(TonemapTest, lookupTonemapGains_exactMatchesLookupTonemapGain) {
+    const TestColors colors;
+    const tonemap::Metadata metadata{.displayMaxLuminance = 500.f,
+                                     .contentMaxLuminance = 4000.f,
+                                     .currentDisplayLuminance = 300.f};
+    for (const auto source : kTransfers) {
+        for (const auto destination : kTransfers) {
+            const std::vector<double> expected =
+                    tonemap::getToneMapper()->lookupTonemapGain(source, destination, colors.colors,
+                                                               metadata);
+            std::vector<float> gains(colors.colors.size());
+            tonemap::getToneMapper()->lookupTonemapGains(source, destination, colors.planar(),
+                                                        metadata, gains, tonemap::GainMode::Exact);
+            for (size_t i = 0; i < gains.size(); i++) {
+                ASSERT_EQ(static_cast<float>(expected[i]), gains[i]) << "color " << i;
+            }
+        }
+    }
+}
+
+TEST_F(TonemapTest, lookupTonemapGains_tableIsWithinBound) {
+    const TestColors colors;
+    const tonemap::Metadata metadata{.displayMaxLuminance = 500.f,
+                                     .contentMaxLuminance = 4000.f,
+                                     .currentDisplayLuminance = 300.f};
+    for (const auto source : kTransfers) {
+        for (const auto destination : kTransfers) {
+            const std::vector<double> expected =
+                    tonemap::getToneMapper()->lookupTonemapGain(source, destination, colors.colors,
+                                                               metadata);
+            std::vector<float> gains(colors.colors.size());
+            tonemap::getToneMapper()->lookupTonemapGains(source, destination, colors.planar(),
+                                                        metadata, gains, tonemap::GainMode::Table);
+            for (size_t i = 0; i < gains.size(); i++) {
+                const float maxRGB = std::max({colors.red[i], colors.green[i], colors.blue[i]});
+                if (maxRGB <= 0.f || colors.y[i] <= 0.f) {
+                    ASSERT_EQ(expected[i], gains[i]) << "color " << i;
+                } else if (maxRGB >= 1.f && colors.y[i] >= 1.f) {
+                    ASSERT_NEAR(expected[i], gains[i], expected[i] * 0.02) << "color " << i;
+                }
+            }
+        }
+    }
+}
+
 } // namespace android
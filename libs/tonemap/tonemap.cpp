@@ -17,6 +17,8 @@
 #include <tonemap/tonemap.h>
 
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdint>
 #include <mutex>
 #include <type_traits>
@@ -64,6 +66,53 @@ float computeHlgGamma(float currentDisplayBrightnessNits) {
     return 1.2 + 0.42 * std::log10(currentDisplayBrightnessNits / 1000);
 }
 
+// The number of intervals of the tables that GainMode::Table interpolates the gains from.
+constexpr size_t kGainTableSize = 1024;
+// The tables cover the luminance range of PQ. The gains of brighter colors are computed exactly.
+constexpr double kGainTableMaxNits = 10000.0;
+
+// Writes the gain of each color into gains, given the luminance of the colors, which the
+// tonemapping curve targetNits maps.
+template <typename Luminance, typename Curve>
+void computeGains(const Luminance& luminance, const Curve& targetNits, std::span<float> gains,
+                  GainMode mode) {
+    if (mode == GainMode::Exact) {
+        for (size_t i = 0; i < gains.size(); i++) {
+            const double nits = luminance(i);
+            gains[i] = nits <= 0.0 ? 1.0f : static_cast<float>(targetNits(nits) / nits);
+        }
+        return;
+    }
+
+    // The table is indexed by the square root of the luminance, so that it samples the dark
+    // colors, where the gain changes the fastest, more densely. The gain of black is 1, so the
+    // first entry is the gain of a color between the first two samples instead.
+    std::array<float, kGainTableSize + 1> table;
+    for (size_t i = 0; i < table.size(); i++) {
+        const double position = i == 0 ? 0.5 : static_cast<double>(i);
+        const double nits = kGainTableMaxNits * std::pow(position / kGainTableSize, 2.0);
+        table[i] = static_cast<float>(targetNits(nits) / nits);
+    }
+
+    // This loop has no branches, so that the compiler can vectorize it.
+    const float scale = static_cast<float>(kGainTableSize / std::sqrt(kGainTableMaxNits));
+    for (size_t i = 0; i < gains.size(); i++) {
+        const float nits = luminance(i);
+        const float position = std::min(std::sqrt(std::max(nits, 0.0f)) * scale,
+                                        static_cast<float>(kGainTableSize));
+        const size_t index = std::min(static_cast<size_t>(position), kGainTableSize - 1);
+        const float t = position - static_cast<float>(index);
+        const float gain = table[index] + t * (table[index + 1] - table[index]);
+        gains[i] = nits <= 0.0f ? 1.0f : gain;
+    }
+    for (size_t i = 0; i < gains.size(); i++) {
+        const double nits = luminance(i);
+        if (nits > kGainTableMaxNits) {
+            gains[i] = static_cast<float>(targetNits(nits) / nits);
+        }
+    }
+}
+
 class ToneMapperO : public ToneMapper {
 public:
     std::string generateTonemapGainShaderSkSL(
@@ -291,111 +340,137 @@ public:
             const std::vector<Color>& colors, const Metadata& metadata) override {
         std::vector<Gain> gains;
         gains.reserve(colors.size());
-
-        for (const auto [_, xyz] : colors) {
-            if (xyz.y <= 0.0) {
-                gains.push_back(1.0);
-                continue;
+        withCurve(sourceDataspace, destinationDataspace, metadata, [&](const auto& targetNits) {
+            for (const auto [_, xyz] : colors) {
+                gains.push_back(xyz.y <= 0.0 ? 1.0 : targetNits(xyz.y) / xyz.y);
             }
-            const int32_t sourceDataspaceInt = static_cast<int32_t>(sourceDataspace);
-            const int32_t destinationDataspaceInt = static_cast<int32_t>(destinationDataspace);
-
-            double targetNits = 0.0;
-            switch (sourceDataspaceInt & kTransferMask) {
-                case kTransferST2084:
-                case kTransferHLG:
-                    switch (destinationDataspaceInt & kTransferMask) {
-                        case kTransferST2084:
-                            targetNits = xyz.y;
-                            break;
-                        case kTransferHLG:
+        });
+        return gains;
+    }
+
+    void lookupTonemapGains(
+            aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+            aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+            const PlanarColors& colors, const Metadata& metadata, std::span<float> gains,
+            GainMode mode) override {
+        withCurve(sourceDataspace, destinationDataspace, metadata, [&](const auto& targetNits) {
+            computeGains([&](size_t i) { return colors.y[i]; }, targetNits, gains, mode);
+        });
+    }
+
+private:
+    // Calls f with the tonemapping curve, which maps the luminance of a color, as CIE Y in nits,
+    // to its tonemapped luminance.
+    template <typename F>
+    void withCurve(aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+                   aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+                   const Metadata& metadata, F&& f) {
+        const int32_t sourceDataspaceInt = static_cast<int32_t>(sourceDataspace);
+        const int32_t destinationDataspaceInt = static_cast<int32_t>(destinationDataspace);
+
+        switch (sourceDataspaceInt & kTransferMask) {
+            case kTransferST2084:
+            case kTransferHLG:
+                switch (destinationDataspaceInt & kTransferMask) {
+                    case kTransferST2084:
+                        f([](double nits) { return nits; });
+                        break;
+                    case kTransferHLG:
+                        f([](double nits) {
                             // PQ has a wider luminance range (10,000 nits vs. 1,000 nits) than HLG,
                             // so we'll clamp the luminance range in case we're mapping from PQ
                             // input to HLG output.
-                            targetNits = std::clamp(xyz.y, 0.0f, 1000.0f);
-                            targetNits *= std::pow(targetNits / 1000.f, -0.2 / 1.2);
+                            const double targetNits = std::clamp(nits, 0.0, 1000.0);
+                            return targetNits * std::pow(targetNits / 1000.0, -0.2 / 1.2);
+                        });
+                        break;
+                    default: {
+                        // Here we're mapping from HDR to SDR content, so interpolate using a
+                        // Hermitian polynomial onto the smaller luminance range.
+                        const bool isHlg = (sourceDataspaceInt & kTransferMask) == kTransferHLG;
+
+                        // if the max input luminance is less than what we can output then
+                        // no tone mapping is needed as all color values will be in range.
+                        if (metadata.contentMaxLuminance <= metadata.displayMaxLuminance) {
+                            f([isHlg](double nits) {
+                                return isHlg ? nits * std::pow(nits, 0.2) : nits;
+                            });
                             break;
-                        default:
-                            // Here we're mapping from HDR to SDR content, so interpolate using a
-                            // Hermitian polynomial onto the smaller luminance range.
-
-                            targetNits = xyz.y;
+                        }
 
-                            if ((sourceDataspaceInt & kTransferMask) == kTransferHLG) {
-                                targetNits *= std::pow(targetNits, 0.2);
-                            }
-                            // if the max input luminance is less than what we can output then
-                            // no tone mapping is needed as all color values will be in range.
-                            if (metadata.contentMaxLuminance > metadata.displayMaxLuminance) {
-                                // three control points
-                                const double x0 = 10.0;
-                                const double y0 = 17.0;
-                                double x1 = metadata.displayMaxLuminance * 0.75;
-                                double y1 = x1;
-                                double x2 = x1 + (metadata.contentMaxLuminance - x1) / 2.0;
-                                double y2 = y1 + (metadata.displayMaxLuminance - y1) * 0.75;
-
-                                // horizontal distances between the last three control points
-                                double h12 = x2 - x1;
-                                double h23 = metadata.contentMaxLuminance - x2;
-                                // tangents at the last three control points
-                                double m1 = (y2 - y1) / h12;
-                                double m3 = (metadata.displayMaxLuminance - y2) / h23;
-                                double m2 = (m1 + m3) / 2.0;
-
-                                if (targetNits < x0) {
-                                    // scale [0.0, x0] to [0.0, y0] linearly
-                                    double slope = y0 / x0;
-                                    targetNits *= slope;
-                                } else if (targetNits < x1) {
-                                    // scale [x0, x1] to [y0, y1] linearly
-                                    double slope = (y1 - y0) / (x1 - x0);
-                                    targetNits = y0 + (targetNits - x0) * slope;
-                                } else if (targetNits < x2) {
-                                    // scale [x1, x2] to [y1, y2] using Hermite interp
-                                    double t = (targetNits - x1) / h12;
-                                    targetNits = (y1 * (1.0 + 2.0 * t) + h12 * m1 * t) * (1.0 - t) *
-                                                    (1.0 - t) +
-                                            (y2 * (3.0 - 2.0 * t) + h12 * m2 * (t - 1.0)) * t * t;
-                                } else {
-                                    // scale [x2, maxInLumi] to [y2, maxOutLumi] using Hermite
-                                    // interp
-                                    double t = (targetNits - x2) / h23;
-                                    targetNits = (y2 * (1.0 + 2.0 * t) + h23 * m2 * t) * (1.0 - t) *
-                                                    (1.0 - t) +
-                                            (metadata.displayMaxLuminance * (3.0 - 2.0 * t) +
-                                             h23 * m3 * (t - 1.0)) *
-                                                    t * t;
-                                }
+                        // three control points
+                        const double x0 = 10.0;
+                        const double y0 = 17.0;
+                        const double x1 = metadata.displayMaxLuminance * 0.75;
+                        const double y1 = x1;
+                        const double x2 = x1 + (metadata.contentMaxLuminance - x1) / 2.0;
+                        const double y2 = y1 + (metadata.displayMaxLuminance - y1) * 0.75;
+                        const double y3 = metadata.displayMaxLuminance;
+
+                        // horizontal distances between the last three control points
+                        const double h12 = x2 - x1;
+                        const double h23 = metadata.contentMaxLuminance - x2;
+                        // tangents at the last three control points
+                        const double m1 = (y2 - y1) / h12;
+                        const double m3 = (y3 - y2) / h23;
+                        const double m2 = (m1 + m3) / 2.0;
+
+                        f([=](double nits) {
+                            double targetNits = isHlg ? nits * std::pow(nits, 0.2) : nits;
+                            if (targetNits < x0) {
+                                // scale [0.0, x0] to [0.0, y0] linearly
+                                double slope = y0 / x0;
+                                targetNits *= slope;
+                            } else if (targetNits < x1) {
+                                // scale [x0, x1] to [y0, y1] linearly
+                                double slope = (y1 - y0) / (x1 - x0);
+                                targetNits = y0 + (targetNits - x0) * slope;
+                            } else if (targetNits < x2) {
+                                // scale [x1, x2] to [y1, y2] using Hermite interp
+                                double t = (targetNits - x1) / h12;
+                                targetNits = (y1 * (1.0 + 2.0 * t) + h12 * m1 * t) * (1.0 - t) *
+                                                (1.0 - t) +
+                                        (y2 * (3.0 - 2.0 * t) + h12 * m2 * (t - 1.0)) * t * t;
+                            } else {
+                                // scale [x2, maxInLumi] to [y2, maxOutLumi] using Hermite interp
+                                double t = (targetNits - x2) / h23;
+                                targetNits = (y2 * (1.0 + 2.0 * t) + h23 * m2 * t) * (1.0 - t) *
+                                                (1.0 - t) +
+                                        (y3 * (3.0 - 2.0 * t) + h23 * m3 * (t - 1.0)) * t * t;
                             }
-                            break;
-                    }
-                    break;
-                default:
-                    // source is SDR
-                    switch (destinationDataspaceInt & kTransferMask) {
-                        case kTransferST2084:
-                        case kTransferHLG: {
-                            // Map from SDR onto an HDR output buffer
-                            // Here we use a polynomial curve to map from [0, displayMaxLuminance]
-                            // onto [0, maxOutLumi] which is hard-coded to be 3000 nits.
-                            const double maxOutLumi = 3000.0;
-
-                            double x0 = 5.0;
-                            double y0 = 2.5;
-                            double x1 = metadata.displayMaxLuminance * 0.7;
-                            double y1 = maxOutLumi * 0.15;
-                            double x2 = metadata.displayMaxLuminance * 0.9;
-                            double y2 = maxOutLumi * 0.45;
-                            double x3 = metadata.displayMaxLuminance;
-                            double y3 = maxOutLumi;
-
-                            double c1 = y1 / 3.0;
-                            double c2 = y2 / 2.0;
-                            double c3 = y3 / 1.5;
-
-                            targetNits = xyz.y;
-
+                            return targetNits;
+                        });
+                    } break;
+                }
+                break;
+            default:
+                // source is SDR
+                switch (destinationDataspaceInt & kTransferMask) {
+                    case kTransferST2084:
+                    case kTransferHLG: {
+                        // Map from SDR onto an HDR output buffer
+                        // Here we use a polynomial curve to map from [0, displayMaxLuminance]
+                        // onto [0, maxOutLumi] which is hard-coded to be 3000 nits.
+                        const double maxOutLumi = 3000.0;
+
+                        const double x0 = 5.0;
+                        const double y0 = 2.5;
+                        const double x1 = metadata.displayMaxLuminance * 0.7;
+                        const double y1 = maxOutLumi * 0.15;
+                        const double x2 = metadata.displayMaxLuminance * 0.9;
+                        const double y2 = maxOutLumi * 0.45;
+                        const double x3 = metadata.displayMaxLuminance;
+                        const double y3 = maxOutLumi;
+
+                        const double c1 = y1 / 3.0;
+                        const double c2 = y2 / 2.0;
+                        const double c3 = y3 / 1.5;
+
+                        const bool isHlg =
+                                (destinationDataspaceInt & kTransferMask) == kTransferHLG;
+
+                        f([=](double nits) {
+                            double targetNits = nits;
                             if (targetNits <= x0) {
                                 // scale [0.0, x0] to [0.0, y0] linearly
                                 double slope = y0 / x0;
@@ -417,26 +492,25 @@ public:
                                         t * t * y3;
                             }
 
-                            if ((destinationDataspaceInt & kTransferMask) == kTransferHLG) {
+                            if (isHlg) {
                                 targetNits *= std::pow(targetNits / 1000.0, -0.2 / 1.2);
                             }
-                        } break;
-                        default:
-                            // For completeness, this is tone-mapping from SDR to SDR, where this is
-                            // just a no-op.
-                            targetNits = xyz.y;
-                            break;
-                    }
-            }
-            gains.push_back(targetNits / xyz.y);
+                            return targetNits;
+                        });
+                    } break;
+                    default:
+                        // For completeness, this is tone-mapping from SDR to SDR, where this is
+                        // just a no-op.
+                        f([](double nits) { return nits; });
+                        break;
+                }
         }
-        return gains;
     }
 };
 
 class ToneMapper13 : public ToneMapper {
 private:
-    double OETF_ST2084(double nits) {
+    static double OETF_ST2084(double nits) {
         nits = nits / 10000.0;
         double m1 = (2610.0 / 4096.0) / 4.0;
         double m2 = (2523.0 / 4096.0) * 128.0;
@@ -632,99 +706,120 @@ public:
             const std::vector<Color>& colors, const Metadata& metadata) override {
         std::vector<Gain> gains;
         gains.reserve(colors.size());
+        withCurve(sourceDataspace, destinationDataspace, metadata, [&](const auto& targetNits) {
+            for (const auto [linearRGB, _] : colors) {
+                const double maxRGB = std::max({linearRGB.r, linearRGB.g, linearRGB.b});
+                gains.push_back(maxRGB <= 0.0 ? 1.0 : targetNits(maxRGB) / maxRGB);
+            }
+        });
+        return gains;
+    }
 
-        // Precompute constants for HDR->SDR tonemapping parameters
-        constexpr double maxInLumi = 4000;
-        const double maxOutLumi = metadata.displayMaxLuminance;
-
-        const double x1 = maxOutLumi * 0.65;
-        const double y1 = x1;
-
-        const double x3 = maxInLumi;
-        const double y3 = maxOutLumi;
+    void lookupTonemapGains(
+            aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+            aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+            const PlanarColors& colors, const Metadata& metadata, std::span<float> gains,
+            GainMode mode) override {
+        withCurve(sourceDataspace, destinationDataspace, metadata, [&](const auto& targetNits) {
+            computeGains(
+                    [&](size_t i) {
+                        return std::max(colors.r[i], std::max(colors.g[i], colors.b[i]));
+                    },
+                    targetNits, gains, mode);
+        });
+    }
 
-        const double x2 = x1 + (x3 - x1) * 4.0 / 17.0;
-        const double y2 = maxOutLumi * 0.9;
+private:
+    // Calls f with the tonemapping curve, which maps the luminance of a color, as the maximum of
+    // its linear RGB channels in nits, to its tonemapped luminance.
+    template <typename F>
+    void withCurve(aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+                   aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+                   const Metadata& metadata, F&& f) {
+        const int32_t sourceDataspaceInt = static_cast<int32_t>(sourceDataspace);
+        const int32_t destinationDataspaceInt = static_cast<int32_t>(destinationDataspace);
+        const double hlgGamma = computeHlgGamma(metadata.currentDisplayLuminance);
 
-        const double greyNorm1 = OETF_ST2084(x1);
-        const double greyNorm2 = OETF_ST2084(x2);
-        const double greyNorm3 = OETF_ST2084(x3);
+        switch (sourceDataspaceInt & kTransferMask) {
+            case kTransferST2084:
+                switch (destinationDataspaceInt & kTransferMask) {
+                    case kTransferST2084:
+                        f([](double nits) { return nits; });
+                        break;
+                    case kTransferHLG:
+                        f([hlgGamma](double nits) {
+                            // PQ has a wider luminance range (10,000 nits vs. 1,000 nits) than HLG,
+                            // so we'll clamp the luminance range in case we're mapping from PQ
+                            // input to HLG output.
+                            const double targetNits = std::clamp(nits, 0.0, 1000.0);
+                            return targetNits *
+                                    std::pow(targetNits / 1000.0, (1 - hlgGamma) / (hlgGamma));
+                        });
+                        break;
+                    default: {
+                        // Precompute constants for HDR->SDR tonemapping parameters
+                        constexpr double maxInLumi = 4000;
+                        const double maxOutLumi = metadata.displayMaxLuminance;
 
-        const double slope2 = (y2 - y1) / (greyNorm2 - greyNorm1);
-        const double slope3 = (y3 - y2) / (greyNorm3 - greyNorm2);
+                        const double x1 = maxOutLumi * 0.65;
+                        const double y1 = x1;
 
-        const double hlgGamma = computeHlgGamma(metadata.currentDisplayLuminance);
+                        const double x3 = maxInLumi;
+                        const double y3 = maxOutLumi;
 
-        for (const auto [linearRGB, _] : colors) {
-            double maxRGB = std::max({linearRGB.r, linearRGB.g, linearRGB.b});
+                        const double x2 = x1 + (x3 - x1) * 4.0 / 17.0;
+                        const double y2 = maxOutLumi * 0.9;
 
-            if (maxRGB <= 0.0) {
-                gains.push_back(1.0);
-                continue;
-            }
+                        const double greyNorm1 = OETF_ST2084(x1);
+                        const double greyNorm2 = OETF_ST2084(x2);
+                        const double greyNorm3 = OETF_ST2084(x3);
 
-            const int32_t sourceDataspaceInt = static_cast<int32_t>(sourceDataspace);
-            const int32_t destinationDataspaceInt = static_cast<int32_t>(destinationDataspace);
+                        const double slope2 = (y2 - y1) / (greyNorm2 - greyNorm1);
+                        const double slope3 = (y3 - y2) / (greyNorm3 - greyNorm2);
 
-            double targetNits = 0.0;
-            switch (sourceDataspaceInt & kTransferMask) {
-                case kTransferST2084:
-                    switch (destinationDataspaceInt & kTransferMask) {
-                        case kTransferST2084:
-                            targetNits = maxRGB;
-                            break;
-                        case kTransferHLG:
-                            // PQ has a wider luminance range (10,000 nits vs. 1,000 nits) than HLG,
-                            // so we'll clamp the luminance range in case we're mapping from PQ
-                            // input to HLG output.
-                            targetNits = std::clamp(maxRGB, 0.0, 1000.0);
-                            targetNits *= pow(targetNits / 1000.0, (1 - hlgGamma) / (hlgGamma));
-                            break;
-                        default:
-                            targetNits = maxRGB;
-                            if (targetNits < x1) {
-                                break;
+                        f([=](double nits) {
+                            if (nits < x1) {
+                                return nits;
                             }
-
-                            if (targetNits > maxInLumi) {
-                                targetNits = maxOutLumi;
-                                break;
+                            if (nits > maxInLumi) {
+                                return maxOutLumi;
                             }
 
-                            const double greyNits = OETF_ST2084(targetNits);
+                            const double greyNits = OETF_ST2084(nits);
 
                             if (greyNits <= greyNorm2) {
-                                targetNits = (greyNits - greyNorm2) * slope2 + y2;
+                                return (greyNits - greyNorm2) * slope2 + y2;
                             } else if (greyNits <= greyNorm3) {
-                                targetNits = (greyNits - greyNorm3) * slope3 + y3;
-                            } else {
-                                targetNits = maxOutLumi;
+                                return (greyNits - greyNorm3) * slope3 + y3;
                             }
-                            break;
-                    }
-                    break;
-                case kTransferHLG:
-                    switch (destinationDataspaceInt & kTransferMask) {
-                        case kTransferST2084:
-                            targetNits = maxRGB * pow(maxRGB / 1000.0, hlgGamma - 1);
-                            break;
-                        case kTransferHLG:
-                            targetNits = maxRGB;
-                            break;
-                        default:
-                            targetNits = maxRGB * pow(maxRGB / 1000.0, hlgGamma - 1) *
-                                    metadata.displayMaxLuminance / 1000.0;
-                            break;
-                    }
-                    break;
-                default:
-                    targetNits = maxRGB;
-                    break;
-            }
-
-            gains.push_back(targetNits / maxRGB);
+                            return maxOutLumi;
+                        });
+                    } break;
+                }
+                break;
+            case kTransferHLG:
+                switch (destinationDataspaceInt & kTransferMask) {
+                    case kTransferST2084:
+                        f([hlgGamma](double nits) {
+                            return nits * std::pow(nits / 1000.0, hlgGamma - 1);
+                        });
+                        break;
+                    case kTransferHLG:
+                        f([](double nits) { return nits; });
+                        break;
+                    default: {
+                        const double displayMaxLuminance = metadata.displayMaxLuminance;
+                        f([hlgGamma, displayMaxLuminance](double nits) {
+                            return nits * std::pow(nits / 1000.0, hlgGamma - 1) *
+                                    displayMaxLuminance / 1000.0;
+                        });
+                    } break;
+                }
+                break;
+            default:
+                f([](double nits) { return nits; });
+                break;
         }
-        return gains;
     }
 };
 
@@ -21,8 +21,10 @@
 #include <cutils/compiler.h>  // For CC_[UN]LIKELY
 #include <utils/Log.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <stdlib.h>
 
+#include <array>
 #include <memory>
 
 namespace android {
@@ -289,6 +291,13 @@ status_t FenceTime::Snapshot::unflatten(
 // ============================================================================
 void FenceTimeline::push(const std::shared_ptr<FenceTime>& fence) {
     std::lock_guard<std::mutex> lock(mMutex);
+    // A fence whose signal time is already known has nothing left to poll, and a fence pushed
+    // twice in a row would be polled twice.
+    if (fence == nullptr || fence->getCachedSignalTime() != Fence::SIGNAL_TIME_PENDING ||
+        (!mQueue.empty() && mQueue.back().lock() == fence)) {
+        mStats.skippedPushes++;
+        return;
+    }
     while (mQueue.size() >= MAX_ENTRIES) {
         // This is a sanity check to make sure the queue doesn't grow unbounded.
         // MAX_ENTRIES should be big enough not to trigger this path.
@@ -301,32 +310,68 @@ void FenceTimeline::push(const std::shared_ptr<FenceTime>& fence) {
             // we are removing it from the timeline.
             front->getSignalTime();
         }
-        mQueue.pop();
+        mQueue.pop_front();
     }
-    mQueue.push(fence);
+    mQueue.push_back(fence);
 }
 
 void FenceTimeline::updateSignalTimes() {
     std::lock_guard<std::mutex> lock(mMutex);
-    while (!mQueue.empty()) {
-        std::shared_ptr<FenceTime> fence = mQueue.front().lock();
-        if (!fence) {
-            // The shared_ptr no longer exists and no one cares about the
-            // timestamp anymore.
-            mQueue.pop();
+    mStats.updates++;
+
+    // Reading the signal time of a fence takes two ioctls whether or not it
+    // signaled, so the pending fences are polled together first and only the
+    // ones that signaled are read.
+    std::array<std::shared_ptr<FenceTime>, MAX_ENTRIES> pending;
+    std::array<sp<Fence>, MAX_ENTRIES> pendingFences;
+    std::array<pollfd, MAX_ENTRIES> pollFds;
+    size_t pendingCount = 0;
+    for (const std::weak_ptr<FenceTime>& entry : mQueue) {
+        std::shared_ptr<FenceTime> fenceTime = entry.lock();
+        if (!fenceTime) {
+            continue;
+        }
+        FenceTime::Snapshot snapshot = fenceTime->getSnapshot();
+        if (snapshot.state != FenceTime::Snapshot::State::FENCE) {
             continue;
-        } else if (fence->getSignalTime() != Fence::SIGNAL_TIME_PENDING) {
-            // The fence has signaled and we've removed the sp<Fence> ref.
-            mQueue.pop();
+        }
+        if (!snapshot.fence->isValid()) {
+            // Fences without a file descriptor are resolved without a syscall.
+            fenceTime->getSignalTime();
             continue;
-        } else {
-            // The fence didn't signal yet. Break since the later ones
-            // shouldn't have signaled either.
+        }
+        pollFds[pendingCount] = {.fd = snapshot.fence->get(), .events = POLLIN, .revents = 0};
+        pendingFences[pendingCount] = std::move(snapshot.fence);
+        pending[pendingCount++] = std::move(fenceTime);
+    }
+
+    if (pendingCount > 0) {
+        mStats.polls++;
+        const bool polled = poll(pollFds.data(), pendingCount, /*timeout=*/0) >= 0;
+        for (size_t i = 0; i < pendingCount; i++) {
+            if (!polled || pollFds[i].revents != 0) {
+                mStats.signalTimeReads++;
+                pending[i]->getSignalTime();
+            }
+        }
+    }
+
+    // Drop the entries at the front that nobody holds anymore or that have
+    // signaled, which also removed their sp<Fence> refs.
+    while (!mQueue.empty()) {
+        std::shared_ptr<FenceTime> fence = mQueue.front().lock();
+        if (fence && fence->getCachedSignalTime() == Fence::SIGNAL_TIME_PENDING) {
             break;
         }
+        mQueue.pop_front();
     }
 }
 
+FenceTimeline::Stats FenceTimeline::getStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
 // ============================================================================
 // FenceToFenceTimeMap
 // ============================================================================
@@ -114,6 +114,7 @@ status_t GraphicBufferMapper::importBuffer(const native_handle_t* rawHandle, uin
         return static_cast<status_t>(error);
     }
 
+    addImportedBuffer(bufferHandle);
     *outHandle = bufferHandle;
 
     return NO_ERROR;
@@ -121,7 +122,52 @@ status_t GraphicBufferMapper::importBuffer(const native_handle_t* rawHandle, uin
 
 status_t GraphicBufferMapper::importBufferNoValidate(const native_handle_t* rawHandle,
                                                      buffer_handle_t* outHandle) {
-    return mMapper->importBuffer(rawHandle, outHandle);
+    const status_t error = mMapper->importBuffer(rawHandle, outHandle);
+    if (error == NO_ERROR) {
+        addImportedBuffer(*outHandle);
+    }
+    return error;
+}
+
+void GraphicBufferMapper::addImportedBuffer(buffer_handle_t bufferHandle) {
+    std::lock_guard lock(mMetadataMutex);
+    mMetadata[bufferHandle] = {};
+}
+
+template <typename T>
+status_t GraphicBufferMapper::getImmutableMetadata(
+        buffer_handle_t bufferHandle, std::optional<T> ImmutableMetadata::*field,
+        status_t (GrallocMapper::*query)(buffer_handle_t, T*) const, T* outValue) {
+    // Only the buffers imported here are cached, since their handles are known to be freed with
+    // freeBuffer, which drops their metadata before the handle can be reused.
+    bool imported;
+    {
+        std::lock_guard lock(mMetadataMutex);
+        const auto it = mMetadata.find(bufferHandle);
+        imported = it != mMetadata.end();
+        if (imported) {
+            if (const std::optional<T>& value = it->second.*field) {
+                mMetadataCacheStats.hits++;
+                *outValue = *value;
+                return OK;
+            }
+            mMetadataCacheStats.misses++;
+        }
+    }
+
+    const status_t status = (mMapper.get()->*query)(bufferHandle, outValue);
+    if (imported && status == OK) {
+        std::lock_guard lock(mMetadataMutex);
+        if (const auto it = mMetadata.find(bufferHandle); it != mMetadata.end()) {
+            it->second.*field = *outValue;
+        }
+    }
+    return status;
+}
+
+GraphicBufferMapper::MetadataCacheStats GraphicBufferMapper::getMetadataCacheStats() const {
+    std::lock_guard lock(mMetadataMutex);
+    return mMetadataCacheStats;
 }
 
 void GraphicBufferMapper::getTransportSize(buffer_handle_t handle,
@@ -134,6 +180,10 @@ status_t GraphicBufferMapper::freeBuffer(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    {
+        std::lock_guard lock(mMetadataMutex);
+        mMetadata.erase(handle);
+    }
     mMapper->freeBuffer(handle);
 
     return NO_ERROR;
@@ -228,7 +278,8 @@ status_t GraphicBufferMapper::isSupported(uint32_t width, uint32_t height,
 }
 
 status_t GraphicBufferMapper::getBufferId(buffer_handle_t bufferHandle, uint64_t* outBufferId) {
-    return mMapper->getBufferId(bufferHandle, outBufferId);
+    return getImmutableMetadata(bufferHandle, &ImmutableMetadata::bufferId,
+                                &GrallocMapper::getBufferId, outBufferId);
 }
 
 status_t GraphicBufferMapper::getName(buffer_handle_t bufferHandle, std::string* outName) {
@@ -236,39 +287,47 @@ status_t GraphicBufferMapper::getName(buffer_handle_t bufferHandle, std::string*
 }
 
 status_t GraphicBufferMapper::getWidth(buffer_handle_t bufferHandle, uint64_t* outWidth) {
-    return mMapper->getWidth(bufferHandle, outWidth);
+    return getImmutableMetadata(bufferHandle, &ImmutableMetadata::width, &GrallocMapper::getWidth,
+                                outWidth);
 }
 
 status_t GraphicBufferMapper::getHeight(buffer_handle_t bufferHandle, uint64_t* outHeight) {
-    return mMapper->getHeight(bufferHandle, outHeight);
+    return getImmutableMetadata(bufferHandle, &ImmutableMetadata::height, &GrallocMapper::getHeight,
+                                outHeight);
 }
 
 status_t GraphicBufferMapper::getLayerCount(buffer_handle_t bufferHandle, uint64_t* outLayerCount) {
-    return mMapper->getLayerCount(bufferHandle, outLayerCount);
+    return getImmutableMetadata(bufferHandle, &ImmutableMetadata::layerCount,
+                                &GrallocMapper::getLayerCount, outLayerCount);
 }
 
 status_t GraphicBufferMapper::getPixelFormatRequested(buffer_handle_t bufferHandle,
                                                       ui::PixelFormat* outPixelFormatRequested) {
-    return mMapper->getPixelFormatRequested(bufferHandle, outPixelFormatRequested);
+    return getImmutableMetadata(bufferHandle, &ImmutableMetadata::pixelFormatRequested,
+                                &GrallocMapper::getPixelFormatRequested, outPixelFormatRequested);
 }
 
 status_t GraphicBufferMapper::getPixelFormatFourCC(buffer_handle_t bufferHandle,
                                                    uint32_t* outPixelFormatFourCC) {
-    return mMapper->getPixelFormatFourCC(bufferHandle, outPixelFormatFourCC);
+    return getImmutableMetadata(bufferHandle, &ImmutableMetadata::pixelFormatFourCC,
+                                &GrallocMapper::getPixelFormatFourCC, outPixelFormatFourCC);
 }
 
 status_t GraphicBufferMapper::getPixelFormatModifier(buffer_handle_t bufferHandle,
                                                      uint64_t* outPixelFormatModifier) {
-    return mMapper->getPixelFormatModifier(bufferHandle, outPixelFormatModifier);
+    return getImmutableMetadata(bufferHandle, &ImmutableMetadata::pixelFormatModifier,
+                                &GrallocMapper::getPixelFormatModifier, outPixelFormatModifier);
 }
 
 status_t GraphicBufferMapper::getUsage(buffer_handle_t bufferHandle, uint64_t* outUsage) {
-    return mMapper->getUsage(bufferHandle, outUsage);
+    return getImmutableMetadata(bufferHandle, &ImmutableMetadata::usage, &GrallocMapper::getUsage,
+                                outUsage);
 }
 
 status_t GraphicBufferMapper::getAllocationSize(buffer_handle_t bufferHandle,
                                                 uint64_t* outAllocationSize) {
-    return mMapper->getAllocationSize(bufferHandle, outAllocationSize);
+    return getImmutableMetadata(bufferHandle, &ImmutableMetadata::allocationSize,
+                                &GrallocMapper::getAllocationSize, outAllocationSize);
 }
 
 status_t GraphicBufferMapper::getProtectedContent(buffer_handle_t bufferHandle,
@@ -311,13 +370,14 @@ status_t GraphicBufferMapper::getChromaSiting(buffer_handle_t bufferHandle,
 
 status_t GraphicBufferMapper::getPlaneLayouts(buffer_handle_t bufferHandle,
                                               std::vector<ui::PlaneLayout>* outPlaneLayouts) {
-    return mMapper->getPlaneLayouts(bufferHandle, outPlaneLayouts);
+    return getImmutableMetadata(bufferHandle, &ImmutableMetadata::planeLayouts,
+                                &GrallocMapper::getPlaneLayouts, outPlaneLayouts);
 }
 
 ui::Result<std::vector<ui::PlaneLayout>> GraphicBufferMapper::getPlaneLayouts(
         buffer_handle_t bufferHandle) {
     std::vector<ui::PlaneLayout> temp;
-    status_t status = mMapper->getPlaneLayouts(bufferHandle, &temp);
+    status_t status = getPlaneLayouts(bufferHandle, &temp);
     if (status == OK) {
         return std::move(temp);
     } else {
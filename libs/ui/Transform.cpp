@@ -23,10 +23,76 @@
 #include <cutils/compiler.h>
 #include <ui/Region.h>
 #include <ui/Transform.h>
+#include <utils/Log.h>
 #include <utils/String8.h>
 
+#include <algorithm>
+#include <array>
+
 namespace android::ui {
 
+namespace {
+
+// The coefficients of a transform whose last row is < 0 , 0 , 1 >.
+struct Affine {
+    float a, b, c, d, x, y;
+};
+
+// Calls store(i, left, top, right, bottom) with the bounds of each transformed rect, using the
+// kernel for the kind of matrix. The products are separate statements so that they are rounded
+// exactly like in transform(const vec2&), rather than fused with the additions.
+template <typename RectType, typename Store>
+void transformBounds(const Affine& m, std::span<const RectType> in, Store store) {
+    const size_t count = in.size();
+    if (m.b == 0 && m.c == 0) {
+        // Identity, translation, scale and flips: the left and right edges only depend on x,
+        // and the top and bottom edges on y.
+        for (size_t i = 0; i < count; i++) {
+            const float l = m.a * static_cast<float>(in[i].left);
+            const float r = m.a * static_cast<float>(in[i].right);
+            const float t = m.d * static_cast<float>(in[i].top);
+            const float b = m.d * static_cast<float>(in[i].bottom);
+            const float x0 = l + m.x;
+            const float x1 = r + m.x;
+            const float y0 = t + m.y;
+            const float y1 = b + m.y;
+            store(i, std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1));
+        }
+    } else if (m.a == 0 && m.d == 0) {
+        // Rotations by 90 and 270 degrees: the edges swap axes.
+        for (size_t i = 0; i < count; i++) {
+            const float t = m.b * static_cast<float>(in[i].top);
+            const float b = m.b * static_cast<float>(in[i].bottom);
+            const float l = m.c * static_cast<float>(in[i].left);
+            const float r = m.c * static_cast<float>(in[i].right);
+            const float x0 = t + m.x;
+            const float x1 = b + m.x;
+            const float y0 = l + m.y;
+            const float y1 = r + m.y;
+            store(i, std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1));
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            const float l = static_cast<float>(in[i].left);
+            const float t = static_cast<float>(in[i].top);
+            const float r = static_cast<float>(in[i].right);
+            const float b = static_cast<float>(in[i].bottom);
+            const float ltx = m.a * l + m.b * t + m.x;
+            const float lty = m.c * l + m.d * t + m.y;
+            const float rtx = m.a * r + m.b * t + m.x;
+            const float rty = m.c * r + m.d * t + m.y;
+            const float lbx = m.a * l + m.b * b + m.x;
+            const float lby = m.c * l + m.d * b + m.y;
+            const float rbx = m.a * r + m.b * b + m.x;
+            const float rby = m.c * r + m.d * b + m.y;
+            store(i, std::min({ltx, rtx, lbx, rbx}), std::min({lty, rty, lby, rby}),
+                  std::max({ltx, rtx, lbx, rbx}), std::max({lty, rty, lby, rby}));
+        }
+    }
+}
+
+} // namespace
+
 Transform::Transform() {
     reset();
 }
@@ -298,14 +364,93 @@ FloatRect Transform::transform(const FloatRect& bounds) const {
     return r;
 }
 
+void Transform::transform(std::span<const vec2> in, std::span<vec2> out) const {
+    LOG_ALWAYS_FATAL_IF(in.size() != out.size(), "Transforming %zu points into %zu", in.size(),
+                        out.size());
+    const mat33& M(mMatrix);
+    const float a = M[0][0];
+    const float b = M[1][0];
+    const float c = M[0][1];
+    const float d = M[1][1];
+    const float x = M[2][0];
+    const float y = M[2][1];
+    const size_t count = in.size();
+
+    if (b == 0 && c == 0) {
+        if (a == 1 && d == 1) {
+            // Identity and translation.
+            for (size_t i = 0; i < count; i++) {
+                out[i] = vec2(in[i].x + x, in[i].y + y);
+            }
+            return;
+        }
+        // Scale and flips.
+        for (size_t i = 0; i < count; i++) {
+            const float sx = a * in[i].x;
+            const float sy = d * in[i].y;
+            out[i] = vec2(sx + x, sy + y);
+        }
+    } else if (a == 0 && d == 0) {
+        // Rotations by 90 and 270 degrees.
+        for (size_t i = 0; i < count; i++) {
+            const float sx = b * in[i].y;
+            const float sy = c * in[i].x;
+            out[i] = vec2(sx + x, sy + y);
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            const vec2 v = in[i];
+            out[i] = vec2(a * v.x + b * v.y + x, c * v.x + d * v.y + y);
+        }
+    }
+}
+
+void Transform::transform(std::span<const FloatRect> in, std::span<FloatRect> out) const {
+    LOG_ALWAYS_FATAL_IF(in.size() != out.size(), "Transforming %zu rects into %zu", in.size(),
+                        out.size());
+    const mat33& M(mMatrix);
+    transformBounds(Affine{M[0][0], M[1][0], M[0][1], M[1][1], M[2][0], M[2][1]}, in,
+                    [out](size_t i, float left, float top, float right, float bottom) {
+                        out[i] = FloatRect(left, top, right, bottom);
+                    });
+}
+
+void Transform::transform(std::span<const Rect> in, std::span<Rect> out,
+                          bool roundOutwards) const {
+    LOG_ALWAYS_FATAL_IF(in.size() != out.size(), "Transforming %zu rects into %zu", in.size(),
+                        out.size());
+    const mat33& M(mMatrix);
+    const Affine m{M[0][0], M[1][0], M[0][1], M[1][1], M[2][0], M[2][1]};
+    if (roundOutwards) {
+        transformBounds(m, in, [out](size_t i, float left, float top, float right, float bottom) {
+            out[i] = Rect(static_cast<int32_t>(floorf(left)), static_cast<int32_t>(floorf(top)),
+                          static_cast<int32_t>(ceilf(right)), static_cast<int32_t>(ceilf(bottom)));
+        });
+    } else {
+        transformBounds(m, in, [out](size_t i, float left, float top, float right, float bottom) {
+            out[i] = Rect(static_cast<int32_t>(floorf(left + 0.5f)),
+                          static_cast<int32_t>(floorf(top + 0.5f)),
+                          static_cast<int32_t>(floorf(right + 0.5f)),
+                          static_cast<int32_t>(floorf(bottom + 0.5f)));
+        });
+    }
+}
+
 Region Transform::transform(const Region& reg) const {
     Region out;
     if (CC_UNLIKELY(type() > TRANSLATE)) {
         if (CC_LIKELY(preserveRects())) {
-            Region::const_iterator it = reg.begin();
-            Region::const_iterator const end = reg.end();
-            while (it != end) {
-                out.orSelf(transform(*it++));
+            // Go through a small stack buffer a chunk at a time, so that transforming a region
+            // does not allocate.
+            const std::span<const Rect> rects(reg.begin(), reg.end());
+            std::array<Rect, 8> transformed;
+            for (size_t i = 0; i < rects.size(); i += transformed.size()) {
+                const std::span<const Rect> chunk =
+                        rects.subspan(i, std::min(transformed.size(), rects.size() - i));
+                transform(chunk, std::span<Rect>(transformed).first(chunk.size()));
+                for (size_t j = 0; j < chunk.size(); j++) {
+                    out.orSelf(transformed[j]);
+                }
             }
         } else {
             out.set(transform(reg.bounds()));
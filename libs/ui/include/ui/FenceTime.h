@@ -23,6 +23,7 @@
 #include <utils/Timers.h>
 
 #include <atomic>
+#include <deque>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
@@ -158,18 +159,37 @@ using FenceTimePtr = std::shared_ptr<FenceTime>;
 // if FenceTimeline did nothing. i.e. they should eventually call
 // Fence::getSignalTime(), not only Fence::getCachedSignalTime().
 //
+// updateSignalTimes() checks all the pending fences with a single poll()
+// and only reads the signal time of the fences that signaled, which takes
+// two ioctls per fence.
+//
 // push() and updateSignalTimes() are safe to call simultaneously from
 // different threads.
 class FenceTimeline {
 public:
     static constexpr size_t MAX_ENTRIES = 64;
 
+    struct Stats {
+        // The number of calls to updateSignalTimes().
+        uint64_t updates = 0;
+        // The number of poll() calls made to check the pending fences.
+        uint64_t polls = 0;
+        // The number of signal times read from the kernel.
+        uint64_t signalTimeReads = 0;
+        // The number of pushed fences that were not queued, because their
+        // signal time was known or they were already at the back.
+        uint64_t skippedPushes = 0;
+    };
+
     void push(const std::shared_ptr<FenceTime>& fence);
     void updateSignalTimes();
 
+    Stats getStats() const;
+
 private:
     mutable std::mutex mMutex;
-    std::queue<std::weak_ptr<FenceTime>> mQueue GUARDED_BY(mMutex);
+    std::deque<std::weak_ptr<FenceTime>> mQueue GUARDED_BY(mMutex);
+    Stats mStats GUARDED_BY(mMutex);
 };
 
 // Used by test code to create or get FenceTimes for a given Fence.
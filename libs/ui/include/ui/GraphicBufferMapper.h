@@ -21,7 +21,12 @@
 #include <sys/types.h>
 
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
+#include <android-base/thread_annotations.h>
 #include <android-base/unique_fd.h>
 #include <ui/GraphicTypes.h>
 #include <ui/PixelFormat.h>
@@ -176,14 +181,55 @@ public:
 
     Version getMapperVersion() const { return mMapperVersion; }
 
-private:
+    /**
+     * Counts the queries of the metadata that gralloc fixes at allocation, for the buffers imported
+     * with importBuffer or importBufferNoValidate. Each of these is only sent to gralloc once per
+     * import, and answered from the cache afterwards.
+     */
+    struct MetadataCacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+    MetadataCacheStats getMetadataCacheStats() const;
+
+protected:
     friend class Singleton<GraphicBufferMapper>;
 
     GraphicBufferMapper();
 
     std::unique_ptr<const GrallocMapper> mMapper;
 
+private:
+    // The metadata of a buffer that never changes after allocation. The dataspace and the HDR
+    // metadata are not cached, since the other processes that imported the buffer may set them.
+    struct ImmutableMetadata {
+        std::optional<uint64_t> bufferId;
+        std::optional<uint64_t> width;
+        std::optional<uint64_t> height;
+        std::optional<uint64_t> layerCount;
+        std::optional<ui::PixelFormat> pixelFormatRequested;
+        std::optional<uint32_t> pixelFormatFourCC;
+        std::optional<uint64_t> pixelFormatModifier;
+        std::optional<uint64_t> usage;
+        std::optional<uint64_t> allocationSize;
+        std::optional<std::vector<ui::PlaneLayout>> planeLayouts;
+    };
+
+    void addImportedBuffer(buffer_handle_t bufferHandle);
+
+    // Returns the field of the cached metadata of the buffer, and queries gralloc with query if it
+    // is not cached yet.
+    template <typename T>
+    status_t getImmutableMetadata(buffer_handle_t bufferHandle,
+                                  std::optional<T> ImmutableMetadata::*field,
+                                  status_t (GrallocMapper::*query)(buffer_handle_t, T*) const,
+                                  T* outValue);
+
     Version mMapperVersion;
+
+    mutable std::mutex mMetadataMutex;
+    std::unordered_map<buffer_handle_t, ImmutableMetadata> mMetadata GUARDED_BY(mMetadataMutex);
+    MetadataCacheStats mMetadataCacheStats GUARDED_BY(mMetadataMutex);
 };
 
 // ---------------------------------------------------------------------------
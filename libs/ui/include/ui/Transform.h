@@ -20,6 +20,7 @@
 #include <sys/types.h>
 #include <array>
 #include <ostream>
+#include <span>
 #include <string>
 
 #include <math/mat4.h>
@@ -103,6 +104,15 @@ public:
     vec2 transform(const vec2& v) const;
     vec3 transform(const vec3& v) const;
 
+    // Batched versions of transform(), which give the same results as transforming each element
+    // on its own. The kernel for the kind of matrix (translation, scale, rotation by a multiple
+    // of 90 degrees, or any affine transform) is picked once for the whole batch, and has no
+    // branches so that it can be vectorized. out must have the size of in, and may alias it.
+    void transform(std::span<const vec2> in, std::span<vec2> out) const;
+    void transform(std::span<const FloatRect> in, std::span<FloatRect> out) const;
+    void transform(std::span<const Rect> in, std::span<Rect> out,
+                   bool roundOutwards = false) const;
+
     // Expands from the internal 3x3 matrix to an equivalent 4x4 matrix
     mat4 asMatrix4() const;
 
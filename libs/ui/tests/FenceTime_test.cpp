@@ -0,0 +1,93 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <ui/FenceTime.h>
+
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace android {
+
+namespace {
+
+// A fence that never signals, backed by the read end of an empty pipe.
+std::shared_ptr<FenceTime> makePendingFenceTime(base::unique_fd& outWriteEnd) {
+    int fds[2];
+    EXPECT_EQ(0, pipe(fds));
+    outWriteEnd.reset(fds[1]);
+    return std::make_shared<FenceTime>(sp<Fence>::make(fds[0]));
+}
+
+} // namespace
+
+TEST(FenceTimelineTest, PushSkipsResolvedAndRepeatedFences) {
+    FenceToFenceTimeMap fenceMap;
+    FenceTimeline timeline;
+
+    timeline.push(std::make_shared<FenceTime>(nsecs_t(10)));
+    const std::shared_ptr<FenceTime> pending = fenceMap.makePendingFenceForTest().second;
+    timeline.push(pending);
+    timeline.push(pending);
+
+    EXPECT_EQ(2u, timeline.getStats().skippedPushes);
+}
+
+TEST(FenceTimelineTest, UpdatePollsAllPendingFencesAtOnce) {
+    base::unique_fd writeEnds[3];
+    FenceTimeline timeline;
+    std::vector<std::shared_ptr<FenceTime>> fences;
+    for (base::unique_fd& writeEnd : writeEnds) {
+        fences.push_back(makePendingFenceTime(writeEnd));
+        timeline.push(fences.back());
+    }
+
+    timeline.updateSignalTimes();
+    timeline.updateSignalTimes();
+
+    const FenceTimeline::Stats stats = timeline.getStats();
+    EXPECT_EQ(2u, stats.updates);
+    EXPECT_EQ(2u, stats.polls);
+    EXPECT_EQ(0u, stats.signalTimeReads);
+    for (const std::shared_ptr<FenceTime>& fence : fences) {
+        EXPECT_EQ(Fence::SIGNAL_TIME_PENDING, fence->getCachedSignalTime());
+    }
+}
+
+TEST(FenceTimelineTest, UpdateDropsSignaledFences) {
+    FenceToFenceTimeMap fenceMap;
+    FenceTimeline timeline;
+    const auto [fence, fenceTime] = fenceMap.makePendingFenceForTest();
+    timeline.push(fenceTime);
+
+    timeline.updateSignalTimes();
+    EXPECT_EQ(Fence::SIGNAL_TIME_PENDING, fenceTime->getCachedSignalTime());
+
+    fenceMap.signalAllForTest(fence, 20);
+    timeline.updateSignalTimes();
+    EXPECT_EQ(20, fenceTime->getCachedSignalTime());
+
+    // A signaled fence is not queued again.
+    timeline.push(fenceTime);
+    // Fences without a file descriptor never need a poll.
+    EXPECT_EQ(0u, timeline.getStats().polls);
+    EXPECT_EQ(1u, timeline.getStats().skippedPushes);
+}
+
+} // namespace android
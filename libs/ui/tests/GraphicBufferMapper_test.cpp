@@ -0,0 +1,183 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "GraphicBufferMapperTest"
+
+#include <ui/Gralloc.h>
+#include <ui/GraphicBufferMapper.h>
+
+#include <cutils/native_handle.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace android {
+
+namespace {
+
+// A mapper whose buffers have no memory, and which counts the metadata queries that reach it.
+class FakeGrallocMapper : public GrallocMapper {
+public:
+    bool isLoaded() const override { return true; }
+
+    status_t importBuffer(const native_handle_t* rawHandle,
+                          buffer_handle_t* outBufferHandle) const override {
+        *outBufferHandle = native_handle_clone(rawHandle);
+        return *outBufferHandle ? OK : NO_MEMORY;
+    }
+
+    void freeBuffer(buffer_handle_t bufferHandle) const override {
+        native_handle_t* handle = const_cast<native_handle_t*>(bufferHandle);
+        native_handle_close(handle);
+        native_handle_delete(handle);
+    }
+
+    status_t validateBufferSize(buffer_handle_t, uint32_t, uint32_t, PixelFormat, uint32_t,
+                                uint64_t, uint32_t) const override {
+        return OK;
+    }
+
+    void getTransportSize(buffer_handle_t, uint32_t* outNumFds,
+                          uint32_t* outNumInts) const override {
+        *outNumFds = 0;
+        *outNumInts = 0;
+    }
+
+    status_t lock(buffer_handle_t, uint64_t, const Rect&, int acquireFence, void**, int32_t*,
+                  int32_t*) const override {
+        if (acquireFence >= 0) close(acquireFence);
+        return INVALID_OPERATION;
+    }
+
+    status_t lock(buffer_handle_t, uint64_t, const Rect&, int acquireFence,
+                  android_ycbcr*) const override {
+        if (acquireFence >= 0) close(acquireFence);
+        return INVALID_OPERATION;
+    }
+
+    int unlock(buffer_handle_t) const override { return -1; }
+
+    status_t getPixelFormatRequested(buffer_handle_t,
+                                     ui::PixelFormat* outPixelFormatRequested) const override {
+        mQueries++;
+        *outPixelFormatRequested = ui::PixelFormat::RGBA_8888;
+        return OK;
+    }
+
+    status_t getPlaneLayouts(buffer_handle_t,
+                             std::vector<ui::PlaneLayout>* outPlaneLayouts) const override {
+        mQueries++;
+        *outPlaneLayouts = {ui::PlaneLayout{.strideInBytes = 256, .widthInSamples = 64}};
+        return OK;
+    }
+
+    status_t getDataspace(buffer_handle_t, ui::Dataspace* outDataspace) const override {
+        mQueries++;
+        *outDataspace = ui::Dataspace::V0_SRGB;
+        return OK;
+    }
+
+    int getQueries() const { return mQueries; }
+
+private:
+    mutable int mQueries = 0;
+};
+
+class TestableGraphicBufferMapper : public GraphicBufferMapper {
+public:
+    TestableGraphicBufferMapper() { mMapper = std::make_unique<const FakeGrallocMapper>(); }
+
+    int getQueries() const { return static_cast<const FakeGrallocMapper&>(*mMapper).getQueries(); }
+};
+
+} // namespace
+
+class GraphicBufferMapperTest : public testing::Test {
+protected:
+    GraphicBufferMapperTest() : mRawHandle(native_handle_create(/*numFds=*/0, /*numInts=*/0)) {}
+    ~GraphicBufferMapperTest() { native_handle_delete(mRawHandle); }
+
+    buffer_handle_t importBuffer() {
+        buffer_handle_t handle = nullptr;
+        EXPECT_EQ(OK,
+                  mMapper.importBuffer(mRawHandle, 64, 64, 1, PIXEL_FORMAT_RGBA_8888,
+                                       GRALLOC_USAGE_SW_READ_OFTEN, 64, &handle));
+        return handle;
+    }
+
+    native_handle_t* const mRawHandle;
+    TestableGraphicBufferMapper mMapper;
+};
+
+TEST_F(GraphicBufferMapperTest, ImportedBuffer_QueriesImmutableMetadataOnce) {
+    buffer_handle_t handle = importBuffer();
+    ASSERT_NE(nullptr, handle);
+
+    for (int i = 0; i < 2; i++) {
+        ui::PixelFormat format;
+        ASSERT_EQ(OK, mMapper.getPixelFormatRequested(handle, &format));
+        EXPECT_EQ(ui::PixelFormat::RGBA_8888, format);
+
+        ui::Result<std::vector<ui::PlaneLayout>> planeLayouts = mMapper.getPlaneLayouts(handle);
+        ASSERT_TRUE(planeLayouts.has_value());
+        ASSERT_EQ(1u, planeLayouts->size());
+        EXPECT_EQ(256, (*planeLayouts)[0].strideInBytes);
+    }
+    EXPECT_EQ(2, mMapper.getQueries());
+    EXPECT_EQ(2u, mMapper.getMetadataCacheStats().hits);
+    EXPECT_EQ(2u, mMapper.getMetadataCacheStats().misses);
+
+    mMapper.freeBuffer(handle);
+}
+
+TEST_F(GraphicBufferMapperTest, Dataspace_IsNotCached) {
+    buffer_handle_t handle = importBuffer();
+    ASSERT_NE(nullptr, handle);
+
+    ui::Dataspace dataspace;
+    ASSERT_EQ(OK, mMapper.getDataspace(handle, &dataspace));
+    ASSERT_EQ(OK, mMapper.getDataspace(handle, &dataspace));
+    EXPECT_EQ(2, mMapper.getQueries());
+    EXPECT_EQ(0u, mMapper.getMetadataCacheStats().hits);
+
+    mMapper.freeBuffer(handle);
+}
+
+TEST_F(GraphicBufferMapperTest, FreedBuffer_DropsItsMetadata) {
+    ui::PixelFormat format;
+    buffer_handle_t handle = importBuffer();
+    ASSERT_EQ(OK, mMapper.getPixelFormatRequested(handle, &format));
+    mMapper.freeBuffer(handle);
+
+    // The new import may get the address of the freed handle.
+    handle = importBuffer();
+    ASSERT_EQ(OK, mMapper.getPixelFormatRequested(handle, &format));
+    EXPECT_EQ(2, mMapper.getQueries());
+    EXPECT_EQ(0u, mMapper.getMetadataCacheStats().hits);
+    EXPECT_EQ(2u, mMapper.getMetadataCacheStats().misses);
+
+    mMapper.freeBuffer(handle);
+}
+
+TEST_F(GraphicBufferMapperTest, BufferNotImported_IsNotCached) {
+    ui::PixelFormat format;
+    ASSERT_EQ(OK, mMapper.getPixelFormatRequested(mRawHandle, &format));
+    ASSERT_EQ(OK, mMapper.getPixelFormatRequested(mRawHandle, &format));
+    EXPECT_EQ(2, mMapper.getQueries());
+    EXPECT_EQ(0u, mMapper.getMetadataCacheStats().hits);
+    EXPECT_EQ(0u, mMapper.getMetadataCacheStats().misses);
+}
+
+} // namespace android
@@ -18,6 +18,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 namespace android::ui {
 
 TEST(TransformTest, inverseRotation_hasCorrectType) {
@@ -46,4 +48,67 @@ TEST(TransformTest, inverseRotation_hasCorrectType) {
     testRotationFlagsForInverse(Transform::FLIP_V, Transform::FLIP_V, false);
 }
 
+// The transforms of each batched kernel.
+std::vector<Transform> getBatchedTransforms() {
+    Transform translate;
+    translate.set(12.5f, -3.25f);
+    Transform scale;
+    scale.set(1.5f, 0, 0, 0.75f);
+    scale.set(-20.f, 40.f);
+    Transform skew;
+    skew.set(0.8660254f, 0.5f, -0.5f, 0.8660254f);
+    skew.set(7.f, 3.f);
+    return {Transform(),
+            translate,
+            scale,
+            Transform(Transform::FLIP_H, 1080, 2340),
+            Transform(Transform::ROT_90, 1080, 2340),
+            Transform(Transform::ROT_270, 1080, 2340),
+            skew};
+}
+
+TEST(TransformTest, batchedPoints_matchSinglePoints) {
+    const std::vector<vec2> points = {{0.f, 0.f}, {1.5f, -2.25f}, {1079.9f, 2339.1f},
+                                      {-300.f, 45.125f}};
+    for (const Transform& t : getBatchedTransforms()) {
+        std::vector<vec2> transformed(points.size());
+        t.transform(points, transformed);
+        for (size_t i = 0; i < points.size(); i++) {
+            EXPECT_EQ(t.transform(points[i]), transformed[i]);
+        }
+
+        // The points can be transformed in place.
+        std::vector<vec2> inPlace = points;
+        t.transform(inPlace, inPlace);
+        EXPECT_EQ(transformed, inPlace);
+    }
+}
+
+TEST(TransformTest, batchedFloatRects_matchSingleRects) {
+    const std::vector<FloatRect> rects = {{0.f, 0.f, 1080.f, 2340.f},
+                                          {10.5f, 20.25f, 30.75f, 400.f},
+                                          {-5.f, -5.f, 5.f, 5.f}};
+    for (const Transform& t : getBatchedTransforms()) {
+        std::vector<FloatRect> transformed(rects.size());
+        t.transform(rects, transformed);
+        for (size_t i = 0; i < rects.size(); i++) {
+            EXPECT_EQ(t.transform(rects[i]), transformed[i]);
+        }
+    }
+}
+
+TEST(TransformTest, batchedRects_matchSingleRects) {
+    const std::vector<Rect> rects = {Rect(1080, 2340), Rect(10, 20, 31, 401),
+                                     Rect(-5, -5, 5, 5)};
+    for (const Transform& t : getBatchedTransforms()) {
+        for (bool roundOutwards : {false, true}) {
+            std::vector<Rect> transformed(rects.size());
+            t.transform(rects, transformed, roundOutwards);
+            for (size_t i = 0; i < rects.size(); i++) {
+                EXPECT_EQ(t.transform(rects[i], roundOutwards), transformed[i]);
+            }
+        }
+    }
+}
+
 } // namespace android::ui
@@ -0,0 +1,284 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EvemuRecording.h"
+
+#include <linux/input.h>
+
+#include <algorithm>
+
+namespace android {
+
+namespace {
+
+constexpr uint16_t BUS_USB_ID = 0x03;
+constexpr uint16_t BUS_I2C_ID = 0x18;
+
+// The time between a lift and the next touch.
+constexpr nsecs_t GESTURE_GAP = ms2ns(100);
+
+/**
+ * Appends events to a recording, one sync frame at a time.
+ */
+class EventWriter {
+public:
+    EventWriter(EvemuRecording& recording, nsecs_t frameInterval)
+          : mRecording(recording), mFrameInterval(frameInterval) {}
+
+    void write(int32_t type, int32_t code, int32_t value) {
+        mRecording.events.push_back({mWhen, type, code, value});
+    }
+
+    /* Ends the current frame with a SYN_REPORT. */
+    void sync() {
+        write(EV_SYN, SYN_REPORT, 0);
+        mWhen += mFrameInterval;
+    }
+
+    void wait(nsecs_t duration) { mWhen += duration; }
+
+private:
+    EvemuRecording& mRecording;
+    const nsecs_t mFrameInterval;
+    // The first event is at 1us, like in the recordings of evemu-record.
+    nsecs_t mWhen = us2ns(1);
+};
+
+/**
+ * Touches of one or more fingers that move in a straight line, from their first frame to their
+ * last, all by the same amount. The fingers are spread horizontally.
+ */
+struct Gesture {
+    int32_t fingerCount;
+    int32_t frameCount;
+    int32_t startX;
+    int32_t startY;
+    int32_t endX;
+    int32_t endY;
+    int32_t fingerSpacing;
+};
+
+int32_t interpolate(int32_t start, int32_t end, int32_t frame, int32_t frameCount) {
+    return frameCount <= 1 ? start : start + (end - start) * frame / (frameCount - 1);
+}
+
+void writeTouchscreenGesture(EventWriter& writer, const Gesture& gesture, int32_t& trackingId) {
+    for (int32_t frame = 0; frame < gesture.frameCount; frame++) {
+        for (int32_t finger = 0; finger < gesture.fingerCount; finger++) {
+            writer.write(EV_ABS, ABS_MT_SLOT, finger);
+            if (frame == 0) {
+                writer.write(EV_ABS, ABS_MT_TRACKING_ID, trackingId++);
+            }
+            writer.write(EV_ABS, ABS_MT_POSITION_X,
+                         interpolate(gesture.startX, gesture.endX, frame, gesture.frameCount) +
+                                 finger * gesture.fingerSpacing);
+            writer.write(EV_ABS, ABS_MT_POSITION_Y,
+                         interpolate(gesture.startY, gesture.endY, frame, gesture.frameCount));
+            writer.write(EV_ABS, ABS_MT_PRESSURE, 64 + (frame + finger) % 16);
+            writer.write(EV_ABS, ABS_MT_TOUCH_MAJOR, 16 + (frame + finger) % 4);
+        }
+        if (frame == 0) {
+            writer.write(EV_KEY, BTN_TOUCH, 1);
+        }
+        writer.sync();
+    }
+    for (int32_t finger = 0; finger < gesture.fingerCount; finger++) {
+        writer.write(EV_ABS, ABS_MT_SLOT, finger);
+        writer.write(EV_ABS, ABS_MT_TRACKING_ID, -1);
+    }
+    writer.write(EV_KEY, BTN_TOUCH, 0);
+    writer.sync();
+    writer.wait(GESTURE_GAP);
+}
+
+int32_t getTouchpadToolCode(int32_t fingerCount) {
+    switch (fingerCount) {
+        case 1:
+            return BTN_TOOL_FINGER;
+        case 2:
+            return BTN_TOOL_DOUBLETAP;
+        default:
+            return BTN_TOOL_TRIPLETAP;
+    }
+}
+
+void writeTouchpadGesture(EventWriter& writer, const Gesture& gesture, bool click,
+                          int32_t& trackingId) {
+    const int32_t toolCode = getTouchpadToolCode(gesture.fingerCount);
+    for (int32_t frame = 0; frame < gesture.frameCount; frame++) {
+        const int32_t x = interpolate(gesture.startX, gesture.endX, frame, gesture.frameCount);
+        const int32_t y = interpolate(gesture.startY, gesture.endY, frame, gesture.frameCount);
+        const int32_t pressure = 40 + frame % 16;
+        for (int32_t finger = 0; finger < gesture.fingerCount; finger++) {
+            writer.write(EV_ABS, ABS_MT_SLOT, finger);
+            if (frame == 0) {
+                writer.write(EV_ABS, ABS_MT_TRACKING_ID, trackingId++);
+            }
+            writer.write(EV_ABS, ABS_MT_POSITION_X, x + finger * gesture.fingerSpacing);
+            writer.write(EV_ABS, ABS_MT_POSITION_Y, y);
+            writer.write(EV_ABS, ABS_MT_PRESSURE, pressure);
+        }
+        if (frame == 0) {
+            writer.write(EV_KEY, toolCode, 1);
+            writer.write(EV_KEY, BTN_TOUCH, 1);
+        }
+        // The button is pressed in the middle of the gesture, and released two frames later.
+        if (click && frame == gesture.frameCount / 2) {
+            writer.write(EV_KEY, BTN_LEFT, 1);
+        } else if (click && frame == gesture.frameCount / 2 + 2) {
+            writer.write(EV_KEY, BTN_LEFT, 0);
+        }
+        // The single touch axes follow the first finger.
+        writer.write(EV_ABS, ABS_X, x);
+        writer.write(EV_ABS, ABS_Y, y);
+        writer.write(EV_ABS, ABS_PRESSURE, pressure);
+        writer.sync();
+    }
+    for (int32_t finger = 0; finger < gesture.fingerCount; finger++) {
+        writer.write(EV_ABS, ABS_MT_SLOT, finger);
+        writer.write(EV_ABS, ABS_MT_TRACKING_ID, -1);
+    }
+    writer.write(EV_KEY, toolCode, 0);
+    writer.write(EV_KEY, BTN_TOUCH, 0);
+    writer.write(EV_ABS, ABS_PRESSURE, 0);
+    writer.sync();
+    writer.wait(GESTURE_GAP);
+}
+
+} // namespace
+
+EvemuRecording EvemuRecording::createTouchscreen() {
+    EvemuRecording recording;
+    recording.name = "Synthetic Touchscreen";
+    recording.bus = BUS_I2C_ID;
+    recording.version = 1;
+    recording.properties = {INPUT_PROP_DIRECT};
+    recording.codes = {{EV_SYN, SYN_REPORT}, {EV_KEY, BTN_TOUCH}};
+    recording.absoluteAxes = {
+            {ABS_MT_SLOT, 0, 9, 0, 0, 0},
+            {ABS_MT_TOUCH_MAJOR, 0, 255, 0, 0, 0},
+            {ABS_MT_POSITION_X, 0, 1439, 0, 0, 0},
+            {ABS_MT_POSITION_Y, 0, 3119, 0, 0, 0},
+            {ABS_MT_TRACKING_ID, 0, 65535, 0, 0, 0},
+            {ABS_MT_PRESSURE, 0, 255, 0, 0, 0},
+    };
+
+    EventWriter writer(recording, us2ns(8333));
+    int32_t trackingId = 100;
+    // Taps, then vertical swipes like scrolls, then swipes of more fingers.
+    for (int32_t i = 0; i < 4; i++) {
+        writeTouchscreenGesture(writer, {1, 2, 300 + i * 250, 2500, 300 + i * 250, 2500, 0},
+                                trackingId);
+    }
+    for (int32_t i = 0; i < 4; i++) {
+        writeTouchscreenGesture(writer, {1, 60, 720, 2600, 720 - i * 50, 600, 0}, trackingId);
+    }
+    writeTouchscreenGesture(writer, {2, 90, 400, 2000, 500, 800, 300}, trackingId);
+    writeTouchscreenGesture(writer, {3, 90, 300, 2400, 300, 1200, 300}, trackingId);
+    writeTouchscreenGesture(writer, {5, 120, 100, 2800, 100, 1600, 250}, trackingId);
+    return recording;
+}
+
+EvemuRecording EvemuRecording::createTouchpad() {
+    EvemuRecording recording;
+    recording.name = "Synthetic Touchpad";
+    recording.bus = BUS_I2C_ID;
+    recording.version = 1;
+    recording.properties = {INPUT_PROP_POINTER, INPUT_PROP_BUTTONPAD};
+    recording.codes = {
+            {EV_SYN, SYN_REPORT},       {EV_KEY, BTN_LEFT},           {EV_KEY, BTN_TOOL_FINGER},
+            {EV_KEY, BTN_TOUCH},        {EV_KEY, BTN_TOOL_DOUBLETAP}, {EV_KEY, BTN_TOOL_TRIPLETAP},
+    };
+    recording.absoluteAxes = {
+            {ABS_X, 0, 1936, 0, 0, 19},
+            {ABS_Y, 0, 1057, 0, 0, 19},
+            {ABS_PRESSURE, 0, 255, 0, 0, 0},
+            {ABS_MT_SLOT, 0, 4, 0, 0, 0},
+            {ABS_MT_POSITION_X, 0, 1936, 0, 0, 19},
+            {ABS_MT_POSITION_Y, 0, 1057, 0, 0, 19},
+            {ABS_MT_TRACKING_ID, 0, 65535, 0, 0, 0},
+            {ABS_MT_PRESSURE, 0, 255, 0, 0, 0},
+    };
+
+    EventWriter writer(recording, us2ns(11111));
+    int32_t trackingId = 100;
+    // Pointer movements, a click, two finger scrolls and three finger swipes.
+    writeTouchpadGesture(writer, {1, 120, 1500, 500, 400, 600, 0}, /*click=*/false, trackingId);
+    writeTouchpadGesture(writer, {1, 120, 400, 300, 1400, 900, 0}, /*click=*/false, trackingId);
+    writeTouchpadGesture(writer, {1, 10, 900, 800, 900, 800, 0}, /*click=*/true, trackingId);
+    writeTouchpadGesture(writer, {2, 90, 800, 900, 800, 200, 250}, /*click=*/false, trackingId);
+    writeTouchpadGesture(writer, {2, 90, 800, 200, 800, 900, 250}, /*click=*/false, trackingId);
+    writeTouchpadGesture(writer, {3, 60, 300, 500, 1200, 500, 200}, /*click=*/false, trackingId);
+    return recording;
+}
+
+EvemuRecording EvemuRecording::createMouse() {
+    EvemuRecording recording;
+    recording.name = "Synthetic Mouse";
+    recording.bus = BUS_USB_ID;
+    recording.version = 1;
+    recording.codes = {
+            {EV_SYN, SYN_REPORT}, {EV_KEY, BTN_LEFT}, {EV_KEY, BTN_RIGHT}, {EV_KEY, BTN_MIDDLE},
+            {EV_REL, REL_X},      {EV_REL, REL_Y},    {EV_REL, REL_WHEEL},
+    };
+
+    EventWriter writer(recording, ms2ns(1));
+    // One second of movement, that slows down and turns around every 250ms, with a wheel tick
+    // every 100ms and two clicks.
+    for (int32_t frame = 0; frame < 1000; frame++) {
+        const int32_t phase = frame % 250;
+        const int32_t speed = 8 - std::min(phase, 249 - phase) / 16;
+        const bool forward = (frame / 250) % 2 == 0;
+        writer.write(EV_REL, REL_X, forward ? speed : -speed);
+        writer.write(EV_REL, REL_Y, frame % 3 == 0 ? 1 : 0);
+        if (frame % 100 == 0) {
+            writer.write(EV_REL, REL_WHEEL, -1);
+        }
+        if (frame == 300 || frame == 700) {
+            writer.write(EV_KEY, BTN_LEFT, 1);
+        } else if (frame == 380 || frame == 780) {
+            writer.write(EV_KEY, BTN_LEFT, 0);
+        }
+        writer.sync();
+    }
+    return recording;
+}
+
+bool EvemuRecording::hasProperty(int32_t property) const {
+    return std::find(properties.begin(), properties.end(), property) != properties.end();
+}
+
+bool EvemuRecording::hasCode(int32_t type, int32_t code) const {
+    if (type == EV_ABS) {
+        return std::any_of(absoluteAxes.begin(), absoluteAxes.end(),
+                           [code](const AbsoluteAxis& axis) { return axis.code == code; });
+    }
+    return std::any_of(codes.begin(), codes.end(), [type, code](const Code& supported) {
+        return supported.type == type && supported.code == code;
+    });
+}
+
+std::vector<int32_t> EvemuRecording::getCodes(int32_t type) const {
+    std::vector<int32_t> result;
+    for (const Code& supported : codes) {
+        if (supported.type == type) {
+            result.push_back(supported.code);
+        }
+    }
+    return result;
+}
+
+} // namespace android
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Timers.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace android {
+
+/**
+ * The device description and events of an input device, in the model of an evemu recording.
+ *
+ * The recordings are generated in code, with the event streams that the evdev drivers of the
+ * devices produce, rather than captured from real devices.
+ *
+ * See https://gitlab.freedesktop.org/libevdev/evemu#device-description-format for the format.
+ */
+struct EvemuRecording {
+    struct AbsoluteAxis {
+        int32_t code;
+        int32_t minValue;
+        int32_t maxValue;
+        int32_t fuzz;
+        int32_t flat;
+        int32_t resolution;
+    };
+
+    struct Event {
+        nsecs_t when;
+        int32_t type;
+        int32_t code;
+        int32_t value;
+    };
+
+    struct Code {
+        int32_t type;
+        int32_t code;
+    };
+
+    std::string name;
+    uint16_t bus = 0;
+    uint16_t vendor = 0;
+    uint16_t product = 0;
+    uint16_t version = 0;
+
+    std::vector<int32_t> properties;
+    std::vector<Code> codes;
+    std::vector<AbsoluteAxis> absoluteAxes;
+    std::vector<Event> events;
+
+    /* A 120 Hz multi-touch screen, with taps and swipes of one to five fingers. */
+    static EvemuRecording createTouchscreen();
+    /* A 90 Hz touchpad, with pointer movements, clicks, scrolls and three finger swipes. */
+    static EvemuRecording createTouchpad();
+    /* A 1000 Hz mouse, with movements, clicks and wheel scrolls. */
+    static EvemuRecording createMouse();
+
+    bool hasProperty(int32_t property) const;
+    bool hasCode(int32_t type, int32_t code) const;
+    /* Returns all the codes supported for the given event type. */
+    std::vector<int32_t> getCodes(int32_t type) const;
+};
+
+} // namespace android
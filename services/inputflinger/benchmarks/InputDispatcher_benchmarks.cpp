@@ -17,12 +17,18 @@
 #include <benchmark/benchmark.h>
 
 #include <android/os/IInputConstants.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <binder/Binder.h>
 #include <gui/constants.h>
 #include "../dispatcher/InputDispatcher.h"
+#include "../dispatcher/trace/InputTracingPerfettoBackend.h"
+#include "../dispatcher/trace/ThreadedBackend.h"
 #include "../tests/FakeApplicationHandle.h"
 #include "../tests/FakeInputDispatcherPolicy.h"
 #include "../tests/FakeWindowHandle.h"
+#include "HeapAllocations.h"
 
 using android::base::Result;
 using android::gui::WindowInfo;
@@ -46,6 +52,39 @@ static nsecs_t now() {
     return systemTime(SYSTEM_TIME_MONOTONIC);
 }
 
+/**
+ * Reports the heap allocations and the dispatcher entry pool usage between construction and
+ * destruction as per-iteration counters of the benchmark.
+ */
+class AllocationCounter {
+public:
+    explicit AllocationCounter(benchmark::State& state)
+          : mState(state),
+            mInitialAllocationCount(getHeapAllocationCount()),
+            mInitialPoolStats(getEntryPoolStats()) {}
+
+    ~AllocationCounter() {
+        const EntryPoolStats poolStats = getEntryPoolStats();
+        const auto pooledAllocations = [](const EntryPoolStats& stats) {
+            return stats.keyEntries.pooledAllocations + stats.motionEntries.pooledAllocations +
+                    stats.dispatchEntries.pooledAllocations;
+        };
+        mState.counters["allocations"] =
+                benchmark::Counter(static_cast<double>(getHeapAllocationCount() -
+                                                       mInitialAllocationCount),
+                                   benchmark::Counter::kAvgIterations);
+        mState.counters["pooled_entries"] =
+                benchmark::Counter(static_cast<double>(pooledAllocations(poolStats) -
+                                                       pooledAllocations(mInitialPoolStats)),
+                                   benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    benchmark::State& mState;
+    const size_t mInitialAllocationCount;
+    const EntryPoolStats mInitialPoolStats;
+};
+
 static MotionEvent generateMotionEvent() {
     PointerProperties pointerProperties[1];
     PointerCoords pointerCoords[1];
@@ -101,10 +140,16 @@ static NotifyMotionArgs generateMotionArgs() {
     return args;
 }
 
-static void benchmarkNotifyMotion(benchmark::State& state) {
+static std::unique_ptr<trace::InputTracingBackendInterface> createTracingBackend() {
+    return std::make_unique<trace::impl::ThreadedBackend<trace::impl::PerfettoBackend>>(
+            trace::impl::PerfettoBackend());
+}
+
+static void notifyMotion(benchmark::State& state,
+                         std::unique_ptr<trace::InputTracingBackendInterface> traceBackend) {
     // Create dispatcher
     FakeInputDispatcherPolicy fakePolicy;
-    InputDispatcher dispatcher(fakePolicy);
+    InputDispatcher dispatcher(fakePolicy, std::move(traceBackend));
     dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
     dispatcher.start();
 
@@ -117,22 +162,206 @@ static void benchmarkNotifyMotion(benchmark::State& state) {
 
     NotifyMotionArgs motionArgs = generateMotionArgs();
 
-    for (auto _ : state) {
-        // Send ACTION_DOWN
-        motionArgs.action = AMOTION_EVENT_ACTION_DOWN;
-        motionArgs.downTime = now();
-        motionArgs.eventTime = motionArgs.downTime;
-        dispatcher.notifyMotion(motionArgs);
+    {
+        AllocationCounter allocationCounter(state);
+        for (auto _ : state) {
+            // Send ACTION_DOWN
+            motionArgs.action = AMOTION_EVENT_ACTION_DOWN;
+            motionArgs.downTime = now();
+            motionArgs.eventTime = motionArgs.downTime;
+            dispatcher.notifyMotion(motionArgs);
+
+            // Send ACTION_UP
+            motionArgs.action = AMOTION_EVENT_ACTION_UP;
+            motionArgs.eventTime = now();
+            dispatcher.notifyMotion(motionArgs);
+
+            window->consumeMotion();
+            window->consumeMotion();
+        }
+    }
+
+    dispatcher.stop();
+}
+
+static void benchmarkNotifyMotion(benchmark::State& state) {
+    notifyMotion(state, /*traceBackend=*/nullptr);
+}
+
+/**
+ * Like benchmarkNotifyMotion, but with input tracing enabled, to measure what tracing adds to the
+ * dispatch of every event.
+ */
+static void benchmarkNotifyMotionWithTracing(benchmark::State& state) {
+    notifyMotion(state, createTracingBackend());
+}
+
+/**
+ * The time that the dispatcher thread spends handing a motion event with the given number of
+ * pointers to the tracing backend.
+ */
+static void benchmarkTraceMotionEvent(benchmark::State& state) {
+    trace::impl::ThreadedBackend<trace::impl::PerfettoBackend> backend{
+            trace::impl::PerfettoBackend()};
+    const NotifyMotionArgs args = generateMotionArgs();
+    trace::TracedMotionEvent event{.id = args.id,
+                                   .eventTime = args.eventTime,
+                                   .policyFlags = args.policyFlags,
+                                   .deviceId = args.deviceId,
+                                   .source = args.source,
+                                   .displayId = args.displayId,
+                                   .action = args.action,
+                                   .actionButton = args.actionButton,
+                                   .flags = args.flags,
+                                   .metaState = args.metaState,
+                                   .buttonState = args.buttonState,
+                                   .classification = args.classification,
+                                   .edgeFlags = args.edgeFlags,
+                                   .xPrecision = args.xPrecision,
+                                   .yPrecision = args.yPrecision,
+                                   .xCursorPosition = args.xCursorPosition,
+                                   .yCursorPosition = args.yCursorPosition,
+                                   .downTime = args.downTime,
+                                   .pointerProperties = {},
+                                   .pointerCoords = {}};
+    for (int32_t i = 0; i < state.range(0); i++) {
+        event.pointerProperties.push_back(args.pointerProperties[0]);
+        event.pointerProperties.back().id = i;
+        event.pointerCoords.push_back(args.pointerCoords[0]);
+    }
+
+    {
+        AllocationCounter allocationCounter(state);
+        for (auto _ : state) {
+            backend.traceMotionEvent(event);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    // The events that the tracing thread could not keep up with.
+    state.counters["dropped"] = benchmark::Counter(static_cast<double>(backend.getDroppedCount()),
+                                                   benchmark::Counter::kAvgIterations);
+}
+
+/**
+ * Like benchmarkNotifyMotion, but with many small trusted overlays above the touched window, as on
+ * devices that show lots of floating decorations. The overlays are not at the touch location, so
+ * the touched window is the last one in z-order to be hit tested.
+ */
+static void benchmarkNotifyMotionManyWindows(benchmark::State& state) {
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    std::vector<sp<FakeWindowHandle>> overlays;
+    std::vector<gui::WindowInfo> windowInfos;
+    for (int64_t i = 0; i < state.range(0) - 1; i++) {
+        sp<FakeWindowHandle> overlay =
+                sp<FakeWindowHandle>::make(application, dispatcher,
+                                           "Overlay " + std::to_string(i), DISPLAY_ID);
+        const int32_t left = (i % 10) * 50;
+        const int32_t top = 200 + ((i / 10) % 12) * 50;
+        overlay->setFrame(Rect(left, top, left + 40, top + 40));
+        overlay->setTrustedOverlay(true);
+        windowInfos.push_back(*overlay->getInfo());
+        overlays.push_back(overlay);
+    }
 
-        // Send ACTION_UP
-        motionArgs.action = AMOTION_EVENT_ACTION_UP;
+    // Create a window that will receive motion events
+    sp<FakeWindowHandle> window =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Fake Window", DISPLAY_ID);
+    windowInfos.push_back(*window->getInfo());
+
+    dispatcher.onWindowInfosChanged({windowInfos, {}, 0, 0});
+
+    NotifyMotionArgs motionArgs = generateMotionArgs();
+
+    {
+        AllocationCounter allocationCounter(state);
+        for (auto _ : state) {
+            // Send ACTION_DOWN
+            motionArgs.action = AMOTION_EVENT_ACTION_DOWN;
+            motionArgs.downTime = now();
+            motionArgs.eventTime = motionArgs.downTime;
+            dispatcher.notifyMotion(motionArgs);
+
+            // Send ACTION_UP
+            motionArgs.action = AMOTION_EVENT_ACTION_UP;
+            motionArgs.eventTime = now();
+            dispatcher.notifyMotion(motionArgs);
+
+            window->consumeMotion();
+            window->consumeMotion();
+        }
+    }
+
+    dispatcher.stop();
+}
+
+/**
+ * Measure the latency from notifying the dispatcher of a motion event to the event arriving at a
+ * window, while a spy window above it only reads its events every so often. In between, the spy
+ * socket fills up and the dispatch cycles to it end with failed writes.
+ */
+static void benchmarkNotifyMotionSlowConsumer(benchmark::State& state) {
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    sp<FakeWindowHandle> spy =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Slow Spy", DISPLAY_ID);
+    spy->setSpy(true);
+    spy->setTrustedOverlay(true);
+    // Don't let the slow spy be reported as unresponsive
+    spy->setDispatchingTimeout(1min);
+
+    // Create a window that will receive motion events
+    sp<FakeWindowHandle> window =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Fake Window", DISPLAY_ID);
+
+    dispatcher.onWindowInfosChanged({{*spy->getInfo(), *window->getInfo()}, {}, 0, 0});
+
+    std::atomic<bool> running = true;
+    std::thread slowConsumer([&]() {
+        while (running) {
+            std::this_thread::sleep_for(std::chrono::microseconds(state.range(0)));
+            while (spy->consume(/*timeout=*/0ms) != nullptr) {
+            }
+        }
+    });
+
+    NotifyMotionArgs motionArgs = generateMotionArgs();
+    motionArgs.action = AMOTION_EVENT_ACTION_DOWN;
+    motionArgs.downTime = now();
+    motionArgs.eventTime = motionArgs.downTime;
+    dispatcher.notifyMotion(motionArgs);
+    window->consumeMotion();
+
+    std::vector<nsecs_t> latencies;
+    latencies.reserve(state.max_iterations);
+    motionArgs.action = AMOTION_EVENT_ACTION_MOVE;
+    for (auto _ : state) {
         motionArgs.eventTime = now();
         dispatcher.notifyMotion(motionArgs);
-
-        window->consumeMotion();
         window->consumeMotion();
+        latencies.push_back(now() - motionArgs.eventTime);
     }
 
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentileMicros = [&latencies](size_t percentile) {
+        return latencies.empty() ? 0.0
+                                 : ns2us(latencies[(latencies.size() - 1) * percentile / 100]);
+    };
+    state.counters["p50_us"] = percentileMicros(50);
+    state.counters["p99_us"] = percentileMicros(99);
+
+    running = false;
+    slowConsumer.join();
     dispatcher.stop();
 }
 
@@ -150,21 +379,24 @@ static void benchmarkInjectMotion(benchmark::State& state) {
 
     dispatcher.onWindowInfosChanged({{*window->getInfo()}, {}, 0, 0});
 
-    for (auto _ : state) {
-        MotionEvent event = generateMotionEvent();
-        // Send ACTION_DOWN
-        dispatcher.injectInputEvent(&event, /*targetUid=*/{}, InputEventInjectionSync::NONE,
-                                    INJECT_EVENT_TIMEOUT,
-                                    POLICY_FLAG_FILTERED | POLICY_FLAG_PASS_TO_USER);
-
-        // Send ACTION_UP
-        event.setAction(AMOTION_EVENT_ACTION_UP);
-        dispatcher.injectInputEvent(&event, /*targetUid=*/{}, InputEventInjectionSync::NONE,
-                                    INJECT_EVENT_TIMEOUT,
-                                    POLICY_FLAG_FILTERED | POLICY_FLAG_PASS_TO_USER);
-
-        window->consumeMotion();
-        window->consumeMotion();
+    {
+        AllocationCounter allocationCounter(state);
+        for (auto _ : state) {
+            MotionEvent event = generateMotionEvent();
+            // Send ACTION_DOWN
+            dispatcher.injectInputEvent(&event, /*targetUid=*/{}, InputEventInjectionSync::NONE,
+                                        INJECT_EVENT_TIMEOUT,
+                                        POLICY_FLAG_FILTERED | POLICY_FLAG_PASS_TO_USER);
+
+            // Send ACTION_UP
+            event.setAction(AMOTION_EVENT_ACTION_UP);
+            dispatcher.injectInputEvent(&event, /*targetUid=*/{}, InputEventInjectionSync::NONE,
+                                        INJECT_EVENT_TIMEOUT,
+                                        POLICY_FLAG_FILTERED | POLICY_FLAG_PASS_TO_USER);
+
+            window->consumeMotion();
+            window->consumeMotion();
+        }
     }
 
     dispatcher.stop();
@@ -199,6 +431,10 @@ static void benchmarkOnWindowInfosChanged(benchmark::State& state) {
 } // namespace
 
 BENCHMARK(benchmarkNotifyMotion);
+BENCHMARK(benchmarkNotifyMotionWithTracing);
+BENCHMARK(benchmarkTraceMotionEvent)->Arg(1)->Arg(5)->Arg(MAX_POINTERS);
+BENCHMARK(benchmarkNotifyMotionManyWindows)->Arg(10)->Arg(80)->Arg(200);
+BENCHMARK(benchmarkNotifyMotionSlowConsumer)->Arg(500)->Arg(5000);
 BENCHMARK(benchmarkInjectMotion);
 BENCHMARK(benchmarkOnWindowInfosChanged);
 
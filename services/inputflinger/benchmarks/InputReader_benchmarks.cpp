@@ -0,0 +1,216 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/logging.h>
+#include <linux/input.h>
+
+#include "../tests/FakeEventHub.h"
+#include "../tests/FakeInputReaderPolicy.h"
+#include "../tests/FakePointerController.h"
+#include "../tests/InstrumentedInputReader.h"
+#include "EvemuRecording.h"
+#include "HeapAllocations.h"
+
+namespace android {
+
+namespace {
+
+constexpr int32_t EVENTHUB_ID = 1;
+constexpr int32_t DISPLAY_ID = 0;
+constexpr int32_t DISPLAY_WIDTH = 1440;
+constexpr int32_t DISPLAY_HEIGHT = 3120;
+const std::string DISPLAY_UNIQUE_ID = "local:0";
+
+/**
+ * Counts the notifications of the reader without keeping them, so that the listener adds no cost
+ * that grows with the length of the benchmark.
+ */
+class CountingInputListener : public InputListenerInterface {
+public:
+    size_t getMotionCount() const { return mMotionCount; }
+    size_t getKeyCount() const { return mKeyCount; }
+
+    void notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs&) override {}
+    void notifyConfigurationChanged(const NotifyConfigurationChangedArgs&) override {}
+    void notifyKey(const NotifyKeyArgs&) override { mKeyCount++; }
+    void notifyMotion(const NotifyMotionArgs&) override { mMotionCount++; }
+    void notifySwitch(const NotifySwitchArgs&) override {}
+    void notifySensor(const NotifySensorArgs&) override {}
+    void notifyVibratorState(const NotifyVibratorStateArgs&) override {}
+    void notifyDeviceReset(const NotifyDeviceResetArgs&) override {}
+    void notifyPointerCaptureChanged(const NotifyPointerCaptureChangedArgs&) override {}
+
+private:
+    size_t mMotionCount = 0;
+    size_t mKeyCount = 0;
+};
+
+/**
+ * Classifies the device of a recording the same way as EventHub::openDeviceLocked does for the
+ * device types that the recordings cover.
+ */
+ftl::Flags<InputDeviceClass> getDeviceClasses(const EvemuRecording& recording) {
+    ftl::Flags<InputDeviceClass> classes;
+    if (recording.hasCode(EV_KEY, BTN_MOUSE) && recording.hasCode(EV_REL, REL_X) &&
+        recording.hasCode(EV_REL, REL_Y)) {
+        classes |= InputDeviceClass::CURSOR;
+    }
+    if (recording.hasCode(EV_ABS, ABS_MT_POSITION_X) &&
+        recording.hasCode(EV_ABS, ABS_MT_POSITION_Y)) {
+        classes |= InputDeviceClass::TOUCH | InputDeviceClass::TOUCH_MT;
+        bool hasStylusTool = false;
+        for (int32_t code = BTN_TOOL_PEN; code < BTN_TOOL_FINGER; code++) {
+            hasStylusTool |= recording.hasCode(EV_KEY, code);
+        }
+        if (recording.hasProperty(INPUT_PROP_POINTER) && !hasStylusTool) {
+            classes |= InputDeviceClass::TOUCHPAD;
+        }
+    } else if (recording.hasCode(EV_KEY, BTN_TOUCH) && recording.hasCode(EV_ABS, ABS_X) &&
+               recording.hasCode(EV_ABS, ABS_Y)) {
+        classes |= InputDeviceClass::TOUCH;
+    }
+    return classes;
+}
+
+/**
+ * An InputReader with a single device, set up from a recording, that replays the recorded events
+ * one sync frame at a time.
+ */
+class RecordingReplayer {
+public:
+    explicit RecordingReplayer(EvemuRecording recording) : mRecording(std::move(recording)) {
+        CHECK(!mRecording.events.empty()) << "No events in the " << mRecording.name << " recording";
+
+        // Split the events into the frames that the evdev driver reports with SYN_REPORT.
+        for (size_t i = 0; i < mRecording.events.size(); i++) {
+            const EvemuRecording::Event& event = mRecording.events[i];
+            if (event.type == EV_SYN && event.code == SYN_REPORT) {
+                mFrameEnds.push_back(i + 1);
+            }
+        }
+        mDuration = mRecording.events.back().when - mRecording.events.front().when + ms2ns(10);
+
+        mFakePolicy->addDisplayViewport(DISPLAY_ID, DISPLAY_WIDTH, DISPLAY_HEIGHT, ui::ROTATION_0,
+                                        /*isActive=*/true, DISPLAY_UNIQUE_ID,
+                                        /*physicalPort=*/std::nullopt, ViewportType::INTERNAL);
+        mFakePolicy->setPointerController(std::make_shared<FakePointerController>());
+        addDevice();
+        mReader = std::make_unique<InstrumentedInputReader>(mFakeEventHub, mFakePolicy, mListener);
+        mFakeEventHub->finishDeviceScan();
+        mReader->loopOnce();
+        mReader->loopOnce();
+    }
+
+    size_t getEventCount() const { return mRecording.events.size(); }
+    size_t getFrameCount() const { return mFrameEnds.size(); }
+    const CountingInputListener& getListener() const { return mListener; }
+
+    /* Replays the whole recording, with the timestamps moved after the previous replay. */
+    void replay() {
+        const nsecs_t offset = mReplayCount++ * mDuration;
+        size_t begin = 0;
+        for (size_t end : mFrameEnds) {
+            for (size_t i = begin; i < end; i++) {
+                const EvemuRecording::Event& event = mRecording.events[i];
+                const nsecs_t when = event.when + offset;
+                mFakeEventHub->enqueueEvent(when, /*readTime=*/when, EVENTHUB_ID, event.type,
+                                            event.code, event.value);
+            }
+            mReader->loopOnce();
+            begin = end;
+        }
+    }
+
+private:
+    EvemuRecording mRecording;
+    std::vector<size_t> mFrameEnds;
+    nsecs_t mDuration = 0;
+    nsecs_t mReplayCount = 0;
+
+    std::shared_ptr<FakeEventHub> mFakeEventHub = std::make_shared<FakeEventHub>();
+    sp<FakeInputReaderPolicy> mFakePolicy = sp<FakeInputReaderPolicy>::make();
+    CountingInputListener mListener;
+    std::unique_ptr<InstrumentedInputReader> mReader;
+
+    void addDevice() {
+        mFakeEventHub->addDevice(EVENTHUB_ID, mRecording.name, getDeviceClasses(mRecording),
+                                 mRecording.bus);
+        for (const EvemuRecording::AbsoluteAxis& axis : mRecording.absoluteAxes) {
+            mFakeEventHub->addAbsoluteAxis(EVENTHUB_ID, axis.code, axis.minValue, axis.maxValue,
+                                           axis.flat, axis.fuzz, axis.resolution);
+        }
+        for (int32_t code : mRecording.getCodes(EV_REL)) {
+            mFakeEventHub->addRelativeAxis(EVENTHUB_ID, code);
+        }
+        for (int32_t code : mRecording.getCodes(EV_KEY)) {
+            mFakeEventHub->addKey(EVENTHUB_ID, code, /*usageCode=*/0, AKEYCODE_UNKNOWN,
+                                  /*flags=*/0);
+        }
+        for (int property = 0; property < INPUT_PROP_CNT; property++) {
+            if (mRecording.hasProperty(property)) {
+                mFakeEventHub->addInputProperty(EVENTHUB_ID, property);
+            }
+        }
+    }
+};
+
+/**
+ * The cost of processing the raw events of a device, from the EventHub to the notifications of
+ * the reader.
+ *
+ * Reports the events processed per second, the time per raw event, and the heap allocations made
+ * per sync frame. The allocations include the event buffer of the fake EventHub.
+ */
+void benchmarkReplayRecording(benchmark::State& state, EvemuRecording (*createRecording)()) {
+    RecordingReplayer replayer(createRecording());
+    const CountingInputListener& listener = replayer.getListener();
+    const size_t initialMotionCount = listener.getMotionCount();
+    const size_t initialKeyCount = listener.getKeyCount();
+    const size_t initialAllocationCount = getHeapAllocationCount();
+
+    for (auto _ : state) {
+        replayer.replay();
+    }
+
+    const double iterations = static_cast<double>(state.iterations());
+    const double eventCount = static_cast<double>(replayer.getEventCount());
+    const double frameCount = static_cast<double>(replayer.getFrameCount());
+    state.SetItemsProcessed(state.iterations() * replayer.getEventCount());
+    state.counters["time_per_event"] =
+            benchmark::Counter(eventCount,
+                               benchmark::Counter::kIsIterationInvariantRate |
+                                       benchmark::Counter::kInvert);
+    state.counters["allocations_per_frame"] =
+            benchmark::Counter(static_cast<double>(getHeapAllocationCount() -
+                                                   initialAllocationCount) /
+                               (iterations * frameCount));
+    state.counters["notify_motion"] =
+            benchmark::Counter(static_cast<double>(listener.getMotionCount() - initialMotionCount),
+                               benchmark::Counter::kAvgIterations);
+    state.counters["notify_key"] =
+            benchmark::Counter(static_cast<double>(listener.getKeyCount() - initialKeyCount),
+                               benchmark::Counter::kAvgIterations);
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(benchmarkReplayRecording, touchscreen, &EvemuRecording::createTouchscreen);
+BENCHMARK_CAPTURE(benchmarkReplayRecording, touchpad, &EvemuRecording::createTouchpad);
+BENCHMARK_CAPTURE(benchmarkReplayRecording, mouse, &EvemuRecording::createMouse);
+
+} // namespace android
@@ -51,6 +51,12 @@ public:
     // application consumes some of the input.
     bool responsive = true;
 
+    // True from the time the dispatcher thread moves the outbound queue to the back of the wait
+    // queue until it has handled the outcome of writing those entries to the socket, which it does
+    // without holding the dispatcher lock. Entries removed from the wait queue in the meantime
+    // must be kept alive until then.
+    bool publishing = false;
+
     // Queue of events that need to be published to the connection.
     std::deque<std::unique_ptr<DispatchEntry>> outboundQueue;
 
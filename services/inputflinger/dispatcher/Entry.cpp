@@ -29,6 +29,40 @@ using android::base::StringPrintf;
 
 namespace android::inputdispatcher {
 
+namespace {
+
+// Upper bounds on the number of recycled blocks kept around. A burst of multi-touch and stylus
+// events at high report rates keeps a few hundred motion entries alive across the inbound,
+// outbound and wait queues.
+constexpr size_t MAX_FREE_KEY_ENTRIES = 64;
+constexpr size_t MAX_FREE_MOTION_ENTRIES = 256;
+constexpr size_t MAX_FREE_DISPATCH_ENTRIES = 512;
+
+// The pools are intentionally leaked, so that entries that are still alive during static
+// destruction can be released safely.
+EntryPool& keyEntryPool() {
+    static EntryPool& pool = *new EntryPool(sizeof(KeyEntry), MAX_FREE_KEY_ENTRIES);
+    return pool;
+}
+
+EntryPool& motionEntryPool() {
+    static EntryPool& pool = *new EntryPool(sizeof(MotionEntry), MAX_FREE_MOTION_ENTRIES);
+    return pool;
+}
+
+EntryPool& dispatchEntryPool() {
+    static EntryPool& pool = *new EntryPool(sizeof(DispatchEntry), MAX_FREE_DISPATCH_ENTRIES);
+    return pool;
+}
+
+} // namespace
+
+EntryPoolStats getEntryPoolStats() {
+    return {.keyEntries = keyEntryPool().getStats(),
+            .motionEntries = motionEntryPool().getStats(),
+            .dispatchEntries = dispatchEntryPool().getStats()};
+}
+
 VerifiedKeyEvent verifiedKeyEventFromKeyEntry(const KeyEntry& entry) {
     return {{VerifiedInputEvent::Type::KEY, entry.deviceId, entry.eventTime, entry.source,
              entry.displayId},
@@ -164,6 +198,14 @@ std::string KeyEntry::getDescription() const {
                         keyCode, scanCode, metaState, repeatCount, policyFlags);
 }
 
+void* KeyEntry::operator new(size_t size) {
+    return keyEntryPool().allocate(size);
+}
+
+void KeyEntry::operator delete(void* ptr, size_t size) {
+    keyEntryPool().deallocate(ptr, size);
+}
+
 std::ostream& operator<<(std::ostream& out, const KeyEntry& keyEntry) {
     out << keyEntry.getDescription();
     return out;
@@ -188,8 +230,8 @@ MotionEntry::MotionEntry(int32_t id, std::shared_ptr<InjectionState> injectionSt
                          int32_t metaState, int32_t buttonState,
                          MotionClassification classification, int32_t edgeFlags, float xPrecision,
                          float yPrecision, float xCursorPosition, float yCursorPosition,
-                         nsecs_t downTime, const std::vector<PointerProperties>& pointerProperties,
-                         const std::vector<PointerCoords>& pointerCoords)
+                         nsecs_t downTime, std::vector<PointerProperties> pointerProperties,
+                         std::vector<PointerCoords> pointerCoords)
       : EventEntry(id, Type::MOTION, eventTime, policyFlags),
         deviceId(deviceId),
         source(source),
@@ -206,8 +248,8 @@ MotionEntry::MotionEntry(int32_t id, std::shared_ptr<InjectionState> injectionSt
         xCursorPosition(xCursorPosition),
         yCursorPosition(yCursorPosition),
         downTime(downTime),
-        pointerProperties(pointerProperties),
-        pointerCoords(pointerCoords) {
+        pointerProperties(std::move(pointerProperties)),
+        pointerCoords(std::move(pointerCoords)) {
     EventEntry::injectionState = std::move(injectionState);
 }
 
@@ -238,6 +280,14 @@ std::string MotionEntry::getDescription() const {
     return msg;
 }
 
+void* MotionEntry::operator new(size_t size) {
+    return motionEntryPool().allocate(size);
+}
+
+void MotionEntry::operator delete(void* ptr, size_t size) {
+    motionEntryPool().deallocate(ptr, size);
+}
+
 std::ostream& operator<<(std::ostream& out, const MotionEntry& motionEntry) {
     out << motionEntry.getDescription();
     return out;
@@ -314,6 +364,14 @@ DispatchEntry::DispatchEntry(std::shared_ptr<const EventEntry> eventEntry,
     }
 }
 
+void* DispatchEntry::operator new(size_t size) {
+    return dispatchEntryPool().allocate(size);
+}
+
+void DispatchEntry::operator delete(void* ptr, size_t size) {
+    dispatchEntryPool().deallocate(ptr, size);
+}
+
 uint32_t DispatchEntry::nextSeq() {
     // Sequence number 0 is reserved and will never be returned.
     uint32_t seq;
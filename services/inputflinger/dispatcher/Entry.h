@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "EntryPool.h"
 #include "InjectionState.h"
 #include "InputTargetFlags.h"
 #include "trace/EventTrackerInterface.h"
@@ -50,6 +51,9 @@ struct EventEntry {
     nsecs_t eventTime;
     uint32_t policyFlags;
     std::shared_ptr<InjectionState> injectionState;
+    // Time at which the entry, or the entry it was split from, was added to the inbound queue.
+    // 0 for events synthesized by the dispatcher, which never go through the inbound queue.
+    nsecs_t enqueueTime = 0;
 
     mutable bool dispatchInProgress; // initially false, set to true while dispatching
 
@@ -147,6 +151,10 @@ struct KeyEntry : EventEntry {
              int32_t action, int32_t flags, int32_t keyCode, int32_t scanCode, int32_t metaState,
              int32_t repeatCount, nsecs_t downTime);
     std::string getDescription() const override;
+
+    // Allocated from an EntryPool, see getEntryPoolStats().
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
 };
 
 std::ostream& operator<<(std::ostream& out, const KeyEntry& motionEntry);
@@ -178,9 +186,13 @@ struct MotionEntry : EventEntry {
                 int32_t action, int32_t actionButton, int32_t flags, int32_t metaState,
                 int32_t buttonState, MotionClassification classification, int32_t edgeFlags,
                 float xPrecision, float yPrecision, float xCursorPosition, float yCursorPosition,
-                nsecs_t downTime, const std::vector<PointerProperties>& pointerProperties,
-                const std::vector<PointerCoords>& pointerCoords);
+                nsecs_t downTime, std::vector<PointerProperties> pointerProperties,
+                std::vector<PointerCoords> pointerCoords);
     std::string getDescription() const override;
+
+    // Allocated from an EntryPool, see getEntryPoolStats().
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
 };
 
 std::ostream& operator<<(std::ostream& out, const MotionEntry& motionEntry);
@@ -249,6 +261,10 @@ struct DispatchEntry {
 
     inline bool isSplit() const { return targetFlags.test(InputTargetFlags::SPLIT); }
 
+    // Allocated from an EntryPool, see getEntryPoolStats().
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+
 private:
     static volatile int32_t sNextSeqAtomic;
 
@@ -257,6 +273,16 @@ private:
 
 std::ostream& operator<<(std::ostream& out, const DispatchEntry& entry);
 
+// Allocation statistics of the pools that KeyEntry, MotionEntry and DispatchEntry are allocated
+// from.
+struct EntryPoolStats {
+    EntryPool::Stats keyEntries;
+    EntryPool::Stats motionEntries;
+    EntryPool::Stats dispatchEntries;
+};
+
+EntryPoolStats getEntryPoolStats();
+
 VerifiedKeyEvent verifiedKeyEventFromKeyEntry(const KeyEntry& entry);
 VerifiedMotionEvent verifiedMotionEventFromMotionEntry(const MotionEntry& entry,
                                                        const ui::Transform& rawTransform);
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EntryPool.h"
+
+#include <new>
+
+namespace android::inputdispatcher {
+
+EntryPool::EntryPool(size_t blockSize, size_t maxFreeBlocks)
+      : mBlockSize(blockSize), mMaxFreeBlocks(maxFreeBlocks) {
+    mFreeBlocks.reserve(maxFreeBlocks);
+}
+
+EntryPool::~EntryPool() {
+    for (void* block : mFreeBlocks) {
+        ::operator delete(block);
+    }
+}
+
+void* EntryPool::allocate(size_t size) {
+    if (size == mBlockSize) {
+        std::scoped_lock lock(mLock);
+        if (!mFreeBlocks.empty()) {
+            void* block = mFreeBlocks.back();
+            mFreeBlocks.pop_back();
+            mPooledAllocations++;
+            return block;
+        }
+        mHeapAllocations++;
+    }
+    return ::operator new(size);
+}
+
+void EntryPool::deallocate(void* block, size_t size) {
+    if (block == nullptr) {
+        return;
+    }
+    if (size == mBlockSize) {
+        std::scoped_lock lock(mLock);
+        if (mFreeBlocks.size() < mMaxFreeBlocks) {
+            mFreeBlocks.push_back(block);
+            return;
+        }
+    }
+    ::operator delete(block);
+}
+
+EntryPool::Stats EntryPool::getStats() const {
+    std::scoped_lock lock(mLock);
+    return {.heapAllocations = mHeapAllocations,
+            .pooledAllocations = mPooledAllocations,
+            .freeBlocks = mFreeBlocks.size()};
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace android::inputdispatcher {
+
+/**
+ * Free list of fixed size memory blocks, used by the class specific allocation functions of the
+ * entries that are created for every input event. Blocks of any other size are passed straight to
+ * the global allocator, so subclasses of a pooled entry type are still allocated correctly.
+ *
+ * Entries are usually created on the reader thread and destroyed on the dispatcher thread, so the
+ * free list is guarded by its own lock rather than by the dispatcher lock.
+ */
+class EntryPool {
+public:
+    struct Stats {
+        // Allocations that had to go to the global allocator.
+        size_t heapAllocations = 0;
+        // Allocations served from the free list.
+        size_t pooledAllocations = 0;
+        // Blocks currently kept in the free list.
+        size_t freeBlocks = 0;
+    };
+
+    EntryPool(size_t blockSize, size_t maxFreeBlocks);
+    ~EntryPool();
+
+    EntryPool(const EntryPool&) = delete;
+    EntryPool& operator=(const EntryPool&) = delete;
+
+    void* allocate(size_t size);
+    void deallocate(void* block, size_t size);
+
+    Stats getStats() const;
+
+private:
+    const size_t mBlockSize;
+    const size_t mMaxFreeBlocks;
+
+    mutable std::mutex mLock;
+    std::vector<void*> mFreeBlocks GUARDED_BY(mLock);
+    size_t mHeapAllocations GUARDED_BY(mLock) = 0;
+    size_t mPooledAllocations GUARDED_BY(mLock) = 0;
+};
+
+} // namespace android::inputdispatcher
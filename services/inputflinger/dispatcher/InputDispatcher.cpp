@@ -441,7 +441,7 @@ std::unique_ptr<DispatchEntry> createDispatchEntry(const IdGenerator& idGenerato
                                           motionEntry.xPrecision, motionEntry.yPrecision,
                                           motionEntry.xCursorPosition, motionEntry.yCursorPosition,
                                           motionEntry.downTime, motionEntry.pointerProperties,
-                                          pointerCoords);
+                                          std::move(pointerCoords));
 
     std::unique_ptr<DispatchEntry> dispatchEntry =
             std::make_unique<DispatchEntry>(std::move(combinedMotionEntry), inputTargetFlags,
@@ -914,6 +914,11 @@ void InputDispatcher::dispatchOnce() {
     { // acquire lock
         std::scoped_lock _l(mLock);
         mDispatcherIsAlive.notify_all();
+        mInDispatchLoop = true;
+
+        // Handle the outcome of the events written to the connection sockets during the previous
+        // iteration. This may post commands.
+        finishPublishBatchesLocked(now());
 
         // Run a dispatch loop if there are no pending commands.
         // The dispatch loop might enqueue commands to run afterwards.
@@ -932,6 +937,14 @@ void InputDispatcher::dispatchOnce() {
         const nsecs_t nextAnrCheck = processAnrsLocked();
         nextWakeupTime = std::min(nextWakeupTime, nextAnrCheck);
 
+        // Move the outbound queues of the scheduled connections to their wait queues. The writes
+        // are finished by the next iteration, so wake up immediately to run it.
+        takePublishBatchesLocked(now());
+        mInDispatchLoop = false;
+        if (!mPublishBatches.empty()) {
+            nextWakeupTime = LLONG_MIN;
+        }
+
         // We are about to enter an infinitely long sleep, because we have no commands or
         // pending or queued events
         if (nextWakeupTime == LLONG_MAX) {
@@ -939,6 +952,12 @@ void InputDispatcher::dispatchOnce() {
         }
     } // release lock
 
+    // Write the events to the connection sockets without holding the lock, so that a slow or
+    // stuck consumer does not hold up the threads that notify the dispatcher of new events.
+    for (PublishBatch& batch : mPublishBatches) {
+        publishBatch(batch);
+    }
+
     // Wait for callback or timeout or wake.  (make sure we round up, not down)
     nsecs_t currentTime = now();
     int timeoutMillis = toMillisecondTimeoutDelay(currentTime, nextWakeupTime);
@@ -1265,6 +1284,7 @@ bool InputDispatcher::shouldPruneInboundQueueLocked(const MotionEntry& motionEnt
 
 bool InputDispatcher::enqueueInboundEventLocked(std::unique_ptr<EventEntry> newEntry) {
     bool needWake = mInboundQueue.empty();
+    newEntry->enqueueTime = now();
     mInboundQueue.push_back(std::move(newEntry));
     const EventEntry& entry = *(mInboundQueue.back());
     traceInboundQueueLengthLocked();
@@ -1357,14 +1377,16 @@ sp<WindowInfoHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t displayI
                                                                 bool ignoreDragWindow) const {
     // Traverse windows from front to back to find touched window.
     const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+    const ui::Transform displayTransform = getTransformLocked(displayId);
+    for (size_t index : getHitTestCandidatesLocked(displayId, x, y)) {
+        const sp<WindowInfoHandle>& windowHandle = windowHandles[index];
         if (ignoreDragWindow && haveSameToken(windowHandle, mDragState->dragWindow)) {
             continue;
         }
 
         const WindowInfo& info = *windowHandle->getInfo();
         if (!info.isSpy() &&
-            windowAcceptsTouchAt(info, displayId, x, y, isStylus, getTransformLocked(displayId))) {
+            windowAcceptsTouchAt(info, displayId, x, y, isStylus, displayTransform)) {
             return windowHandle;
         }
     }
@@ -1403,10 +1425,12 @@ std::vector<sp<WindowInfoHandle>> InputDispatcher::findTouchedSpyWindowsAtLocked
     // Traverse windows from front to back and gather the touched spy windows.
     std::vector<sp<WindowInfoHandle>> spyWindows;
     const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+    const ui::Transform displayTransform = getTransformLocked(displayId);
+    for (size_t index : getHitTestCandidatesLocked(displayId, x, y)) {
+        const sp<WindowInfoHandle>& windowHandle = windowHandles[index];
         const WindowInfo& info = *windowHandle->getInfo();
 
-        if (!windowAcceptsTouchAt(info, displayId, x, y, isStylus, getTransformLocked(displayId))) {
+        if (!windowAcceptsTouchAt(info, displayId, x, y, isStylus, displayTransform)) {
             continue;
         }
         if (!info.isSpy()) {
@@ -3358,7 +3382,7 @@ void InputDispatcher::enqueueDispatchEntryAndStartDispatchCycleLocked(
 
     // If the outbound queue was previously empty, start the dispatch cycle going.
     if (wasEmpty && !connection->outboundQueue.empty()) {
-        startDispatchCycleLocked(currentTime, connection);
+        startDispatchCycleLocked(connection);
     }
 }
 
@@ -3695,146 +3719,227 @@ status_t InputDispatcher::publishMotionEvent(Connection& connection,
                                 motionEntry.pointerProperties.data(), usingCoords);
 }
 
-void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
-                                               const std::shared_ptr<Connection>& connection) {
-    ATRACE_NAME_IF(ATRACE_ENABLED(),
-                   StringPrintf("startDispatchCycleLocked(inputChannel=%s)",
-                                connection->getInputChannelName().c_str()));
+void InputDispatcher::startDispatchCycleLocked(const std::shared_ptr<Connection>& connection) {
     if (DEBUG_DISPATCH_CYCLE) {
         ALOGD("channel '%s' ~ startDispatchCycle", connection->getInputChannelName().c_str());
     }
 
-    while (connection->status == Connection::Status::NORMAL && !connection->outboundQueue.empty()) {
-        std::unique_ptr<DispatchEntry>& dispatchEntry = connection->outboundQueue.front();
-        dispatchEntry->deliveryTime = currentTime;
-        const std::chrono::nanoseconds timeout = getDispatchingTimeoutLocked(connection);
-        dispatchEntry->timeoutTime = currentTime + timeout.count();
-
-        // Publish the event.
-        status_t status;
-        const EventEntry& eventEntry = *(dispatchEntry->eventEntry);
-        switch (eventEntry.type) {
-            case EventEntry::Type::KEY: {
-                const KeyEntry& keyEntry = static_cast<const KeyEntry&>(eventEntry);
-                std::array<uint8_t, 32> hmac = getSignature(keyEntry, *dispatchEntry);
-                if (DEBUG_OUTBOUND_EVENT_DETAILS) {
-                    LOG(INFO) << "Publishing " << *dispatchEntry << " to "
-                              << connection->getInputChannelName();
-                }
+    if (std::find(mConnectionsPendingPublish.begin(), mConnectionsPendingPublish.end(),
+                  connection) != mConnectionsPendingPublish.end()) {
+        return;
+    }
+    mConnectionsPendingPublish.push_back(connection);
+    if (!mInDispatchLoop) {
+        mLooper->wake();
+    }
+}
 
-                // Publish the key event.
-                status = connection->inputPublisher
-                                 .publishKeyEvent(dispatchEntry->seq, keyEntry.id,
-                                                  keyEntry.deviceId, keyEntry.source,
-                                                  keyEntry.displayId, std::move(hmac),
-                                                  keyEntry.action, dispatchEntry->resolvedFlags,
-                                                  keyEntry.keyCode, keyEntry.scanCode,
-                                                  keyEntry.metaState, keyEntry.repeatCount,
-                                                  keyEntry.downTime, keyEntry.eventTime);
-                if (mTracer) {
-                    mTracer->traceEventDispatch(*dispatchEntry, keyEntry.traceTracker.get());
-                }
-                break;
+void InputDispatcher::takePublishBatchesLocked(nsecs_t currentTime) {
+    mPublishBatches.reserve(mConnectionsPendingPublish.size());
+    for (const std::shared_ptr<Connection>& connection : mConnectionsPendingPublish) {
+        if (connection->status != Connection::Status::NORMAL ||
+            connection->outboundQueue.empty()) {
+            continue;
+        }
+        PublishBatch& batch = mPublishBatches.emplace_back();
+        batch.connection = connection;
+        batch.entries.reserve(connection->outboundQueue.size());
+
+        // Move the events to the wait queue before they are written, so that ANR checks, dumps
+        // and gesture transfers running while the lock is released see them as dispatched.
+        const nsecs_t timeoutTime = currentTime + getDispatchingTimeoutLocked(connection).count();
+        for (std::unique_ptr<DispatchEntry>& dispatchEntry : connection->outboundQueue) {
+            dispatchEntry->deliveryTime = currentTime;
+            dispatchEntry->timeoutTime = timeoutTime;
+            batch.entries.push_back(dispatchEntry.get());
+            connection->waitQueue.emplace_back(std::move(dispatchEntry));
+            if (connection->responsive) {
+                mAnrTracker.insert(timeoutTime, connection->getToken());
             }
+        }
+        connection->outboundQueue.clear();
+        traceOutboundQueueLength(*connection);
+        traceWaitQueueLength(*connection);
+        connection->publishing = true;
+    }
+    mConnectionsPendingPublish.clear();
+}
 
-            case EventEntry::Type::MOTION: {
-                if (DEBUG_OUTBOUND_EVENT_DETAILS) {
-                    LOG(INFO) << "Publishing " << *dispatchEntry << " to "
-                              << connection->getInputChannelName();
-                }
-                const MotionEntry& motionEntry = static_cast<const MotionEntry&>(eventEntry);
-                status = publishMotionEvent(*connection, *dispatchEntry);
-                if (mTracer) {
-                    mTracer->traceEventDispatch(*dispatchEntry, motionEntry.traceTracker.get());
-                }
-                break;
-            }
+void InputDispatcher::publishBatch(PublishBatch& batch) const {
+    Connection& connection = *batch.connection;
+    ATRACE_NAME_IF(ATRACE_ENABLED(),
+                   StringPrintf("publishBatch(inputChannel=%s, entries=%zu)",
+                                connection.getInputChannelName().c_str(), batch.entries.size()));
+
+    // Write all the events to the socket with as few system calls as possible.
+    connection.inputPublisher.beginBatch();
+    size_t batchedCount = 0;
+    status_t status = OK;
+    for (DispatchEntry* dispatchEntry : batch.entries) {
+        status = publishDispatchEntry(connection, *dispatchEntry);
+        if (status != OK) {
+            break;
+        }
+        batchedCount++;
+    }
+    const status_t sendStatus = connection.inputPublisher.endBatch(&batch.publishedCount);
+    batch.status = batch.publishedCount < batchedCount ? sendStatus : status;
+    batch.publishTime = now();
+}
 
-            case EventEntry::Type::FOCUS: {
-                const FocusEntry& focusEntry = static_cast<const FocusEntry&>(eventEntry);
-                status = connection->inputPublisher.publishFocusEvent(dispatchEntry->seq,
-                                                                      focusEntry.id,
-                                                                      focusEntry.hasFocus);
-                break;
+status_t InputDispatcher::publishDispatchEntry(Connection& connection,
+                                               DispatchEntry& dispatchEntry) const {
+    const EventEntry& eventEntry = *(dispatchEntry.eventEntry);
+    switch (eventEntry.type) {
+        case EventEntry::Type::KEY: {
+            const KeyEntry& keyEntry = static_cast<const KeyEntry&>(eventEntry);
+            std::array<uint8_t, 32> hmac = getSignature(keyEntry, dispatchEntry);
+            if (DEBUG_OUTBOUND_EVENT_DETAILS) {
+                LOG(INFO) << "Publishing " << dispatchEntry << " to "
+                          << connection.getInputChannelName();
             }
 
-            case EventEntry::Type::TOUCH_MODE_CHANGED: {
-                const TouchModeEntry& touchModeEntry =
-                        static_cast<const TouchModeEntry&>(eventEntry);
-                status = connection->inputPublisher
-                                 .publishTouchModeEvent(dispatchEntry->seq, touchModeEntry.id,
-                                                        touchModeEntry.inTouchMode);
+            // Publish the key event.
+            return connection.inputPublisher
+                    .publishKeyEvent(dispatchEntry.seq, keyEntry.id, keyEntry.deviceId,
+                                     keyEntry.source, keyEntry.displayId, std::move(hmac),
+                                     keyEntry.action, dispatchEntry.resolvedFlags,
+                                     keyEntry.keyCode, keyEntry.scanCode, keyEntry.metaState,
+                                     keyEntry.repeatCount, keyEntry.downTime, keyEntry.eventTime);
+        }
 
-                break;
+        case EventEntry::Type::MOTION: {
+            if (DEBUG_OUTBOUND_EVENT_DETAILS) {
+                LOG(INFO) << "Publishing " << dispatchEntry << " to "
+                          << connection.getInputChannelName();
             }
+            return publishMotionEvent(connection, dispatchEntry);
+        }
 
-            case EventEntry::Type::POINTER_CAPTURE_CHANGED: {
-                const auto& captureEntry =
-                        static_cast<const PointerCaptureChangedEntry&>(eventEntry);
-                status = connection->inputPublisher
-                                 .publishCaptureEvent(dispatchEntry->seq, captureEntry.id,
-                                                      captureEntry.pointerCaptureRequest.enable);
-                break;
-            }
+        case EventEntry::Type::FOCUS: {
+            const FocusEntry& focusEntry = static_cast<const FocusEntry&>(eventEntry);
+            return connection.inputPublisher.publishFocusEvent(dispatchEntry.seq, focusEntry.id,
+                                                               focusEntry.hasFocus);
+        }
 
-            case EventEntry::Type::DRAG: {
-                const DragEntry& dragEntry = static_cast<const DragEntry&>(eventEntry);
-                status = connection->inputPublisher.publishDragEvent(dispatchEntry->seq,
-                                                                     dragEntry.id, dragEntry.x,
-                                                                     dragEntry.y,
-                                                                     dragEntry.isExiting);
-                break;
+        case EventEntry::Type::TOUCH_MODE_CHANGED: {
+            const TouchModeEntry& touchModeEntry = static_cast<const TouchModeEntry&>(eventEntry);
+            return connection.inputPublisher.publishTouchModeEvent(dispatchEntry.seq,
+                                                                   touchModeEntry.id,
+                                                                   touchModeEntry.inTouchMode);
+        }
+
+        case EventEntry::Type::POINTER_CAPTURE_CHANGED: {
+            const auto& captureEntry = static_cast<const PointerCaptureChangedEntry&>(eventEntry);
+            return connection.inputPublisher
+                    .publishCaptureEvent(dispatchEntry.seq, captureEntry.id,
+                                         captureEntry.pointerCaptureRequest.enable);
+        }
+
+        case EventEntry::Type::DRAG: {
+            const DragEntry& dragEntry = static_cast<const DragEntry&>(eventEntry);
+            return connection.inputPublisher.publishDragEvent(dispatchEntry.seq, dragEntry.id,
+                                                              dragEntry.x, dragEntry.y,
+                                                              dragEntry.isExiting);
+        }
+
+        case EventEntry::Type::CONFIGURATION_CHANGED:
+        case EventEntry::Type::DEVICE_RESET:
+        case EventEntry::Type::SENSOR: {
+            LOG_ALWAYS_FATAL("Should never start dispatch cycles for %s events",
+                             ftl::enum_string(eventEntry.type).c_str());
+            return INVALID_OPERATION;
+        }
+    }
+}
+
+void InputDispatcher::finishPublishBatchesLocked(nsecs_t currentTime) {
+    for (PublishBatch& batch : mPublishBatches) {
+        const std::shared_ptr<Connection>& connection = batch.connection;
+        connection->publishing = false;
+        mPublishStats.writeCount++;
+        mPublishStats.eventCount += batch.publishedCount;
+
+        // Trace every entry that was attempted, whether or not it could be published.
+        const size_t attemptedCount =
+                batch.status == OK ? batch.publishedCount : batch.publishedCount + 1;
+        for (size_t i = 0; i < attemptedCount; i++) {
+            const DispatchEntry& dispatchEntry = *batch.entries[i];
+            const EventEntry& eventEntry = *dispatchEntry.eventEntry;
+            if (mTracer && eventEntry.type == EventEntry::Type::KEY) {
+                const auto& keyEntry = static_cast<const KeyEntry&>(eventEntry);
+                mTracer->traceEventDispatch(dispatchEntry, keyEntry.traceTracker.get());
+            } else if (mTracer && eventEntry.type == EventEntry::Type::MOTION) {
+                const auto& motionEntry = static_cast<const MotionEntry&>(eventEntry);
+                mTracer->traceEventDispatch(dispatchEntry, motionEntry.traceTracker.get());
+            }
+            if (i < batch.publishedCount && eventEntry.enqueueTime != 0) {
+                mPublishLatency.record(batch.publishTime - eventEntry.enqueueTime);
             }
+        }
 
-            case EventEntry::Type::CONFIGURATION_CHANGED:
-            case EventEntry::Type::DEVICE_RESET:
-            case EventEntry::Type::SENSOR: {
-                LOG_ALWAYS_FATAL("Should never start dispatch cycles for %s events",
-                                 ftl::enum_string(eventEntry.type).c_str());
-                return;
+        // The connection was broken or removed while the lock was released, and its queues have
+        // already been drained.
+        if (connection->status != Connection::Status::NORMAL) {
+            continue;
+        }
+
+        // Put the events that could not be published back in front of the outbound queue. They
+        // are still the last entries of the wait queue: only this thread adds to it, and the
+        // application cannot have finished events it never received.
+        const size_t unpublishedCount = batch.entries.size() - batch.publishedCount;
+        if (unpublishedCount > 0) {
+            const auto firstUnpublished = connection->waitQueue.end() - unpublishedCount;
+            LOG_ALWAYS_FATAL_IF(firstUnpublished->get() != batch.entries[batch.publishedCount],
+                                "channel '%s' ~ Unpublished events are not at the back of the "
+                                "wait queue",
+                                connection->getInputChannelName().c_str());
+            for (auto it = firstUnpublished; it != connection->waitQueue.end(); it++) {
+                if (connection->responsive) {
+                    mAnrTracker.erase((*it)->timeoutTime, connection->getToken());
+                }
             }
+            connection->outboundQueue.insert(connection->outboundQueue.begin(),
+                                             std::make_move_iterator(firstUnpublished),
+                                             std::make_move_iterator(connection->waitQueue.end()));
+            connection->waitQueue.erase(firstUnpublished, connection->waitQueue.end());
+            traceWaitQueueLength(*connection);
+            traceOutboundQueueLength(*connection);
         }
 
         // Check the result.
-        if (status) {
-            if (status == WOULD_BLOCK) {
-                if (connection->waitQueue.empty()) {
-                    ALOGE("channel '%s' ~ Could not publish event because the pipe is full. "
-                          "This is unexpected because the wait queue is empty, so the pipe "
-                          "should be empty and we shouldn't have any problems writing an "
-                          "event to it, status=%s(%d)",
-                          connection->getInputChannelName().c_str(), statusToString(status).c_str(),
-                          status);
-                    abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
-                } else {
-                    // Pipe is full and we are waiting for the app to finish process some events
-                    // before sending more events to it.
-                    if (DEBUG_DISPATCH_CYCLE) {
-                        ALOGD("channel '%s' ~ Could not publish event because the pipe is full, "
-                              "waiting for the application to catch up",
-                              connection->getInputChannelName().c_str());
-                    }
-                }
-            } else {
-                ALOGE("channel '%s' ~ Could not publish event due to an unexpected error, "
-                      "status=%s(%d)",
+        const status_t status = batch.status;
+        if (status == OK) {
+            continue;
+        }
+        if (status == WOULD_BLOCK) {
+            if (connection->waitQueue.empty()) {
+                ALOGE("channel '%s' ~ Could not publish event because the pipe is full. "
+                      "This is unexpected because the wait queue is empty, so the pipe "
+                      "should be empty and we shouldn't have any problems writing an "
+                      "event to it, status=%s(%d)",
                       connection->getInputChannelName().c_str(), statusToString(status).c_str(),
                       status);
                 abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
+            } else {
+                // Pipe is full and we are waiting for the app to finish process some events
+                // before sending more events to it.
+                if (DEBUG_DISPATCH_CYCLE) {
+                    ALOGD("channel '%s' ~ Could not publish event because the pipe is full, "
+                          "waiting for the application to catch up",
+                          connection->getInputChannelName().c_str());
+                }
             }
-            return;
-        }
-
-        // Re-enqueue the event on the wait queue.
-        const nsecs_t timeoutTime = dispatchEntry->timeoutTime;
-        connection->waitQueue.emplace_back(std::move(dispatchEntry));
-        connection->outboundQueue.erase(connection->outboundQueue.begin());
-        traceOutboundQueueLength(*connection);
-        if (connection->responsive) {
-            mAnrTracker.insert(timeoutTime, connection->getToken());
+        } else {
+            ALOGE("channel '%s' ~ Could not publish event due to an unexpected error, "
+                  "status=%s(%d)",
+                  connection->getInputChannelName().c_str(), statusToString(status).c_str(),
+                  status);
+            abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
         }
-        traceWaitQueueLength(*connection);
     }
+    mPublishBatches.clear();
+    mEntriesReleasedWhilePublishing.clear();
 }
 
 std::array<uint8_t, 32> InputDispatcher::sign(const VerifiedInputEvent& event) const {
@@ -3906,7 +4011,10 @@ void InputDispatcher::abortBrokenDispatchCycleLocked(nsecs_t currentTime,
     // Clear the dispatch queues.
     drainDispatchQueue(connection->outboundQueue);
     traceOutboundQueueLength(*connection);
-    drainDispatchQueue(connection->waitQueue);
+    for (std::unique_ptr<DispatchEntry>& dispatchEntry : connection->waitQueue) {
+        releaseWaitQueueEntryLocked(*connection, std::move(dispatchEntry));
+    }
+    connection->waitQueue.clear();
     traceWaitQueueLength(*connection);
 
     // The connection appears to be unrecoverably broken.
@@ -3941,6 +4049,19 @@ void InputDispatcher::releaseDispatchEntry(std::unique_ptr<DispatchEntry> dispat
     }
 }
 
+void InputDispatcher::releaseWaitQueueEntryLocked(const Connection& connection,
+                                                  std::unique_ptr<DispatchEntry> dispatchEntry) {
+    if (!connection.publishing) {
+        releaseDispatchEntry(std::move(dispatchEntry));
+        return;
+    }
+    // A publish batch that has not been finished yet may still refer to the entry.
+    if (dispatchEntry->hasForegroundTarget()) {
+        decrementPendingForegroundDispatches(*(dispatchEntry->eventEntry));
+    }
+    mEntriesReleasedWhilePublishing.push_back(std::move(dispatchEntry));
+}
+
 int InputDispatcher::handleReceiveCallback(int events, sp<IBinder> connectionToken) {
     std::scoped_lock _l(mLock);
     std::shared_ptr<Connection> connection = getConnectionLocked(connectionToken);
@@ -3988,9 +4109,10 @@ int InputDispatcher::handleReceiveCallback(int events, sp<IBinder> connectionTok
         }
         if (gotOne) {
             runCommandsLockedInterruptable();
-            if (status == WOULD_BLOCK) {
-                return 1;
-            }
+        }
+        if (status == WOULD_BLOCK) {
+            // Also the case when the socket only held a request that the channel handled itself.
+            return 1;
         }
 
         notify = status != DEAD_OBJECT || !connection->monitor;
@@ -4187,7 +4309,7 @@ void InputDispatcher::synthesizeCancelationEventsForConnectionLocked(
 
     // If the outbound queue was previously empty, start the dispatch cycle going.
     if (wasEmpty && !connection->outboundQueue.empty()) {
-        startDispatchCycleLocked(currentTime, connection);
+        startDispatchCycleLocked(connection);
     }
 }
 
@@ -4264,7 +4386,7 @@ void InputDispatcher::synthesizePointerDownEventsForConnectionLocked(
 
     // If the outbound queue was previously empty, start the dispatch cycle going.
     if (wasEmpty && !connection->outboundQueue.empty()) {
-        startDispatchCycleLocked(downTime, connection);
+        startDispatchCycleLocked(connection);
     }
 }
 
@@ -4365,6 +4487,7 @@ std::unique_ptr<MotionEntry> InputDispatcher::splitMotionEvent(
                                           originalMotionEntry.xCursorPosition,
                                           originalMotionEntry.yCursorPosition, splitDownTime,
                                           splitPointerProperties, splitPointerCoords);
+    splitMotionEntry->enqueueTime = originalMotionEntry.enqueueTime;
 
     return splitMotionEntry;
 }
@@ -5117,6 +5240,13 @@ ui::Transform InputDispatcher::getTransformLocked(int32_t displayId) const {
                                                 : kIdentityTransform;
 }
 
+const std::vector<size_t>& InputDispatcher::getHitTestCandidatesLocked(int32_t displayId, float x,
+                                                                       float y) const {
+    static const std::vector<size_t> NO_CANDIDATES;
+    auto it = mWindowHitIndexByDisplay.find(displayId);
+    return it != mWindowHitIndexByDisplay.end() ? it->second.getCandidates(x, y) : NO_CANDIDATES;
+}
+
 bool InputDispatcher::canWindowReceiveMotionLocked(const sp<WindowInfoHandle>& window,
                                                    const MotionEntry& motionEntry) const {
     const WindowInfo& info = *window->getInfo();
@@ -5184,6 +5314,7 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     if (windowInfoHandles.empty()) {
         // Remove all handles on a display if there are no windows left.
         mWindowHandlesByDisplay.erase(displayId);
+        mWindowHitIndexByDisplay.erase(displayId);
         return;
     }
 
@@ -5229,6 +5360,10 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
 
     // Insert or replace
     mWindowHandlesByDisplay[displayId] = newHandles;
+    // The handles were updated in place, so the index has to be refreshed even if the list of
+    // handles stayed the same. This only rebuilds the index if the touchable bounds changed.
+    mWindowHitIndexByDisplay[displayId].update(newHandles, displayId,
+                                               getTransformLocked(displayId));
 }
 
 /**
@@ -5809,6 +5944,10 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) const {
             } else {
                 dump += INDENT2 "No DisplayInfo found!\n";
             }
+            if (const auto& it = mWindowHitIndexByDisplay.find(displayId);
+                it != mWindowHitIndexByDisplay.end()) {
+                dump += INDENT2 "WindowHitIndex: " + it->second.dump() + "\n";
+            }
 
             if (!windowHandles.empty()) {
                 dump += INDENT2 "Windows:\n";
@@ -5928,6 +6067,20 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) const {
                          ns2ms(mConfig.keyRepeatTimeout));
     dump += mLatencyTracker.dump(INDENT2);
     dump += mLatencyAggregator.dump(INDENT2);
+    dump += INDENT "PublishLatency: " + mPublishLatency.dump() + "\n";
+    dump += StringPrintf(INDENT "PublishStats: writeCount=%zu, eventCount=%zu\n",
+                         mPublishStats.writeCount, mPublishStats.eventCount);
+    const auto dumpEntryPool = [&dump](const char* name, const EntryPool::Stats& stats) {
+        dump += StringPrintf(INDENT2 "%s: heapAllocations=%zu, pooledAllocations=%zu, "
+                                     "freeBlocks=%zu\n",
+                             name, stats.heapAllocations, stats.pooledAllocations,
+                             stats.freeBlocks);
+    };
+    const EntryPoolStats entryPoolStats = getEntryPoolStats();
+    dump += INDENT "EntryPools:\n";
+    dumpEntryPool("KeyEntry", entryPoolStats.keyEntries);
+    dumpEntryPool("MotionEntry", entryPoolStats.motionEntries);
+    dumpEntryPool("DispatchEntry", entryPoolStats.dispatchEntries);
     dump += INDENT "InputTracer: ";
     dump += mTracer == nullptr ? "Disabled" : "Enabled";
 }
@@ -5963,6 +6116,7 @@ Result<std::unique_ptr<InputChannel>> InputDispatcher::createInputChannel(const
     if (result) {
         return base::Error(result) << "Failed to open input channel pair with name " << name;
     }
+    serverChannel->setCompactMotionEncodingAllowed(input_flags::compact_input_message_encoding());
 
     { // acquire lock
         std::scoped_lock _l(mLock);
@@ -5998,6 +6152,7 @@ Result<std::unique_ptr<InputChannel>> InputDispatcher::createInputMonitor(int32_
     if (result) {
         return base::Error(result) << "Failed to open input channel pair with name " << name;
     }
+    serverChannel->setCompactMotionEncodingAllowed(input_flags::compact_input_message_encoding());
 
     { // acquire lock
         std::scoped_lock _l(mLock);
@@ -6303,11 +6458,11 @@ void InputDispatcher::doDispatchCycleFinishedCommand(nsecs_t finishTime,
                 }
             }
         }
-        releaseDispatchEntry(std::move(dispatchEntry));
+        releaseWaitQueueEntryLocked(*connection, std::move(dispatchEntry));
     }
 
     // Start the next dispatch cycle for this connection.
-    startDispatchCycleLocked(now(), connection);
+    startDispatchCycleLocked(connection);
 }
 
 void InputDispatcher::sendFocusChangedCommandLocked(const sp<IBinder>& oldToken,
@@ -6939,6 +7094,11 @@ void InputDispatcher::cancelCurrentTouch() {
     mLooper->wake();
 }
 
+InputDispatcher::PublishStats InputDispatcher::getPublishStats() const {
+    std::scoped_lock _l(mLock);
+    return mPublishStats;
+}
+
 void InputDispatcher::setMonitorDispatchingTimeoutForTest(std::chrono::nanoseconds timeout) {
     std::scoped_lock _l(mLock);
     mMonitorDispatchingTimeout = timeout;
@@ -28,10 +28,12 @@
 #include "InputTarget.h"
 #include "InputThread.h"
 #include "LatencyAggregator.h"
+#include "LatencyHistogram.h"
 #include "LatencyTracker.h"
 #include "Monitor.h"
 #include "TouchState.h"
 #include "TouchedWindow.h"
+#include "WindowHitIndex.h"
 #include "trace/InputTracerInterface.h"
 #include "trace/InputTracingBackendInterface.h"
 
@@ -152,6 +154,15 @@ public:
     // Public to allow tests to verify that a Monitor can get ANR.
     void setMonitorDispatchingTimeoutForTest(std::chrono::nanoseconds timeout);
 
+    struct PublishStats {
+        // Writes to the connection sockets, each a single InputChannel::sendMessages call.
+        size_t writeCount = 0;
+        // Events carried by those writes.
+        size_t eventCount = 0;
+    };
+    // Public to allow tests to verify that events queued together are written together.
+    PublishStats getPublishStats() const;
+
     void setKeyRepeatConfiguration(std::chrono::nanoseconds timeout,
                                    std::chrono::nanoseconds delay) override;
 
@@ -356,6 +367,10 @@ private:
             mWindowHandlesByDisplay GUARDED_BY(mLock);
     std::unordered_map<int32_t /*displayId*/, android::gui::DisplayInfo> mDisplayInfos
             GUARDED_BY(mLock);
+    // Narrows down the windows to hit test for touches. Kept in sync with mWindowHandlesByDisplay
+    // and mDisplayInfos by updateWindowHandlesForDisplayLocked.
+    std::unordered_map<int32_t /*displayId*/, WindowHitIndex> mWindowHitIndexByDisplay
+            GUARDED_BY(mLock);
     void setInputWindowsLocked(
             const std::vector<sp<android::gui::WindowInfoHandle>>& inputWindowHandles,
             int32_t displayId) REQUIRES(mLock);
@@ -363,6 +378,10 @@ private:
     const std::vector<sp<android::gui::WindowInfoHandle>>& getWindowHandlesLocked(
             int32_t displayId) const REQUIRES(mLock);
     ui::Transform getTransformLocked(int32_t displayId) const REQUIRES(mLock);
+    // Get the positions in getWindowHandlesLocked(displayId) of the windows that may accept a
+    // touch at the given location, front to back.
+    const std::vector<size_t>& getHitTestCandidatesLocked(int32_t displayId, float x,
+                                                          float y) const REQUIRES(mLock);
 
     sp<android::gui::WindowInfoHandle> getWindowHandleLocked(
             const sp<IBinder>& windowHandleToken, std::optional<int32_t> displayId = {}) const
@@ -596,8 +615,45 @@ private:
                                     std::shared_ptr<const EventEntry>,
                                     const InputTarget& inputTarget) REQUIRES(mLock);
     status_t publishMotionEvent(Connection& connection, DispatchEntry& dispatchEntry) const;
-    void startDispatchCycleLocked(nsecs_t currentTime,
-                                  const std::shared_ptr<Connection>& connection) REQUIRES(mLock);
+
+    // Dispatch cycles only schedule the connection for publishing. With mLock held, the dispatcher
+    // thread moves the outbound queues of the scheduled connections to their wait queues, and
+    // then writes the moved entries to the sockets without holding mLock. The outcome of the
+    // writes is handled when the dispatcher thread next takes mLock.
+    struct PublishBatch {
+        std::shared_ptr<Connection> connection;
+        // Entries moved from the outbound queue to the back of the wait queue. The wait queue owns
+        // them, and the connection is marked as publishing until the batch is finished so that
+        // they stay alive.
+        std::vector<DispatchEntry*> entries;
+        // How many entries, starting from the front, have been written to the socket.
+        size_t publishedCount = 0;
+        // The result of publishing the entry that follows the published ones, if any.
+        status_t status = OK;
+        // When the writes to the socket were done.
+        nsecs_t publishTime = 0;
+    };
+    void startDispatchCycleLocked(const std::shared_ptr<Connection>& connection) REQUIRES(mLock);
+    void takePublishBatchesLocked(nsecs_t currentTime) REQUIRES(mLock);
+    void publishBatch(PublishBatch& batch) const EXCLUDES(mLock);
+    status_t publishDispatchEntry(Connection& connection, DispatchEntry& dispatchEntry) const;
+    void finishPublishBatchesLocked(nsecs_t currentTime) REQUIRES(mLock);
+    // Connections that have outbound events for the dispatcher thread to publish.
+    std::vector<std::shared_ptr<Connection>> mConnectionsPendingPublish GUARDED_BY(mLock);
+    // The batches taken by the last dispatchOnce. Only accessed by the dispatcher thread, which
+    // writes them to the sockets without holding mLock.
+    std::vector<PublishBatch> mPublishBatches;
+    // Entries released from the wait queue of a connection while it was publishing. They are
+    // destroyed once the publish batches are finished.
+    std::deque<std::unique_ptr<DispatchEntry>> mEntriesReleasedWhilePublishing GUARDED_BY(mLock);
+    // True while the dispatcher thread holds mLock in dispatchOnce, which takes the pending
+    // connections before it releases the lock. Connections scheduled at any other time need to
+    // wake the looper.
+    bool mInDispatchLoop GUARDED_BY(mLock) = false;
+    // Time from adding an event to the inbound queue to writing it to a connection socket.
+    LatencyHistogram mPublishLatency GUARDED_BY(mLock);
+    PublishStats mPublishStats GUARDED_BY(mLock);
+
     void finishDispatchCycleLocked(nsecs_t currentTime,
                                    const std::shared_ptr<Connection>& connection, uint32_t seq,
                                    bool handled, nsecs_t consumeTime) REQUIRES(mLock);
@@ -606,6 +662,10 @@ private:
             REQUIRES(mLock);
     void drainDispatchQueue(std::deque<std::unique_ptr<DispatchEntry>>& queue);
     void releaseDispatchEntry(std::unique_ptr<DispatchEntry> dispatchEntry);
+    // Releases an entry removed from the wait queue of the connection. While the connection is
+    // publishing, the entry is only destroyed once the publish batches are finished.
+    void releaseWaitQueueEntryLocked(const Connection& connection,
+                                     std::unique_ptr<DispatchEntry> dispatchEntry) REQUIRES(mLock);
     int handleReceiveCallback(int events, sp<IBinder> connectionToken);
     // The action sent should only be of type AMOTION_EVENT_*
     void dispatchPointerDownOutsideFocus(uint32_t source, int32_t action,
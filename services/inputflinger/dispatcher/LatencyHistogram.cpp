@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LatencyHistogram.h"
+
+#include <android-base/stringprintf.h>
+
+#include <algorithm>
+#include <bit>
+#include <cinttypes>
+#include <cmath>
+
+using android::base::StringPrintf;
+
+namespace android::inputdispatcher {
+
+void LatencyHistogram::record(nsecs_t latency) {
+    latency = std::max(latency, nsecs_t(0));
+    const uint64_t micros = static_cast<uint64_t>(ns2us(latency));
+    const size_t bucket = std::min(static_cast<size_t>(std::bit_width(micros)), NUM_BUCKETS - 1);
+    mBuckets[bucket]++;
+    mCount++;
+    mMax = std::max(mMax, latency);
+}
+
+nsecs_t LatencyHistogram::getPercentile(float percentile) const {
+    if (mCount == 0) {
+        return 0;
+    }
+    const size_t target =
+            std::max(size_t(1), static_cast<size_t>(std::ceil(mCount * percentile / 100.0f)));
+    size_t cumulativeCount = 0;
+    for (size_t i = 0; i < NUM_BUCKETS - 1; i++) {
+        cumulativeCount += mBuckets[i];
+        if (cumulativeCount >= target) {
+            return std::min(us2ns(nsecs_t(1) << i), mMax);
+        }
+    }
+    return mMax;
+}
+
+std::string LatencyHistogram::dump() const {
+    return StringPrintf("count=%zu, p50=%" PRId64 "us, p90=%" PRId64 "us, p99=%" PRId64
+                        "us, max=%" PRId64 "us",
+                        mCount, ns2us(getPercentile(50)), ns2us(getPercentile(90)),
+                        ns2us(getPercentile(99)), ns2us(mMax));
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Timers.h>
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace android::inputdispatcher {
+
+/**
+ * Histogram of latencies with power of two microsecond buckets. Cheap enough to record every
+ * dispatched event, at the cost of reporting percentiles as the upper bound of their bucket.
+ *
+ * Not thread safe.
+ */
+class LatencyHistogram {
+public:
+    // Bucket i holds latencies below 2^i microseconds. The last bucket holds everything else.
+    static constexpr size_t NUM_BUCKETS = 24;
+
+    void record(nsecs_t latency);
+
+    size_t getCount() const { return mCount; }
+    nsecs_t getMax() const { return mMax; }
+
+    /**
+     * Returns the upper bound of the bucket that holds the given percentile (0 to 100] of the
+     * recorded latencies, capped at the largest recorded latency. Returns 0 if nothing was
+     * recorded.
+     */
+    nsecs_t getPercentile(float percentile) const;
+
+    std::string dump() const;
+
+private:
+    std::array<size_t, NUM_BUCKETS> mBuckets{};
+    size_t mCount = 0;
+    nsecs_t mMax = 0;
+};
+
+} // namespace android::inputdispatcher
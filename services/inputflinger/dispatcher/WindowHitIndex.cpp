@@ -0,0 +1,156 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WindowHitIndex.h"
+
+#include <android-base/stringprintf.h>
+
+#include <algorithm>
+#include <cmath>
+
+using android::base::StringPrintf;
+using android::gui::WindowInfo;
+using android::gui::WindowInfoHandle;
+
+namespace android::inputdispatcher {
+
+namespace {
+
+// Grids are at most this many cells wide and high. Beyond that, the cost of inserting full screen
+// windows into every cell outweighs the benefit of smaller cells.
+constexpr int64_t MAX_CELLS_PER_SIDE = 16;
+
+} // namespace
+
+bool WindowHitIndex::update(const std::vector<sp<WindowInfoHandle>>& windowHandles,
+                            int32_t displayId, const ui::Transform& displayTransform) {
+    std::vector<Rect> windowBounds;
+    windowBounds.reserve(windowHandles.size());
+    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+        windowBounds.push_back(
+                getTouchableBounds(*windowHandle->getInfo(), displayId, displayTransform));
+    }
+
+    // The grid is in logical display space, so it stays valid across display transform changes
+    // as long as the bounds in that space are the same.
+    mDisplayTransform = displayTransform;
+    if (windowBounds == mWindowBounds) {
+        return false;
+    }
+
+    mWindowBounds = std::move(windowBounds);
+    rebuildGrid();
+    return true;
+}
+
+const std::vector<size_t>& WindowHitIndex::getCandidates(float x, float y) const {
+    static const std::vector<size_t> NO_CANDIDATES;
+    if (mCells.empty()) {
+        return NO_CANDIDATES;
+    }
+
+    // Mirror the rounding in windowAcceptsTouchAt. Compare in double precision so that large
+    // coordinates are not rounded before the bounds check.
+    const vec2 p = mDisplayTransform.transform(x, y);
+    const double px = std::floor(p.x);
+    const double py = std::floor(p.y);
+    if (!(px >= mGridBounds.left && px < mGridBounds.right && py >= mGridBounds.top &&
+          py < mGridBounds.bottom)) {
+        return NO_CANDIDATES;
+    }
+
+    const int64_t column = (static_cast<int64_t>(px) - mGridBounds.left) / mCellWidth;
+    const int64_t row = (static_cast<int64_t>(py) - mGridBounds.top) / mCellHeight;
+    return mCells[row * mColumns + column];
+}
+
+std::string WindowHitIndex::dump() const {
+    return StringPrintf("gridBounds=%s, cells=%dx%d, windows=%zu, rebuilds=%zu",
+                        to_string(mGridBounds).c_str(), mColumns, mRows, mWindowBounds.size(),
+                        mRebuildCount);
+}
+
+Rect WindowHitIndex::getTouchableBounds(const WindowInfo& info, int32_t displayId,
+                                        const ui::Transform& displayTransform) {
+    // Only exclude windows that windowAcceptsTouchAt rejects regardless of the event. Windows that
+    // are not touchable may still intercept stylus events.
+    if (info.displayId != displayId ||
+        info.inputConfig.test(WindowInfo::InputConfig::NOT_VISIBLE)) {
+        return Rect::EMPTY_RECT;
+    }
+    return displayTransform.transform(info.touchableRegion).getBounds();
+}
+
+void WindowHitIndex::rebuildGrid() {
+    mRebuildCount++;
+    mCells.clear();
+
+    bool hasBounds = false;
+    for (const Rect& bounds : mWindowBounds) {
+        if (bounds.isEmpty()) {
+            continue;
+        }
+        if (!hasBounds) {
+            mGridBounds = bounds;
+            hasBounds = true;
+            continue;
+        }
+        mGridBounds.left = std::min(mGridBounds.left, bounds.left);
+        mGridBounds.top = std::min(mGridBounds.top, bounds.top);
+        mGridBounds.right = std::max(mGridBounds.right, bounds.right);
+        mGridBounds.bottom = std::max(mGridBounds.bottom, bounds.bottom);
+    }
+
+    if (!hasBounds) {
+        mGridBounds = Rect::EMPTY_RECT;
+        mColumns = 0;
+        mRows = 0;
+        return;
+    }
+
+    // Aim for about one window per cell.
+    const int64_t width = static_cast<int64_t>(mGridBounds.right) - mGridBounds.left;
+    const int64_t height = static_cast<int64_t>(mGridBounds.bottom) - mGridBounds.top;
+    const int64_t cellsPerSide =
+            std::clamp(static_cast<int64_t>(std::ceil(std::sqrt(mWindowBounds.size()))),
+                       int64_t(1), MAX_CELLS_PER_SIDE);
+    mColumns = static_cast<int32_t>(std::min(cellsPerSide, width));
+    mRows = static_cast<int32_t>(std::min(cellsPerSide, height));
+    mCellWidth = (width + mColumns - 1) / mColumns;
+    mCellHeight = (height + mRows - 1) / mRows;
+    mCells.resize(static_cast<size_t>(mColumns) * mRows);
+
+    for (size_t i = 0; i < mWindowBounds.size(); i++) {
+        const Rect& bounds = mWindowBounds[i];
+        if (bounds.isEmpty()) {
+            continue;
+        }
+        const int64_t firstColumn = (bounds.left - static_cast<int64_t>(mGridBounds.left)) /
+                mCellWidth;
+        const int64_t lastColumn =
+                (bounds.right - 1 - static_cast<int64_t>(mGridBounds.left)) / mCellWidth;
+        const int64_t firstRow = (bounds.top - static_cast<int64_t>(mGridBounds.top)) / mCellHeight;
+        const int64_t lastRow =
+                (bounds.bottom - 1 - static_cast<int64_t>(mGridBounds.top)) / mCellHeight;
+        for (int64_t row = firstRow; row <= lastRow; row++) {
+            for (int64_t column = firstColumn; column <= lastColumn; column++) {
+                mCells[row * mColumns + column].push_back(i);
+            }
+        }
+    }
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <gui/WindowInfo.h>
+#include <ui/Rect.h>
+#include <ui/Transform.h>
+
+#include <string>
+#include <vector>
+
+namespace android::inputdispatcher {
+
+/**
+ * Uniform grid over the touchable bounds of the windows on a display, used to narrow down the
+ * windows that need an exact hit test for a touch.
+ *
+ * Bounds are kept in the same logical display space that windowAcceptsTouchAt tests in, so a
+ * window that accepts a touch at a location is always among the candidates returned for it. The
+ * reverse does not hold: candidates still need the exact touchable region check.
+ */
+class WindowHitIndex {
+public:
+    // Indexes the given windows, listed front to back. Only rebuilds the grid if the touchable
+    // bounds of the windows or the display transform changed since the last call. Returns true if
+    // the grid was rebuilt.
+    bool update(const std::vector<sp<gui::WindowInfoHandle>>& windowHandles, int32_t displayId,
+                const ui::Transform& displayTransform);
+
+    // Returns the positions in the window list passed to update() of the windows whose touchable
+    // bounds contain the given display location, in front to back order.
+    const std::vector<size_t>& getCandidates(float x, float y) const;
+
+    size_t getRebuildCount() const { return mRebuildCount; }
+
+    std::string dump() const;
+
+private:
+    // Returns an empty rect for windows that can never accept a touch on the display.
+    static Rect getTouchableBounds(const gui::WindowInfo& info, int32_t displayId,
+                                   const ui::Transform& displayTransform);
+
+    void rebuildGrid();
+
+    ui::Transform mDisplayTransform;
+    // Touchable bounds in logical display space, one per window.
+    std::vector<Rect> mWindowBounds;
+
+    // Union of mWindowBounds, split into mColumns * mRows cells.
+    Rect mGridBounds;
+    int32_t mColumns = 0;
+    int32_t mRows = 0;
+    int64_t mCellWidth = 0;
+    int64_t mCellHeight = 0;
+    // Window positions overlapping each cell, in front to back order. Row major.
+    std::vector<std::vector<size_t>> mCells;
+
+    size_t mRebuildCount = 0;
+};
+
+} // namespace android::inputdispatcher
@@ -43,6 +43,8 @@ struct TracedKeyEvent {
     nsecs_t downTime;
     int32_t flags;
     int32_t repeatCount;
+
+    bool operator==(const TracedKeyEvent&) const = default;
 };
 
 /**
@@ -69,6 +71,8 @@ struct TracedMotionEvent {
     nsecs_t downTime;
     std::vector<PointerProperties> pointerProperties;
     std::vector<PointerCoords> pointerCoords;
+
+    bool operator==(const TracedMotionEvent&) const = default;
 };
 
 /** A representation of a traced input event. */
@@ -98,6 +102,8 @@ public:
         ui::Transform transform;
         ui::Transform rawTransform;
         std::array<uint8_t, 32> hmac;
+
+        bool operator==(const WindowDispatchArgs&) const = default;
     };
     virtual void traceWindowDispatch(const WindowDispatchArgs&) = 0;
 };
@@ -24,84 +24,103 @@
 
 namespace android::inputdispatcher::trace::impl {
 
-namespace {
-
-// Helper to std::visit with lambdas.
-template <typename... V>
-struct Visitor : V... {
-    using V::operator()...;
-};
-
-} // namespace
-
 // --- ThreadedBackend ---
 
 template <typename Backend>
-ThreadedBackend<Backend>::ThreadedBackend(Backend&& innerBackend)
-      : mTracerThread(
+ThreadedBackend<Backend>::ThreadedBackend(Backend&& innerBackend, size_t capacity)
+      : mBackend(std::move(innerBackend)),
+        mRing(capacity),
+        mTracerThread(
                 "InputTracer", [this]() { threadLoop(); },
-                [this]() { mThreadWakeCondition.notify_all(); }),
-        mBackend(std::move(innerBackend)) {}
+                [this]() {
+                    mWakeSequence.fetch_add(1, std::memory_order_release);
+                    mWakeSequence.notify_all();
+                }) {}
 
 template <typename Backend>
 ThreadedBackend<Backend>::~ThreadedBackend() {
-    {
-        std::scoped_lock lock(mLock);
-        mThreadExit = true;
+    mThreadExit.store(true);
+    mWakeSequence.fetch_add(1, std::memory_order_release);
+    mWakeSequence.notify_all();
+}
+
+template <typename Backend>
+template <typename Fill>
+void ThreadedBackend<Backend>::push(Fill&& fill) {
+    if (!mRing.tryPush(fill)) {
+        // The ring counts the dropped event.
+        return;
     }
-    mThreadWakeCondition.notify_all();
+    mWakeSequence.fetch_add(1, std::memory_order_release);
+    // This only makes a system call when the tracing thread is waiting.
+    mWakeSequence.notify_one();
 }
 
 template <typename Backend>
 void ThreadedBackend<Backend>::traceMotionEvent(const TracedMotionEvent& event) {
-    std::scoped_lock lock(mLock);
-    mQueue.emplace_back(event);
-    mThreadWakeCondition.notify_all();
+    push([&event](TraceRecord& record) {
+        record.type = TraceRecord::Type::MOTION;
+        record.setEvent(event);
+    });
 }
 
 template <typename Backend>
 void ThreadedBackend<Backend>::traceKeyEvent(const TracedKeyEvent& event) {
-    std::scoped_lock lock(mLock);
-    mQueue.emplace_back(event);
-    mThreadWakeCondition.notify_all();
+    push([&event](TraceRecord& record) {
+        record.type = TraceRecord::Type::KEY;
+        record.setEvent(event);
+    });
 }
 
 template <typename Backend>
 void ThreadedBackend<Backend>::traceWindowDispatch(const WindowDispatchArgs& dispatchArgs) {
-    std::scoped_lock lock(mLock);
-    mQueue.emplace_back(dispatchArgs);
-    mThreadWakeCondition.notify_all();
+    push([&dispatchArgs](TraceRecord& record) {
+        record.type = TraceRecord::Type::WINDOW_DISPATCH;
+        record.setWindowDispatch(dispatchArgs);
+    });
 }
 
 template <typename Backend>
-void ThreadedBackend<Backend>::threadLoop() {
-    std::vector<TraceEntry> entries;
+size_t ThreadedBackend<Backend>::getDroppedCount() const {
+    return mRing.getDroppedCount();
+}
 
-    { // acquire lock
-        std::unique_lock lock(mLock);
-        base::ScopedLockAssertion assumeLocked(mLock);
+template <typename Backend>
+void ThreadedBackend<Backend>::threadLoop() {
+    // Read the wake sequence before draining the ring, so that a record pushed after the ring was
+    // found empty changes the sequence and ends the wait below.
+    const uint32_t wakeSequence = mWakeSequence.load(std::memory_order_acquire);
+    if (mThreadExit.load()) {
+        return;
+    }
 
-        // Wait until we need to process more events or exit.
-        mThreadWakeCondition.wait(lock,
-                                  [&]() REQUIRES(mLock) { return mThreadExit || !mQueue.empty(); });
-        if (mThreadExit) {
-            return;
+    // Trace the events into the backend, converting them back from the records in place.
+    while (mRing.tryPop([&](const TraceRecord& record) {
+        switch (record.type) {
+            case TraceRecord::Type::KEY:
+                mBackend.traceKeyEvent(record.key);
+                break;
+            case TraceRecord::Type::MOTION:
+                record.getMotionEvent(mMotionEvent);
+                mBackend.traceMotionEvent(mMotionEvent);
+                break;
+            case TraceRecord::Type::WINDOW_DISPATCH:
+                record.getWindowDispatch(mWindowDispatchArgs);
+                mBackend.traceWindowDispatch(mWindowDispatchArgs);
+                break;
         }
+    })) {
+    }
 
-        mQueue.swap(entries);
-    } // release lock
-
-    // Trace the events into the backend without holding the lock to reduce the amount of
-    // work performed in the critical section.
-    for (const auto& entry : entries) {
-        std::visit(Visitor{[&](const TracedMotionEvent& e) { mBackend.traceMotionEvent(e); },
-                           [&](const TracedKeyEvent& e) { mBackend.traceKeyEvent(e); },
-                           [&](const WindowDispatchArgs& args) {
-                               mBackend.traceWindowDispatch(args);
-                           }},
-                   entry);
+    const size_t droppedCount = getDroppedCount();
+    if (droppedCount != mReportedDroppedCount) {
+        LOG(WARNING) << "Dropped " << (droppedCount - mReportedDroppedCount)
+                     << " traced input events because the tracing thread fell behind";
+        mReportedDroppedCount = droppedCount;
     }
-    entries.clear();
+
+    // Wait until we need to process more events or exit.
+    mWakeSequence.wait(wakeSequence, std::memory_order_acquire);
 }
 
 // Explicit template instantiation for the PerfettoBackend.
@@ -18,11 +18,10 @@
 
 #include "InputThread.h"
 #include "InputTracingPerfettoBackend.h"
+#include "TraceRecord.h"
+#include "TraceRing.h"
 
-#include <android-base/thread_annotations.h>
-#include <mutex>
-#include <variant>
-#include <vector>
+#include <atomic>
 
 namespace android::inputdispatcher::trace::impl {
 
@@ -31,28 +30,55 @@ namespace android::inputdispatcher::trace::impl {
  * from a single new thread that it creates. The new tracing thread is started when the
  * ThreadedBackend is created, and is stopped when it is destroyed. The ThreadedBackend is
  * thread-safe.
+ *
+ * The traced events are copied into a preallocated lock-free ring, so that tracing an event
+ * neither allocates nor takes a lock on the calling thread. The events are converted back and
+ * written to the inner backend on the tracing thread. When the tracing thread falls behind by
+ * more than the capacity of the ring, new events are dropped and counted.
  */
 template <typename Backend>
 class ThreadedBackend : public InputTracingBackendInterface {
 public:
-    ThreadedBackend(Backend&& innerBackend);
+    // Enough for bursts of many windows receiving multi-pointer gestures, at about 2.5 KB per
+    // record.
+    static constexpr size_t DEFAULT_CAPACITY = 256;
+
+    ThreadedBackend(Backend&& innerBackend, size_t capacity = DEFAULT_CAPACITY);
     ~ThreadedBackend() override;
 
     void traceKeyEvent(const TracedKeyEvent&) override;
     void traceMotionEvent(const TracedMotionEvent&) override;
     void traceWindowDispatch(const WindowDispatchArgs&) override;
 
-private:
-    std::mutex mLock;
-    InputThread mTracerThread;
-    bool mThreadExit GUARDED_BY(mLock){false};
-    std::condition_variable mThreadWakeCondition;
-    Backend mBackend;
-    using TraceEntry = std::variant<TracedKeyEvent, TracedMotionEvent, WindowDispatchArgs>;
-    std::vector<TraceEntry> mQueue GUARDED_BY(mLock);
+    /** Returns the number of events that were dropped because the ring was full. */
+    size_t getDroppedCount() const;
 
+private:
     using WindowDispatchArgs = InputTracingBackendInterface::WindowDispatchArgs;
 
+    Backend mBackend;
+    TraceRing<TraceRecord> mRing;
+    size_t mReportedDroppedCount{0};
+    // Incremented whenever a record is pushed, or the thread should exit. The tracing thread
+    // waits on it when the ring is empty.
+    std::atomic<uint32_t> mWakeSequence{0};
+    std::atomic<bool> mThreadExit{false};
+    // Reused by the tracing thread for the conversions back.
+    TracedMotionEvent mMotionEvent;
+    WindowDispatchArgs mWindowDispatchArgs{.eventEntry = TracedKeyEvent{},
+                                           .deliveryTime = 0,
+                                           .resolvedFlags = 0,
+                                           .targetUid = gui::Uid::INVALID,
+                                           .vsyncId = 0,
+                                           .windowId = 0,
+                                           .transform = {},
+                                           .rawTransform = {},
+                                           .hmac = {}};
+    // Declared last so that the thread is stopped before the members it uses are destroyed.
+    InputThread mTracerThread;
+
+    template <typename Fill>
+    void push(Fill&& fill);
     void threadLoop();
 };
 
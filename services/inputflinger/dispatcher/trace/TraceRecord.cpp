@@ -0,0 +1,134 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TraceRecord.h"
+
+#include <algorithm>
+
+namespace android::inputdispatcher::trace::impl {
+
+namespace {
+
+// Helper to std::visit with lambdas.
+template <typename... V>
+struct Visitor : V... {
+    using V::operator()...;
+};
+
+// Input transforms are affine, like the ones sent to the apps, so the last row is not stored.
+std::array<float, 9> toMatrix(const ui::Transform& transform) {
+    return {transform.dsdx(), transform.dtdx(), transform.tx(),
+            transform.dtdy(), transform.dsdy(), transform.ty(),
+            0,                0,                1};
+}
+
+} // namespace
+
+void TraceRecord::setEvent(const TracedKeyEvent& event) {
+    isMotion = false;
+    key = event;
+}
+
+void TraceRecord::setEvent(const TracedMotionEvent& event) {
+    isMotion = true;
+    motion.id = event.id;
+    motion.eventTime = event.eventTime;
+    motion.policyFlags = event.policyFlags;
+    motion.deviceId = event.deviceId;
+    motion.source = event.source;
+    motion.displayId = event.displayId;
+    motion.action = event.action;
+    motion.actionButton = event.actionButton;
+    motion.flags = event.flags;
+    motion.metaState = event.metaState;
+    motion.buttonState = event.buttonState;
+    motion.classification = event.classification;
+    motion.edgeFlags = event.edgeFlags;
+    motion.xPrecision = event.xPrecision;
+    motion.yPrecision = event.yPrecision;
+    motion.xCursorPosition = event.xCursorPosition;
+    motion.yCursorPosition = event.yCursorPosition;
+    motion.downTime = event.downTime;
+    motion.pointerCount = std::min(event.pointerProperties.size(), MAX_POINTERS);
+    std::copy_n(event.pointerProperties.begin(), motion.pointerCount,
+                motion.pointerProperties.begin());
+    std::copy_n(event.pointerCoords.begin(), motion.pointerCount, motion.pointerCoords.begin());
+}
+
+void TraceRecord::setEvent(const TracedEvent& event) {
+    std::visit(Visitor{[&](const TracedMotionEvent& e) { setEvent(e); },
+                       [&](const TracedKeyEvent& e) { setEvent(e); }},
+               event);
+}
+
+void TraceRecord::setWindowDispatch(const WindowDispatchArgs& args) {
+    setEvent(args.eventEntry);
+    dispatch.deliveryTime = args.deliveryTime;
+    dispatch.resolvedFlags = args.resolvedFlags;
+    dispatch.targetUid = args.targetUid.val();
+    dispatch.vsyncId = args.vsyncId;
+    dispatch.windowId = args.windowId;
+    dispatch.transform = toMatrix(args.transform);
+    dispatch.rawTransform = toMatrix(args.rawTransform);
+    dispatch.hmac = args.hmac;
+}
+
+void TraceRecord::getMotionEvent(TracedMotionEvent& outEvent) const {
+    outEvent.id = motion.id;
+    outEvent.eventTime = motion.eventTime;
+    outEvent.policyFlags = motion.policyFlags;
+    outEvent.deviceId = motion.deviceId;
+    outEvent.source = motion.source;
+    outEvent.displayId = motion.displayId;
+    outEvent.action = motion.action;
+    outEvent.actionButton = motion.actionButton;
+    outEvent.flags = motion.flags;
+    outEvent.metaState = motion.metaState;
+    outEvent.buttonState = motion.buttonState;
+    outEvent.classification = motion.classification;
+    outEvent.edgeFlags = motion.edgeFlags;
+    outEvent.xPrecision = motion.xPrecision;
+    outEvent.yPrecision = motion.yPrecision;
+    outEvent.xCursorPosition = motion.xCursorPosition;
+    outEvent.yCursorPosition = motion.yCursorPosition;
+    outEvent.downTime = motion.downTime;
+    outEvent.pointerProperties.assign(motion.pointerProperties.begin(),
+                                      motion.pointerProperties.begin() + motion.pointerCount);
+    outEvent.pointerCoords.assign(motion.pointerCoords.begin(),
+                                  motion.pointerCoords.begin() + motion.pointerCount);
+}
+
+void TraceRecord::getWindowDispatch(WindowDispatchArgs& outArgs) const {
+    if (isMotion) {
+        // Convert into the existing motion event, if any, to reuse its pointer storage.
+        if (!std::holds_alternative<TracedMotionEvent>(outArgs.eventEntry)) {
+            outArgs.eventEntry = TracedMotionEvent{};
+        }
+        getMotionEvent(std::get<TracedMotionEvent>(outArgs.eventEntry));
+    } else {
+        outArgs.eventEntry = key;
+    }
+    outArgs.deliveryTime = dispatch.deliveryTime;
+    outArgs.resolvedFlags = dispatch.resolvedFlags;
+    outArgs.targetUid = gui::Uid{dispatch.targetUid};
+    outArgs.vsyncId = dispatch.vsyncId;
+    outArgs.windowId = dispatch.windowId;
+    outArgs.transform.set(dispatch.transform);
+    outArgs.rawTransform.set(dispatch.rawTransform);
+    outArgs.hmac = dispatch.hmac;
+}
+
+} // namespace android::inputdispatcher::trace::impl
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "InputTracingBackendInterface.h"
+
+#include <input/Input.h>
+#include <array>
+
+namespace android::inputdispatcher::trace::impl {
+
+/**
+ * A trivially copyable copy of a traced event, or of a window dispatch and its event, that holds
+ * the pointers inline, so that it can be stored in a TraceRing.
+ */
+struct TraceRecord {
+    using WindowDispatchArgs = InputTracingBackendInterface::WindowDispatchArgs;
+
+    enum class Type : uint8_t { KEY, MOTION, WINDOW_DISPATCH };
+
+    // The fields of TracedMotionEvent, other than the pointers.
+    struct MotionEvent {
+        int32_t id;
+        nsecs_t eventTime;
+        uint32_t policyFlags;
+        int32_t deviceId;
+        uint32_t source;
+        int32_t displayId;
+        int32_t action;
+        int32_t actionButton;
+        int32_t flags;
+        int32_t metaState;
+        int32_t buttonState;
+        MotionClassification classification;
+        int32_t edgeFlags;
+        float xPrecision;
+        float yPrecision;
+        float xCursorPosition;
+        float yCursorPosition;
+        nsecs_t downTime;
+        uint32_t pointerCount;
+        std::array<PointerProperties, MAX_POINTERS> pointerProperties;
+        std::array<PointerCoords, MAX_POINTERS> pointerCoords;
+    };
+
+    // The fields of WindowDispatchArgs, other than the event.
+    struct WindowDispatch {
+        nsecs_t deliveryTime;
+        int32_t resolvedFlags;
+        uid_t targetUid;
+        int64_t vsyncId;
+        int32_t windowId;
+        std::array<float, 9> transform;
+        std::array<float, 9> rawTransform;
+        std::array<uint8_t, 32> hmac;
+    };
+
+    Type type;
+    // Whether the event is a motion event, for a window dispatch.
+    bool isMotion;
+    TracedKeyEvent key;
+    MotionEvent motion;
+    WindowDispatch dispatch;
+
+    void setEvent(const TracedKeyEvent& event);
+    void setEvent(const TracedMotionEvent& event);
+    void setEvent(const TracedEvent& event);
+    void setWindowDispatch(const WindowDispatchArgs& args);
+
+    // The conversions back reuse the storage of the output, so that the tracing thread does not
+    // allocate for every event.
+    void getMotionEvent(TracedMotionEvent& outEvent) const;
+    void getWindowDispatch(WindowDispatchArgs& outArgs) const;
+};
+
+} // namespace android::inputdispatcher::trace::impl
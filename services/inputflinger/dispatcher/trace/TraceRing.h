@@ -0,0 +1,113 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace android::inputdispatcher::trace::impl {
+
+/**
+ * A bounded, lock-free queue of trivially copyable records, with any number of producers and a
+ * single consumer. All of the records are allocated when the ring is created, so pushing a record
+ * never allocates, and a producer never waits for the consumer: when the ring is full, the record
+ * is dropped.
+ *
+ * Each slot carries a sequence number that tells whether it is free for the producer of a given
+ * position, or holds the record for the consumer of that position.
+ */
+template <typename Record>
+class TraceRing {
+    static_assert(std::is_trivially_copyable_v<Record>);
+
+public:
+    explicit TraceRing(size_t capacity)
+          : mCapacity(capacity), mSlots(std::make_unique<Slot[]>(capacity)) {
+        for (size_t i = 0; i < mCapacity; i++) {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Claims a slot and lets the fill function write the record into it in place. Returns false,
+     * without calling the fill function, and counts the record as dropped when the ring is full.
+     */
+    template <typename Fill>
+    bool tryPush(Fill&& fill) {
+        size_t position = mEnqueuePosition.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &mSlots[position % mCapacity];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            if (sequence == position) {
+                if (mEnqueuePosition.compare_exchange_weak(position, position + 1,
+                                                           std::memory_order_relaxed)) {
+                    break;
+                }
+                // Another producer claimed the position, and position was updated to the current
+                // one.
+            } else if (sequence < position) {
+                // The consumer has not yet read the record that was written a lap ago.
+                mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                position = mEnqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        fill(slot->record);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Lets the consume function read the oldest record, in place, and frees its slot. Returns
+     * false when the ring is empty. Must only be called from the consumer thread.
+     */
+    template <typename Consume>
+    bool tryPop(Consume&& consume) {
+        Slot& slot = mSlots[mDequeuePosition % mCapacity];
+        if (slot.sequence.load(std::memory_order_acquire) != mDequeuePosition + 1) {
+            return false;
+        }
+        consume(static_cast<const Record&>(slot.record));
+        slot.sequence.store(mDequeuePosition + mCapacity, std::memory_order_release);
+        mDequeuePosition++;
+        return true;
+    }
+
+    /** Returns the number of records that were dropped because the ring was full. */
+    size_t getDroppedCount() const { return mDroppedCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+
+    // Keep the producer and consumer positions on separate cache lines.
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    const size_t mCapacity;
+    const std::unique_ptr<Slot[]> mSlots;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> mEnqueuePosition{0};
+    std::atomic<size_t> mDroppedCount{0};
+    alignas(CACHE_LINE_SIZE) size_t mDequeuePosition{0};
+};
+
+} // namespace android::inputdispatcher::trace::impl
@@ -39,6 +39,7 @@
 #include <android-base/file.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
+#include <com_android_input_flags.h>
 #include <cutils/properties.h>
 #include <ftl/enum.h>
 #include <input/KeyCharacterMap.h>
@@ -70,6 +71,8 @@ namespace android {
 
 using namespace ftl::flag_operators;
 
+namespace input_flags = com::android::input::flags;
+
 static const char* DEVICE_INPUT_PATH = "/dev/input";
 // v4l2 devices go directly into /dev
 static const char* DEVICE_PATH = "/dev";
@@ -81,6 +84,9 @@ static constexpr int32_t FF_WEAK_MAGNITUDE_CHANNEL_IDX = 1;
 
 static constexpr size_t EVENT_BUFFER_SIZE = 256;
 
+// Directory of the compiled key layout and key character map files.
+static const char* KEY_MAP_CACHE_PATH = "/data/system/input/keymaps";
+
 // Mapping for input battery class node IDs lookup.
 // https://www.kernel.org/doc/Documentation/power/power_supply_class.txt
 static const std::unordered_map<std::string, InputBatteryClass> BATTERY_CLASSES =
@@ -707,8 +713,8 @@ bool EventHub::Device::loadVirtualKeyMapLocked() {
     return virtualKeyMap != nullptr;
 }
 
-status_t EventHub::Device::loadKeyMapLocked() {
-    return keyMap.load(identifier, configuration.get());
+status_t EventHub::Device::loadKeyMapLocked(KeyMapCache* keyMapCache) {
+    return keyMap.load(identifier, configuration.get(), keyMapCache);
 }
 
 bool EventHub::Device::isExternalDeviceLocked() {
@@ -911,6 +917,15 @@ EventHub::EventHub(void)
         }
     }
 
+    if (input_flags::key_map_cache()) {
+        if (std::filesystem::create_directories(KEY_MAP_CACHE_PATH, errorCode) || !errorCode) {
+            mKeyMapCache = std::make_unique<KeyMapCache>(KEY_MAP_CACHE_PATH);
+        } else {
+            ALOGW("Could not create key map cache directory %s: %s", KEY_MAP_CACHE_PATH,
+                  errorCode.message().c_str());
+        }
+    }
+
     if (isV4lScanningEnabled() && !isDeviceInotifyAdded) {
         addDeviceInotify();
     } else {
@@ -2464,7 +2479,7 @@ void EventHub::openDeviceLocked(const std::string& devicePath) {
     if (device->classes.any(InputDeviceClass::KEYBOARD | InputDeviceClass::JOYSTICK |
                             InputDeviceClass::SENSOR)) {
         // Load the keymap for the device.
-        keyMapStatus = device->loadKeyMapLocked();
+        keyMapStatus = device->loadKeyMapLocked(mKeyMapCache.get());
     }
 
     // Configure the keyboard, gamepad or virtual keyboard.
@@ -2677,7 +2692,7 @@ void EventHub::createVirtualKeyboardLocked() {
                                      identifier, /*associatedDevice=*/nullptr);
     device->classes = InputDeviceClass::KEYBOARD | InputDeviceClass::ALPHAKEY |
             InputDeviceClass::DPAD | InputDeviceClass::VIRTUAL;
-    device->loadKeyMapLocked();
+    device->loadKeyMapLocked(mKeyMapCache.get());
     addDeviceLocked(std::move(device));
 }
 
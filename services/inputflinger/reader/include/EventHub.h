@@ -33,6 +33,7 @@
 #include <input/InputDevice.h>
 #include <input/KeyCharacterMap.h>
 #include <input/KeyLayoutMap.h>
+#include <input/KeyMapCache.h>
 #include <input/Keyboard.h>
 #include <input/PropertyMap.h>
 #include <input/VirtualKeyMap.h>
@@ -684,7 +685,7 @@ private:
         bool hasKeycodeLocked(int keycode) const;
         void loadConfigurationLocked();
         bool loadVirtualKeyMapLocked();
-        status_t loadKeyMapLocked();
+        status_t loadKeyMapLocked(KeyMapCache* keyMapCache);
         bool isExternalDeviceLocked();
         bool deviceHasMicLocked();
         void setLedForControllerLocked();
@@ -793,6 +794,9 @@ private:
     bool mNeedToScanDevices;
     std::vector<std::string> mExcludedDevices;
 
+    // Compiled key maps shared by all devices, or null if the cache is disabled.
+    std::unique_ptr<KeyMapCache> mKeyMapCache;
+
     int mEpollFd;
     int mINotifyFd;
     int mWakeReadPipeFd;
@@ -342,6 +342,8 @@ std::list<NotifyArgs> TouchInputMapper::reconfigure(nsecs_t when,
         configureInputDevice(when, &resetNeeded);
     }
 
+    compileCookingKernel();
+
     if (changes.any() && resetNeeded) {
         out += reset(when);
 
@@ -2283,6 +2285,216 @@ const BitSet32& TouchInputMapper::findActiveIdBits(const CookedPointerData& cook
     return cookedPointerData.hoveringIdBits;
 }
 
+void TouchInputMapper::compileCookingKernel() {
+    CookingKernel& kernel = mCookingKernel;
+    using Size = Calibration::SizeCalibration;
+    using Pointer = RawPointerData::Pointer;
+
+    if (mCalibration.sizeCalibration != Size::NONE) {
+        // resolveCalibration only keeps a size calibration when a touch or tool axis is valid.
+        const bool haveTouch = mRawPointerAxes.touchMajor.valid;
+        const bool haveTool = mRawPointerAxes.toolMajor.valid;
+        if (haveTouch) {
+            kernel.touchMajorAxis = &Pointer::touchMajor;
+            kernel.touchMinorAxis =
+                    mRawPointerAxes.touchMinor.valid ? &Pointer::touchMinor : &Pointer::touchMajor;
+        }
+        if (haveTool) {
+            kernel.toolMajorAxis = &Pointer::toolMajor;
+            kernel.toolMinorAxis =
+                    mRawPointerAxes.toolMinor.valid ? &Pointer::toolMinor : &Pointer::toolMajor;
+        }
+        if (!haveTool) {
+            kernel.toolMajorAxis = kernel.touchMajorAxis;
+            kernel.toolMinorAxis = kernel.touchMinorAxis;
+        } else if (!haveTouch) {
+            kernel.touchMajorAxis = kernel.toolMajorAxis;
+            kernel.touchMinorAxis = kernel.toolMinorAxis;
+        }
+    }
+    kernel.sizeIsSummed = mCalibration.sizeIsSummed && *mCalibration.sizeIsSummed;
+    kernel.geometricScale = mGeometricScale;
+    kernel.sizeCalibrationScale = mCalibration.sizeScale.value_or(1);
+    kernel.sizeCalibrationBias = mCalibration.sizeBias.value_or(0);
+    kernel.sizeScale = mSizeScale;
+
+    kernel.pressureFromAxis =
+            mCalibration.pressureCalibration == Calibration::PressureCalibration::PHYSICAL ||
+            mCalibration.pressureCalibration == Calibration::PressureCalibration::AMPLITUDE;
+    kernel.pressureScale = mPressureScale;
+
+    kernel.orientationCalibration = mCalibration.orientationCalibration;
+    kernel.orientationScale = mOrientationScale;
+    kernel.tiltXCenter = mTiltXCenter;
+    kernel.tiltXScale = mTiltXScale;
+    kernel.tiltYCenter = mTiltYCenter;
+    kernel.tiltYScale = mTiltYScale;
+    kernel.rawRotation = mRawRotation;
+
+    kernel.distanceScale =
+            mCalibration.distanceCalibration == Calibration::DistanceCalibration::SCALED
+            ? mDistanceScale
+            : 0;
+
+    kernel.affineTransform = {mAffineTransform.x_scale, mAffineTransform.x_ymix,
+                              mAffineTransform.x_offset, mAffineTransform.y_xmix,
+                              mAffineTransform.y_scale, mAffineTransform.y_offset};
+    kernel.rawToDisplay = {mRawToDisplay.dsdx(), mRawToDisplay.dtdx(), mRawToDisplay.tx(),
+                           mRawToDisplay.dtdy(), mRawToDisplay.dsdy(), mRawToDisplay.ty()};
+
+    // The size calibration is never DEFAULT after resolveCalibration.
+    static constexpr std::array<std::array<CookingKernel::CookFunction, 2>,
+                                ftl::to_underlying(Size::ftl_last) + 1>
+            COOK_FUNCTIONS = {{
+                    {&cookPointers<Size::NONE, false>, &cookPointers<Size::NONE, true>},
+                    {&cookPointers<Size::NONE, false>, &cookPointers<Size::NONE, true>},
+                    {&cookPointers<Size::GEOMETRIC, false>, &cookPointers<Size::GEOMETRIC, true>},
+                    {&cookPointers<Size::DIAMETER, false>, &cookPointers<Size::DIAMETER, true>},
+                    {&cookPointers<Size::BOX, false>, &cookPointers<Size::BOX, true>},
+                    {&cookPointers<Size::AREA, false>, &cookPointers<Size::AREA, true>},
+            }};
+    LOG_ALWAYS_FATAL_IF(mCalibration.sizeCalibration == Size::DEFAULT,
+                        "Resolution should not be 'DEFAULT' at this point");
+    kernel.cook = COOK_FUNCTIONS[ftl::to_underlying(mCalibration.sizeCalibration)][mHaveTilt];
+}
+
+template <TouchInputMapper::Calibration::SizeCalibration sizeCalibration, bool haveTilt>
+void TouchInputMapper::cookPointers(const CookingKernel& kernel, const RawPointerData& in,
+                                    CookedPointerData& out) {
+    using Size = Calibration::SizeCalibration;
+    const uint32_t count = in.pointerCount;
+
+    // Each step below is a loop over all of the pointers, which keeps the arithmetic of the
+    // common steps free of branches so that it can be vectorized. The arithmetic is the same as
+    // that of the per-pointer implementation this replaced, so that the output does not change.
+
+    // Location: the affine calibration, then the conversion to the natural display coordinates.
+    std::array<float, MAX_POINTERS> x;
+    std::array<float, MAX_POINTERS> y;
+    {
+        const auto& [xScale, xYMix, xOffset, yXMix, yScale, yOffset] = kernel.affineTransform;
+        const auto& [m00, m10, m20, m01, m11, m21] = kernel.rawToDisplay;
+        for (uint32_t i = 0; i < count; i++) {
+            const float rawX = in.pointers[i].x;
+            const float rawY = in.pointers[i].y;
+            const float calibratedX = rawX * xScale + rawY * xYMix + xOffset;
+            const float calibratedY = rawX * yXMix + rawY * yScale + yOffset;
+            x[i] = m00 * calibratedX + m10 * calibratedY + m20;
+            y[i] = m01 * calibratedX + m11 * calibratedY + m21;
+        }
+    }
+
+    // Size
+    std::array<float, MAX_POINTERS> touchMajor{};
+    std::array<float, MAX_POINTERS> touchMinor{};
+    std::array<float, MAX_POINTERS> toolMajor{};
+    std::array<float, MAX_POINTERS> toolMinor{};
+    std::array<float, MAX_POINTERS> size{};
+    if constexpr (sizeCalibration != Size::NONE) {
+        const uint32_t touchingCount = in.touchingIdBits.count();
+        // Dividing by one leaves the sizes unchanged.
+        const float divisor = kernel.sizeIsSummed && touchingCount > 1 ? touchingCount : 1;
+        const auto applySizeScaleAndBias = [&kernel](float value) {
+            value *= kernel.sizeCalibrationScale;
+            value += kernel.sizeCalibrationBias;
+            return value < 0 ? 0 : value;
+        };
+        for (uint32_t i = 0; i < count; i++) {
+            const RawPointerData::Pointer& pointer = in.pointers[i];
+            float inTouchMajor = pointer.*kernel.touchMajorAxis;
+            float inTouchMinor = pointer.*kernel.touchMinorAxis;
+            float inToolMajor = pointer.*kernel.toolMajorAxis;
+            float inToolMinor = pointer.*kernel.toolMinorAxis;
+            // The average of an axis with itself is the axis, so this covers a missing minor axis.
+            float inSize = avg(inTouchMajor, inTouchMinor);
+
+            inTouchMajor /= divisor;
+            inTouchMinor /= divisor;
+            inToolMajor /= divisor;
+            inToolMinor /= divisor;
+            inSize /= divisor;
+
+            if constexpr (sizeCalibration == Size::GEOMETRIC) {
+                inTouchMajor *= kernel.geometricScale;
+                inTouchMinor *= kernel.geometricScale;
+                inToolMajor *= kernel.geometricScale;
+                inToolMinor *= kernel.geometricScale;
+            } else if constexpr (sizeCalibration == Size::AREA) {
+                inTouchMajor = inTouchMajor > 0 ? sqrtf(inTouchMajor) : 0;
+                inTouchMinor = inTouchMajor;
+                inToolMajor = inToolMajor > 0 ? sqrtf(inToolMajor) : 0;
+                inToolMinor = inToolMajor;
+            } else if constexpr (sizeCalibration == Size::DIAMETER) {
+                inTouchMinor = inTouchMajor;
+                inToolMinor = inToolMajor;
+            }
+
+            touchMajor[i] = applySizeScaleAndBias(inTouchMajor);
+            touchMinor[i] = applySizeScaleAndBias(inTouchMinor);
+            toolMajor[i] = applySizeScaleAndBias(inToolMajor);
+            toolMinor[i] = applySizeScaleAndBias(inToolMinor);
+            size[i] = inSize * kernel.sizeScale;
+        }
+    }
+
+    // Pressure and distance
+    std::array<float, MAX_POINTERS> pressure;
+    std::array<float, MAX_POINTERS> distance;
+    for (uint32_t i = 0; i < count; i++) {
+        const RawPointerData::Pointer& pointer = in.pointers[i];
+        pressure[i] = kernel.pressureFromAxis ? pointer.pressure * kernel.pressureScale
+                                              : (pointer.isHovering ? 0 : 1);
+        distance[i] = pointer.distance * kernel.distanceScale;
+    }
+
+    // Tilt and orientation. These need trigonometry, so there is little to gain from batching.
+    std::array<float, MAX_POINTERS> tilt{};
+    std::array<float, MAX_POINTERS> orientation{};
+    for (uint32_t i = 0; i < count; i++) {
+        const RawPointerData::Pointer& pointer = in.pointers[i];
+        if constexpr (haveTilt) {
+            float tiltXAngle = (pointer.tiltX - kernel.tiltXCenter) * kernel.tiltXScale;
+            float tiltYAngle = (pointer.tiltY - kernel.tiltYCenter) * kernel.tiltYScale;
+            orientation[i] = transformAngle(kernel.rawRotation,
+                                            atan2f(-sinf(tiltXAngle), sinf(tiltYAngle)));
+            tilt[i] = acosf(cosf(tiltXAngle) * cosf(tiltYAngle));
+        } else if (kernel.orientationCalibration ==
+                   Calibration::OrientationCalibration::INTERPOLATED) {
+            orientation[i] = transformAngle(kernel.rawRotation,
+                                            pointer.orientation * kernel.orientationScale);
+        } else if (kernel.orientationCalibration == Calibration::OrientationCalibration::VECTOR) {
+            int32_t c1 = signExtendNybble((pointer.orientation & 0xf0) >> 4);
+            int32_t c2 = signExtendNybble(pointer.orientation & 0x0f);
+            if (c1 != 0 || c2 != 0) {
+                orientation[i] = transformAngle(kernel.rawRotation, atan2f(c1, c2) * 0.5f);
+                float confidence = hypotf(c1, c2);
+                float scale = 1.0f + confidence / 16.0f;
+                touchMajor[i] *= scale;
+                touchMinor[i] /= scale;
+                toolMajor[i] *= scale;
+                toolMinor[i] /= scale;
+            }
+        }
+    }
+
+    // Write output coords.
+    for (uint32_t i = 0; i < count; i++) {
+        PointerCoords& coords = out.pointerCoords[i];
+        coords.clear();
+        coords.setAxisValue(AMOTION_EVENT_AXIS_X, x[i]);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_Y, y[i]);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, pressure[i]);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_SIZE, size[i]);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, touchMajor[i]);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, touchMinor[i]);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, orientation[i]);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_TILT, tilt[i]);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_DISTANCE, distance[i]);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, toolMajor[i]);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MINOR, toolMinor[i]);
+    }
+}
+
 void TouchInputMapper::cookPointerData() {
     uint32_t currentPointerCount = mCurrentRawState.rawPointerData.pointerCount;
 
@@ -2301,177 +2513,22 @@ void TouchInputMapper::cookPointerData() {
         mCurrentCookedState.buttonState = mCurrentRawState.buttonState;
     }
 
-    // Walk through the the active pointers and map device coordinates onto
-    // display coordinates and adjust for display orientation.
+    // Map device coordinates onto display coordinates and calibrate the other axes of all of the
+    // active pointers.
+    mCookingKernel.cook(mCookingKernel, mCurrentRawState.rawPointerData,
+                        mCurrentCookedState.cookedPointerData);
+
     for (uint32_t i = 0; i < currentPointerCount; i++) {
         const RawPointerData::Pointer& in = mCurrentRawState.rawPointerData.pointers[i];
-
-        // Size
-        float touchMajor, touchMinor, toolMajor, toolMinor, size;
-        switch (mCalibration.sizeCalibration) {
-            case Calibration::SizeCalibration::GEOMETRIC:
-            case Calibration::SizeCalibration::DIAMETER:
-            case Calibration::SizeCalibration::BOX:
-            case Calibration::SizeCalibration::AREA:
-                if (mRawPointerAxes.touchMajor.valid && mRawPointerAxes.toolMajor.valid) {
-                    touchMajor = in.touchMajor;
-                    touchMinor = mRawPointerAxes.touchMinor.valid ? in.touchMinor : in.touchMajor;
-                    toolMajor = in.toolMajor;
-                    toolMinor = mRawPointerAxes.toolMinor.valid ? in.toolMinor : in.toolMajor;
-                    size = mRawPointerAxes.touchMinor.valid ? avg(in.touchMajor, in.touchMinor)
-                                                            : in.touchMajor;
-                } else if (mRawPointerAxes.touchMajor.valid) {
-                    toolMajor = touchMajor = in.touchMajor;
-                    toolMinor = touchMinor =
-                            mRawPointerAxes.touchMinor.valid ? in.touchMinor : in.touchMajor;
-                    size = mRawPointerAxes.touchMinor.valid ? avg(in.touchMajor, in.touchMinor)
-                                                            : in.touchMajor;
-                } else if (mRawPointerAxes.toolMajor.valid) {
-                    touchMajor = toolMajor = in.toolMajor;
-                    touchMinor = toolMinor =
-                            mRawPointerAxes.toolMinor.valid ? in.toolMinor : in.toolMajor;
-                    size = mRawPointerAxes.toolMinor.valid ? avg(in.toolMajor, in.toolMinor)
-                                                           : in.toolMajor;
-                } else {
-                    ALOG_ASSERT(false,
-                                "No touch or tool axes.  "
-                                "Size calibration should have been resolved to NONE.");
-                    touchMajor = 0;
-                    touchMinor = 0;
-                    toolMajor = 0;
-                    toolMinor = 0;
-                    size = 0;
-                }
-
-                if (mCalibration.sizeIsSummed && *mCalibration.sizeIsSummed) {
-                    uint32_t touchingCount = mCurrentRawState.rawPointerData.touchingIdBits.count();
-                    if (touchingCount > 1) {
-                        touchMajor /= touchingCount;
-                        touchMinor /= touchingCount;
-                        toolMajor /= touchingCount;
-                        toolMinor /= touchingCount;
-                        size /= touchingCount;
-                    }
-                }
-
-                if (mCalibration.sizeCalibration == Calibration::SizeCalibration::GEOMETRIC) {
-                    touchMajor *= mGeometricScale;
-                    touchMinor *= mGeometricScale;
-                    toolMajor *= mGeometricScale;
-                    toolMinor *= mGeometricScale;
-                } else if (mCalibration.sizeCalibration == Calibration::SizeCalibration::AREA) {
-                    touchMajor = touchMajor > 0 ? sqrtf(touchMajor) : 0;
-                    touchMinor = touchMajor;
-                    toolMajor = toolMajor > 0 ? sqrtf(toolMajor) : 0;
-                    toolMinor = toolMajor;
-                } else if (mCalibration.sizeCalibration == Calibration::SizeCalibration::DIAMETER) {
-                    touchMinor = touchMajor;
-                    toolMinor = toolMajor;
-                }
-
-                mCalibration.applySizeScaleAndBias(touchMajor);
-                mCalibration.applySizeScaleAndBias(touchMinor);
-                mCalibration.applySizeScaleAndBias(toolMajor);
-                mCalibration.applySizeScaleAndBias(toolMinor);
-                size *= mSizeScale;
-                break;
-            case Calibration::SizeCalibration::DEFAULT:
-                LOG_ALWAYS_FATAL("Resolution should not be 'DEFAULT' at this point");
-                break;
-            case Calibration::SizeCalibration::NONE:
-                touchMajor = 0;
-                touchMinor = 0;
-                toolMajor = 0;
-                toolMinor = 0;
-                size = 0;
-                break;
-        }
-
-        // Pressure
-        float pressure;
-        switch (mCalibration.pressureCalibration) {
-            case Calibration::PressureCalibration::PHYSICAL:
-            case Calibration::PressureCalibration::AMPLITUDE:
-                pressure = in.pressure * mPressureScale;
-                break;
-            default:
-                pressure = in.isHovering ? 0 : 1;
-                break;
-        }
-
-        // Tilt and Orientation
-        float tilt;
-        float orientation;
-        if (mHaveTilt) {
-            float tiltXAngle = (in.tiltX - mTiltXCenter) * mTiltXScale;
-            float tiltYAngle = (in.tiltY - mTiltYCenter) * mTiltYScale;
-            orientation = transformAngle(mRawRotation, atan2f(-sinf(tiltXAngle), sinf(tiltYAngle)));
-            tilt = acosf(cosf(tiltXAngle) * cosf(tiltYAngle));
-        } else {
-            tilt = 0;
-
-            switch (mCalibration.orientationCalibration) {
-                case Calibration::OrientationCalibration::INTERPOLATED:
-                    orientation = transformAngle(mRawRotation, in.orientation * mOrientationScale);
-                    break;
-                case Calibration::OrientationCalibration::VECTOR: {
-                    int32_t c1 = signExtendNybble((in.orientation & 0xf0) >> 4);
-                    int32_t c2 = signExtendNybble(in.orientation & 0x0f);
-                    if (c1 != 0 || c2 != 0) {
-                        orientation = transformAngle(mRawRotation, atan2f(c1, c2) * 0.5f);
-                        float confidence = hypotf(c1, c2);
-                        float scale = 1.0f + confidence / 16.0f;
-                        touchMajor *= scale;
-                        touchMinor /= scale;
-                        toolMajor *= scale;
-                        toolMinor /= scale;
-                    } else {
-                        orientation = 0;
-                    }
-                    break;
-                }
-                default:
-                    orientation = 0;
-            }
-        }
-
-        // Distance
-        float distance;
-        switch (mCalibration.distanceCalibration) {
-            case Calibration::DistanceCalibration::SCALED:
-                distance = in.distance * mDistanceScale;
-                break;
-            default:
-                distance = 0;
-        }
-
-        // Adjust X,Y coords for device calibration and convert to the natural display coordinates.
-        vec2 transformed = {in.x, in.y};
-        mAffineTransform.applyTo(transformed.x /*byRef*/, transformed.y /*byRef*/);
-        transformed = mRawToDisplay.transform(transformed);
-
-        // Write output coords.
         PointerCoords& out = mCurrentCookedState.cookedPointerData.pointerCoords[i];
-        out.clear();
-        out.setAxisValue(AMOTION_EVENT_AXIS_X, transformed.x);
-        out.setAxisValue(AMOTION_EVENT_AXIS_Y, transformed.y);
-        out.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, pressure);
-        out.setAxisValue(AMOTION_EVENT_AXIS_SIZE, size);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, touchMajor);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, touchMinor);
-        out.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, orientation);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TILT, tilt);
-        out.setAxisValue(AMOTION_EVENT_AXIS_DISTANCE, distance);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, toolMajor);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MINOR, toolMinor);
 
         // Write output relative fields if applicable.
         uint32_t id = in.id;
         if (mSource == AINPUT_SOURCE_TOUCHPAD &&
             mLastCookedState.cookedPointerData.hasPointerCoordsForId(id)) {
             const PointerCoords& p = mLastCookedState.cookedPointerData.pointerCoordsForId(id);
-            float dx = transformed.x - p.getAxisValue(AMOTION_EVENT_AXIS_X);
-            float dy = transformed.y - p.getAxisValue(AMOTION_EVENT_AXIS_Y);
+            float dx = out.getX() - p.getAxisValue(AMOTION_EVENT_AXIS_X);
+            float dy = out.getY() - p.getAxisValue(AMOTION_EVENT_AXIS_Y);
             out.setAxisValue(AMOTION_EVENT_AXIS_RELATIVE_X, dx);
             out.setAxisValue(AMOTION_EVENT_AXIS_RELATIVE_Y, dy);
         }
@@ -429,21 +429,65 @@ private:
     // The transform used for non-planar raw axes, such as orientation and tilt.
     ui::Transform mRawRotation;
 
-    float mGeometricScale;
-
-    float mPressureScale;
-
-    float mSizeScale;
-
-    float mOrientationScale;
-
-    float mDistanceScale;
-
-    bool mHaveTilt;
-    float mTiltXCenter;
-    float mTiltXScale;
-    float mTiltYCenter;
-    float mTiltYScale;
+    float mGeometricScale{0};
+
+    float mPressureScale{0};
+
+    float mSizeScale{0};
+
+    float mOrientationScale{0};
+
+    float mDistanceScale{0};
+
+    bool mHaveTilt{false};
+    float mTiltXCenter{0};
+    float mTiltXScale{0};
+    float mTiltYCenter{0};
+    float mTiltYScale{0};
+
+    // The per-pointer part of cookPointerData, compiled from the calibration, the scales and the
+    // transforms above whenever the mapper is reconfigured. The size calibration and the presence
+    // of tilt select the cook function, so the calibration is not branched on for every sample,
+    // and each step runs over all of the pointers of a sync at once.
+    struct CookingKernel {
+        using CookFunction = void (*)(const CookingKernel& kernel, const RawPointerData& in,
+                                      CookedPointerData& out);
+        CookFunction cook{nullptr};
+
+        // The raw axes that the sizes are read from. A minor axis refers to its major axis when
+        // the device does not report it, and the touch and tool axes refer to each other when the
+        // device only reports one of them.
+        int32_t RawPointerData::Pointer::*touchMajorAxis{&RawPointerData::Pointer::touchMajor};
+        int32_t RawPointerData::Pointer::*touchMinorAxis{&RawPointerData::Pointer::touchMajor};
+        int32_t RawPointerData::Pointer::*toolMajorAxis{&RawPointerData::Pointer::toolMajor};
+        int32_t RawPointerData::Pointer::*toolMinorAxis{&RawPointerData::Pointer::toolMajor};
+        bool sizeIsSummed{false};
+        float geometricScale{0};
+        // The scale and bias of the size calibration, or the identity when they are not set.
+        float sizeCalibrationScale{1};
+        float sizeCalibrationBias{0};
+        float sizeScale{0};
+
+        bool pressureFromAxis{false};
+        float pressureScale{0};
+
+        Calibration::OrientationCalibration orientationCalibration{
+                Calibration::OrientationCalibration::NONE};
+        float orientationScale{0};
+        float tiltXCenter{0};
+        float tiltXScale{0};
+        float tiltYCenter{0};
+        float tiltYScale{0};
+        ui::Transform rawRotation;
+
+        // Zero when the distance is not calibrated.
+        float distanceScale{0};
+
+        // The affine location calibration and the raw to display transform, as the rows of 2x3
+        // matrices.
+        std::array<float, 6> affineTransform{};
+        std::array<float, 6> rawToDisplay{};
+    } mCookingKernel;
 
     bool mExternalStylusConnected;
 
@@ -750,6 +794,10 @@ private:
                                                                      BitSet32 idBits,
                                                                      nsecs_t readTime);
     const BitSet32& findActiveIdBits(const CookedPointerData& cookedPointerData);
+    void compileCookingKernel();
+    template <Calibration::SizeCalibration sizeCalibration, bool haveTilt>
+    static void cookPointers(const CookingKernel& kernel, const RawPointerData& in,
+                             CookedPointerData& out);
     void cookPointerData();
     [[nodiscard]] std::list<NotifyArgs> abortTouches(nsecs_t when, nsecs_t readTime,
                                                      uint32_t policyFlags);
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/Entry.h"
+#include "../dispatcher/EntryPool.h"
+
+#include <gtest/gtest.h>
+
+namespace android::inputdispatcher {
+
+// --- EntryPoolTest ---
+
+TEST(EntryPoolTest, ReleasedBlocks_AreReused) {
+    EntryPool pool(/*blockSize=*/64, /*maxFreeBlocks=*/2);
+
+    void* first = pool.allocate(64);
+    void* second = pool.allocate(64);
+    ASSERT_EQ(2u, pool.getStats().heapAllocations);
+
+    pool.deallocate(first, 64);
+    pool.deallocate(second, 64);
+    ASSERT_EQ(2u, pool.getStats().freeBlocks);
+
+    void* reused = pool.allocate(64);
+    ASSERT_TRUE(reused == first || reused == second);
+    ASSERT_EQ(1u, pool.getStats().pooledAllocations);
+    ASSERT_EQ(2u, pool.getStats().heapAllocations);
+
+    pool.deallocate(reused, 64);
+}
+
+TEST(EntryPoolTest, FreeList_IsBounded) {
+    EntryPool pool(/*blockSize=*/64, /*maxFreeBlocks=*/1);
+
+    void* first = pool.allocate(64);
+    void* second = pool.allocate(64);
+    pool.deallocate(first, 64);
+    pool.deallocate(second, 64);
+
+    ASSERT_EQ(1u, pool.getStats().freeBlocks);
+}
+
+TEST(EntryPoolTest, OtherSizes_BypassThePool) {
+    EntryPool pool(/*blockSize=*/64, /*maxFreeBlocks=*/2);
+
+    void* block = pool.allocate(128);
+    pool.deallocate(block, 128);
+
+    const EntryPool::Stats stats = pool.getStats();
+    ASSERT_EQ(0u, stats.heapAllocations);
+    ASSERT_EQ(0u, stats.pooledAllocations);
+    ASSERT_EQ(0u, stats.freeBlocks);
+}
+
+TEST(EntryPoolTest, MotionEntries_AreRecycled) {
+    PointerProperties properties;
+    properties.clear();
+    PointerCoords coords;
+    coords.clear();
+    const auto createEntry = [&]() {
+        return std::make_unique<
+                MotionEntry>(/*id=*/1, /*injectionState=*/nullptr, /*eventTime=*/0,
+                             /*deviceId=*/1, AINPUT_SOURCE_TOUCHSCREEN, /*displayId=*/0,
+                             /*policyFlags=*/0, AMOTION_EVENT_ACTION_DOWN, /*actionButton=*/0,
+                             /*flags=*/0, AMETA_NONE, /*buttonState=*/0,
+                             MotionClassification::NONE, AMOTION_EVENT_EDGE_FLAG_NONE,
+                             /*xPrecision=*/0, /*yPrecision=*/0,
+                             AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                             AMOTION_EVENT_INVALID_CURSOR_POSITION, /*downTime=*/0,
+                             std::vector{properties}, std::vector{coords});
+    };
+
+    // Release an entry through a base class pointer, as the dispatcher queues do
+    std::unique_ptr<EventEntry> entry = createEntry();
+    entry.reset();
+
+    const size_t pooledAllocations = getEntryPoolStats().motionEntries.pooledAllocations;
+    std::unique_ptr<MotionEntry> recycledEntry = createEntry();
+    ASSERT_EQ(pooledAllocations + 1, getEntryPoolStats().motionEntries.pooledAllocations);
+    ASSERT_EQ(1u, recycledEntry->getPointerCount());
+}
+
+} // namespace android::inputdispatcher
@@ -177,6 +177,10 @@ void FakeEventHub::setMscEvent(int32_t deviceId, int32_t mscEvent) {
     getDevice(deviceId)->mscBitmask.loadFromBuffer(buffer);
 }
 
+void FakeEventHub::addInputProperty(int32_t deviceId, int property) {
+    getDevice(deviceId)->propertyBitmask.set(property, true);
+}
+
 void FakeEventHub::addRawLightInfo(int32_t rawId, RawLightInfo&& info) {
     mRawLightInfos.emplace(rawId, std::move(info));
 }
@@ -285,8 +289,9 @@ bool FakeEventHub::hasRelativeAxis(int32_t deviceId, int axis) const {
     return false;
 }
 
-bool FakeEventHub::hasInputProperty(int32_t, int) const {
-    return false;
+bool FakeEventHub::hasInputProperty(int32_t deviceId, int property) const {
+    Device* device = getDevice(deviceId);
+    return device != nullptr && device->propertyBitmask.test(property);
 }
 
 bool FakeEventHub::hasMscEvent(int32_t deviceId, int mscEvent) const {
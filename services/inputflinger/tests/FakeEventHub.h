@@ -61,6 +61,7 @@ class FakeEventHub : public EventHubInterface {
         std::unordered_map<int32_t, int32_t> keyCodeMapping;
         std::unordered_map<int32_t, SensorInfo> sensorsByAbsCode;
         BitArray<MSC_MAX> mscBitmask;
+        BitArray<INPUT_PROP_CNT> propertyBitmask;
         std::vector<VirtualKeyDefinition> virtualKeys;
         bool enabled;
         std::optional<RawLayoutInfo> layoutInfo;
@@ -139,6 +140,8 @@ public:
 
     void setMscEvent(int32_t deviceId, int32_t mscEvent);
 
+    void addInputProperty(int32_t deviceId, int property);
+
     void addLed(int32_t deviceId, int32_t led, bool initialState);
     void addRawLightInfo(int32_t rawId, RawLightInfo&& info);
     void fakeLightBrightness(int32_t rawId, int32_t brightness);
@@ -5621,6 +5621,49 @@ TEST_P(TransferTouchFixture, TransferTouch_TwoPointersNonSplitTouch) {
     secondWindow->consumeMotionUp(ADISPLAY_ID_DEFAULT, AMOTION_EVENT_FLAG_NO_FOCUS_CHANGE);
 }
 
+TEST_F(InputDispatcherTest, TransferTouch_PublishesSynthesizedEventsInOneWrite) {
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+
+    PointF touchPoint = {10, 10};
+
+    sp<FakeWindowHandle> firstWindow =
+            sp<FakeWindowHandle>::make(application, mDispatcher, "First Window",
+                                       ADISPLAY_ID_DEFAULT);
+    firstWindow->setPreventSplitting(true);
+    sp<FakeWindowHandle> secondWindow =
+            sp<FakeWindowHandle>::make(application, mDispatcher, "Second Window",
+                                       ADISPLAY_ID_DEFAULT);
+    secondWindow->setPreventSplitting(true);
+
+    mDispatcher->onWindowInfosChanged(
+            {{*firstWindow->getInfo(), *secondWindow->getInfo()}, {}, 0, 0});
+
+    mDispatcher->notifyMotion(generateMotionArgs(AMOTION_EVENT_ACTION_DOWN,
+                                                 AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT,
+                                                 {touchPoint}));
+    firstWindow->consumeMotionDown();
+    mDispatcher->notifyMotion(generateMotionArgs(POINTER_1_DOWN, AINPUT_SOURCE_TOUCHSCREEN,
+                                                 ADISPLAY_ID_DEFAULT, {touchPoint, touchPoint}));
+    firstWindow->consumeMotionPointerDown(1);
+    ASSERT_TRUE(mDispatcher->waitForIdle());
+    const InputDispatcher::PublishStats statsBefore = mDispatcher->getPublishStats();
+
+    // The transfer queues a cancel for the first window, and a down and a pointer down for the
+    // second window, all at once.
+    ASSERT_TRUE(
+            mDispatcher->transferTouchGesture(firstWindow->getToken(), secondWindow->getToken()));
+    firstWindow->consumeMotionCancel();
+    secondWindow->consumeMotionDown(ADISPLAY_ID_DEFAULT, AMOTION_EVENT_FLAG_NO_FOCUS_CHANGE);
+    secondWindow->consumeMotionPointerDown(1, ADISPLAY_ID_DEFAULT,
+                                           AMOTION_EVENT_FLAG_NO_FOCUS_CHANGE);
+    ASSERT_TRUE(mDispatcher->waitForIdle());
+    const InputDispatcher::PublishStats statsAfter = mDispatcher->getPublishStats();
+
+    // The two events for the second window reach its channel in a single write.
+    EXPECT_EQ(3u, statsAfter.eventCount - statsBefore.eventCount);
+    EXPECT_EQ(2u, statsAfter.writeCount - statsBefore.writeCount);
+}
+
 TEST_P(TransferTouchFixture, TransferTouch_MultipleWallpapers) {
     std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
 
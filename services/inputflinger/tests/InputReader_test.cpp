@@ -8030,6 +8030,48 @@ TEST_F(MultiTouchInputMapperTest, Process_TouchAndToolAxes_AreaCalibration) {
             x, y, 1.0f, size, touch, touch, tool, tool, 0, 0));
 }
 
+TEST_F(MultiTouchInputMapperTest, Process_ToolAxesOnly_VectorOrientationAndScaledDistance) {
+    addConfigurationProperty("touch.deviceType", "touchScreen");
+    prepareDisplay(ui::ROTATION_0);
+    prepareAxes(POSITION | TOOL | ORIENTATION | DISTANCE);
+    addConfigurationProperty("touch.size.calibration", "box");
+    addConfigurationProperty("touch.size.scale", "2");
+    addConfigurationProperty("touch.orientation.calibration", "vector");
+    addConfigurationProperty("touch.distance.calibration", "scaled");
+    addConfigurationProperty("touch.distance.scale", "0.5");
+    MultiTouchInputMapper& mapper = constructAndAddMapper<MultiTouchInputMapper>();
+
+    // These calculations are based on the input device calibration documentation. Without touch
+    // axes, the touch sizes are those of the tool.
+    int32_t rawX = 100;
+    int32_t rawY = 200;
+    int32_t rawToolMajor = 9;
+    // The orientation vector is encoded as two signed nybbles: (c1, c2) = (1, 2).
+    int32_t rawOrientation = 0x12;
+    int32_t rawDistance = 5;
+
+    float x = toDisplayX(rawX);
+    float y = toDisplayY(rawY);
+    float size = float(rawToolMajor) / RAW_TOOL_MAX;
+    float confidenceScale = 1.0f + hypotf(1, 2) / 16.0f;
+    float major = float(rawToolMajor) * 2.0f * confidenceScale;
+    float minor = float(rawToolMajor) * 2.0f / confidenceScale;
+    float orientation = atan2f(1, 2) * 0.5f;
+    float distance = float(rawDistance) * 0.5f;
+
+    processPosition(mapper, rawX, rawY);
+    processToolMajor(mapper, rawToolMajor);
+    processOrientation(mapper, rawOrientation);
+    processDistance(mapper, rawDistance);
+    processMTSync(mapper);
+    processSync(mapper);
+
+    NotifyMotionArgs args;
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&args));
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(args.pointerCoords[0],
+            x, y, 1.0f, size, major, minor, major, minor, orientation, distance));
+}
+
 TEST_F(MultiTouchInputMapperTest, Process_PressureAxis_AmplitudeCalibration) {
     addConfigurationProperty("touch.deviceType", "touchScreen");
     prepareDisplay(ui::ROTATION_0);
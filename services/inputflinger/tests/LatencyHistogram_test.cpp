@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/LatencyHistogram.h"
+
+#include <gtest/gtest.h>
+
+namespace android::inputdispatcher {
+
+// --- LatencyHistogramTest ---
+
+TEST(LatencyHistogramTest, EmptyHistogram_ReportsZero) {
+    LatencyHistogram histogram;
+    ASSERT_EQ(0u, histogram.getCount());
+    ASSERT_EQ(0, histogram.getPercentile(50));
+    ASSERT_EQ(0, histogram.getMax());
+}
+
+TEST(LatencyHistogramTest, Percentiles_AreBucketUpperBounds) {
+    LatencyHistogram histogram;
+    // 90 latencies of 100us, in the [64us, 128us) bucket
+    for (int i = 0; i < 90; i++) {
+        histogram.record(us2ns(100));
+    }
+    // 10 latencies of 3ms, in the [2048us, 4096us) bucket
+    for (int i = 0; i < 10; i++) {
+        histogram.record(ms2ns(3));
+    }
+
+    ASSERT_EQ(100u, histogram.getCount());
+    ASSERT_EQ(us2ns(128), histogram.getPercentile(50));
+    ASSERT_EQ(us2ns(128), histogram.getPercentile(90));
+    // Capped at the largest recorded latency, rather than the 4096us bucket bound
+    ASSERT_EQ(ms2ns(3), histogram.getPercentile(99));
+    ASSERT_EQ(ms2ns(3), histogram.getMax());
+}
+
+TEST(LatencyHistogramTest, OutOfRangeLatencies_AreClamped) {
+    LatencyHistogram histogram;
+    histogram.record(-1);
+    ASSERT_EQ(0, histogram.getPercentile(100));
+
+    const nsecs_t veryLongLatency = s2ns(3600);
+    histogram.record(veryLongLatency);
+    ASSERT_EQ(2u, histogram.getCount());
+    ASSERT_EQ(veryLongLatency, histogram.getPercentile(100));
+}
+
+} // namespace android::inputdispatcher
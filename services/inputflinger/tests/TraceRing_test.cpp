@@ -0,0 +1,242 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/trace/TraceRecord.h"
+#include "../dispatcher/trace/TraceRing.h"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace android::inputdispatcher::trace::impl {
+
+namespace {
+
+struct TestRecord {
+    int32_t producer;
+    int32_t value;
+};
+
+bool push(TraceRing<TestRecord>& ring, int32_t producer, int32_t value) {
+    return ring.tryPush([&](TestRecord& record) { record = {producer, value}; });
+}
+
+std::optional<TestRecord> pop(TraceRing<TestRecord>& ring) {
+    std::optional<TestRecord> result;
+    ring.tryPop([&](const TestRecord& record) { result = record; });
+    return result;
+}
+
+} // namespace
+
+// --- TraceRingTest ---
+
+TEST(TraceRingTest, PopsRecordsInOrder) {
+    TraceRing<TestRecord> ring(4);
+
+    ASSERT_TRUE(push(ring, 0, 1));
+    ASSERT_TRUE(push(ring, 0, 2));
+
+    ASSERT_EQ(1, pop(ring)->value);
+    ASSERT_EQ(2, pop(ring)->value);
+    ASSERT_EQ(std::nullopt, pop(ring));
+}
+
+TEST(TraceRingTest, WrapsAround) {
+    constexpr size_t capacity = 3;
+    TraceRing<TestRecord> ring(capacity);
+
+    // Go around the ring several times, with the ring partly full, so that the positions of the
+    // producer and the consumer both wrap around.
+    int32_t nextPushed = 0;
+    int32_t nextPopped = 0;
+    for (size_t lap = 0; lap < 5 * capacity; lap++) {
+        ASSERT_TRUE(push(ring, 0, nextPushed++));
+        ASSERT_TRUE(push(ring, 0, nextPushed++));
+        ASSERT_EQ(nextPopped++, pop(ring)->value);
+        ASSERT_EQ(nextPopped++, pop(ring)->value);
+    }
+    ASSERT_EQ(std::nullopt, pop(ring));
+    ASSERT_EQ(0u, ring.getDroppedCount());
+}
+
+TEST(TraceRingTest, DropsAndCountsRecordsWhenFull) {
+    constexpr size_t capacity = 3;
+    TraceRing<TestRecord> ring(capacity);
+
+    for (int32_t i = 0; i < static_cast<int32_t>(capacity); i++) {
+        ASSERT_TRUE(push(ring, 0, i));
+    }
+    bool filled = false;
+    ASSERT_FALSE(ring.tryPush([&](TestRecord&) { filled = true; }));
+    ASSERT_FALSE(push(ring, 0, 4));
+    ASSERT_FALSE(filled) << "A record must not be written when the ring is full";
+    ASSERT_EQ(2u, ring.getDroppedCount());
+
+    // The records that fit are kept, and popping one makes room for a new record.
+    ASSERT_EQ(0, pop(ring)->value);
+    ASSERT_TRUE(push(ring, 0, 5));
+    ASSERT_EQ(1, pop(ring)->value);
+    ASSERT_EQ(2, pop(ring)->value);
+    ASSERT_EQ(5, pop(ring)->value);
+    ASSERT_EQ(2u, ring.getDroppedCount());
+}
+
+TEST(TraceRingTest, ConcurrentPushesAreAllPoppedOrCounted) {
+    // Smaller than the number of pushes, so that some of them are dropped.
+    TraceRing<TestRecord> ring(64);
+
+    constexpr int32_t numProducers = 4;
+    constexpr int32_t numItems = 1000;
+    std::atomic<int32_t> finishedProducers = 0;
+    std::vector<std::thread> producers;
+    for (int32_t producer = 0; producer < numProducers; producer++) {
+        producers.emplace_back([&ring, &finishedProducers, producer]() {
+            for (int32_t i = 0; i < numItems; i++) {
+                push(ring, producer, i);
+            }
+            finishedProducers++;
+        });
+    }
+
+    // Each producer's records must be popped in the order it pushed them, and only once.
+    std::vector<int32_t> lastPopped(numProducers, -1);
+    size_t poppedCount = 0;
+    bool producersFinished = false;
+    while (!producersFinished) {
+        // Only stop once the ring is drained after all the producers finished.
+        producersFinished = finishedProducers.load() == numProducers;
+        while (std::optional<TestRecord> record = pop(ring)) {
+            EXPECT_GT(record->value, lastPopped[record->producer]);
+            lastPopped[record->producer] = record->value;
+            poppedCount++;
+        }
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    ASSERT_EQ(static_cast<size_t>(numProducers * numItems), poppedCount + ring.getDroppedCount());
+}
+
+// --- TraceRecordTest ---
+
+TEST(TraceRecordTest, WindowDispatchOfMotionEventRoundTrips) {
+    TracedMotionEvent event{.id = 1,
+                            .eventTime = 2,
+                            .policyFlags = 3,
+                            .deviceId = 4,
+                            .source = AINPUT_SOURCE_TOUCHSCREEN,
+                            .displayId = 5,
+                            .action = AMOTION_EVENT_ACTION_MOVE,
+                            .actionButton = 0,
+                            .flags = 6,
+                            .metaState = 7,
+                            .buttonState = 8,
+                            .classification = MotionClassification::NONE,
+                            .edgeFlags = 9,
+                            .xPrecision = 1.5f,
+                            .yPrecision = 2.5f,
+                            .xCursorPosition = 10.5f,
+                            .yCursorPosition = 20.5f,
+                            .downTime = 1,
+                            .pointerProperties = {},
+                            .pointerCoords = {}};
+    for (int32_t i = 0; i < 3; i++) {
+        PointerProperties& properties = event.pointerProperties.emplace_back();
+        properties.id = i;
+        properties.toolType = ToolType::FINGER;
+        PointerCoords& coords = event.pointerCoords.emplace_back();
+        coords.setAxisValue(AMOTION_EVENT_AXIS_X, 100 + i);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_Y, 200 + i);
+        coords.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 0.5f);
+    }
+    const TraceRecord::WindowDispatchArgs args{.eventEntry = event,
+                                               .deliveryTime = 11,
+                                               .resolvedFlags = 12,
+                                               .targetUid = gui::Uid{13},
+                                               .vsyncId = 14,
+                                               .windowId = 15,
+                                               .transform = ui::Transform(ui::Transform::ROT_90,
+                                                                          1080, 2400),
+                                               .rawTransform = ui::Transform(),
+                                               .hmac = {16, 17, 18}};
+
+    // The records are held in the ring with their previous contents, so start from garbage.
+    auto record = std::make_unique<TraceRecord>();
+    std::memset(record.get(), 0xff, sizeof(TraceRecord));
+    record->setWindowDispatch(args);
+
+    // Convert back into a dispatch that held a key event before, as the tracing thread reuses it.
+    TraceRecord::WindowDispatchArgs outArgs{.eventEntry = TracedKeyEvent{},
+                                            .deliveryTime = 0,
+                                            .resolvedFlags = 0,
+                                            .targetUid = gui::Uid::INVALID,
+                                            .vsyncId = 0,
+                                            .windowId = 0,
+                                            .transform = {},
+                                            .rawTransform = {},
+                                            .hmac = {}};
+    record->getWindowDispatch(outArgs);
+    ASSERT_EQ(args, outArgs);
+}
+
+TEST(TraceRecordTest, WindowDispatchOfKeyEventRoundTrips) {
+    const TracedKeyEvent event{.id = 1,
+                               .eventTime = 2,
+                               .policyFlags = 3,
+                               .deviceId = 4,
+                               .source = AINPUT_SOURCE_KEYBOARD,
+                               .displayId = 5,
+                               .action = AKEY_EVENT_ACTION_DOWN,
+                               .keyCode = AKEYCODE_A,
+                               .scanCode = 6,
+                               .metaState = 7,
+                               .downTime = 2,
+                               .flags = 8,
+                               .repeatCount = 0};
+    const TraceRecord::WindowDispatchArgs args{.eventEntry = event,
+                                               .deliveryTime = 11,
+                                               .resolvedFlags = 12,
+                                               .targetUid = gui::Uid{13},
+                                               .vsyncId = 14,
+                                               .windowId = 15,
+                                               .transform = ui::Transform(),
+                                               .rawTransform = ui::Transform(),
+                                               .hmac = {16, 17, 18}};
+
+    auto record = std::make_unique<TraceRecord>();
+    record->setWindowDispatch(args);
+
+    // Convert back into a dispatch that held a motion event before.
+    TraceRecord::WindowDispatchArgs outArgs{.eventEntry = TracedMotionEvent{},
+                                            .deliveryTime = 0,
+                                            .resolvedFlags = 0,
+                                            .targetUid = gui::Uid::INVALID,
+                                            .vsyncId = 0,
+                                            .windowId = 0,
+                                            .transform = {},
+                                            .rawTransform = {},
+                                            .hmac = {}};
+    record->getWindowDispatch(outArgs);
+    ASSERT_EQ(args, outArgs);
+}
+
+} // namespace android::inputdispatcher::trace::impl
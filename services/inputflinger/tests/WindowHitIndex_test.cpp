@@ -0,0 +1,151 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/WindowHitIndex.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using android::gui::WindowInfo;
+using android::gui::WindowInfoHandle;
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+namespace android::inputdispatcher {
+
+namespace {
+
+constexpr int32_t DISPLAY_ID = 0;
+constexpr int32_t SECOND_DISPLAY_ID = 1;
+
+sp<WindowInfoHandle> makeWindow(const Rect& touchableBounds, int32_t displayId = DISPLAY_ID) {
+    WindowInfo info;
+    info.displayId = displayId;
+    info.touchableRegion = Region(touchableBounds);
+    return sp<WindowInfoHandle>::make(info);
+}
+
+} // namespace
+
+// --- WindowHitIndexTest ---
+
+TEST(WindowHitIndexTest, EmptyIndex_HasNoCandidates) {
+    WindowHitIndex index;
+    ASSERT_THAT(index.getCandidates(10, 10), IsEmpty());
+
+    index.update({}, DISPLAY_ID, ui::Transform());
+    ASSERT_THAT(index.getCandidates(10, 10), IsEmpty());
+}
+
+TEST(WindowHitIndexTest, OverlappingWindows_ReturnedFrontToBack) {
+    WindowHitIndex index;
+    index.update({makeWindow(Rect(0, 0, 50, 50)), makeWindow(Rect(100, 100, 200, 200)),
+                  makeWindow(Rect(0, 0, 200, 200))},
+                 DISPLAY_ID, ui::Transform());
+
+    ASSERT_THAT(index.getCandidates(10, 10), ElementsAre(0, 2));
+    ASSERT_THAT(index.getCandidates(150, 150), ElementsAre(1, 2));
+    ASSERT_THAT(index.getCandidates(75, 75), ElementsAre(2));
+    ASSERT_THAT(index.getCandidates(250, 250), IsEmpty());
+    ASSERT_THAT(index.getCandidates(-1, 10), IsEmpty());
+}
+
+TEST(WindowHitIndexTest, RightAndBottomEdges_AreExcluded) {
+    WindowHitIndex index;
+    index.update({makeWindow(Rect(0, 0, 100, 100))}, DISPLAY_ID, ui::Transform());
+
+    ASSERT_THAT(index.getCandidates(99.9, 99.9), ElementsAre(0));
+    ASSERT_THAT(index.getCandidates(100, 50), IsEmpty());
+    ASSERT_THAT(index.getCandidates(50, 100), IsEmpty());
+}
+
+TEST(WindowHitIndexTest, InvisibleWindowsAndOtherDisplays_AreNotCandidates) {
+    sp<WindowInfoHandle> invisibleWindow = makeWindow(Rect(0, 0, 100, 100));
+    invisibleWindow->editInfo()->setInputConfig(WindowInfo::InputConfig::NOT_VISIBLE, true);
+    sp<WindowInfoHandle> untouchableWindow = makeWindow(Rect(0, 0, 100, 100));
+    untouchableWindow->editInfo()->setInputConfig(WindowInfo::InputConfig::NOT_TOUCHABLE, true);
+
+    WindowHitIndex index;
+    index.update({invisibleWindow, makeWindow(Rect(0, 0, 100, 100), SECOND_DISPLAY_ID),
+                  untouchableWindow},
+                 DISPLAY_ID, ui::Transform());
+
+    // Untouchable windows may still intercept stylus events, so they remain candidates
+    ASSERT_THAT(index.getCandidates(50, 50), ElementsAre(2));
+}
+
+TEST(WindowHitIndexTest, DisplayTransform_IsApplied) {
+    ui::Transform displayTransform;
+    displayTransform.set(100, 200);
+
+    WindowHitIndex index;
+    index.update({makeWindow(Rect(0, 0, 10, 10))}, DISPLAY_ID, displayTransform);
+
+    ASSERT_THAT(index.getCandidates(5, 5), ElementsAre(0));
+    ASSERT_THAT(index.getCandidates(105, 205), IsEmpty());
+
+    // A new display transform takes effect without rebuilding the grid, as long as the bounds in
+    // logical display space stay the same
+    ui::Transform offsetTransform;
+    offsetTransform.set(90, 190);
+    ASSERT_FALSE(index.update({makeWindow(Rect(10, 10, 20, 20))}, DISPLAY_ID, offsetTransform));
+    ASSERT_THAT(index.getCandidates(15, 15), ElementsAre(0));
+    ASSERT_THAT(index.getCandidates(5, 5), IsEmpty());
+}
+
+TEST(WindowHitIndexTest, Update_OnlyRebuildsWhenBoundsChange) {
+    WindowHitIndex index;
+    ASSERT_TRUE(index.update({makeWindow(Rect(0, 0, 100, 100))}, DISPLAY_ID, ui::Transform()));
+    ASSERT_FALSE(index.update({makeWindow(Rect(0, 0, 100, 100))}, DISPLAY_ID, ui::Transform()));
+    ASSERT_EQ(1u, index.getRebuildCount());
+
+    ASSERT_TRUE(index.update({makeWindow(Rect(0, 0, 50, 100))}, DISPLAY_ID, ui::Transform()));
+    ASSERT_EQ(2u, index.getRebuildCount());
+    ASSERT_THAT(index.getCandidates(75, 50), IsEmpty());
+}
+
+/**
+ * Check that the candidates match a brute force touchable region check for many windows spread
+ * over the display.
+ */
+TEST(WindowHitIndexTest, ManyWindows_MatchBruteForce) {
+    std::vector<sp<WindowInfoHandle>> windows;
+    for (int32_t i = 0; i < 100; i++) {
+        const int32_t left = (i * 37) % 1000;
+        const int32_t top = (i * 53) % 2000;
+        windows.push_back(
+                makeWindow(Rect(left, top, left + 50 + (i % 7) * 40, top + 30 + (i % 5) * 80)));
+    }
+    // A full screen window at the bottom, like a wallpaper
+    windows.push_back(makeWindow(Rect(0, 0, 1080, 2400)));
+
+    WindowHitIndex index;
+    index.update(windows, DISPLAY_ID, ui::Transform());
+
+    for (int32_t y = -10; y < 2450; y += 13) {
+        for (int32_t x = -10; x < 1150; x += 11) {
+            std::vector<size_t> expected;
+            for (size_t i = 0; i < windows.size(); i++) {
+                if (windows[i]->getInfo()->touchableRegion.contains(x, y)) {
+                    expected.push_back(i);
+                }
+            }
+            ASSERT_EQ(expected, index.getCandidates(x, y)) << "at " << x << ", " << y;
+        }
+    }
+}
+
+} // namespace android::inputdispatcher
@@ -19,7 +19,9 @@
 #define LOG_TAG "ClientCache"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <algorithm>
 #include <cinttypes>
+#include <utility>
 
 #include <android-base/stringprintf.h>
 #include <gui/TraceUtils.h>
@@ -33,15 +35,19 @@ ANDROID_SINGLETON_STATIC_INSTANCE(ClientCache);
 
 ClientCache::ClientCache() : mDeathRecipient(sp<CacheDeathRecipient>::make()) {}
 
-bool ClientCache::getBuffer(const client_cache_t& cacheId,
+ClientCache::ProcessShard& ClientCache::shardFor(const wp<IBinder>& processToken) {
+    return mProcessShards[std::hash<IBinder*>{}(processToken.unsafe_get()) % kNumProcessShards];
+}
+
+bool ClientCache::getBuffer(ProcessShard& shard, const client_cache_t& cacheId,
                             ClientCacheBuffer** outClientCacheBuffer) {
     auto& [processToken, id] = cacheId;
     if (processToken == nullptr) {
         ALOGE_AND_TRACE("ClientCache::getBuffer - invalid (nullptr) process token");
         return false;
     }
-    auto it = mBuffers.find(processToken);
-    if (it == mBuffers.end()) {
+    auto it = shard.buffers.find(processToken);
+    if (it == shard.buffers.end()) {
         ALOGE_AND_TRACE("ClientCache::getBuffer - invalid process token");
         return false;
     }
@@ -59,6 +65,52 @@ bool ClientCache::getBuffer(const client_cache_t& cacheId,
     return true;
 }
 
+std::shared_ptr<renderengine::ExternalTexture> ClientCache::getOrCreateTexture(
+        const sp<GraphicBuffer>& buffer) {
+    const uint64_t bufferId = buffer->getId();
+    {
+        std::lock_guard lock(mTexturesMutex);
+        auto it = mTextures.find(bufferId);
+        if (it != mTextures.end()) {
+            if (auto texture = it->second.lock()) {
+                mTextureReuses++;
+                return texture;
+            }
+        }
+    }
+
+    LOG_ALWAYS_FATAL_IF(mRenderEngine == nullptr,
+                        "Attempted to build the ClientCache before a RenderEngine instance was "
+                        "ready!");
+
+    // Import outside of the lock, mapping the buffer into RenderEngine can be slow.
+    std::shared_ptr<renderengine::ExternalTexture> texture =
+            std::make_shared<renderengine::impl::ExternalTexture>(buffer, *mRenderEngine,
+                                                                  renderengine::impl::
+                                                                          ExternalTexture::Usage::
+                                                                                  READABLE);
+    mTextureImports++;
+
+    std::lock_guard lock(mTexturesMutex);
+    auto& cached = mTextures[bufferId];
+    if (auto existing = cached.lock()) {
+        // Another process imported the same buffer concurrently. Keep the first texture so that
+        // both processes share it; ours is unmapped when it goes out of scope.
+        return existing;
+    }
+    cached = texture;
+
+    // Sweep the expired entries only once the map has doubled since the last sweep, so that the
+    // cost of a sweep is amortized over the textures added in the meantime.
+    if (mTextures.size() > mTexturesSweepSize) {
+        for (auto it = mTextures.begin(); it != mTextures.end();) {
+            it = it->second.expired() ? mTextures.erase(it) : std::next(it);
+        }
+        mTexturesSweepSize = std::max<size_t>(BUFFER_CACHE_MAX_SIZE, 2 * mTextures.size());
+    }
+    return texture;
+}
+
 base::expected<std::shared_ptr<renderengine::ExternalTexture>, ClientCache::AddError>
 ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer) {
     auto& [processToken, id] = cacheId;
@@ -72,60 +124,77 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
         return base::unexpected(AddError::Unspecified);
     }
 
-    std::lock_guard lock(mMutex);
-    sp<IBinder> token;
+    ProcessShard& shard = shardFor(processToken);
+    {
+        std::lock_guard lock(shard.mutex);
+        sp<IBinder> token;
+
+        // If this is a new process token, set a death recipient. If the client process dies, we
+        // will get a callback through binderDied.
+        auto it = shard.buffers.find(processToken);
+        if (it == shard.buffers.end()) {
+            token = processToken.promote();
+            if (!token) {
+                ALOGE_AND_TRACE("ClientCache::add - invalid token");
+                return base::unexpected(AddError::Unspecified);
+            }
 
-    // If this is a new process token, set a death recipient. If the client process dies, we will
-    // get a callback through binderDied.
-    auto it = mBuffers.find(processToken);
-    if (it == mBuffers.end()) {
-        token = processToken.promote();
-        if (!token) {
-            ALOGE_AND_TRACE("ClientCache::add - invalid token");
-            return base::unexpected(AddError::Unspecified);
+            // Only call linkToDeath if not a local binder
+            if (token->localBinder() == nullptr) {
+                status_t err = token->linkToDeath(mDeathRecipient);
+                if (err != NO_ERROR) {
+                    ALOGE_AND_TRACE("ClientCache::add - could not link to death");
+                    return base::unexpected(AddError::Unspecified);
+                }
+            }
+            auto [itr, success] =
+                    shard.buffers.emplace(processToken,
+                                          std::make_pair(token,
+                                                         std::unordered_map<uint64_t,
+                                                                            ClientCacheBuffer>()));
+            LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
+            it = itr;
         }
 
-        // Only call linkToDeath if not a local binder
-        if (token->localBinder() == nullptr) {
-            status_t err = token->linkToDeath(mDeathRecipient);
-            if (err != NO_ERROR) {
-                ALOGE_AND_TRACE("ClientCache::add - could not link to death");
-                return base::unexpected(AddError::Unspecified);
-            }
+        if (it->second.second.size() > BUFFER_CACHE_MAX_SIZE) {
+            ALOGE_AND_TRACE("ClientCache::add - cache is full");
+            return base::unexpected(AddError::CacheFull);
         }
-        auto [itr, success] =
-                mBuffers.emplace(processToken,
-                                 std::make_pair(token,
-                                                std::unordered_map<uint64_t, ClientCacheBuffer>()));
-        LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
-        it = itr;
     }
 
-    auto& processBuffers = it->second.second;
+    auto texture = getOrCreateTexture(buffer);
+    // Declared before the lock so that a texture replaced under the same cache id is released
+    // after the lock, unmapping it from RenderEngine can be slow.
+    std::shared_ptr<renderengine::ExternalTexture> replacedTexture;
+
+    std::lock_guard lock(shard.mutex);
+    // The process may have died while the texture was being imported.
+    auto it = shard.buffers.find(processToken);
+    if (it == shard.buffers.end()) {
+        ALOGE_AND_TRACE("ClientCache::add - process removed");
+        return base::unexpected(AddError::Unspecified);
+    }
 
+    auto& processBuffers = it->second.second;
     if (processBuffers.size() > BUFFER_CACHE_MAX_SIZE) {
         ALOGE_AND_TRACE("ClientCache::add - cache is full");
         return base::unexpected(AddError::CacheFull);
     }
-
-    LOG_ALWAYS_FATAL_IF(mRenderEngine == nullptr,
-                        "Attempted to build the ClientCache before a RenderEngine instance was "
-                        "ready!");
-
-    return (processBuffers[id].buffer = std::make_shared<
-                    renderengine::impl::ExternalTexture>(buffer, *mRenderEngine,
-                                                         renderengine::impl::ExternalTexture::
-                                                                 Usage::READABLE));
+    ClientCacheBuffer& cacheBuffer = processBuffers[id];
+    replacedTexture = std::exchange(cacheBuffer.buffer, std::move(texture));
+    return cacheBuffer.buffer;
 }
 
 sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
     sp<GraphicBuffer> buffer;
     auto& [processToken, id] = cacheId;
     std::vector<sp<ErasedRecipient>> pendingErase;
+    std::shared_ptr<renderengine::ExternalTexture> texture;
     {
-        std::lock_guard lock(mMutex);
+        ProcessShard& shard = shardFor(processToken);
+        std::lock_guard lock(shard.mutex);
         ClientCacheBuffer* buf = nullptr;
-        if (!getBuffer(cacheId, &buf)) {
+        if (!getBuffer(shard, cacheId, &buf)) {
             ALOGE("failed to erase buffer, could not retrieve buffer");
             return nullptr;
         }
@@ -139,8 +208,11 @@ sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
             }
         }
 
-        mBuffers[processToken].second.erase(id);
+        // Release the texture outside of the lock, unmapping it from RenderEngine can be slow.
+        texture = std::move(buf->buffer);
+        shard.buffers[processToken].second.erase(id);
     }
+    texture.reset();
 
     for (auto& recipient : pendingErase) {
         recipient->bufferErased(cacheId);
@@ -149,10 +221,11 @@ sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
 }
 
 std::shared_ptr<renderengine::ExternalTexture> ClientCache::get(const client_cache_t& cacheId) {
-    std::lock_guard lock(mMutex);
+    ProcessShard& shard = shardFor(cacheId.token);
+    std::lock_guard lock(shard.mutex);
 
     ClientCacheBuffer* buf = nullptr;
-    if (!getBuffer(cacheId, &buf)) {
+    if (!getBuffer(shard, cacheId, &buf)) {
         ALOGE("failed to get buffer, could not retrieve buffer");
         return nullptr;
     }
@@ -162,10 +235,11 @@ std::shared_ptr<renderengine::ExternalTexture> ClientCache::get(const client_cac
 
 bool ClientCache::registerErasedRecipient(const client_cache_t& cacheId,
                                           const wp<ErasedRecipient>& recipient) {
-    std::lock_guard lock(mMutex);
+    ProcessShard& shard = shardFor(cacheId.token);
+    std::lock_guard lock(shard.mutex);
 
     ClientCacheBuffer* buf = nullptr;
-    if (!getBuffer(cacheId, &buf)) {
+    if (!getBuffer(shard, cacheId, &buf)) {
         ALOGV("failed to register erased recipient, could not retrieve buffer");
         return false;
     }
@@ -175,10 +249,11 @@ bool ClientCache::registerErasedRecipient(const client_cache_t& cacheId,
 
 void ClientCache::unregisterErasedRecipient(const client_cache_t& cacheId,
                                             const wp<ErasedRecipient>& recipient) {
-    std::lock_guard lock(mMutex);
+    ProcessShard& shard = shardFor(cacheId.token);
+    std::lock_guard lock(shard.mutex);
 
     ClientCacheBuffer* buf = nullptr;
-    if (!getBuffer(cacheId, &buf)) {
+    if (!getBuffer(shard, cacheId, &buf)) {
         ALOGE("failed to unregister erased recipient");
         return;
     }
@@ -188,14 +263,17 @@ void ClientCache::unregisterErasedRecipient(const client_cache_t& cacheId,
 
 void ClientCache::removeProcess(const wp<IBinder>& processToken) {
     std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>> pendingErase;
+    // Released outside of the lock, see erase().
+    std::unordered_map<uint64_t, ClientCacheBuffer> removedBuffers;
     {
         if (processToken == nullptr) {
             ALOGE("failed to remove process, invalid (nullptr) process token");
             return;
         }
-        std::lock_guard lock(mMutex);
-        auto itr = mBuffers.find(processToken);
-        if (itr == mBuffers.end()) {
+        ProcessShard& shard = shardFor(processToken);
+        std::lock_guard lock(shard.mutex);
+        auto itr = shard.buffers.find(processToken);
+        if (itr == shard.buffers.end()) {
             ALOGE("failed to remove process, could not find process");
             return;
         }
@@ -209,8 +287,10 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
                 }
             }
         }
-        mBuffers.erase(itr);
+        removedBuffers = std::move(itr->second.second);
+        shard.buffers.erase(itr);
     }
+    removedBuffers.clear();
 
     for (auto& [recipient, cacheId] : pendingErase) {
         recipient->bufferErased(cacheId);
@@ -222,16 +302,25 @@ void ClientCache::CacheDeathRecipient::binderDied(const wp<IBinder>& who) {
 }
 
 void ClientCache::dump(std::string& result) {
-    std::lock_guard lock(mMutex);
-    for (const auto& [_, cache] : mBuffers) {
-        base::StringAppendF(&result, " Cache owner: %p\n", cache.first.get());
-
-        for (const auto& [id, entry] : cache.second) {
-            const auto& buffer = entry.buffer->getBuffer();
-            base::StringAppendF(&result, "\tID: %" PRIu64 ", size: %ux%u\n", id, buffer->getWidth(),
-                                buffer->getHeight());
+    for (auto& shard : mProcessShards) {
+        std::lock_guard lock(shard.mutex);
+        for (const auto& [_, cache] : shard.buffers) {
+            base::StringAppendF(&result, " Cache owner: %p\n", cache.first.get());
+
+            for (const auto& [id, entry] : cache.second) {
+                const auto& buffer = entry.buffer->getBuffer();
+                base::StringAppendF(&result, "\tID: %" PRIu64 ", size: %ux%u, refs: %ld\n", id,
+                                    buffer->getWidth(), buffer->getHeight(),
+                                    entry.buffer.use_count());
+            }
         }
     }
+
+    std::lock_guard lock(mTexturesMutex);
+    base::StringAppendF(&result,
+                        " Textures: %zu tracked, %" PRIu64 " imported, %" PRIu64
+                        " shared between processes\n",
+                        mTextures.size(), mTextureImports.load(), mTextureReuses.load());
 }
 
 } // namespace android
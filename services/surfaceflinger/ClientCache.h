@@ -24,6 +24,8 @@
 #include <utils/RefBase.h>
 #include <utils/Singleton.h>
 
+#include <array>
+#include <atomic>
 #include <map>
 #include <mutex>
 #include <set>
@@ -46,6 +48,13 @@ namespace android {
 // both the SurfaceFlinger side of this other cache, as well as Composer HAL's
 // side of the cache.
 //
+// Processes are spread over shards, each with its own lock, so that clients
+// caching buffers concurrently do not contend. The ExternalTexture created for
+// a buffer is shared by every process that caches a buffer with the same
+// GraphicBuffer id, so that a buffer passed between processes is only imported
+// into RenderEngine once. The texture is released when the last cache entry
+// and the last layer referencing it let go of it.
+//
 class ClientCache : public Singleton<ClientCache> {
 public:
     ClientCache();
@@ -78,16 +87,37 @@ public:
     void dump(std::string& result);
 
 private:
-    std::mutex mMutex;
-
     struct ClientCacheBuffer {
         std::shared_ptr<renderengine::ExternalTexture> buffer;
         std::set<wp<ErasedRecipient>> recipients;
     };
-    std::map<wp<IBinder> /*caching process*/,
-             std::pair<sp<IBinder> /*strong ref to caching process*/,
-                       std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer>>>
-            mBuffers GUARDED_BY(mMutex);
+    using ProcessBuffers =
+            std::map<wp<IBinder> /*caching process*/,
+                     std::pair<sp<IBinder> /*strong ref to caching process*/,
+                               std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer>>>;
+
+    struct ProcessShard {
+        std::mutex mutex;
+        ProcessBuffers buffers GUARDED_BY(mutex);
+    };
+    static constexpr size_t kNumProcessShards = 8;
+    std::array<ProcessShard, kNumProcessShards> mProcessShards;
+
+    ProcessShard& shardFor(const wp<IBinder>& processToken);
+
+    // Returns the texture already imported for a buffer with the same id, or imports a new one.
+    std::shared_ptr<renderengine::ExternalTexture> getOrCreateTexture(
+            const sp<GraphicBuffer>& buffer);
+
+    // Textures keyed by GraphicBuffer id. Entries expire once no cache entry or layer holds the
+    // texture anymore, and are swept once the map grows past mTexturesSweepSize.
+    std::mutex mTexturesMutex;
+    std::unordered_map<uint64_t /*buffer id*/, std::weak_ptr<renderengine::ExternalTexture>>
+            mTextures GUARDED_BY(mTexturesMutex);
+    // Twice the size of mTextures after the last sweep, and at least BUFFER_CACHE_MAX_SIZE.
+    size_t mTexturesSweepSize GUARDED_BY(mTexturesMutex) = BUFFER_CACHE_MAX_SIZE;
+    std::atomic<uint64_t> mTextureImports = 0;
+    std::atomic<uint64_t> mTextureReuses = 0;
 
     class CacheDeathRecipient : public IBinder::DeathRecipient {
     public:
@@ -97,8 +127,8 @@ private:
     sp<CacheDeathRecipient> mDeathRecipient;
     renderengine::RenderEngine* mRenderEngine = nullptr;
 
-    bool getBuffer(const client_cache_t& cacheId, ClientCacheBuffer** outClientCacheBuffer)
-            REQUIRES(mMutex);
+    bool getBuffer(ProcessShard& shard, const client_cache_t& cacheId,
+                   ClientCacheBuffer** outClientCacheBuffer) REQUIRES(shard.mutex);
 };
 
 }; // namespace android
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <compositionengine/impl/planner/Predictor.h>
+#include <compositionengine/mock/LayerFE.h>
+#include <compositionengine/mock/OutputLayer.h>
+
+#include <aidl/android/hardware/graphics/composer3/Composition.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using aidl::android::hardware::graphics::composer3::Composition;
+
+namespace android::compositionengine::impl::planner {
+namespace {
+
+using testing::NiceMock;
+using testing::Return;
+using testing::ReturnRef;
+
+const std::string sDebugName = std::string("Benchmark LayerFE");
+
+// Replays a layer stack sequence resembling a captured session: a status bar and an app window
+// that never change, an IME that is shown and hidden every few frames, and a cursor that moves
+// across the screen every frame. The IME is client composited while it animates in.
+class LayerStackSequence {
+public:
+    explicit LayerStackSequence(size_t cursorPositions) {
+        for (size_t frame = 0; frame < kFrameCount; ++frame) {
+            const bool imeShown = (frame / 8) % 2 == 1;
+            const bool imeAnimating = imeShown && frame % 8 == 0;
+
+            Frame& result = mFrames.emplace_back();
+            result.layers.push_back(addLayer(1, Rect(0, 0, 1080, 80), Composition::DEVICE));
+            result.layers.push_back(addLayer(2, Rect(0, 80, 1080, 2400), Composition::DEVICE));
+            if (imeShown) {
+                result.layers.push_back(addLayer(3, Rect(0, 1600, 1080, 2400),
+                                                 imeAnimating ? Composition::CLIENT
+                                                              : Composition::DEVICE));
+            }
+            const int32_t cursorOffset = static_cast<int32_t>(frame % cursorPositions) * 16;
+            result.layers.push_back(addLayer(4,
+                                             Rect(cursorOffset, cursorOffset, cursorOffset + 32,
+                                                  cursorOffset + 32),
+                                             Composition::CURSOR));
+
+            for (const LayerState* layer : result.layers) {
+                result.plan.addLayerType(layer->getCompositionType());
+            }
+            result.hash = getNonBufferHash(result.layers);
+        }
+    }
+
+    struct Frame {
+        std::vector<const LayerState*> layers;
+        NonBufferHash hash;
+        Plan plan;
+    };
+
+    const std::vector<Frame>& frames() const { return mFrames; }
+
+    static constexpr size_t kFrameCount = 256;
+
+private:
+    struct Layer {
+        NiceMock<mock::OutputLayer> outputLayer;
+        sp<NiceMock<mock::LayerFE>> layerFE = sp<NiceMock<mock::LayerFE>>::make();
+        OutputLayerCompositionState outputLayerState;
+        LayerFECompositionState layerFEState;
+        std::unique_ptr<LayerState> layerState;
+    };
+
+    const LayerState* addLayer(int32_t sequence, Rect displayFrame, Composition composition) {
+        Layer& layer = *mLayers.emplace_back(std::make_unique<Layer>());
+        layer.outputLayerState.displayFrame = displayFrame;
+        layer.outputLayerState.visibleRegion = Region(displayFrame);
+        layer.layerFEState.compositionType = composition;
+
+        ON_CALL(layer.outputLayer, getLayerFE()).WillByDefault(ReturnRef(*layer.layerFE));
+        ON_CALL(layer.outputLayer, getState()).WillByDefault(ReturnRef(layer.outputLayerState));
+        ON_CALL(*layer.layerFE, getSequence()).WillByDefault(Return(sequence));
+        ON_CALL(*layer.layerFE, getDebugName()).WillByDefault(Return(sDebugName.c_str()));
+        ON_CALL(*layer.layerFE, getCompositionState()).WillByDefault(Return(&layer.layerFEState));
+
+        layer.layerState = std::make_unique<LayerState>(&layer.outputLayer);
+        return layer.layerState.get();
+    }
+
+    std::vector<std::unique_ptr<Layer>> mLayers;
+    std::vector<Frame> mFrames;
+};
+
+size_t replay(Predictor& predictor, const LayerStackSequence& sequence) {
+    size_t hits = 0;
+    for (const auto& frame : sequence.frames()) {
+        auto predictedPlan = predictor.getPredictedPlan(frame.layers, frame.hash);
+        if (predictedPlan && predictedPlan->plan == frame.plan) {
+            ++hits;
+        }
+        predictor.recordResult(predictedPlan, frame.hash, frame.layers, false, frame.plan);
+    }
+    return hits;
+}
+
+// Steady state: the same predictor sees the sequence over and over.
+void BM_Predictor_replay(benchmark::State& state) {
+    const LayerStackSequence sequence(static_cast<size_t>(state.range(0)));
+    Predictor predictor;
+
+    size_t hits = 0;
+    size_t frames = 0;
+    for (auto _ : state) {
+        hits += replay(predictor, sequence);
+        frames += sequence.frames().size();
+    }
+
+    state.counters["hit_rate"] = static_cast<double>(hits) / static_cast<double>(frames);
+    state.SetItemsProcessed(static_cast<int64_t>(frames));
+}
+BENCHMARK(BM_Predictor_replay)->Arg(4)->Arg(16)->Arg(64);
+
+// Cold start: every iteration replays the sequence through a fresh predictor, optionally seeded
+// with the plans saved by a predictor that has already seen the sequence.
+void BM_Predictor_coldReplay(benchmark::State& state) {
+    const LayerStackSequence sequence(static_cast<size_t>(state.range(0)));
+    const bool loadSavedPlans = state.range(1) != 0;
+
+    std::string savedPlans;
+    {
+        Predictor predictor;
+        replay(predictor, sequence);
+        replay(predictor, sequence);
+        predictor.savePlans(savedPlans);
+    }
+
+    size_t hits = 0;
+    size_t frames = 0;
+    for (auto _ : state) {
+        Predictor predictor;
+        if (loadSavedPlans) {
+            predictor.loadPlans(savedPlans);
+        }
+        hits += replay(predictor, sequence);
+        frames += sequence.frames().size();
+    }
+
+    state.counters["hit_rate"] = static_cast<double>(hits) / static_cast<double>(frames);
+    state.SetItemsProcessed(static_cast<int64_t>(frames));
+}
+BENCHMARK(BM_Predictor_coldReplay)->ArgsProduct({{4, 16, 64}, {0, 1}});
+
+} // namespace
+} // namespace android::compositionengine::impl::planner
+
+BENCHMARK_MAIN();
@@ -220,12 +220,13 @@ public:
     ftl::Flags<LayerStateField> update(compositionengine::OutputLayer*);
 
     // Computes a hash for this LayerState.
-    // The hash is only computed from NonUniqueFields, and excludes GraphicBuffers since they are
-    // not guaranteed to live longer than the LayerState object.
+    // The hash is only computed from HashedFields. It excludes GraphicBuffers, since they are not
+    // guaranteed to live longer than the LayerState object, and frame numbers, which change with
+    // every buffer. The hash is used to match and persist layer stacks across frames.
     size_t getHash() const;
 
     // Returns the bit-set of differing fields between this LayerState and another LayerState.
-    // This bit-set is based on NonUniqueFields only, and excludes GraphicBuffers.
+    // This bit-set is based on HashedFields only.
     ftl::Flags<LayerStateField> getDifferingFields(const LayerState& other) const;
     bool isSourceCropSizeEqual(const LayerState& other) const;
 
@@ -404,7 +405,12 @@ private:
                             },
                             [](void* p) {
                                 return std::vector<std::string>{base::StringPrintf("%p", p)};
-                            }};
+                            },
+                            OutputLayerState<void*, LayerStateField::SidebandStream>::
+                                    getDefaultEquals(),
+                            // The handle's address changes across restarts, so only its presence
+                            // feeds the NonBufferHash that persisted plans are keyed by.
+                            [](void* p) { return std::hash<bool>{}(p != nullptr); }};
 
     static auto constexpr BufferEquals = [](const wp<GraphicBuffer>& lhs,
                                             const wp<GraphicBuffer>& rhs) -> bool {
@@ -518,6 +524,17 @@ private:
                 &mBuffer,       &mSolidColor,     &mBackgroundBlurRadius, &mBlurRegions,
                 &mFrameNumber,  &mIsProtected,    &mCachingHint};
     }
+
+    static const constexpr size_t kNumHashedFields = kNumNonUniqueFields - 2;
+
+    // The NonUniqueFields without the per-frame mBuffer and mFrameNumber.
+    std::array<const StateInterface*, kNumHashedFields> getHashedFields() const {
+        return {&mDisplayFrame,   &mSourceCrop,           &mBufferTransform, &mBlendMode,
+                &mAlpha,          &mLayerMetadata,        &mVisibleRegion,   &mOutputDataspace,
+                &mPixelFormat,    &mColorTransform,       &mCompositionType, &mSidebandStream,
+                &mSolidColor,     &mBackgroundBlurRadius, &mBlurRegions,     &mIsProtected,
+                &mCachingHint};
+    }
 };
 
 using NonBufferHash = size_t;
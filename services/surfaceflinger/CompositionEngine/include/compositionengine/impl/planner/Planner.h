@@ -74,6 +74,7 @@ public:
 
 private:
     void dumpUsage(std::string&) const;
+    void loadPredictions();
 
     std::unordered_map<LayerId, LayerState> mPreviousLayers;
 
@@ -86,6 +87,8 @@ private:
     NonBufferHash mFlattenedHash = 0;
 
     bool mPredictorEnabled = false;
+    // Where predicted plans are persisted across restarts, if set.
+    std::string mPredictionStorePath;
 };
 
 } // namespace compositionengine::impl::planner
@@ -51,6 +51,16 @@ public:
     std::optional<ApproximateMatch> getApproximateMatch(
             const std::vector<const LayerState*>& other) const;
 
+    // Returns true if every layer of this stack either matches the corresponding layer of the
+    // provided list, or differs from it only in ways that rarely change the composition strategy:
+    // its visible region or metadata, its position but not its size, or the color of a solid color
+    // layer. Unlike getApproximateMatch, any number of layers may differ.
+    bool matchesWithinTolerance(const std::vector<const LayerState*>& other) const;
+
+    // Returns the hash of the per-layer features that have to be equal for two stacks to match
+    // within tolerance. See getLayerFeatureHash.
+    size_t getFeatureHash() const;
+
     void compare(const LayerStack& other, std::string& result) const {
         if (mLayers.size() != other.mLayers.size()) {
             base::StringAppendF(&result, "Cannot compare stacks of different sizes (%zd vs. %zd)\n",
@@ -106,6 +116,10 @@ private:
     constexpr static int kMaxDifferingFields = 6;
 };
 
+// Hashes the features of each layer that matchesWithinTolerance requires to be equal, so that
+// stacks which may match within tolerance can be looked up without comparing them field by field.
+size_t getLayerFeatureHash(const std::vector<const LayerState*>& layers);
+
 class Plan {
 public:
     static std::optional<Plan> fromString(const std::string&);
@@ -148,6 +162,7 @@ public:
     enum class Type {
         Exact,
         Approximate,
+        Tolerant,
         Total,
     };
 
@@ -159,6 +174,8 @@ public:
                 return "Exact";
             case Type::Approximate:
                 return "Approximate";
+            case Type::Tolerant:
+                return "Tolerant";
             case Type::Total:
                 return "Total";
         }
@@ -176,14 +193,16 @@ public:
 
     size_t getHitCount(Type type) const {
         if (type == Type::Total) {
-            return getHitCount(Type::Exact) + getHitCount(Type::Approximate);
+            return getHitCount(Type::Exact) + getHitCount(Type::Approximate) +
+                    getHitCount(Type::Tolerant);
         }
         return getStatsForType(type).hitCount;
     }
 
     size_t getMissCount(Type type) const {
         if (type == Type::Total) {
-            return getMissCount(Type::Exact) + getMissCount(Type::Approximate);
+            return getMissCount(Type::Exact) + getMissCount(Type::Approximate) +
+                    getMissCount(Type::Tolerant);
         }
         return getStatsForType(type).missCount;
     }
@@ -207,7 +226,14 @@ private:
     };
 
     const Stats& getStatsForType(Type type) const {
-        return (type == Type::Exact) ? mExactStats : mApproximateStats;
+        switch (type) {
+            case Type::Exact:
+                return mExactStats;
+            case Type::Tolerant:
+                return mTolerantStats;
+            default:
+                return mApproximateStats;
+        }
     }
 
     Stats& getStatsForType(Type type) {
@@ -219,6 +245,7 @@ private:
 
     Stats mExactStats;
     Stats mApproximateStats;
+    Stats mTolerantStats;
 };
 
 class Predictor {
@@ -238,7 +265,8 @@ public:
     // If the exact layer stack has previously been seen by the predictor, then report the plan used
     // for that layer stack.
     //
-    // Otherwise, try to match to the best approximate stack to retireve the most likely plan.
+    // Otherwise, try to match to the best approximate stack to retireve the most likely plan, and
+    // failing that, to a previously seen stack that matches within tolerance.
     std::optional<PredictedPlan> getPredictedPlan(const std::vector<const LayerState*>& layers,
                                                   NonBufferHash hash) const;
 
@@ -251,6 +279,13 @@ public:
 
     void dump(std::string&) const;
 
+    // Serializes the plans of the predictions that have never missed, so that they can be restored
+    // with loadPlans after SurfaceFlinger restarts. Layer stacks are not persisted, so restored
+    // plans only serve exact matches until they are hit again.
+    void savePlans(std::string& result) const;
+    // Restores plans serialized by savePlans. Returns the number of plans restored.
+    size_t loadPlans(const std::string&);
+
     void compareLayerStacks(NonBufferHash leftHash, NonBufferHash rightHash, std::string&) const;
     void describeLayerStack(NonBufferHash, std::string&) const;
     void listSimilarStacks(Plan, std::string&) const;
@@ -260,13 +295,20 @@ private:
     const Prediction& getPrediction(NonBufferHash) const;
     Prediction& getPrediction(NonBufferHash);
 
+    bool hasPrediction(NonBufferHash) const;
+
     std::optional<Plan> getExactMatch(NonBufferHash) const;
     std::optional<NonBufferHash> getApproximateMatch(
             const std::vector<const LayerState*>& layers) const;
+    std::optional<NonBufferHash> getToleratedMatch(
+            const std::vector<const LayerState*>& layers) const;
 
+    void addPrediction(NonBufferHash, Prediction&&);
     void promoteIfCandidate(NonBufferHash);
     void recordPredictedResult(PredictedPlan, const std::vector<const LayerState*>& layers,
                                Plan result);
+    void recordPersistedResult(NonBufferHash, const std::vector<const LayerState*>& layers,
+                               Plan result);
     bool findSimilarPrediction(const std::vector<const LayerState*>& layers, Plan result);
 
     void dumpPredictionsByFrequency(std::string&) const;
@@ -291,6 +333,10 @@ private:
 
     std::unordered_map<NonBufferHash, Prediction> mPredictions;
     std::unordered_map<Plan, std::vector<NonBufferHash>> mSimilarStacks;
+    // Predictions keyed by the feature hash of their example layer stack.
+    std::unordered_map<size_t, std::vector<NonBufferHash>> mPredictionsByFeatures;
+    // Plans restored by loadPlans that have not been seen since.
+    std::unordered_map<NonBufferHash, Plan> mPersistedPlans;
 
     struct ApproximateStack {
         ApproximateStack(NonBufferHash hash, LayerStack::ApproximateMatch match)
@@ -308,7 +354,10 @@ private:
 
     mutable size_t mExactHitCount = 0;
     mutable size_t mApproximateHitCount = 0;
+    mutable size_t mTolerantHitCount = 0;
     mutable size_t mMissCount = 0;
+    size_t mPersistedHitCount = 0;
+    size_t mPersistedMissCount = 0;
 };
 
 // Defining PrintTo helps with Google Tests.
@@ -66,10 +66,7 @@ ftl::Flags<LayerStateField> LayerState::update(compositionengine::OutputLayer* l
 
 size_t LayerState::getHash() const {
     size_t hash = 0;
-    for (const StateInterface* field : getNonUniqueFields()) {
-        if (field->getField() == LayerStateField::Buffer) {
-            continue;
-        }
+    for (const StateInterface* field : getHashedFields()) {
         android::hashCombineSingleHashed(hash, field->getHash());
     }
 
@@ -83,13 +80,9 @@ bool LayerState::isSourceCropSizeEqual(const LayerState& other) const {
 
 ftl::Flags<LayerStateField> LayerState::getDifferingFields(const LayerState& other) const {
     ftl::Flags<LayerStateField> differences;
-    auto myFields = getNonUniqueFields();
-    auto otherFields = other.getNonUniqueFields();
+    auto myFields = getHashedFields();
+    auto otherFields = other.getHashedFields();
     for (size_t i = 0; i < myFields.size(); ++i) {
-        if (myFields[i]->getField() == LayerStateField::Buffer) {
-            continue;
-        }
-
         differences |= myFields[i]->getFieldIfDifferent(otherFields[i]);
     }
 
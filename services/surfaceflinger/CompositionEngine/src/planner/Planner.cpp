@@ -20,6 +20,7 @@
 #define LOG_TAG "Planner"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <android-base/file.h>
 #include <android-base/properties.h>
 #include <compositionengine/LayerFECompositionState.h>
 #include <compositionengine/impl/OutputLayerCompositionState.h>
@@ -75,6 +76,27 @@ Planner::Planner(renderengine::RenderEngine& renderEngine)
                    buildFlattenerTuneables()) {
     mPredictorEnabled =
             base::GetBoolProperty(std::string("debug.sf.enable_planner_prediction"), false);
+    if (mPredictorEnabled) {
+        mPredictionStorePath =
+                base::GetProperty(std::string("debug.sf.planner_prediction_store"), "");
+        loadPredictions();
+    }
+}
+
+void Planner::loadPredictions() {
+    if (mPredictionStorePath.empty()) {
+        return;
+    }
+
+    std::string plans;
+    if (!base::ReadFileToString(mPredictionStorePath, &plans)) {
+        ALOGV("[%s] No predictions stored at %s", __func__, mPredictionStorePath.c_str());
+        return;
+    }
+
+    const size_t loadedCount = mPredictor.loadPlans(plans);
+    ALOGI("[%s] Restored %zu predicted plans from %s", __func__, loadedCount,
+          mPredictionStorePath.c_str());
 }
 
 void Planner::setDisplaySize(ui::Size size) {
@@ -301,6 +323,23 @@ void Planner::dump(const Vector<String16>& args, std::string& result) {
             }
         } else if (command == "--layers" || command == "-l") {
             mFlattener.dumpLayers(result);
+        } else if (command == "--save-predictions") {
+            if (!mPredictorEnabled || mPredictionStorePath.empty()) {
+                result.append("Prediction store is not configured, set "
+                              "debug.sf.planner_prediction_store and "
+                              "debug.sf.enable_planner_prediction\n");
+                return;
+            }
+
+            std::string plans;
+            mPredictor.savePlans(plans);
+            if (!base::WriteStringToFile(plans, mPredictionStorePath)) {
+                base::StringAppendF(&result, "Failed to write predictions to %s\n",
+                                    mPredictionStorePath.c_str());
+                return;
+            }
+            base::StringAppendF(&result, "Saved predictions to %s\n",
+                                mPredictionStorePath.c_str());
         } else {
             base::StringAppendF(&result, "Unknown command '%s'\n\n", command.c_str());
             dumpUsage(result);
@@ -341,6 +380,10 @@ void Planner::dumpUsage(std::string& result) const {
 
     result.append("[--layers|-l]\n");
     result.append("  Prints the current layers\n");
+
+    result.append("[--save-predictions]\n");
+    result.append("  Writes the predicted plans to debug.sf.planner_prediction_store, from where they"
+                  " are restored when SurfaceFlinger starts\n");
 }
 
 } // namespace android::compositionengine::impl::planner
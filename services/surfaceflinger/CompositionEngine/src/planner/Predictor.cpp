@@ -21,8 +21,73 @@
 
 #include <compositionengine/impl/planner/Predictor.h>
 
+#include <sstream>
+
 namespace android::compositionengine::impl::planner {
 
+namespace {
+
+constexpr const char* kPersistedPlansHeader = "planner-predictions 1";
+
+// Differences in these fields are always tolerated by LayerStack::matchesWithinTolerance.
+constexpr uint32_t kToleratedFields = static_cast<uint32_t>(LayerStateField::VisibleRegion) |
+        static_cast<uint32_t>(LayerStateField::LayerMetadata);
+
+bool isWithinTolerance(const LayerState& lhs, const LayerState& rhs) {
+    if (lhs.getHash() == rhs.getHash()) {
+        return true;
+    }
+
+    const auto compositionType = lhs.getCompositionType();
+    if (compositionType != rhs.getCompositionType()) {
+        return false;
+    }
+
+    // As in getApproximateMatch, client-composited layers don't change the composition plan
+    if (compositionType == aidl::android::hardware::graphics::composer3::Composition::CLIENT) {
+        return true;
+    }
+
+    uint32_t differingFields = lhs.getDifferingFields(rhs).get() & ~kToleratedFields;
+
+    // A layer that moved without being resized, e.g. a cursor
+    const Rect lhsFrame = lhs.getDisplayFrame();
+    const Rect rhsFrame = rhs.getDisplayFrame();
+    if (lhsFrame.getWidth() == rhsFrame.getWidth() &&
+        lhsFrame.getHeight() == rhsFrame.getHeight()) {
+        differingFields &= ~static_cast<uint32_t>(LayerStateField::DisplayFrame);
+    }
+    if (lhs.isSourceCropSizeEqual(rhs)) {
+        differingFields &= ~static_cast<uint32_t>(LayerStateField::SourceCrop);
+    }
+
+    if (compositionType ==
+        aidl::android::hardware::graphics::composer3::Composition::SOLID_COLOR) {
+        differingFields &= ~static_cast<uint32_t>(LayerStateField::SolidColor);
+    }
+
+    return differingFields == 0;
+}
+
+// The features hashed here must be equal for isWithinTolerance to succeed.
+size_t hashLayerFeatures(const LayerState& layer) {
+    size_t hash = 0;
+    const auto compositionType = layer.getCompositionType();
+    android::hashCombineSingle(hash, static_cast<int32_t>(compositionType));
+    if (compositionType == aidl::android::hardware::graphics::composer3::Composition::CLIENT) {
+        return hash;
+    }
+
+    const Rect displayFrame = layer.getDisplayFrame();
+    android::hashCombineSingle(hash, displayFrame.getWidth());
+    android::hashCombineSingle(hash, displayFrame.getHeight());
+    android::hashCombineSingle(hash, static_cast<int32_t>(layer.getDataspace()));
+    android::hashCombineSingle(hash, layer.isProtected());
+    return hash;
+}
+
+} // namespace
+
 std::optional<LayerStack::ApproximateMatch> LayerStack::getApproximateMatch(
         const std::vector<const LayerState*>& other) const {
     // Differing numbers of layers are never an approximate match
@@ -86,6 +151,35 @@ std::optional<LayerStack::ApproximateMatch> LayerStack::getApproximateMatch(
     };
 }
 
+bool LayerStack::matchesWithinTolerance(const std::vector<const LayerState*>& other) const {
+    if (mLayers.size() != other.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < mLayers.size(); ++i) {
+        if (!isWithinTolerance(mLayers[i], *other[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t LayerStack::getFeatureHash() const {
+    size_t hash = 0;
+    for (const LayerState& layer : mLayers) {
+        android::hashCombineSingleHashed(hash, hashLayerFeatures(layer));
+    }
+    return hash;
+}
+
+size_t getLayerFeatureHash(const std::vector<const LayerState*>& layers) {
+    size_t hash = 0;
+    for (const LayerState* layer : layers) {
+        android::hashCombineSingleHashed(hash, hashLayerFeatures(*layer));
+    }
+    return hash;
+}
+
 std::optional<Plan> Plan::fromString(const std::string& string) {
     Plan plan;
     for (char c : string) {
@@ -166,6 +260,8 @@ void Prediction::dump(std::string& result) const {
     mExactStats.dump(result);
     result.append("] [Approximate ");
     mApproximateStats.dump(result);
+    result.append("] [Tolerant ");
+    mTolerantStats.dump(result);
     result.append("]");
 }
 
@@ -194,6 +290,14 @@ std::optional<Predictor::PredictedPlan> Predictor::getPredictedPlan(
                              .type = Prediction::Type::Approximate};
     }
 
+    // Finally check for stacks that only differ in ways that rarely change the plan
+    if (std::optional<NonBufferHash> toleratedMatch = getToleratedMatch(layers); toleratedMatch) {
+        ALOGV("[%s] Found a match within tolerance for %zx", __func__, *toleratedMatch);
+        return PredictedPlan{.hash = *toleratedMatch,
+                             .plan = getPrediction(*toleratedMatch).getPlan(),
+                             .type = Prediction::Type::Tolerant};
+    }
+
     return std::nullopt;
 }
 
@@ -201,11 +305,19 @@ void Predictor::recordResult(std::optional<PredictedPlan> predictedPlan,
                              NonBufferHash flattenedHash,
                              const std::vector<const LayerState*>& layers, bool hasSkippedLayers,
                              Plan result) {
-    if (predictedPlan) {
+    if (predictedPlan && hasPrediction(predictedPlan->hash)) {
         recordPredictedResult(*predictedPlan, layers, std::move(result));
         return;
     }
 
+    if (predictedPlan) {
+        // The plan was restored by loadPlans and has not been seen since
+        recordPersistedResult(predictedPlan->hash, layers, result);
+        if (predictedPlan->plan == result) {
+            return;
+        }
+    }
+
     ++mMissCount;
 
     if (!hasSkippedLayers && findSimilarPrediction(layers, result)) {
@@ -222,17 +334,69 @@ void Predictor::recordResult(std::optional<PredictedPlan> predictedPlan,
 void Predictor::dump(std::string& result) const {
     result.append("Predictor state:\n");
 
-    const size_t hitCount = mExactHitCount + mApproximateHitCount;
+    const size_t hitCount = mExactHitCount + mApproximateHitCount + mTolerantHitCount;
     const size_t totalAttempts = hitCount + mMissCount;
     base::StringAppendF(&result, "Global non-skipped hit rate: %.2f%% (%zd/%zd)\n",
                         100.0f * hitCount / totalAttempts, hitCount, totalAttempts);
-    base::StringAppendF(&result, "  Exact hits: %zd\n", mExactHitCount);
+    base::StringAppendF(&result, "  Exact hits: %zd (%zd from persisted plans)\n", mExactHitCount,
+                        mPersistedHitCount);
     base::StringAppendF(&result, "  Approximate hits: %zd\n", mApproximateHitCount);
-    base::StringAppendF(&result, "  Misses: %zd\n\n", mMissCount);
+    base::StringAppendF(&result, "  Tolerant hits: %zd\n", mTolerantHitCount);
+    base::StringAppendF(&result, "  Misses: %zd (%zd from persisted plans)\n", mMissCount,
+                        mPersistedMissCount);
+    base::StringAppendF(&result, "  Persisted plans not seen yet: %zd\n\n",
+                        mPersistedPlans.size());
 
     dumpPredictionsByFrequency(result);
 }
 
+void Predictor::savePlans(std::string& result) const {
+    result.append(kPersistedPlansHeader);
+    result.append("\n");
+    for (const auto& [hash, prediction] : mPredictions) {
+        if (prediction.getMissCount(Prediction::Type::Exact) != 0) {
+            continue;
+        }
+        base::StringAppendF(&result, "%016zx %s\n", hash, to_string(prediction.getPlan()).c_str());
+    }
+    for (const auto& [hash, plan] : mPersistedPlans) {
+        base::StringAppendF(&result, "%016zx %s\n", hash, to_string(plan).c_str());
+    }
+}
+
+size_t Predictor::loadPlans(const std::string& plans) {
+    std::istringstream stream(plans);
+    std::string line;
+    if (!std::getline(stream, line) || line != kPersistedPlansHeader) {
+        ALOGW("[%s] Ignoring plans in an unknown format", __func__);
+        return 0;
+    }
+
+    size_t loadedCount = 0;
+    while (std::getline(stream, line)) {
+        const size_t separator = line.find(' ');
+        NonBufferHash hash = 0;
+        if (separator == std::string::npos || sscanf(line.c_str(), "%zx", &hash) != 1) {
+            ALOGW("[%s] Skipping malformed line '%s'", __func__, line.c_str());
+            continue;
+        }
+
+        std::optional<Plan> plan = Plan::fromString(line.substr(separator + 1));
+        if (!plan) {
+            ALOGW("[%s] Skipping malformed plan '%s'", __func__, line.c_str());
+            continue;
+        }
+
+        if (hasPrediction(hash)) {
+            continue;
+        }
+
+        mPersistedPlans.insert_or_assign(hash, std::move(*plan));
+        ++loadedCount;
+    }
+    return loadedCount;
+}
+
 void Predictor::compareLayerStacks(NonBufferHash leftHash, NonBufferHash rightHash,
                                    std::string& result) const {
     const auto& [leftPredictionEntry, rightPredictionEntry] =
@@ -308,6 +472,10 @@ Prediction& Predictor::getPrediction(NonBufferHash hash) {
     return const_cast<Prediction&>(const_cast<const Predictor*>(this)->getPrediction(hash));
 }
 
+bool Predictor::hasPrediction(NonBufferHash hash) const {
+    return mPredictions.count(hash) != 0 || getCandidateEntryByHash(hash) != mCandidates.cend();
+}
+
 std::optional<Plan> Predictor::getExactMatch(NonBufferHash hash) const {
     const Prediction* match = nullptr;
     if (const auto predictionEntry = mPredictions.find(hash);
@@ -320,6 +488,11 @@ std::optional<Plan> Predictor::getExactMatch(NonBufferHash hash) const {
     }
 
     if (match == nullptr) {
+        if (const auto persistedEntry = mPersistedPlans.find(hash);
+            persistedEntry != mPersistedPlans.end()) {
+            ALOGV("[%s] Using persisted plan for %zx", __func__, hash);
+            return persistedEntry->second;
+        }
         return std::nullopt;
     }
 
@@ -375,6 +548,32 @@ std::optional<NonBufferHash> Predictor::getApproximateMatch(
     return hash;
 }
 
+std::optional<NonBufferHash> Predictor::getToleratedMatch(
+        const std::vector<const LayerState*>& layers) const {
+    const auto predictionsEntry = mPredictionsByFeatures.find(getLayerFeatureHash(layers));
+    if (predictionsEntry == mPredictionsByFeatures.end()) {
+        return std::nullopt;
+    }
+
+    for (NonBufferHash hash : predictionsEntry->second) {
+        const Prediction& prediction = mPredictions.at(hash);
+        if (prediction.getMissCount(Prediction::Type::Tolerant) != 0) {
+            continue;
+        }
+        if (prediction.getExampleLayerStack().matchesWithinTolerance(layers)) {
+            return hash;
+        }
+    }
+    return std::nullopt;
+}
+
+void Predictor::addPrediction(NonBufferHash hash, Prediction&& prediction) {
+    mSimilarStacks[prediction.getPlan()].push_back(hash);
+    mPredictionsByFeatures[prediction.getExampleLayerStack().getFeatureHash()].push_back(hash);
+    mPersistedPlans.erase(hash);
+    mPredictions.emplace(hash, std::move(prediction));
+}
+
 void Predictor::promoteIfCandidate(NonBufferHash predictionHash) {
     // Return if the candidate has already been promoted
     if (mPredictions.count(predictionHash) != 0) {
@@ -386,8 +585,7 @@ void Predictor::promoteIfCandidate(NonBufferHash predictionHash) {
     auto candidateEntry = getCandidateEntryByHash(predictionHash);
     ALOGE_IF(candidateEntry == mCandidates.end(), "Expected to find candidate");
 
-    mSimilarStacks[candidateEntry->prediction.getPlan()].push_back(predictionHash);
-    mPredictions.emplace(predictionHash, std::move(candidateEntry->prediction));
+    addPrediction(predictionHash, std::move(candidateEntry->prediction));
     mCandidates.erase(candidateEntry);
 }
 
@@ -410,6 +608,9 @@ void Predictor::recordPredictedResult(PredictedPlan predictedPlan,
         case Prediction::Type::Exact:
             ++mExactHitCount;
             break;
+        case Prediction::Type::Tolerant:
+            ++mTolerantHitCount;
+            break;
         default:
             break;
     }
@@ -437,6 +638,34 @@ void Predictor::recordPredictedResult(PredictedPlan predictedPlan,
     promoteIfCandidate(predictedPlan.hash);
 }
 
+void Predictor::recordPersistedResult(NonBufferHash hash,
+                                      const std::vector<const LayerState*>& layers, Plan result) {
+    const auto persistedEntry = mPersistedPlans.find(hash);
+    if (persistedEntry == mPersistedPlans.end()) {
+        ALOGE("[%s] Expected to find persisted plan for %zx", __func__, hash);
+        return;
+    }
+
+    if (persistedEntry->second != result) {
+        ALOGV("[%s] Persisted plan for %zx missed", __func__, hash);
+        mPersistedPlans.erase(persistedEntry);
+        ++mPersistedMissCount;
+        return;
+    }
+
+    ++mExactHitCount;
+    ++mPersistedHitCount;
+
+    // Keep the persisted plan until there is an example layer stack to restore the prediction with
+    if (layers.empty()) {
+        return;
+    }
+
+    Prediction prediction(layers, std::move(result));
+    prediction.recordHit(Prediction::Type::Exact);
+    addPrediction(hash, std::move(prediction));
+}
+
 bool Predictor::findSimilarPrediction(const std::vector<const LayerState*>& layers, Plan result) {
     const auto stacksEntry = mSimilarStacks.find(result);
     if (stacksEntry == mSimilarStacks.end()) {
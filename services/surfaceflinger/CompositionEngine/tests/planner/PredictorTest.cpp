@@ -332,6 +332,89 @@ TEST_F(LayerStackTest, getApproximateMatch_doesNotMatchMultipleApproximations) {
     EXPECT_FALSE(stack.getApproximateMatch({&layerStateTwo, &layerStateTwo}));
 }
 
+TEST_F(LayerStackTest, matchesWithinTolerance_toleratesMovedLayers) {
+    mock::OutputLayer outputLayerOne;
+    sp<mock::LayerFE> layerFEOne = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateOne{
+            .visibleRegion = sRegionOne,
+            .displayFrame = Rect(0, 0, 10, 20),
+    };
+    LayerFECompositionState layerFECompositionStateOne;
+    layerFECompositionStateOne.compositionType = Composition::DEVICE;
+    setupMocksForLayer(outputLayerOne, *layerFEOne, outputLayerCompositionStateOne,
+                       layerFECompositionStateOne);
+    LayerState layerStateOne(&outputLayerOne);
+
+    mock::OutputLayer outputLayerTwo;
+    sp<mock::LayerFE> layerFETwo = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateTwo{
+            .visibleRegion = sRegionTwo,
+            .displayFrame = Rect(30, 40, 40, 60),
+    };
+    LayerFECompositionState layerFECompositionStateTwo;
+    layerFECompositionStateTwo.compositionType = Composition::DEVICE;
+    setupMocksForLayer(outputLayerTwo, *layerFETwo, outputLayerCompositionStateTwo,
+                       layerFECompositionStateTwo);
+    LayerState layerStateTwo(&outputLayerTwo);
+
+    LayerStack stack({&layerStateOne, &layerStateOne});
+    EXPECT_TRUE(stack.matchesWithinTolerance({&layerStateTwo, &layerStateTwo}));
+    EXPECT_EQ(stack.getFeatureHash(), getLayerFeatureHash({&layerStateTwo, &layerStateTwo}));
+    // Two differing layers are too many for an approximate match
+    EXPECT_FALSE(stack.getApproximateMatch({&layerStateTwo, &layerStateTwo}));
+}
+
+TEST_F(LayerStackTest, matchesWithinTolerance_doesNotTolerateResizedLayers) {
+    mock::OutputLayer outputLayerOne;
+    sp<mock::LayerFE> layerFEOne = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateOne{
+            .displayFrame = Rect(0, 0, 10, 20),
+    };
+    LayerFECompositionState layerFECompositionStateOne;
+    layerFECompositionStateOne.compositionType = Composition::DEVICE;
+    setupMocksForLayer(outputLayerOne, *layerFEOne, outputLayerCompositionStateOne,
+                       layerFECompositionStateOne);
+    LayerState layerStateOne(&outputLayerOne);
+
+    mock::OutputLayer outputLayerTwo;
+    sp<mock::LayerFE> layerFETwo = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateTwo{
+            .displayFrame = Rect(0, 0, 20, 20),
+    };
+    LayerFECompositionState layerFECompositionStateTwo;
+    layerFECompositionStateTwo.compositionType = Composition::DEVICE;
+    setupMocksForLayer(outputLayerTwo, *layerFETwo, outputLayerCompositionStateTwo,
+                       layerFECompositionStateTwo);
+    LayerState layerStateTwo(&outputLayerTwo);
+
+    EXPECT_FALSE(LayerStack({&layerStateOne}).matchesWithinTolerance({&layerStateTwo}));
+    EXPECT_FALSE(LayerStack({&layerStateOne}).matchesWithinTolerance({}));
+}
+
+TEST_F(LayerStackTest, matchesWithinTolerance_doesNotTolerateDifferentAlpha) {
+    mock::OutputLayer outputLayerOne;
+    sp<mock::LayerFE> layerFEOne = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateOne;
+    LayerFECompositionState layerFECompositionStateOne;
+    layerFECompositionStateOne.compositionType = Composition::DEVICE;
+    layerFECompositionStateOne.alpha = sAlphaOne;
+    setupMocksForLayer(outputLayerOne, *layerFEOne, outputLayerCompositionStateOne,
+                       layerFECompositionStateOne);
+    LayerState layerStateOne(&outputLayerOne);
+
+    mock::OutputLayer outputLayerTwo;
+    sp<mock::LayerFE> layerFETwo = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateTwo;
+    LayerFECompositionState layerFECompositionStateTwo;
+    layerFECompositionStateTwo.compositionType = Composition::DEVICE;
+    layerFECompositionStateTwo.alpha = sAlphaTwo;
+    setupMocksForLayer(outputLayerTwo, *layerFETwo, outputLayerCompositionStateTwo,
+                       layerFECompositionStateTwo);
+    LayerState layerStateTwo(&outputLayerTwo);
+
+    EXPECT_FALSE(LayerStack({&layerStateOne}).matchesWithinTolerance({&layerStateTwo}));
+}
+
 struct PredictionTest : public testing::Test {
     PredictionTest() {
         const ::testing::TestInfo* const test_info =
@@ -550,5 +633,126 @@ TEST_F(PredictorTest, recordMissedPlan_skipsApproximateMatch) {
     EXPECT_FALSE(predictedPlanTwo);
 }
 
+TEST_F(PredictorTest, getPredictedPlan_retrievesMatchWithinTolerance) {
+    mock::OutputLayer outputLayerOne;
+    sp<mock::LayerFE> layerFEOne = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateOne{
+            .displayFrame = Rect(0, 0, 10, 20),
+    };
+    LayerFECompositionState layerFECompositionStateOne;
+    layerFECompositionStateOne.compositionType = Composition::DEVICE;
+    setupMocksForLayer(outputLayerOne, *layerFEOne, outputLayerCompositionStateOne,
+                       layerFECompositionStateOne);
+    LayerState layerStateOne(&outputLayerOne);
+
+    mock::OutputLayer outputLayerTwo;
+    sp<mock::LayerFE> layerFETwo = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateTwo{
+            .displayFrame = Rect(30, 40, 40, 60),
+    };
+    LayerFECompositionState layerFECompositionStateTwo;
+    layerFECompositionStateTwo.compositionType = Composition::DEVICE;
+    setupMocksForLayer(outputLayerTwo, *layerFETwo, outputLayerCompositionStateTwo,
+                       layerFECompositionStateTwo);
+    LayerState layerStateTwo(&outputLayerTwo);
+
+    Plan plan;
+    plan.addLayerType(Composition::DEVICE);
+    plan.addLayerType(Composition::DEVICE);
+
+    Predictor predictor;
+
+    const std::vector<const LayerState*> layersOne = {&layerStateOne, &layerStateOne};
+    const std::vector<const LayerState*> layersTwo = {&layerStateTwo, &layerStateTwo};
+    NonBufferHash hashOne = getNonBufferHash(layersOne);
+    NonBufferHash hashTwo = getNonBufferHash(layersTwo);
+
+    // Promote the first stack to a prediction by hitting it once
+    predictor.recordResult(std::nullopt, hashOne, layersOne, false, plan);
+    auto predictedPlan = predictor.getPredictedPlan(layersOne, hashOne);
+    ASSERT_TRUE(predictedPlan);
+    predictor.recordResult(predictedPlan, hashOne, layersOne, false, plan);
+
+    predictedPlan = predictor.getPredictedPlan(layersTwo, hashTwo);
+    Predictor::PredictedPlan expectedPlan{hashOne, plan, Prediction::Type::Tolerant};
+    EXPECT_EQ(expectedPlan, predictedPlan);
+
+    // A miss disables tolerant matching for the prediction
+    Plan clientPlan;
+    clientPlan.addLayerType(Composition::CLIENT);
+    clientPlan.addLayerType(Composition::CLIENT);
+    predictor.recordResult(predictedPlan, hashTwo, layersTwo, false, clientPlan);
+    EXPECT_FALSE(predictor.getPredictedPlan(layersTwo, hashTwo));
+}
+
+TEST_F(PredictorTest, savedPlansAreRestoredAsExactMatches) {
+    mock::OutputLayer outputLayerOne;
+    sp<mock::LayerFE> layerFEOne = sp<mock::LayerFE>::make();
+    OutputLayerCompositionState outputLayerCompositionStateOne;
+    LayerFECompositionState layerFECompositionStateOne;
+    layerFECompositionStateOne.compositionType = Composition::DEVICE;
+    setupMocksForLayer(outputLayerOne, *layerFEOne, outputLayerCompositionStateOne,
+                       layerFECompositionStateOne);
+    LayerState layerStateOne(&outputLayerOne);
+
+    Plan plan;
+    plan.addLayerType(Composition::DEVICE);
+
+    const std::vector<const LayerState*> layers = {&layerStateOne};
+    NonBufferHash hash = getNonBufferHash(layers);
+
+    std::string savedPlans;
+    {
+        Predictor predictor;
+        predictor.recordResult(std::nullopt, hash, layers, false, plan);
+        predictor.recordResult(predictor.getPredictedPlan(layers, hash), hash, layers, false,
+                               plan);
+        predictor.savePlans(savedPlans);
+    }
+
+    Predictor predictor;
+    EXPECT_EQ(1u, predictor.loadPlans(savedPlans));
+
+    auto predictedPlan = predictor.getPredictedPlan({}, hash);
+    Predictor::PredictedPlan expectedPlan{hash, plan, Prediction::Type::Exact};
+    EXPECT_EQ(expectedPlan, predictedPlan);
+
+    // Hitting the restored plan turns it back into a prediction with an example stack
+    predictor.recordResult(predictedPlan, hash, layers, false, plan);
+    EXPECT_EQ(expectedPlan, predictor.getPredictedPlan(layers, hash));
+
+    std::string dump;
+    predictor.describeLayerStack(hash, dump);
+    EXPECT_EQ(std::string::npos, dump.find("No predictions found"));
+}
+
+TEST_F(PredictorTest, loadPlans_rejectsUnknownFormat) {
+    Predictor predictor;
+    EXPECT_EQ(0u, predictor.loadPlans("0000000000000001 D\n"));
+    EXPECT_FALSE(predictor.getPredictedPlan({}, 1));
+}
+
+TEST_F(PredictorTest, restoredPlanMissIsDiscarded) {
+    Plan plan;
+    plan.addLayerType(Composition::DEVICE);
+
+    Predictor predictor;
+    std::string savedPlans = "planner-predictions 1\n0000000000000001 D\n";
+    ASSERT_EQ(1u, predictor.loadPlans(savedPlans));
+
+    auto predictedPlan = predictor.getPredictedPlan({}, 1);
+    ASSERT_TRUE(predictedPlan);
+    EXPECT_EQ(plan, predictedPlan->plan);
+
+    Plan clientPlan;
+    clientPlan.addLayerType(Composition::CLIENT);
+    predictor.recordResult(predictedPlan, 1, {}, false, clientPlan);
+
+    predictedPlan = predictor.getPredictedPlan({}, 1);
+    ASSERT_TRUE(predictedPlan);
+    // The miss is recorded as a new candidate with the plan that was actually used
+    EXPECT_EQ(clientPlan, predictedPlan->plan);
+}
+
 } // namespace
 } // namespace android::compositionengine::impl::planner
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace android::frametimeline {
+
+/*
+ * Free list of equally sized memory blocks. The first allocation fixes the block size; requests of
+ * any other size go straight to the global allocator. Used through FramePoolAllocator so that the
+ * SurfaceFrames created for every buffer and transaction recycle the memory of frames that have
+ * aged out of the timeline instead of going back to the heap.
+ */
+class FramePool {
+public:
+    explicit FramePool(size_t maxFreeBlocks) : mMaxFreeBlocks(maxFreeBlocks) {
+        mFreeBlocks.reserve(maxFreeBlocks);
+    }
+
+    ~FramePool() {
+        for (void* block : mFreeBlocks) {
+            ::operator delete(block);
+        }
+    }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    void* allocate(size_t size) {
+        {
+            std::scoped_lock lock(mMutex);
+            if (mBlockSize == 0) {
+                mBlockSize = size;
+            }
+            if (size == mBlockSize && !mFreeBlocks.empty()) {
+                void* block = mFreeBlocks.back();
+                mFreeBlocks.pop_back();
+                mReusedBlocks++;
+                return block;
+            }
+            mAllocatedBlocks++;
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void* block, size_t size) {
+        {
+            std::scoped_lock lock(mMutex);
+            if (size == mBlockSize && mFreeBlocks.size() < mMaxFreeBlocks) {
+                mFreeBlocks.push_back(block);
+                return;
+            }
+        }
+        ::operator delete(block);
+    }
+
+    // Number of allocations that had to go to the heap.
+    size_t getAllocatedBlockCount() const {
+        std::scoped_lock lock(mMutex);
+        return mAllocatedBlocks;
+    }
+
+    // Number of allocations served from the free list.
+    size_t getReusedBlockCount() const {
+        std::scoped_lock lock(mMutex);
+        return mReusedBlocks;
+    }
+
+private:
+    const size_t mMaxFreeBlocks;
+    mutable std::mutex mMutex;
+    size_t mBlockSize GUARDED_BY(mMutex) = 0;
+    std::vector<void*> mFreeBlocks GUARDED_BY(mMutex);
+    size_t mAllocatedBlocks GUARDED_BY(mMutex) = 0;
+    size_t mReusedBlocks GUARDED_BY(mMutex) = 0;
+};
+
+/*
+ * Allocator for std::allocate_shared backed by a FramePool. The allocator is stored in the control
+ * block of every shared_ptr it creates, so the pool outlives the owner that created it for as long
+ * as any of its frames are alive.
+ */
+template <typename T>
+class FramePoolAllocator {
+public:
+    using value_type = T;
+
+    explicit FramePoolAllocator(std::shared_ptr<FramePool> pool) : mPool(std::move(pool)) {}
+
+    template <typename U>
+    FramePoolAllocator(const FramePoolAllocator<U>& other) : mPool(other.mPool) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(mPool->allocate(n * sizeof(T))); }
+
+    void deallocate(T* p, size_t n) { mPool->deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const FramePoolAllocator<U>& other) const {
+        return mPool == other.mPool;
+    }
+
+    template <typename U>
+    bool operator!=(const FramePoolAllocator<U>& other) const {
+        return !(*this == other);
+    }
+
+private:
+    template <typename U>
+    friend class FramePoolAllocator;
+
+    std::shared_ptr<FramePool> mPool;
+};
+
+} // namespace android::frametimeline
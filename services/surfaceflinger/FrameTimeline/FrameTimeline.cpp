@@ -25,6 +25,7 @@
 #include <utils/Log.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cinttypes>
 #include <numeric>
@@ -662,22 +663,48 @@ void SurfaceFrame::classifyJankLocked(int32_t displayFrameJankType, const Fps& r
     }
 }
 
-void SurfaceFrame::onPresent(nsecs_t presentTime, int32_t displayFrameJankType, Fps refreshRate,
-                             Fps displayFrameRenderRate, nsecs_t displayDeadlineDelta,
-                             nsecs_t displayPresentDelta) {
-    std::scoped_lock lock(mMutex);
-
+std::optional<TimeStats::JankyFramesInfo> SurfaceFrame::onPresentLocked(
+        nsecs_t presentTime, int32_t displayFrameJankType, Fps refreshRate,
+        Fps displayFrameRenderRate, nsecs_t displayDeadlineDelta, nsecs_t displayPresentDelta) {
     mDisplayFrameRenderRate = displayFrameRenderRate;
     mActuals.presentTime = presentTime;
     nsecs_t deadlineDelta = 0;
 
     classifyJankLocked(displayFrameJankType, refreshRate, displayFrameRenderRate, deadlineDelta);
 
-    if (mPredictionState != PredictionState::None) {
+    if (mPredictionState == PredictionState::None) {
         // Only update janky frames if the app used vsync predictions
-        mTimeStats->incrementJankyFrames({refreshRate, mRenderRate, mOwnerUid, mLayerName,
-                                          mGameMode, mJankType, displayDeadlineDelta,
-                                          displayPresentDelta, deadlineDelta});
+        return std::nullopt;
+    }
+    return TimeStats::JankyFramesInfo{refreshRate,          mRenderRate,         mOwnerUid,
+                                      mLayerName,           mGameMode,           mJankType,
+                                      displayDeadlineDelta, displayPresentDelta, deadlineDelta};
+}
+
+void SurfaceFrame::onPresent(nsecs_t presentTime, int32_t displayFrameJankType, Fps refreshRate,
+                             Fps displayFrameRenderRate, nsecs_t displayDeadlineDelta,
+                             nsecs_t displayPresentDelta) {
+    std::optional<TimeStats::JankyFramesInfo> jankyFramesInfo;
+    {
+        std::scoped_lock lock(mMutex);
+        jankyFramesInfo = onPresentLocked(presentTime, displayFrameJankType, refreshRate,
+                                          displayFrameRenderRate, displayDeadlineDelta,
+                                          displayPresentDelta);
+    }
+    if (jankyFramesInfo) {
+        mTimeStats->incrementJankyFrames(*jankyFramesInfo);
+    }
+}
+
+void SurfaceFrame::onPresent(nsecs_t presentTime, int32_t displayFrameJankType, Fps refreshRate,
+                             Fps displayFrameRenderRate, nsecs_t displayDeadlineDelta,
+                             nsecs_t displayPresentDelta,
+                             std::vector<TimeStats::JankyFramesInfo>& outJankyFrames) {
+    std::scoped_lock lock(mMutex);
+    if (auto jankyFramesInfo =
+                onPresentLocked(presentTime, displayFrameJankType, refreshRate,
+                                displayFrameRenderRate, displayDeadlineDelta, displayPresentDelta)) {
+        outJankyFrames.push_back(std::move(*jankyFramesInfo));
     }
 }
 
@@ -807,32 +834,42 @@ namespace impl {
 int64_t TokenManager::generateTokenForPredictions(TimelineItem&& predictions) {
     ATRACE_CALL();
     std::scoped_lock lock(mMutex);
-    while (mPredictions.size() >= kMaxTokens) {
-        mPredictions.erase(mPredictions.begin());
-    }
     const int64_t assignedToken = mCurrentToken++;
-    mPredictions[assignedToken] = predictions;
+    mPredictions[static_cast<uint64_t>(assignedToken) % kMaxTokens] = {assignedToken, predictions};
     return assignedToken;
 }
 
 std::optional<TimelineItem> TokenManager::getPredictionsForToken(int64_t token) const {
+    if (token < 0) {
+        return {};
+    }
     std::scoped_lock lock(mMutex);
-    auto predictionsIterator = mPredictions.find(token);
-    if (predictionsIterator != mPredictions.end()) {
-        return predictionsIterator->second;
+    const Prediction& prediction = mPredictions[static_cast<uint64_t>(token) % kMaxTokens];
+    if (prediction.token == token) {
+        return prediction.item;
     }
     return {};
 }
 
+size_t TokenManager::getPredictionCount() const {
+    std::scoped_lock lock(mMutex);
+    return static_cast<size_t>(
+            std::count_if(mPredictions.begin(), mPredictions.end(), [](const Prediction& p) {
+                return p.token != FrameTimelineInfo::INVALID_VSYNC_ID;
+            }));
+}
+
 FrameTimeline::FrameTimeline(std::shared_ptr<TimeStats> timeStats, pid_t surfaceFlingerPid,
                              JankClassificationThresholds thresholds, bool useBootTimeClock)
-      : mUseBootTimeClock(useBootTimeClock),
+      : mSurfaceFramePool(std::make_shared<FramePool>(kMaxPooledSurfaceFrames)),
+        mUseBootTimeClock(useBootTimeClock),
         mMaxDisplayFrames(kDefaultMaxDisplayFrames),
         mTimeStats(std::move(timeStats)),
         mSurfaceFlingerPid(surfaceFlingerPid),
         mJankClassificationThresholds(thresholds) {
-    mCurrentDisplayFrame =
-            std::make_shared<DisplayFrame>(mTimeStats, thresholds, &mTraceCookieCounter);
+    std::scoped_lock lock(mMutex);
+    mDisplayFramePool.reserve(kMaxPooledDisplayFrames);
+    mCurrentDisplayFrame = obtainDisplayFrameLocked();
 }
 
 void FrameTimeline::onBootFinished() {
@@ -852,27 +889,30 @@ std::shared_ptr<SurfaceFrame> FrameTimeline::createSurfaceFrameForToken(
         const FrameTimelineInfo& frameTimelineInfo, pid_t ownerPid, uid_t ownerUid, int32_t layerId,
         std::string layerName, std::string debugName, bool isBuffer, GameMode gameMode) {
     ATRACE_CALL();
+    const FramePoolAllocator<SurfaceFrame> allocator(mSurfaceFramePool);
     if (frameTimelineInfo.vsyncId == FrameTimelineInfo::INVALID_VSYNC_ID) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                              std::move(layerName), std::move(debugName),
-                                              PredictionState::None, TimelineItem(), mTimeStats,
-                                              mJankClassificationThresholds, &mTraceCookieCounter,
-                                              isBuffer, gameMode);
+        return std::allocate_shared<SurfaceFrame>(allocator, frameTimelineInfo, ownerPid, ownerUid,
+                                                  layerId, std::move(layerName),
+                                                  std::move(debugName), PredictionState::None,
+                                                  TimelineItem(), mTimeStats,
+                                                  mJankClassificationThresholds,
+                                                  &mTraceCookieCounter, isBuffer, gameMode);
     }
     std::optional<TimelineItem> predictions =
             mTokenManager.getPredictionsForToken(frameTimelineInfo.vsyncId);
     if (predictions) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                              std::move(layerName), std::move(debugName),
-                                              PredictionState::Valid, std::move(*predictions),
-                                              mTimeStats, mJankClassificationThresholds,
-                                              &mTraceCookieCounter, isBuffer, gameMode);
-    }
-    return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                          std::move(layerName), std::move(debugName),
-                                          PredictionState::Expired, TimelineItem(), mTimeStats,
-                                          mJankClassificationThresholds, &mTraceCookieCounter,
-                                          isBuffer, gameMode);
+        return std::allocate_shared<SurfaceFrame>(allocator, frameTimelineInfo, ownerPid, ownerUid,
+                                                  layerId, std::move(layerName),
+                                                  std::move(debugName), PredictionState::Valid,
+                                                  std::move(*predictions), mTimeStats,
+                                                  mJankClassificationThresholds,
+                                                  &mTraceCookieCounter, isBuffer, gameMode);
+    }
+    return std::allocate_shared<SurfaceFrame>(allocator, frameTimelineInfo, ownerPid, ownerUid,
+                                              layerId, std::move(layerName), std::move(debugName),
+                                              PredictionState::Expired, TimelineItem(), mTimeStats,
+                                              mJankClassificationThresholds, &mTraceCookieCounter,
+                                              isBuffer, gameMode);
 }
 
 FrameTimeline::DisplayFrame::DisplayFrame(std::shared_ptr<TimeStats> timeStats,
@@ -904,12 +944,32 @@ void FrameTimeline::setSfPresent(nsecs_t sfPresentTime,
                                  const std::shared_ptr<FenceTime>& presentFence,
                                  const std::shared_ptr<FenceTime>& gpuFence) {
     ATRACE_CALL();
+    std::vector<TimeStats::JankyFramesInfo> jankyFrames;
+    {
+        std::scoped_lock lock(mMutex);
+        mCurrentDisplayFrame->setActualEndTime(sfPresentTime);
+        mCurrentDisplayFrame->setGpuFence(gpuFence);
+        mPendingPresentFences.emplace_back(std::make_pair(presentFence, mCurrentDisplayFrame));
+        flushPendingPresentFences();
+        finalizeCurrentDisplayFrame();
+        if (mJankyFramesToReport.empty()) {
+            return;
+        }
+        std::swap(jankyFrames, mJankyFramesToReport);
+    }
+
+    // TimeStats has its own lock, so report outside of mMutex to keep binder threads creating and
+    // adding SurfaceFrames from waiting on it.
+    for (const auto& jankyFramesInfo : jankyFrames) {
+        mTimeStats->incrementJankyFrames(jankyFramesInfo);
+    }
+
+    // Hand the buffer back so that the next present does not need to allocate.
+    jankyFrames.clear();
     std::scoped_lock lock(mMutex);
-    mCurrentDisplayFrame->setActualEndTime(sfPresentTime);
-    mCurrentDisplayFrame->setGpuFence(gpuFence);
-    mPendingPresentFences.emplace_back(std::make_pair(presentFence, mCurrentDisplayFrame));
-    flushPendingPresentFences();
-    finalizeCurrentDisplayFrame();
+    if (mJankyFramesToReport.empty()) {
+        std::swap(jankyFrames, mJankyFramesToReport);
+    }
 }
 
 void FrameTimeline::DisplayFrame::addSurfaceFrame(std::shared_ptr<SurfaceFrame> surfaceFrame) {
@@ -1082,7 +1142,9 @@ void FrameTimeline::DisplayFrame::classifyJank(nsecs_t& deadlineDelta, nsecs_t&
     }
 }
 
-void FrameTimeline::DisplayFrame::onPresent(nsecs_t signalTime, nsecs_t previousPresentTime) {
+void FrameTimeline::DisplayFrame::onPresent(
+        nsecs_t signalTime, nsecs_t previousPresentTime,
+        std::vector<TimeStats::JankyFramesInfo>& outJankyFrames) {
     mSurfaceFlingerActuals.presentTime = signalTime;
     nsecs_t deadlineDelta = 0;
     nsecs_t deltaToVsync = 0;
@@ -1090,10 +1152,26 @@ void FrameTimeline::DisplayFrame::onPresent(nsecs_t signalTime, nsecs_t previous
 
     for (auto& surfaceFrame : mSurfaceFrames) {
         surfaceFrame->onPresent(signalTime, mJankType, mRefreshRate, mRenderRate, deadlineDelta,
-                                deltaToVsync);
+                                deltaToVsync, outJankyFrames);
     }
 }
 
+void FrameTimeline::DisplayFrame::recycle() {
+    mToken = FrameTimelineInfo::INVALID_VSYNC_ID;
+    mSurfaceFlingerPredictions = TimelineItem();
+    mSurfaceFlingerActuals = TimelineItem();
+    mSurfaceFrames.clear();
+    mPredictionState = PredictionState::None;
+    mJankType = JankType::None;
+    mJankSeverityType = JankSeverityType::None;
+    mGpuFence = FenceTime::NO_FENCE;
+    mFramePresentMetadata = FramePresentMetadata::UnknownPresent;
+    mFrameReadyMetadata = FrameReadyMetadata::UnknownFinish;
+    mFrameStartMetadata = FrameStartMetadata::UnknownStart;
+    mRefreshRate = Fps();
+    mRenderRate = Fps();
+}
+
 void FrameTimeline::DisplayFrame::tracePredictions(pid_t surfaceFlingerPid,
                                                    nsecs_t monoBootOffset) const {
     int64_t expectedTimelineCookie = mTraceCookieCounter.getCookieForTracing();
@@ -1353,7 +1431,7 @@ void FrameTimeline::flushPendingPresentFences() {
         const auto& pendingPresentFence = *mPendingPresentFences.begin();
         const nsecs_t signalTime = Fence::SIGNAL_TIME_INVALID;
         auto& displayFrame = pendingPresentFence.second;
-        displayFrame->onPresent(signalTime, mPreviousActualPresentTime);
+        displayFrame->onPresent(signalTime, mPreviousActualPresentTime, mJankyFramesToReport);
         mPreviousPredictionPresentTime = displayFrame->trace(mSurfaceFlingerPid, monoBootOffset,
                                                              mPreviousPredictionPresentTime);
         mPendingPresentFences.erase(mPendingPresentFences.begin());
@@ -1370,7 +1448,7 @@ void FrameTimeline::flushPendingPresentFences() {
         }
 
         auto& displayFrame = pendingPresentFence.second;
-        displayFrame->onPresent(signalTime, mPreviousActualPresentTime);
+        displayFrame->onPresent(signalTime, mPreviousActualPresentTime, mJankyFramesToReport);
         mPreviousPredictionPresentTime = displayFrame->trace(mSurfaceFlingerPid, monoBootOffset,
                                                              mPreviousPredictionPresentTime);
         mPreviousActualPresentTime = signalTime;
@@ -1383,12 +1461,35 @@ void FrameTimeline::flushPendingPresentFences() {
 void FrameTimeline::finalizeCurrentDisplayFrame() {
     while (mDisplayFrames.size() >= mMaxDisplayFrames) {
         // We maintain only a fixed number of frames' data. Pop older frames
+        recycleDisplayFrameLocked(std::move(mDisplayFrames.front()));
         mDisplayFrames.pop_front();
     }
-    mDisplayFrames.push_back(mCurrentDisplayFrame);
-    mCurrentDisplayFrame.reset();
-    mCurrentDisplayFrame = std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
-                                                          &mTraceCookieCounter);
+    mDisplayFrames.push_back(std::move(mCurrentDisplayFrame));
+    mCurrentDisplayFrame = obtainDisplayFrameLocked();
+}
+
+std::shared_ptr<FrameTimeline::DisplayFrame> FrameTimeline::obtainDisplayFrameLocked() {
+    if (mDisplayFramePool.empty()) {
+        return std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
+                                              &mTraceCookieCounter);
+    }
+    std::shared_ptr<DisplayFrame> displayFrame = std::move(mDisplayFramePool.back());
+    mDisplayFramePool.pop_back();
+    return displayFrame;
+}
+
+void FrameTimeline::recycleDisplayFrameLocked(std::shared_ptr<DisplayFrame>&& displayFrame) {
+    // recycle() clears the DisplayFrame in place, so it can only be reused when this is the last
+    // reference to it. One whose present fence has not signaled yet is still referenced from
+    // mPendingPresentFences.
+    if (displayFrame.use_count() != 1 || mDisplayFramePool.size() >= kMaxPooledDisplayFrames) {
+        displayFrame.reset();
+        return;
+    }
+    // Releases the SurfaceFrames, whose memory goes back to mSurfaceFramePool if nothing else
+    // holds them.
+    displayFrame->recycle();
+    mDisplayFramePool.push_back(std::move(displayFrame));
 }
 
 nsecs_t FrameTimeline::DisplayFrame::getBaseTime() const {
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <deque>
@@ -38,6 +39,7 @@
 #include <scheduler/Fps.h>
 
 #include "../TimeStats/TimeStats.h"
+#include "FramePool.h"
 
 namespace android::frametimeline {
 
@@ -204,6 +206,12 @@ public:
     void onPresent(nsecs_t presentTime, int32_t displayFrameJankType, Fps refreshRate,
                    Fps displayFrameRenderRate, nsecs_t displayDeadlineDelta,
                    nsecs_t displayPresentDelta);
+    // Same as above, but instead of reporting the jank to TimeStats, appends it to outJankyFrames
+    // so that FrameTimeline can report it after releasing its lock.
+    void onPresent(nsecs_t presentTime, int32_t displayFrameJankType, Fps refreshRate,
+                   Fps displayFrameRenderRate, nsecs_t displayDeadlineDelta,
+                   nsecs_t displayPresentDelta,
+                   std::vector<TimeStats::JankyFramesInfo>& outJankyFrames);
     // All the timestamps are dumped relative to the baseTime
     void dump(std::string& result, const std::string& indent, nsecs_t baseTime) const;
     // Dumps only the layer, token, is buffer, jank metadata, prediction and present states.
@@ -236,6 +244,12 @@ private:
     void traceActuals(int64_t displayFrameToken, nsecs_t monoBootOffset) const;
     void classifyJankLocked(int32_t displayFrameJankType, const Fps& refreshRate,
                             Fps displayFrameRenderRate, nsecs_t& deadlineDelta) REQUIRES(mMutex);
+    // Classifies the jank for the present and returns what should be reported to TimeStats, if
+    // anything.
+    std::optional<TimeStats::JankyFramesInfo> onPresentLocked(
+            nsecs_t presentTime, int32_t displayFrameJankType, Fps refreshRate,
+            Fps displayFrameRenderRate, nsecs_t displayDeadlineDelta, nsecs_t displayPresentDelta)
+            REQUIRES(mMutex);
 
     const int64_t mToken;
     const int32_t mInputEventId;
@@ -352,10 +366,22 @@ private:
 
     void flushTokens(nsecs_t flushTime) REQUIRES(mMutex);
 
-    std::map<int64_t, TimelineItem> mPredictions GUARDED_BY(mMutex);
+    static constexpr size_t kMaxTokens = 500;
+
+    struct Prediction {
+        int64_t token = FrameTimelineInfo::INVALID_VSYNC_ID;
+        TimelineItem item;
+    };
+
+    // Number of slots in mPredictions that hold a prediction that has not been flushed.
+    size_t getPredictionCount() const;
+
+    // Ring of the last kMaxTokens predictions, indexed by token. Tokens are handed out
+    // sequentially, so a new token overwrites the slot of the token kMaxTokens before it, which
+    // is exactly the one that would have been evicted as the oldest.
+    std::array<Prediction, kMaxTokens> mPredictions GUARDED_BY(mMutex);
     int64_t mCurrentToken GUARDED_BY(mMutex);
     mutable std::mutex mMutex;
-    static constexpr size_t kMaxTokens = 500;
 };
 
 class FrameTimeline : public android::frametimeline::FrameTimeline {
@@ -388,8 +414,13 @@ public:
         // Sets the token, vsyncPeriod, predictions and SF start time.
         void onSfWakeUp(int64_t token, Fps refreshRate, Fps renderRate,
                         std::optional<TimelineItem> predictions, nsecs_t wakeUpTime);
-        // Sets the appropriate metadata and classifies the jank.
-        void onPresent(nsecs_t signalTime, nsecs_t previousPresentTime);
+        // Sets the appropriate metadata and classifies the jank. Jank of the SurfaceFrames that
+        // needs to be reported to TimeStats is appended to outJankyFrames.
+        void onPresent(nsecs_t signalTime, nsecs_t previousPresentTime,
+                       std::vector<TimeStats::JankyFramesInfo>& outJankyFrames);
+        // Returns the DisplayFrame to its initial state so that it can be reused for a new frame.
+        // Keeps the capacity reserved for SurfaceFrames.
+        void recycle();
         // Adds the provided SurfaceFrame to the current display frame.
         void addSurfaceFrame(std::shared_ptr<SurfaceFrame> surfaceFrame);
 
@@ -495,6 +526,11 @@ private:
     void flushPendingPresentFences() REQUIRES(mMutex);
     std::optional<size_t> getFirstSignalFenceIndex() const REQUIRES(mMutex);
     void finalizeCurrentDisplayFrame() REQUIRES(mMutex);
+    // Returns a recycled DisplayFrame if one is available, otherwise allocates a new one.
+    std::shared_ptr<DisplayFrame> obtainDisplayFrameLocked() REQUIRES(mMutex);
+    // Hands a DisplayFrame that has aged out of the timeline back to the pool, unless it is still
+    // referenced elsewhere.
+    void recycleDisplayFrameLocked(std::shared_ptr<DisplayFrame>&& displayFrame) REQUIRES(mMutex);
     void dumpAll(std::string& result);
     void dumpJank(std::string& result);
 
@@ -503,6 +539,12 @@ private:
     std::vector<std::pair<std::shared_ptr<FenceTime>, std::shared_ptr<DisplayFrame>>>
             mPendingPresentFences GUARDED_BY(mMutex);
     std::shared_ptr<DisplayFrame> mCurrentDisplayFrame GUARDED_BY(mMutex);
+    // DisplayFrames that aged out of mDisplayFrames, ready to be reused.
+    std::vector<std::shared_ptr<DisplayFrame>> mDisplayFramePool GUARDED_BY(mMutex);
+    // Jank classified while flushing present fences, reported to TimeStats once mMutex is released.
+    std::vector<TimeStats::JankyFramesInfo> mJankyFramesToReport GUARDED_BY(mMutex);
+    // Backing memory for SurfaceFrames. Shared with every SurfaceFrame's control block.
+    const std::shared_ptr<FramePool> mSurfaceFramePool;
     TokenManager mTokenManager;
     TraceCookieCounter mTraceCookieCounter;
     mutable std::mutex mMutex;
@@ -519,6 +561,12 @@ private:
     // display frame, this is a good starting size for the vector so that we can avoid the
     // internal vector resizing that happens with push_back.
     static constexpr uint32_t kNumSurfaceFramesInitial = 10;
+    // Upper bound on the number of idle DisplayFrames kept around for reuse. In steady state one
+    // DisplayFrame ages out for every one that is created.
+    static constexpr size_t kMaxPooledDisplayFrames = 4;
+    // Upper bound on the number of idle SurfaceFrame blocks kept around for reuse. Covers the
+    // SurfaceFrames of the retained display frames with room for bursts.
+    static constexpr size_t kMaxPooledSurfaceFrames = 512;
 };
 
 } // namespace impl
@@ -16,6 +16,7 @@
 
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <algorithm>
 #include <vector>
 
 #include <android-base/stringprintf.h>
@@ -276,11 +277,13 @@ void VSyncDispatchTimerQueueEntry::dump(std::string& result) const {
 
 VSyncDispatchTimerQueue::VSyncDispatchTimerQueue(std::unique_ptr<TimeKeeper> tk,
                                                  VsyncSchedule::TrackerPtr tracker,
-                                                 nsecs_t timerSlack, nsecs_t minVsyncDistance)
+                                                 nsecs_t timerSlack, nsecs_t minVsyncDistance,
+                                                 QueueMode queueMode)
       : mTimeKeeper(std::move(tk)),
         mTracker(std::move(tracker)),
         mTimerSlack(timerSlack),
-        mMinVsyncDistance(minVsyncDistance) {}
+        mMinVsyncDistance(minVsyncDistance),
+        mQueueMode(queueMode) {}
 
 VSyncDispatchTimerQueue::~VSyncDispatchTimerQueue() {
     std::lock_guard lock(mMutex);
@@ -310,6 +313,14 @@ void VSyncDispatchTimerQueue::rearmTimer(nsecs_t now) {
 
 void VSyncDispatchTimerQueue::rearmTimerSkippingUpdateFor(
         nsecs_t now, CallbackMap::const_iterator skipUpdateIt) {
+    if (mQueueMode == QueueMode::WakeupOrdered) {
+        rearmTimerFromWakeupQueue(now,
+                                  skipUpdateIt != mCallbacks.cend()
+                                          ? std::make_optional(skipUpdateIt->first)
+                                          : std::nullopt);
+        return;
+    }
+
     ATRACE_CALL();
     std::optional<nsecs_t> min;
     std::optional<nsecs_t> targetVsync;
@@ -342,6 +353,91 @@ void VSyncDispatchTimerQueue::rearmTimerSkippingUpdateFor(
     }
 }
 
+void VSyncDispatchTimerQueue::rearmTimerFromWakeupQueue(nsecs_t now,
+                                                        std::optional<CallbackToken> skipUpdate) {
+    ATRACE_CALL();
+    const auto refresh = [&](CallbackToken token) REQUIRES(mMutex) {
+        const auto it = mCallbacks.find(token);
+        if (it == mCallbacks.end()) {
+            return;
+        }
+        auto& callback = it->second;
+        callback->update(*mTracker, now);
+        traceEntry(*callback, now);
+        enqueueWakeupLocked(token, *callback);
+    };
+
+    // Workload updates may arm a callback that is not queued yet, e.g. one that has just run.
+    for (auto it = mPendingWorkloadUpdates.begin(); it != mPendingWorkloadUpdates.end();) {
+        if (*it == skipUpdate) {
+            ++it;
+            continue;
+        }
+        refresh(*it);
+        it = mPendingWorkloadUpdates.erase(it);
+    }
+
+    // Refresh the callbacks that the next wakeup would dispatch. If that moves them later, the new
+    // front of the queue has not been refreshed yet, so repeat until it has. Each pass refreshes
+    // at least one more callback, so this terminates.
+    mRefreshedTokens.clear();
+    while (!mWakeupQueue.empty()) {
+        const nsecs_t batchEnd = mWakeupQueue.begin()->first + mTimerSlack;
+        mRefreshBatch.clear();
+        for (auto it = mWakeupQueue.begin(); it != mWakeupQueue.end() && it->first <= batchEnd;
+             ++it) {
+            if (std::find(mRefreshedTokens.begin(), mRefreshedTokens.end(), it->second) ==
+                mRefreshedTokens.end()) {
+                mRefreshBatch.push_back(it->second);
+            }
+        }
+        if (mRefreshBatch.empty()) {
+            break;
+        }
+
+        for (const size_t key : mRefreshBatch) {
+            mRefreshedTokens.push_back(key);
+            const CallbackToken token(key);
+            if (token != skipUpdate) {
+                refresh(token);
+            }
+        }
+    }
+
+    if (!mWakeupQueue.empty() && mWakeupQueue.begin()->first < mIntendedWakeupTime) {
+        setTimer(mWakeupQueue.begin()->first, now);
+    } else {
+        ATRACE_NAME("cancel timer");
+        cancelTimer();
+    }
+}
+
+void VSyncDispatchTimerQueue::enqueueWakeupLocked(CallbackToken token,
+                                                  const VSyncDispatchTimerQueueEntry& entry) {
+    if (mQueueMode != QueueMode::WakeupOrdered) {
+        return;
+    }
+
+    dequeueWakeupLocked(token);
+    if (const auto wakeupTime = entry.wakeupTime()) {
+        const size_t key = ftl::to_underlying(token);
+        mWakeupQueue.emplace(*wakeupTime, key);
+        mQueuedWakeupTimes.emplace(key, *wakeupTime);
+    }
+}
+
+void VSyncDispatchTimerQueue::dequeueWakeupLocked(CallbackToken token) {
+    if (mQueueMode != QueueMode::WakeupOrdered) {
+        return;
+    }
+
+    const size_t key = ftl::to_underlying(token);
+    if (const auto it = mQueuedWakeupTimes.find(key); it != mQueuedWakeupTimes.end()) {
+        mWakeupQueue.erase({it->second, key});
+        mQueuedWakeupTimes.erase(it);
+    }
+}
+
 void VSyncDispatchTimerQueue::timerCallback() {
     ATRACE_CALL();
     struct Invocation {
@@ -359,21 +455,42 @@ void VSyncDispatchTimerQueue::timerCallback() {
         }
         auto const now = mTimeKeeper->now();
         mLastTimerCallback = now;
-        for (auto it = mCallbacks.begin(); it != mCallbacks.end(); it++) {
-            auto& callback = it->second;
-            auto const wakeupTime = callback->wakeupTime();
-            if (!wakeupTime) {
-                continue;
-            }
-
-            traceEntry(*callback, now);
-
-            auto const readyTime = callback->readyTime();
-            auto const lagAllowance = std::max(now - mIntendedWakeupTime, static_cast<nsecs_t>(0));
-            if (*wakeupTime < mIntendedWakeupTime + mTimerSlack + lagAllowance) {
+        auto const lagAllowance = std::max(now - mIntendedWakeupTime, static_cast<nsecs_t>(0));
+        auto const dispatchBefore = mIntendedWakeupTime + mTimerSlack + lagAllowance;
+        if (mQueueMode == QueueMode::WakeupOrdered) {
+            // Every callback due in this wakeup is at the front of the queue.
+            while (!mWakeupQueue.empty() && mWakeupQueue.begin()->first < dispatchBefore) {
+                const auto [wakeupTime, key] = *mWakeupQueue.begin();
+                mWakeupQueue.erase(mWakeupQueue.begin());
+                mQueuedWakeupTimes.erase(key);
+
+                const auto it = mCallbacks.find(CallbackToken(key));
+                LOG_ALWAYS_FATAL_IF(it == mCallbacks.end(), "Queued wakeup for unknown callback");
+                auto& callback = it->second;
+                traceEntry(*callback, now);
+
+                auto const readyTime = callback->readyTime();
                 callback->executing();
                 invocations.emplace_back(Invocation{callback, *callback->lastExecutedVsyncTarget(),
-                                                    *wakeupTime, *readyTime});
+                                                    wakeupTime, *readyTime});
+            }
+        } else {
+            for (auto it = mCallbacks.begin(); it != mCallbacks.end(); it++) {
+                auto& callback = it->second;
+                auto const wakeupTime = callback->wakeupTime();
+                if (!wakeupTime) {
+                    continue;
+                }
+
+                traceEntry(*callback, now);
+
+                auto const readyTime = callback->readyTime();
+                if (*wakeupTime < dispatchBefore) {
+                    callback->executing();
+                    invocations.emplace_back(Invocation{callback,
+                                                        *callback->lastExecutedVsyncTarget(),
+                                                        *wakeupTime, *readyTime});
+                }
             }
         }
 
@@ -407,6 +524,7 @@ void VSyncDispatchTimerQueue::unregisterCallback(CallbackToken token) {
         auto it = mCallbacks.find(token);
         if (it != mCallbacks.end()) {
             entry = it->second;
+            dequeueWakeupLocked(token);
             mCallbacks.erase(it->first);
         }
     }
@@ -435,10 +553,16 @@ std::optional<ScheduleResult> VSyncDispatchTimerQueue::scheduleLocked(
      * timer recalculation to avoid cancelling a callback that is about to fire. */
     auto const rearmImminent = now > mIntendedWakeupTime;
     if (CC_UNLIKELY(rearmImminent)) {
+        if (mQueueMode == QueueMode::WakeupOrdered &&
+            std::find(mPendingWorkloadUpdates.begin(), mPendingWorkloadUpdates.end(), token) ==
+                    mPendingWorkloadUpdates.end()) {
+            mPendingWorkloadUpdates.push_back(token);
+        }
         return callback->addPendingWorkloadUpdate(*mTracker, now, scheduleTiming);
     }
 
     const auto result = callback->schedule(scheduleTiming, *mTracker, now);
+    enqueueWakeupLocked(token, *callback);
 
     if (callback->wakeupTime() < mIntendedWakeupTime - mTimerSlack) {
         rearmTimerSkippingUpdateFor(now, it);
@@ -475,6 +599,7 @@ CancelResult VSyncDispatchTimerQueue::cancel(CallbackToken token) {
     auto const wakeupTime = callback->wakeupTime();
     if (wakeupTime) {
         callback->disarm();
+        dequeueWakeupLocked(token);
 
         if (*wakeupTime == mIntendedWakeupTime) {
             mIntendedWakeupTime = kInvalidTime;
@@ -491,6 +616,8 @@ void VSyncDispatchTimerQueue::dump(std::string& result) const {
     mTimeKeeper->dump(result);
     StringAppendF(&result, "\tmTimerSlack: %.2fms mMinVsyncDistance: %.2fms\n", mTimerSlack / 1e6f,
                   mMinVsyncDistance / 1e6f);
+    StringAppendF(&result, "\tmQueueMode: %s\n",
+                  mQueueMode == QueueMode::WakeupOrdered ? "WakeupOrdered" : "Linear");
     StringAppendF(&result, "\tmIntendedWakeupTime: %.2fms from now\n",
                   (mIntendedWakeupTime - mTimeKeeper->now()) / 1e6f);
     StringAppendF(&result, "\tmLastTimerCallback: %.2fms ago mLastTimerSchedule: %.2fms ago\n",
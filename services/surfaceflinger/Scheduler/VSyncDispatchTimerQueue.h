@@ -18,8 +18,12 @@
 
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <android-base/thread_annotations.h>
 #include <ftl/small_map.h>
@@ -116,6 +120,18 @@ private:
  */
 class VSyncDispatchTimerQueue : public VSyncDispatch {
 public:
+    // How armed callbacks are tracked between wakeups.
+    enum class QueueMode {
+        // Every rearm refreshes all armed callbacks against the latest vsync model and scans them
+        // for the earliest wakeup. Cheap for the handful of callbacks SurfaceFlinger registers.
+        Linear,
+        // Armed callbacks are kept ordered by wakeup time, so schedule and cancel are O(log n) and
+        // a wakeup only visits the callbacks it dispatches. Only the callbacks at the front of the
+        // queue are refreshed against the vsync model on rearm; the others are refreshed once they
+        // reach the front. Suited to large numbers of callbacks, e.g. one per app.
+        WakeupOrdered,
+    };
+
     // Constructs a VSyncDispatchTimerQueue.
     // \param[in] tk                    A timekeeper.
     // \param[in] tracker               A tracker.
@@ -123,8 +139,10 @@ public:
     //                                  should be grouped into one wakeup.
     // \param[in] minVsyncDistance      The minimum distance between two vsync estimates before the
     //                                  vsyncs are considered the same vsync event.
+    // \param[in] queueMode             How armed callbacks are tracked. See QueueMode.
     VSyncDispatchTimerQueue(std::unique_ptr<TimeKeeper>, VsyncSchedule::TrackerPtr,
-                            nsecs_t timerSlack, nsecs_t minVsyncDistance);
+                            nsecs_t timerSlack, nsecs_t minVsyncDistance,
+                            QueueMode queueMode = QueueMode::Linear);
     ~VSyncDispatchTimerQueue();
 
     CallbackToken registerCallback(Callback, std::string callbackName) final;
@@ -150,6 +168,14 @@ private:
     void cancelTimer() REQUIRES(mMutex);
     std::optional<ScheduleResult> scheduleLocked(CallbackToken, ScheduleTiming) REQUIRES(mMutex);
 
+    // QueueMode::WakeupOrdered bookkeeping. The queued wakeup time of a callback always matches
+    // VSyncDispatchTimerQueueEntry::wakeupTime(), so these are called whenever an entry is
+    // scheduled, updated, disarmed or executed.
+    void rearmTimerFromWakeupQueue(nsecs_t now, std::optional<CallbackToken> skipUpdate)
+            REQUIRES(mMutex);
+    void enqueueWakeupLocked(CallbackToken, const VSyncDispatchTimerQueueEntry&) REQUIRES(mMutex);
+    void dequeueWakeupLocked(CallbackToken) REQUIRES(mMutex);
+
     std::mutex mutable mMutex;
 
     // During VSyncDispatchTimerQueue deconstruction, skip timerCallback to
@@ -161,12 +187,23 @@ private:
     VsyncSchedule::TrackerPtr mTracker;
     nsecs_t const mTimerSlack;
     nsecs_t const mMinVsyncDistance;
+    QueueMode const mQueueMode;
 
     CallbackToken mCallbackToken GUARDED_BY(mMutex);
 
     CallbackMap mCallbacks GUARDED_BY(mMutex);
     nsecs_t mIntendedWakeupTime GUARDED_BY(mMutex) = kInvalidTime;
 
+    // Armed callbacks ordered by wakeup time, keyed by the underlying token value. Only used in
+    // QueueMode::WakeupOrdered.
+    std::set<std::pair<nsecs_t, size_t>> mWakeupQueue GUARDED_BY(mMutex);
+    std::unordered_map<size_t, nsecs_t> mQueuedWakeupTimes GUARDED_BY(mMutex);
+    // Callbacks with a workload update to apply on the next rearm.
+    std::vector<CallbackToken> mPendingWorkloadUpdates GUARDED_BY(mMutex);
+    // Scratch space for rearmTimerFromWakeupQueue, kept to avoid allocating on every rearm.
+    std::vector<size_t> mRefreshBatch GUARDED_BY(mMutex);
+    std::vector<size_t> mRefreshedTokens GUARDED_BY(mMutex);
+
     // For debugging purposes
     nsecs_t mLastTimerCallback GUARDED_BY(mMutex) = kInvalidTime;
     nsecs_t mLastTimerSchedule GUARDED_BY(mMutex) = kInvalidTime;
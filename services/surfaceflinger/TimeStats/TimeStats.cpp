@@ -146,6 +146,7 @@ bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
 
 bool TimeStats::populateLayerAtom(std::vector<uint8_t>* pulledData) {
     std::lock_guard<std::mutex> lock(mMutex);
+    aggregateCompletedFramesLocked();
 
     std::vector<TimeStatsHelper::TimeStatsLayer*> dumpStats;
     uint32_t numLayers = 0;
@@ -308,8 +309,9 @@ std::string TimeStats::miniDump() {
 
     std::string result = "TimeStats miniDump:\n";
     std::lock_guard<std::mutex> lock(mMutex);
+    aggregateCompletedFramesLocked();
     android::base::StringAppendF(&result, "Number of layers currently being tracked is %zu\n",
-                                 mTimeStatsTracker.size());
+                                 mNumTrackedLayers.load());
     android::base::StringAppendF(&result, "Number of layers in the stats pool is %zu\n",
                                  mTimeStats.stats.size());
     return result;
@@ -441,103 +443,177 @@ static int32_t clampToNearestBucket(Fps fps, size_t bucketWidth) {
     return std::round(fps.getValue() / bucketWidth) * bucketWidth;
 }
 
-void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayRefreshRate,
+bool TimeStats::flushAvailableRecordsToShardLocked(LayerShard& shard, int32_t layerId,
+                                                   Fps displayRefreshRate,
                                                    std::optional<Fps> renderRate,
                                                    SetFrameRateVote frameRateVote,
                                                    GameMode gameMode) {
     ATRACE_CALL();
-    ALOGV("[%d]-flushAvailableRecordsToStatsLocked", layerId);
+    ALOGV("[%d]-flushAvailableRecordsToShardLocked", layerId);
 
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    TimeRecord& prevTimeRecord = layerRecord.prevTimeRecord;
-    std::optional<int32_t>& prevPresentToPresentMs = layerRecord.prevPresentToPresentMs;
-    std::deque<TimeRecord>& timeRecords = layerRecord.timeRecords;
+    LayerRecord* layerRecord = findLayerRecordLocked(shard, layerId);
+    if (!layerRecord) return false;
+    TimeRecord& prevTimeRecord = layerRecord->prevTimeRecord;
+    std::optional<int32_t>& prevPresentToPresentMs = layerRecord->prevPresentToPresentMs;
+    std::deque<TimeRecord>& timeRecords = layerRecord->timeRecords;
     const int32_t refreshRateBucket =
             clampToNearestBucket(displayRefreshRate, REFRESH_RATE_BUCKET_WIDTH);
     const int32_t renderRateBucket =
             clampToNearestBucket(renderRate ? *renderRate : displayRefreshRate,
                                  RENDER_RATE_BUCKET_WIDTH);
+    const TimeStatsHelper::TimelineStatsKey timelineKey = {refreshRateBucket, renderRateBucket};
+    bool hasNewStatsKey = false;
     while (!timeRecords.empty()) {
         if (!recordReadyLocked(layerId, &timeRecords[0])) break;
         ALOGV("[%d]-[%" PRIu64 "]-presentFenceTime[%" PRId64 "]", layerId,
               timeRecords[0].frameTime.frameNumber, timeRecords[0].frameTime.presentTime);
 
         if (prevTimeRecord.ready) {
-            uid_t uid = layerRecord.uid;
-            const std::string& layerName = layerRecord.layerName;
-            TimeStatsHelper::TimelineStatsKey timelineKey = {refreshRateBucket, renderRateBucket};
-            if (!mTimeStats.stats.count(timelineKey)) {
-                mTimeStats.stats[timelineKey].key = timelineKey;
+            const FrameTime& frameTime = timeRecords[0].frameTime;
+            CompletedFrame& frame = shard.completedFrames.emplace_back();
+            frame.uid = layerRecord->uid;
+            frame.layerName = layerRecord->layerName;
+            frame.gameMode = gameMode;
+            frame.refreshRateBucket = refreshRateBucket;
+            frame.renderRateBucket = renderRateBucket;
+            frame.frameRateVote = frameRateVote;
+            frame.droppedFrames = layerRecord->droppedFrames;
+            frame.lateAcquireFrames = layerRecord->lateAcquireFrames;
+            frame.badDesiredPresentFrames = layerRecord->badDesiredPresentFrames;
+
+            if (!layerRecord->lastTimelineKey || !(*layerRecord->lastTimelineKey == timelineKey) ||
+                layerRecord->lastGameMode != gameMode) {
+                layerRecord->lastTimelineKey = timelineKey;
+                layerRecord->lastGameMode = gameMode;
+                hasNewStatsKey = true;
             }
 
-            TimeStatsHelper::TimelineStats& displayStats = mTimeStats.stats[timelineKey];
+            layerRecord->droppedFrames = 0;
+            layerRecord->lateAcquireFrames = 0;
+            layerRecord->badDesiredPresentFrames = 0;
 
-            TimeStatsHelper::LayerStatsKey layerKey = {uid, layerName, gameMode};
-            if (!displayStats.stats.count(layerKey)) {
-                displayStats.stats[layerKey].displayRefreshRateBucket = refreshRateBucket;
-                displayStats.stats[layerKey].renderRateBucket = renderRateBucket;
-                displayStats.stats[layerKey].uid = uid;
-                displayStats.stats[layerKey].layerName = layerName;
-                displayStats.stats[layerKey].gameMode = gameMode;
-            }
-            if (frameRateVote.frameRate > 0.0f) {
-                displayStats.stats[layerKey].setFrameRateVote = frameRateVote;
-            }
-            TimeStatsHelper::TimeStatsLayer& timeStatsLayer = displayStats.stats[layerKey];
-            timeStatsLayer.totalFrames++;
-            timeStatsLayer.droppedFrames += layerRecord.droppedFrames;
-            timeStatsLayer.lateAcquireFrames += layerRecord.lateAcquireFrames;
-            timeStatsLayer.badDesiredPresentFrames += layerRecord.badDesiredPresentFrames;
-
-            layerRecord.droppedFrames = 0;
-            layerRecord.lateAcquireFrames = 0;
-            layerRecord.badDesiredPresentFrames = 0;
-
-            const int32_t postToAcquireMs = msBetween(timeRecords[0].frameTime.postTime,
-                                                      timeRecords[0].frameTime.acquireTime);
-            ALOGV("[%d]-[%" PRIu64 "]-post2acquire[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, postToAcquireMs);
-            timeStatsLayer.deltas["post2acquire"].insert(postToAcquireMs);
-
-            const int32_t postToPresentMs = msBetween(timeRecords[0].frameTime.postTime,
-                                                      timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-post2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, postToPresentMs);
-            timeStatsLayer.deltas["post2present"].insert(postToPresentMs);
-
-            const int32_t acquireToPresentMs = msBetween(timeRecords[0].frameTime.acquireTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-acquire2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, acquireToPresentMs);
-            timeStatsLayer.deltas["acquire2present"].insert(acquireToPresentMs);
-
-            const int32_t latchToPresentMs = msBetween(timeRecords[0].frameTime.latchTime,
-                                                       timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-latch2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, latchToPresentMs);
-            timeStatsLayer.deltas["latch2present"].insert(latchToPresentMs);
-
-            const int32_t desiredToPresentMs = msBetween(timeRecords[0].frameTime.desiredTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-desired2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, desiredToPresentMs);
-            timeStatsLayer.deltas["desired2present"].insert(desiredToPresentMs);
-
-            const int32_t presentToPresentMs = msBetween(prevTimeRecord.frameTime.presentTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-present2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, presentToPresentMs);
-            timeStatsLayer.deltas["present2present"].insert(presentToPresentMs);
+            frame.postToAcquireMs = msBetween(frameTime.postTime, frameTime.acquireTime);
+            ALOGV("[%d]-[%" PRIu64 "]-post2acquire[%d]", layerId, frameTime.frameNumber,
+                  frame.postToAcquireMs);
+
+            frame.postToPresentMs = msBetween(frameTime.postTime, frameTime.presentTime);
+            ALOGV("[%d]-[%" PRIu64 "]-post2present[%d]", layerId, frameTime.frameNumber,
+                  frame.postToPresentMs);
+
+            frame.acquireToPresentMs = msBetween(frameTime.acquireTime, frameTime.presentTime);
+            ALOGV("[%d]-[%" PRIu64 "]-acquire2present[%d]", layerId, frameTime.frameNumber,
+                  frame.acquireToPresentMs);
+
+            frame.latchToPresentMs = msBetween(frameTime.latchTime, frameTime.presentTime);
+            ALOGV("[%d]-[%" PRIu64 "]-latch2present[%d]", layerId, frameTime.frameNumber,
+                  frame.latchToPresentMs);
+
+            frame.desiredToPresentMs = msBetween(frameTime.desiredTime, frameTime.presentTime);
+            ALOGV("[%d]-[%" PRIu64 "]-desired2present[%d]", layerId, frameTime.frameNumber,
+                  frame.desiredToPresentMs);
+
+            frame.presentToPresentMs =
+                    msBetween(prevTimeRecord.frameTime.presentTime, frameTime.presentTime);
+            ALOGV("[%d]-[%" PRIu64 "]-present2present[%d]", layerId, frameTime.frameNumber,
+                  frame.presentToPresentMs);
             if (prevPresentToPresentMs) {
-                const int32_t presentToPresentDeltaMs =
-                        std::abs(presentToPresentMs - *prevPresentToPresentMs);
-                timeStatsLayer.deltas["present2presentDelta"].insert(presentToPresentDeltaMs);
+                frame.presentToPresentDeltaMs =
+                        std::abs(frame.presentToPresentMs - *prevPresentToPresentMs);
             }
-            prevPresentToPresentMs = presentToPresentMs;
+            prevPresentToPresentMs = frame.presentToPresentMs;
         }
         prevTimeRecord = timeRecords[0];
         timeRecords.pop_front();
-        layerRecord.waitData--;
+        layerRecord->waitData--;
+    }
+    return hasNewStatsKey;
+}
+
+void TimeStats::flushAvailableRecordsOnPresent(LayerShard& shard,
+                                               std::unique_lock<std::mutex>& shardLock,
+                                               int32_t layerId, Fps displayRefreshRate,
+                                               std::optional<Fps> renderRate,
+                                               SetFrameRateVote frameRateVote, GameMode gameMode) {
+    const bool hasNewStatsKey = flushAvailableRecordsToShardLocked(shard, layerId,
+                                                                   displayRefreshRate, renderRate,
+                                                                   frameRateVote, gameMode);
+    if (!hasNewStatsKey && shard.completedFrames.size() < kMaxCompletedFramesPerShard) return;
+
+    std::vector<CompletedFrame> completedFrames;
+    completedFrames.reserve(kMaxCompletedFramesPerShard);
+    std::swap(completedFrames, shard.completedFrames);
+    const uint64_t clearGeneration = shard.clearGeneration.load();
+    shardLock.unlock();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    // clearAll holds mMutex for the whole clear, so it either ran entirely before this point or
+    // not at all. If it ran, these frames predate it and belong to the discarded stats.
+    if (shard.clearGeneration.load() != clearGeneration) return;
+    for (const CompletedFrame& frame : completedFrames) {
+        aggregateCompletedFrameLocked(frame);
+    }
+}
+
+void TimeStats::aggregateCompletedFrameLocked(const CompletedFrame& frame) {
+    const TimeStatsHelper::TimelineStatsKey timelineKey = {frame.refreshRateBucket,
+                                                           frame.renderRateBucket};
+    const TimeStatsHelper::LayerStatsKey layerKey = {frame.uid, *frame.layerName, frame.gameMode};
+
+    // The layer may have been admitted while the stats pool still had room, and the pool filled
+    // up before its first frame got here.
+    if (!canAddNewAggregatedStats(frame.uid, *frame.layerName, frame.gameMode)) {
+        return;
+    }
+
+    if (!mTimeStats.stats.count(timelineKey)) {
+        mTimeStats.stats[timelineKey].key = timelineKey;
+    }
+
+    TimeStatsHelper::TimelineStats& displayStats = mTimeStats.stats[timelineKey];
+
+    if (!displayStats.stats.count(layerKey)) {
+        displayStats.stats[layerKey].displayRefreshRateBucket = frame.refreshRateBucket;
+        displayStats.stats[layerKey].renderRateBucket = frame.renderRateBucket;
+        displayStats.stats[layerKey].uid = frame.uid;
+        displayStats.stats[layerKey].layerName = *frame.layerName;
+        displayStats.stats[layerKey].gameMode = frame.gameMode;
+    }
+    if (frame.frameRateVote.frameRate > 0.0f) {
+        displayStats.stats[layerKey].setFrameRateVote = frame.frameRateVote;
+    }
+    TimeStatsHelper::TimeStatsLayer& timeStatsLayer = displayStats.stats[layerKey];
+    timeStatsLayer.totalFrames++;
+    timeStatsLayer.droppedFrames += frame.droppedFrames;
+    timeStatsLayer.lateAcquireFrames += frame.lateAcquireFrames;
+    timeStatsLayer.badDesiredPresentFrames += frame.badDesiredPresentFrames;
+
+    timeStatsLayer.deltas["post2acquire"].insert(frame.postToAcquireMs);
+    timeStatsLayer.deltas["post2present"].insert(frame.postToPresentMs);
+    timeStatsLayer.deltas["acquire2present"].insert(frame.acquireToPresentMs);
+    timeStatsLayer.deltas["latch2present"].insert(frame.latchToPresentMs);
+    timeStatsLayer.deltas["desired2present"].insert(frame.desiredToPresentMs);
+    timeStatsLayer.deltas["present2present"].insert(frame.presentToPresentMs);
+    if (frame.presentToPresentDeltaMs) {
+        timeStatsLayer.deltas["present2presentDelta"].insert(*frame.presentToPresentDeltaMs);
+    }
+}
+
+void TimeStats::aggregateCompletedFramesLocked() {
+    ATRACE_CALL();
+
+    std::vector<CompletedFrame> completedFrames;
+    for (LayerShard& shard : mLayerShards) {
+        {
+            // Swap the buffers so the shard is only locked for the exchange; the shard keeps the
+            // capacity of the previous batch for the next round of presents.
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.completedFrames.empty()) continue;
+            std::swap(completedFrames, shard.completedFrames);
+        }
+        for (const CompletedFrame& frame : completedFrames) {
+            aggregateCompletedFrameLocked(frame);
+        }
+        completedFrames.clear();
     }
 }
 
@@ -564,6 +640,29 @@ bool TimeStats::canAddNewAggregatedStats(uid_t uid, const std::string& layerName
     return layerRecords < MAX_NUM_LAYER_STATS;
 }
 
+TimeStats::LayerRecord* TimeStats::findLayerRecordLocked(LayerShard& shard, int32_t layerId) {
+    const auto it = shard.layers.find(layerId);
+    return it == shard.layers.end() ? nullptr : &it->second;
+}
+
+TimeStats::TimeRecord* TimeStats::waitingTimeRecordLocked(LayerShard& shard, int32_t layerId,
+                                                          uint64_t frameNumber) {
+    LayerRecord* layerRecord = findLayerRecordLocked(shard, layerId);
+    if (!layerRecord) return nullptr;
+    if (layerRecord->waitData < 0 ||
+        layerRecord->waitData >= static_cast<int32_t>(layerRecord->timeRecords.size()))
+        return nullptr;
+    TimeRecord& timeRecord = layerRecord->timeRecords[layerRecord->waitData];
+    if (timeRecord.frameTime.frameNumber != frameNumber) return nullptr;
+    return &timeRecord;
+}
+
+void TimeStats::eraseLayerLocked(LayerShard& shard, int32_t layerId) {
+    if (shard.layers.erase(layerId)) {
+        mNumTrackedLayers--;
+    }
+}
+
 void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::string& layerName,
                             uid_t uid, nsecs_t postTime, GameMode gameMode) {
     if (!mEnabled.load()) return;
@@ -572,22 +671,40 @@ void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::st
     ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerId, frameNumber, layerName.c_str(),
           postTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!canAddNewAggregatedStats(uid, layerName, gameMode)) {
-        return;
-    }
-    if (!mTimeStatsTracker.count(layerId) && mTimeStatsTracker.size() < MAX_NUM_LAYER_RECORDS &&
-        layerNameIsValid(layerName)) {
-        mTimeStatsTracker[layerId].uid = uid;
-        mTimeStatsTracker[layerId].layerName = layerName;
-        mTimeStatsTracker[layerId].gameMode = gameMode;
+    LayerShard& shard = shardFor(layerId);
+    std::unique_lock<std::mutex> shardLock(shard.mutex);
+    if (!findLayerRecordLocked(shard, layerId)) {
+        // First buffer for this layer. Admitting it needs to look at the aggregated stats pool,
+        // which is the only time the per-layer path takes mMutex. The count is only a hint here;
+        // the slot is reserved once the shard lock is taken again.
+        if (mNumTrackedLayers.load() >= MAX_NUM_LAYER_RECORDS || !layerNameIsValid(layerName)) {
+            return;
+        }
+        shardLock.unlock();
+        std::lock_guard<std::mutex> lock(mMutex);
+        aggregateCompletedFramesLocked();
+        if (!canAddNewAggregatedStats(uid, layerName, gameMode)) {
+            return;
+        }
+        shardLock.lock();
+        if (!findLayerRecordLocked(shard, layerId)) {
+            // Other shards admit layers concurrently, so reserve the slot and check the count in
+            // a single step.
+            if (mNumTrackedLayers.fetch_add(1) >= MAX_NUM_LAYER_RECORDS) {
+                mNumTrackedLayers.fetch_sub(1);
+                return;
+            }
+            LayerRecord& layerRecord = shard.layers[layerId];
+            layerRecord.uid = uid;
+            layerRecord.layerName = std::make_shared<const std::string>(layerName);
+            layerRecord.gameMode = gameMode;
+        }
     }
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerRecord& layerRecord = *findLayerRecordLocked(shard, layerId);
     if (layerRecord.timeRecords.size() == MAX_NUM_TIME_RECORDS) {
         ALOGE("[%d]-[%s]-timeRecords is at its maximum size[%zu]. Ignore this when unittesting.",
-              layerId, layerRecord.layerName.c_str(), MAX_NUM_TIME_RECORDS);
-        mTimeStatsTracker.erase(layerId);
+              layerId, layerRecord.layerName->c_str(), MAX_NUM_TIME_RECORDS);
+        eraseLayerLocked(shard, layerId);
         return;
     }
     // For most media content, the acquireFence is invalid because the buffer is
@@ -615,15 +732,10 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerId, frameNumber, latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.latchTime = latchTime;
+    LayerShard& shard = shardFor(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (TimeRecord* timeRecord = waitingTimeRecordLocked(shard, layerId, frameNumber)) {
+        timeRecord->frameTime.latchTime = latchTime;
     }
 }
 
@@ -634,13 +746,14 @@ void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
     ALOGV("[%d]-LatchSkipped-Reason[%d]", layerId,
           static_cast<std::underlying_type<LatchSkipReason>::type>(reason));
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = shardFor(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    LayerRecord* layerRecord = findLayerRecordLocked(shard, layerId);
+    if (!layerRecord) return;
 
     switch (reason) {
         case LatchSkipReason::LateAcquire:
-            layerRecord.lateAcquireFrames++;
+            layerRecord->lateAcquireFrames++;
             break;
     }
 }
@@ -651,10 +764,11 @@ void TimeStats::incrementBadDesiredPresent(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-BadDesiredPresent", layerId);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    layerRecord.badDesiredPresentFrames++;
+    LayerShard& shard = shardFor(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    LayerRecord* layerRecord = findLayerRecordLocked(shard, layerId);
+    if (!layerRecord) return;
+    layerRecord->badDesiredPresentFrames++;
 }
 
 void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t desiredTime) {
@@ -663,15 +777,10 @@ void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t de
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerId, frameNumber, desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.desiredTime = desiredTime;
+    LayerShard& shard = shardFor(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (TimeRecord* timeRecord = waitingTimeRecordLocked(shard, layerId, frameNumber)) {
+        timeRecord->frameTime.desiredTime = desiredTime;
     }
 }
 
@@ -681,15 +790,10 @@ void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t ac
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerId, frameNumber, acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.acquireTime = acquireTime;
+    LayerShard& shard = shardFor(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (TimeRecord* timeRecord = waitingTimeRecordLocked(shard, layerId, frameNumber)) {
+        timeRecord->frameTime.acquireTime = acquireTime;
     }
 }
 
@@ -701,15 +805,10 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerId, frameNumber,
           acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.acquireFence = acquireFence;
+    LayerShard& shard = shardFor(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (TimeRecord* timeRecord = waitingTimeRecordLocked(shard, layerId, frameNumber)) {
+        timeRecord->acquireFence = acquireFence;
     }
 }
 
@@ -721,21 +820,18 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerId, frameNumber, presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.presentTime = presentTime;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
+    LayerShard& shard = shardFor(layerId);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    LayerRecord* layerRecord = findLayerRecordLocked(shard, layerId);
+    if (!layerRecord) return;
+    if (TimeRecord* timeRecord = waitingTimeRecordLocked(shard, layerId, frameNumber)) {
+        timeRecord->frameTime.presentTime = presentTime;
+        timeRecord->ready = true;
+        layerRecord->waitData++;
     }
 
-    flushAvailableRecordsToStatsLocked(layerId, displayRefreshRate, renderRate, frameRateVote,
-                                       gameMode);
+    flushAvailableRecordsOnPresent(shard, lock, layerId, displayRefreshRate, renderRate,
+                                   frameRateVote, gameMode);
 }
 
 void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
@@ -748,21 +844,18 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerId, frameNumber,
           presentFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.presentFence = presentFence;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
+    LayerShard& shard = shardFor(layerId);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    LayerRecord* layerRecord = findLayerRecordLocked(shard, layerId);
+    if (!layerRecord) return;
+    if (TimeRecord* timeRecord = waitingTimeRecordLocked(shard, layerId, frameNumber)) {
+        timeRecord->presentFence = presentFence;
+        timeRecord->ready = true;
+        layerRecord->waitData++;
     }
 
-    flushAvailableRecordsToStatsLocked(layerId, displayRefreshRate, renderRate, frameRateVote,
-                                       gameMode);
+    flushAvailableRecordsOnPresent(shard, lock, layerId, displayRefreshRate, renderRate,
+                                   frameRateVote, gameMode);
 }
 
 static const constexpr int32_t kValidJankyReason = JankType::DisplayHAL |
@@ -817,7 +910,9 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
     // for an animation leash. So while we can show that jank in dumpsys, aggregating based on the
     // layer blows up the stats size, so as a workaround drop those stats. This assumes that
     // TimeStats will flush the first present fence for a layer *before* FrameTimeline does so that
-    // the first jank record is not dropped.
+    // the first jank record is not dropped. The present path folds a layer's frames into
+    // mTimeStats as soon as they land under a new stats key, so there is no need to drain the
+    // shards here.
 
     static const std::string kDefaultLayerName = "none";
     constexpr GameMode kDefaultGameMode = GameMode::Unsupported;
@@ -863,8 +958,9 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
 void TimeStats::onDestroy(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-onDestroy", layerId);
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStatsTracker.erase(layerId);
+    LayerShard& shard = shardFor(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    eraseLayerLocked(shard, layerId);
 }
 
 void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
@@ -873,20 +969,21 @@ void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerId, frameNumber);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = shardFor(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    LayerRecord* layerRecord = findLayerRecordLocked(shard, layerId);
+    if (!layerRecord) return;
     size_t removeAt = 0;
-    for (const TimeRecord& record : layerRecord.timeRecords) {
+    for (const TimeRecord& record : layerRecord->timeRecords) {
         if (record.frameTime.frameNumber == frameNumber) break;
         removeAt++;
     }
-    if (removeAt == layerRecord.timeRecords.size()) return;
-    layerRecord.timeRecords.erase(layerRecord.timeRecords.begin() + removeAt);
-    if (layerRecord.waitData > static_cast<int32_t>(removeAt)) {
-        layerRecord.waitData--;
+    if (removeAt == layerRecord->timeRecords.size()) return;
+    layerRecord->timeRecords.erase(layerRecord->timeRecords.begin() + removeAt);
+    if (layerRecord->waitData > static_cast<int32_t>(removeAt)) {
+        layerRecord->waitData--;
     }
-    layerRecord.droppedFrames++;
+    layerRecord->droppedFrames++;
 }
 
 void TimeStats::flushPowerTimeLocked() {
@@ -1080,7 +1177,13 @@ void TimeStats::clearGlobalLocked() {
 void TimeStats::clearLayersLocked() {
     ATRACE_CALL();
 
-    mTimeStatsTracker.clear();
+    for (LayerShard& shard : mLayerShards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        mNumTrackedLayers -= shard.layers.size();
+        shard.layers.clear();
+        shard.completedFrames.clear();
+        shard.clearGeneration++;
+    }
 
     for (auto& globalRecord : mTimeStats.stats) {
         globalRecord.second.stats.clear();
@@ -1103,6 +1206,7 @@ void TimeStats::dump(bool asProto, std::optional<uint32_t> maxLayers, std::strin
     mTimeStats.statsEndLegacy = static_cast<int64_t>(std::time(0));
 
     flushPowerTimeLocked();
+    aggregateCompletedFramesLocked();
 
     if (asProto) {
         ALOGD("Dumping TimeStats as proto");
@@ -16,8 +16,11 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
@@ -206,7 +209,9 @@ class TimeStats : public android::TimeStats {
 
     struct LayerRecord {
         uid_t uid;
-        std::string layerName;
+        // Shared with the CompletedFrames produced for this layer so that handing a frame off for
+        // aggregation does not copy the name.
+        std::shared_ptr<const std::string> layerName;
         GameMode gameMode = GameMode::Unsupported;
         // This is the index in timeRecords, at which the timestamps for that
         // specific frame are still not fully received. This is not waiting for
@@ -215,11 +220,54 @@ class TimeStats : public android::TimeStats {
         uint32_t droppedFrames = 0;
         uint32_t lateAcquireFrames = 0;
         uint32_t badDesiredPresentFrames = 0;
+        // Stats key of the last frame handed off for aggregation. A frame under a new key is
+        // folded into mTimeStats right away, so that the layer is already there when
+        // FrameTimeline reports jank for it.
+        std::optional<TimeStatsHelper::TimelineStatsKey> lastTimelineKey;
+        GameMode lastGameMode = GameMode::Unsupported;
         TimeRecord prevTimeRecord;
         std::optional<int32_t> prevPresentToPresentMs;
         std::deque<TimeRecord> timeRecords;
     };
 
+    // A fully resolved frame for a layer, waiting to be folded into mTimeStats. Produced under the
+    // layer's shard lock on the present path, consumed under mMutex when stats are read.
+    struct CompletedFrame {
+        uid_t uid = 0;
+        std::shared_ptr<const std::string> layerName;
+        GameMode gameMode = GameMode::Unsupported;
+        int32_t refreshRateBucket = 0;
+        int32_t renderRateBucket = 0;
+        SetFrameRateVote frameRateVote;
+        uint32_t droppedFrames = 0;
+        uint32_t lateAcquireFrames = 0;
+        uint32_t badDesiredPresentFrames = 0;
+        int32_t postToAcquireMs = 0;
+        int32_t postToPresentMs = 0;
+        int32_t acquireToPresentMs = 0;
+        int32_t latchToPresentMs = 0;
+        int32_t desiredToPresentMs = 0;
+        int32_t presentToPresentMs = 0;
+        std::optional<int32_t> presentToPresentDeltaMs;
+    };
+
+    // Per-layer bookkeeping is split across shards keyed by layer id, so that the per-buffer
+    // set*Time calls coming from different layers (and from the main and binder threads) only
+    // contend when they hash to the same shard, and never with stats pulls or dumps.
+    struct LayerShard {
+        std::mutex mutex;
+        std::unordered_map<int32_t, LayerRecord> layers;
+        std::vector<CompletedFrame> completedFrames;
+        // Bumped under the shard lock each time clearLayersLocked drops this shard's frames. A
+        // batch swapped out by the present path is only folded if no clear ran since the swap.
+        std::atomic<uint64_t> clearGeneration = 0;
+    };
+
+    static constexpr size_t kNumLayerShards = 16;
+    // Once a shard has this many completed frames queued, the present path folds them into
+    // mTimeStats instead of waiting for the next stats read.
+    static constexpr size_t kMaxCompletedFramesPerShard = 64;
+
     struct PowerTime {
         PowerMode powerMode = PowerMode::OFF;
         nsecs_t prevTime = 0;
@@ -291,10 +339,31 @@ public:
 private:
     bool populateGlobalAtom(std::vector<uint8_t>* pulledData);
     bool populateLayerAtom(std::vector<uint8_t>* pulledData);
+    LayerShard& shardFor(int32_t layerId) {
+        return mLayerShards[static_cast<uint32_t>(layerId) % kNumLayerShards];
+    }
+    // Returns the tracked record for layerId, or nullptr. Requires the layer's shard lock.
+    static LayerRecord* findLayerRecordLocked(LayerShard&, int32_t layerId);
+    // Returns the record currently waiting for timestamps, or nullptr. Requires the shard lock.
+    static TimeRecord* waitingTimeRecordLocked(LayerShard&, int32_t layerId,
+                                               uint64_t frameNumber);
+    void eraseLayerLocked(LayerShard&, int32_t layerId);
     bool recordReadyLocked(int32_t layerId, TimeRecord* timeRecord);
-    void flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayRefreshRate,
+    // Returns true if a flushed frame has a stats key this layer has not produced before.
+    bool flushAvailableRecordsToShardLocked(LayerShard&, int32_t layerId, Fps displayRefreshRate,
                                             std::optional<Fps> renderRate, SetFrameRateVote,
                                             GameMode);
+    // Flushes the layer's ready records on the present path, and folds the shard's queue into
+    // mTimeStats if it is full or holds a frame under a new stats key. Releases shardLock before
+    // taking mMutex, to keep the mMutex -> shard lock order.
+    void flushAvailableRecordsOnPresent(LayerShard&, std::unique_lock<std::mutex>& shardLock,
+                                        int32_t layerId, Fps displayRefreshRate,
+                                        std::optional<Fps> renderRate, SetFrameRateVote,
+                                        GameMode);
+    // Folds the CompletedFrames of every shard into mTimeStats. Must be called with mMutex held
+    // before reading per-layer stats.
+    void aggregateCompletedFramesLocked();
+    void aggregateCompletedFrameLocked(const CompletedFrame&);
     void flushPowerTimeLocked();
     void flushAvailableGlobalRecordsToStatsLocked();
     bool canAddNewAggregatedStats(uid_t uid, const std::string& layerName, GameMode);
@@ -309,8 +378,10 @@ private:
     std::atomic<bool> mEnabled = false;
     std::mutex mMutex;
     TimeStatsHelper::TimeStatsGlobal mTimeStats;
-    // Hashmap for LayerRecord with layerId as the hash key
-    std::unordered_map<int32_t, LayerRecord> mTimeStatsTracker;
+    // LayerRecords sharded by layerId. Lock ordering is mMutex before any shard mutex, and at
+    // most one shard mutex is held at a time.
+    std::array<LayerShard, kNumLayerShards> mLayerShards;
+    std::atomic<size_t> mNumTrackedLayers = 0;
     PowerTime mPowerTime;
     GlobalRecord mGlobalRecord;
 
@@ -16,6 +16,7 @@
 
 #include <gtest/gtest.h>
 
+#include <android/native_window.h>
 #include <binder/Binder.h>
 #include <binder/Parcel.h>
 
@@ -144,5 +145,90 @@ TEST(LayerStateTest, ParcellingScreenCaptureResultsWithFenceError) {
     ASSERT_EQ(results.fenceResult.error(), results2.fenceResult.error());
 }
 
+TEST(LayerStateTest, ParcellingLayerStateWithChangedFields) {
+    layer_state_t state;
+    state.layerId = 7;
+    state.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged |
+            layer_state_t::eMatrixChanged | layer_state_t::eCropChanged |
+            layer_state_t::eBlurRegionsChanged | layer_state_t::eFrameRateChanged;
+    state.x = 10;
+    state.y = 20;
+    state.color.a = 0.5f;
+    state.matrix = {.dsdx = 2, .dtdx = 0, .dtdy = 0, .dsdy = 3};
+    state.crop = Rect(1, 2, 3, 4);
+    state.blurRegions.push_back({.blurRadius = 5,
+                                 .cornerRadiusTL = 1,
+                                 .cornerRadiusTR = 1,
+                                 .cornerRadiusBL = 1,
+                                 .cornerRadiusBR = 1,
+                                 .alpha = 1,
+                                 .left = 0,
+                                 .top = 0,
+                                 .right = 6,
+                                 .bottom = 6});
+    state.frameRate = 60;
+    state.frameRateCompatibility = ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_FIXED_SOURCE;
+
+    Parcel p;
+    ASSERT_EQ(OK, state.write(p));
+    p.setDataPosition(0);
+
+    layer_state_t state2;
+    ASSERT_EQ(OK, state2.read(p));
+    ASSERT_EQ(p.dataSize(), p.dataPosition());
+
+    ASSERT_EQ(state.layerId, state2.layerId);
+    ASSERT_EQ(state.what, state2.what);
+    ASSERT_EQ(state.x, state2.x);
+    ASSERT_EQ(state.y, state2.y);
+    ASSERT_EQ(state.color.a, state2.color.a);
+    ASSERT_EQ(state.matrix, state2.matrix);
+    ASSERT_EQ(state.crop, state2.crop);
+    ASSERT_EQ(state.blurRegions, state2.blurRegions);
+    ASSERT_EQ(state.frameRate, state2.frameRate);
+    ASSERT_EQ(state.frameRateCompatibility, state2.frameRateCompatibility);
+}
+
+TEST(LayerStateTest, ParcellingLayerStateSkipsUnchangedFields) {
+    layer_state_t state;
+    state.what = layer_state_t::ePositionChanged;
+    state.x = 10;
+    state.y = 20;
+    // Not written, because the changes are not in what.
+    state.z = 3;
+    state.windowInfoHandle->editInfo()->name = "window";
+    state.transparentRegion = Region(Rect(0, 0, 10, 10));
+
+    Parcel p;
+    ASSERT_EQ(OK, state.write(p));
+    p.setDataPosition(0);
+
+    layer_state_t state2;
+    ASSERT_EQ(OK, state2.read(p));
+    ASSERT_EQ(state.x, state2.x);
+    ASSERT_EQ(state.y, state2.y);
+    ASSERT_EQ(0, state2.z);
+    ASSERT_EQ("", state2.windowInfoHandle->getInfo()->name);
+    ASSERT_TRUE(state2.transparentRegion.isEmpty());
+
+    Parcel full;
+    state.what |= layer_state_t::eLayerChanged | layer_state_t::eInputInfoChanged |
+            layer_state_t::eTransparentRegionChanged;
+    ASSERT_EQ(OK, state.write(full));
+    ASSERT_LT(p.dataSize(), full.dataSize());
+}
+
+TEST(LayerStateTest, ParcellingLayerStateWithOtherFormatVersionFails) {
+    Parcel p;
+    p.writeStrongBinder(nullptr);
+    p.writeInt32(/*layerId=*/1);
+    p.writeUint32(layer_state_t::PARCEL_FORMAT_VERSION + 1);
+    p.writeUint64(layer_state_t::ePositionChanged);
+    p.setDataPosition(0);
+
+    layer_state_t state;
+    ASSERT_EQ(BAD_VALUE, state.read(p));
+}
+
 } // namespace test
 } // namespace android
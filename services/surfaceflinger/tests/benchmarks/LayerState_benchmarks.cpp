@@ -0,0 +1,116 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <binder/Parcel.h>
+#include <gui/LayerState.h>
+
+#include <vector>
+
+namespace android {
+namespace {
+
+// The number of layers of a transaction, as in a window animation of a busy launcher.
+constexpr size_t kNumLayerStates = 20;
+
+// The changes of the states written by each benchmark.
+enum class Changes {
+    // The position, as in a drag.
+    POSITION,
+    // The geometry and alpha, as in most window animations.
+    ANIMATION,
+    // All the changes that carry a value.
+    ALL,
+};
+
+uint64_t getWhat(Changes changes) {
+    switch (changes) {
+        case Changes::POSITION:
+            return layer_state_t::ePositionChanged;
+        case Changes::ANIMATION:
+            return layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged |
+                    layer_state_t::eMatrixChanged | layer_state_t::eCropChanged |
+                    layer_state_t::eCornerRadiusChanged;
+        case Changes::ALL:
+            // Except the ones that need objects of other processes.
+            return ~static_cast<uint64_t>(layer_state_t::eBufferChanged |
+                                          layer_state_t::eSidebandStreamChanged |
+                                          layer_state_t::eReparent |
+                                          layer_state_t::eRelativeLayerChanged |
+                                          layer_state_t::eHasListenerCallbacksChanged);
+    }
+}
+
+std::vector<layer_state_t> createLayerStates(Changes changes) {
+    std::vector<layer_state_t> states(kNumLayerStates);
+    for (size_t i = 0; i < states.size(); i++) {
+        layer_state_t& state = states[i];
+        state.layerId = static_cast<int32_t>(i);
+        state.what = getWhat(changes);
+        state.x = 10.f * static_cast<float>(i);
+        state.y = 20.f * static_cast<float>(i);
+        state.color.a = 0.5f;
+        state.crop = Rect(0, 0, 1080, 2400);
+        state.cornerRadius = 16;
+        state.windowInfoHandle->editInfo()->name = "com.example.app/MainActivity";
+        state.transparentRegion = Region(Rect(0, 0, 100, 100));
+        state.surfaceDamageRegion = Region(Rect(0, 0, 1080, 2400));
+    }
+    return states;
+}
+
+// Cost of writing the layer states of a transaction, as paid by the app.
+void BM_LayerState_write(benchmark::State& state, Changes changes) {
+    const std::vector<layer_state_t> layerStates = createLayerStates(changes);
+    Parcel parcel;
+    for (auto _ : state) {
+        parcel.setDataSize(0);
+        for (const layer_state_t& layerState : layerStates) {
+            layerState.write(parcel);
+        }
+        benchmark::DoNotOptimize(parcel.data());
+    }
+    state.SetItemsProcessed(state.iterations() * kNumLayerStates);
+    state.counters["bytes_per_state"] = static_cast<double>(parcel.dataSize()) / kNumLayerStates;
+}
+BENCHMARK_CAPTURE(BM_LayerState_write, position, Changes::POSITION);
+BENCHMARK_CAPTURE(BM_LayerState_write, animation, Changes::ANIMATION);
+BENCHMARK_CAPTURE(BM_LayerState_write, all, Changes::ALL);
+
+// Cost of reading the layer states of a transaction, as paid by SurfaceFlinger on a binder thread.
+void BM_LayerState_read(benchmark::State& state, Changes changes) {
+    Parcel parcel;
+    for (const layer_state_t& layerState : createLayerStates(changes)) {
+        layerState.write(parcel);
+    }
+    for (auto _ : state) {
+        parcel.setDataPosition(0);
+        for (size_t i = 0; i < kNumLayerStates; i++) {
+            ComposerState composerState;
+            composerState.read(parcel);
+            benchmark::DoNotOptimize(composerState);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumLayerStates);
+    state.counters["bytes_per_state"] = static_cast<double>(parcel.dataSize()) / kNumLayerStates;
+}
+BENCHMARK_CAPTURE(BM_LayerState_read, position, Changes::POSITION);
+BENCHMARK_CAPTURE(BM_LayerState_read, animation, Changes::ANIMATION);
+BENCHMARK_CAPTURE(BM_LayerState_read, all, Changes::ALL);
+
+} // namespace
+} // namespace android
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <TimeStats/TimeStats.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace {
+
+constexpr int32_t kNumActiveLayers = 100;
+constexpr uid_t kUid = 10123;
+constexpr Fps kRefreshRate = 60_Hz;
+// The atom ids served by TimeStats::onPullAtom. Pulling once enables TimeStats.
+constexpr int kLayerAtomId = 10063;
+
+struct TimeStatsFixture {
+    impl::TimeStats timeStats;
+    std::vector<std::string> layerNames;
+
+    TimeStatsFixture() {
+        std::vector<uint8_t> pulledData;
+        timeStats.onPullAtom(kLayerAtomId, &pulledData);
+        layerNames.reserve(kNumActiveLayers);
+        for (int32_t layerId = 0; layerId < kNumActiveLayers; layerId++) {
+            layerNames.push_back("com.example.benchmark/MainActivity#" + std::to_string(layerId));
+        }
+    }
+
+    // Runs the calls SurfaceFlinger makes for one buffer of one layer.
+    void onFrame(int32_t layerId, uint64_t frameNumber, nsecs_t now) {
+        timeStats.setPostTime(layerId, frameNumber, layerNames[layerId], kUid, now,
+                              GameMode::Unsupported);
+        timeStats.setDesiredTime(layerId, frameNumber, now);
+        timeStats.setLatchTime(layerId, frameNumber, now + 1'000'000);
+        timeStats.setAcquireTime(layerId, frameNumber, now + 2'000'000);
+        timeStats.setPresentTime(layerId, frameNumber, now + 16'000'000, kRefreshRate,
+                                 std::nullopt, {}, GameMode::Unsupported);
+    }
+};
+
+// Cost of the per-buffer calls for every layer of a frame, with 100 active layers.
+void BM_TimeStats_perLayerCalls(benchmark::State& state) {
+    TimeStatsFixture fixture;
+    uint64_t frameNumber = 0;
+    nsecs_t now = 0;
+    for (auto _ : state) {
+        frameNumber++;
+        now += 16'666'666;
+        for (int32_t layerId = 0; layerId < kNumActiveLayers; layerId++) {
+            fixture.onFrame(layerId, frameNumber, now);
+        }
+    }
+    // Each layer issues 5 calls per frame.
+    state.SetItemsProcessed(state.iterations() * kNumActiveLayers * 5);
+}
+BENCHMARK(BM_TimeStats_perLayerCalls);
+
+// Same as above, but with layers split across threads, as happens when binder threads post
+// buffers while the main thread latches and presents. Each thread owns a disjoint set of layers.
+void BM_TimeStats_perLayerCallsContended(benchmark::State& state) {
+    static TimeStatsFixture* fixture = nullptr;
+    if (state.thread_index() == 0) {
+        fixture = new TimeStatsFixture();
+    }
+    const int32_t layersPerThread = kNumActiveLayers / state.threads();
+    const int32_t firstLayer = state.thread_index() * layersPerThread;
+    uint64_t frameNumber = 0;
+    nsecs_t now = 0;
+    for (auto _ : state) {
+        frameNumber++;
+        now += 16'666'666;
+        for (int32_t layerId = firstLayer; layerId < firstLayer + layersPerThread; layerId++) {
+            fixture->onFrame(layerId, frameNumber, now);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * layersPerThread * 5);
+    if (state.thread_index() == 0) {
+        delete fixture;
+        fixture = nullptr;
+    }
+}
+BENCHMARK(BM_TimeStats_perLayerCallsContended)->ThreadRange(1, 4)->UseRealTime();
+
+// Cost of folding the records of 100 layers into the aggregated stats, as paid by a pull.
+void BM_TimeStats_pullLayerAtom(benchmark::State& state) {
+    TimeStatsFixture fixture;
+    uint64_t frameNumber = 0;
+    nsecs_t now = 0;
+    std::vector<uint8_t> pulledData;
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (int i = 0; i < 2; i++) {
+            frameNumber++;
+            now += 16'666'666;
+            for (int32_t layerId = 0; layerId < kNumActiveLayers; layerId++) {
+                fixture.onFrame(layerId, frameNumber, now);
+            }
+        }
+        state.ResumeTiming();
+        fixture.timeStats.onPullAtom(kLayerAtomId, &pulledData);
+    }
+}
+BENCHMARK(BM_TimeStats_pullLayerAtom);
+
+} // namespace
+} // namespace android
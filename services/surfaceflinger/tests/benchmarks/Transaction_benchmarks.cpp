@@ -0,0 +1,141 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <binder/Binder.h>
+#include <binder/Parcel.h>
+#include <gui/ISurfaceComposerClient.h>
+#include <gui/SurfaceComposerClient.h>
+#include <gui/SurfaceControl.h>
+#include <ui/PixelFormat.h>
+#include <utils/String8.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace {
+
+using Transaction = SurfaceComposerClient::Transaction;
+
+// Allocations made with operator new by the current thread. The allocations of the binder threads
+// and of SurfaceFlinger are not counted.
+thread_local size_t tAllocationCount = 0;
+
+std::vector<sp<SurfaceControl>> createSurfaceControls(size_t count) {
+    std::vector<sp<SurfaceControl>> surfaceControls;
+    for (size_t i = 0; i < count; i++) {
+        surfaceControls.push_back(sp<SurfaceControl>::make(/*client=*/nullptr,
+                                                           sp<BBinder>::make(),
+                                                           static_cast<int32_t>(i),
+                                                           "Layer#" + std::to_string(i)));
+    }
+    return surfaceControls;
+}
+
+// Cost of merging one transaction per layer into a transaction that is then written to a parcel,
+// as when a UI toolkit collects the changes of a frame before applying them. The transactions are
+// reused across frames.
+void BM_Transaction_mergeAndWriteToParcel(benchmark::State& state) {
+    const std::vector<sp<SurfaceControl>> surfaceControls = createSurfaceControls(state.range(0));
+    std::vector<Transaction> layerTransactions(surfaceControls.size());
+    Transaction frameTransaction;
+    Parcel parcel;
+    float position = 0;
+    for (auto _ : state) {
+        position++;
+        for (size_t i = 0; i < surfaceControls.size(); i++) {
+            layerTransactions[i]
+                    .setPosition(surfaceControls[i], position, position)
+                    .setAlpha(surfaceControls[i], 0.5f);
+            frameTransaction.merge(std::move(layerTransactions[i]));
+        }
+        // Changes of the same layers merge into the states that were added above.
+        for (size_t i = 0; i < surfaceControls.size(); i++) {
+            layerTransactions[i].setCornerRadius(surfaceControls[i], position);
+            frameTransaction.merge(std::move(layerTransactions[i]));
+        }
+        parcel.setDataSize(0);
+        frameTransaction.writeToParcel(&parcel);
+        frameTransaction.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Transaction_mergeAndWriteToParcel)->Arg(1)->Arg(10)->Arg(50)->Arg(200);
+
+// Cost of applying a reused transaction that moves every layer. The allocs_per_apply counter
+// should not grow with the number of layers, since the states are sent from the storage of the
+// transaction.
+void BM_Transaction_apply(benchmark::State& state) {
+    const sp<SurfaceComposerClient> client = sp<SurfaceComposerClient>::make();
+    if (client->initCheck() != NO_ERROR) {
+        state.SkipWithError("Could not connect to SurfaceFlinger");
+        return;
+    }
+    std::vector<sp<SurfaceControl>> surfaceControls;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        sp<SurfaceControl> surfaceControl =
+                client->createSurface(String8("BM_Transaction_apply"), /*w=*/0, /*h=*/0,
+                                      PIXEL_FORMAT_RGBA_8888,
+                                      ISurfaceComposerClient::eFXSurfaceEffect);
+        if (surfaceControl == nullptr) {
+            state.SkipWithError("Could not create a layer");
+            return;
+        }
+        surfaceControls.push_back(std::move(surfaceControl));
+    }
+
+    Transaction transaction;
+    float position = 0;
+    size_t allocationCount = 0;
+    for (auto _ : state) {
+        position++;
+        for (const sp<SurfaceControl>& surfaceControl : surfaceControls) {
+            transaction.setPosition(surfaceControl, position, position);
+        }
+        const size_t previousAllocationCount = tAllocationCount;
+        transaction.apply(/*synchronous=*/false, /*oneWay=*/true);
+        allocationCount += tAllocationCount - previousAllocationCount;
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["allocs_per_apply"] =
+            benchmark::Counter(allocationCount, benchmark::Counter::kAvgIterations);
+
+    Transaction removal;
+    for (const sp<SurfaceControl>& surfaceControl : surfaceControls) {
+        removal.reparent(surfaceControl, nullptr);
+    }
+    removal.apply();
+}
+BENCHMARK(BM_Transaction_apply)->Arg(1)->Arg(10)->Arg(50)->Arg(200);
+
+} // namespace
+} // namespace android
+
+void* operator new(size_t size) {
+    android::tAllocationCount++;
+    void* ptr = malloc(size);
+    if (ptr == nullptr) {
+        abort();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <benchmark/benchmark.h>
+
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+#include <vector>
+
+namespace android {
+namespace {
+
+// The kinds of transforms, each of which has its own batched kernel.
+enum class Kind : int64_t {
+    TRANSLATE,
+    SCALE,
+    ROT_90,
+    AFFINE,
+};
+
+ui::Transform createTransform(Kind kind) {
+    ui::Transform transform;
+    switch (kind) {
+        case Kind::TRANSLATE:
+            transform.set(100.f, 200.f);
+            break;
+        case Kind::SCALE:
+            transform.set(1.5f, 0, 0, 1.5f);
+            transform.set(100.f, 200.f);
+            break;
+        case Kind::ROT_90:
+            transform = ui::Transform(ui::Transform::ROT_90, 1080, 2340);
+            break;
+        case Kind::AFFINE:
+            transform.set(0.8660254f, 0.5f, -0.5f, 0.8660254f);
+            transform.set(100.f, 200.f);
+            break;
+    }
+    return transform;
+}
+
+// The rects of a region, as a list of window bounds or damage.
+std::vector<Rect> createRects(size_t count) {
+    std::vector<Rect> rects;
+    rects.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const int32_t top = static_cast<int32_t>(i) * 20;
+        rects.emplace_back(static_cast<int32_t>(i % 7) * 10, top,
+                           static_cast<int32_t>(i % 7) * 10 + 500, top + 10);
+    }
+    return rects;
+}
+
+constexpr size_t kNumRects = 256;
+
+void BM_Transform_rectsOneByOne(benchmark::State& state) {
+    const ui::Transform transform = createTransform(static_cast<Kind>(state.range(0)));
+    const std::vector<Rect> rects = createRects(kNumRects);
+    std::vector<Rect> transformed(rects.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < rects.size(); i++) {
+            transformed[i] = transform.transform(rects[i]);
+        }
+        benchmark::DoNotOptimize(transformed.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * rects.size());
+}
+BENCHMARK(BM_Transform_rectsOneByOne)->DenseRange(0, static_cast<int64_t>(Kind::AFFINE));
+
+void BM_Transform_rectsBatched(benchmark::State& state) {
+    const ui::Transform transform = createTransform(static_cast<Kind>(state.range(0)));
+    const std::vector<Rect> rects = createRects(kNumRects);
+    std::vector<Rect> transformed(rects.size());
+    for (auto _ : state) {
+        transform.transform(rects, transformed);
+        benchmark::DoNotOptimize(transformed.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * rects.size());
+}
+BENCHMARK(BM_Transform_rectsBatched)->DenseRange(0, static_cast<int64_t>(Kind::AFFINE));
+
+void BM_Transform_pointsOneByOne(benchmark::State& state) {
+    const ui::Transform transform = createTransform(static_cast<Kind>(state.range(0)));
+    std::vector<vec2> points(kNumRects);
+    for (size_t i = 0; i < points.size(); i++) {
+        points[i] = vec2(static_cast<float>(i) * 3.5f, static_cast<float>(i) * 7.25f);
+    }
+    std::vector<vec2> transformed(points.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < points.size(); i++) {
+            transformed[i] = transform.transform(points[i]);
+        }
+        benchmark::DoNotOptimize(transformed.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_Transform_pointsOneByOne)->DenseRange(0, static_cast<int64_t>(Kind::AFFINE));
+
+void BM_Transform_pointsBatched(benchmark::State& state) {
+    const ui::Transform transform = createTransform(static_cast<Kind>(state.range(0)));
+    std::vector<vec2> points(kNumRects);
+    for (size_t i = 0; i < points.size(); i++) {
+        points[i] = vec2(static_cast<float>(i) * 3.5f, static_cast<float>(i) * 7.25f);
+    }
+    std::vector<vec2> transformed(points.size());
+    for (auto _ : state) {
+        transform.transform(points, transformed);
+        benchmark::DoNotOptimize(transformed.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_Transform_pointsBatched)->DenseRange(0, static_cast<int64_t>(Kind::AFFINE));
+
+// A region transform, as done for the visible and touchable regions of rotated displays. The
+// argument is the number of rects of the region.
+void BM_Transform_region(benchmark::State& state) {
+    const ui::Transform transform = createTransform(Kind::ROT_90);
+    Region region;
+    for (const Rect& rect : createRects(static_cast<size_t>(state.range(0)))) {
+        region.orSelf(rect);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(transform.transform(region));
+    }
+}
+BENCHMARK(BM_Transform_region)->Arg(1)->Arg(16)->Arg(64);
+
+} // namespace
+} // namespace android
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <scheduler/TimeKeeper.h>
+
+#include "Scheduler/VSyncDispatchTimerQueue.h"
+#include "Scheduler/VSyncTracker.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace android::scheduler {
+namespace {
+
+constexpr nsecs_t kPeriod = 16'666'666;
+constexpr nsecs_t kTimerSlack = 500'000;
+constexpr nsecs_t kMinVsyncDistance = 3'000'000;
+
+using QueueMode = VSyncDispatchTimerQueue::QueueMode;
+
+// Fires alarms only when the benchmark asks, so that no time is spent waiting for a real timer.
+class ManualTimeKeeper : public TimeKeeper {
+public:
+    nsecs_t now() const final { return mNow; }
+
+    void alarmAt(std::function<void()> callback, nsecs_t time) final {
+        mCallback = std::move(callback);
+        mAlarmTime = time;
+    }
+
+    void alarmCancel() final { mAlarmTime.reset(); }
+    void dump(std::string&) const final {}
+
+    // Advances to the armed alarm and runs it. Returns false if no alarm is armed.
+    bool fireAlarm() {
+        if (!mAlarmTime) {
+            return false;
+        }
+        mNow = std::max(mNow, *mAlarmTime);
+        mAlarmTime.reset();
+        // The callback rearms the alarm, which replaces mCallback.
+        const auto callback = std::move(mCallback);
+        callback();
+        return true;
+    }
+
+private:
+    nsecs_t mNow = 0;
+    std::optional<nsecs_t> mAlarmTime;
+    std::function<void()> mCallback;
+};
+
+class FixedRateTracker : public VSyncTracker {
+public:
+    bool addVsyncTimestamp(nsecs_t) final { return true; }
+    nsecs_t nextAnticipatedVSyncTimeFrom(nsecs_t timePoint, std::optional<nsecs_t>) final {
+        const nsecs_t remainder = timePoint % kPeriod;
+        return remainder == 0 ? timePoint : timePoint - remainder + kPeriod;
+    }
+    nsecs_t currentPeriod() const final { return kPeriod; }
+    Period minFramePeriod() const final { return Period::fromNs(kPeriod); }
+    void resetModel() final {}
+    bool needsMoreSamples() const final { return false; }
+    bool isVSyncInPhase(nsecs_t, Fps) final { return false; }
+    void setDisplayModePtr(ftl::NonNull<DisplayModePtr>) final {}
+    void setRenderRate(Fps) final {}
+    void onFrameBegin(TimePoint, TimePoint) final {}
+    void onFrameMissed(TimePoint) final {}
+    void dump(std::string&) const final {}
+};
+
+struct DispatchFixture {
+    ManualTimeKeeper* timeKeeper;
+    std::shared_ptr<VSyncDispatchTimerQueue> dispatch;
+    std::vector<VSyncDispatch::CallbackToken> tokens;
+    std::vector<nsecs_t> lastVsync;
+
+    DispatchFixture(QueueMode queueMode, size_t numCallbacks) {
+        auto manualTimeKeeper = std::make_unique<ManualTimeKeeper>();
+        timeKeeper = manualTimeKeeper.get();
+        dispatch = std::make_shared<VSyncDispatchTimerQueue>(std::move(manualTimeKeeper),
+                                                             std::make_shared<FixedRateTracker>(),
+                                                             kTimerSlack, kMinVsyncDistance,
+                                                             queueMode);
+        lastVsync.resize(numCallbacks, 0);
+        for (size_t i = 0; i < numCallbacks; i++) {
+            // Each callback reschedules itself for the following vsync, like the app and sf
+            // EventThreads do.
+            tokens.push_back(dispatch->registerCallback(
+                    [this, i](nsecs_t vsyncTime, nsecs_t, nsecs_t) {
+                        lastVsync[i] = vsyncTime;
+                        schedule(i);
+                    },
+                    "callback" + std::to_string(i)));
+        }
+    }
+
+    ~DispatchFixture() {
+        for (const auto token : tokens) {
+            dispatch->unregisterCallback(token);
+        }
+    }
+
+    // Spreads the work durations over most of a vsync period so that wakeups are distinct.
+    static nsecs_t workDuration(size_t i) {
+        return 1'000'000 + static_cast<nsecs_t>(i * 7'919) % (kPeriod - 2'000'000);
+    }
+
+    void schedule(size_t i) {
+        dispatch->schedule(tokens[i],
+                           {.workDuration = workDuration(i),
+                            .readyDuration = 0,
+                            .lastVsync = lastVsync[i] + kPeriod});
+    }
+
+    void scheduleAll() {
+        for (size_t i = 0; i < tokens.size(); i++) {
+            schedule(i);
+        }
+    }
+};
+
+void QueueModesAndCallbackCounts(benchmark::internal::Benchmark* b) {
+    for (const auto queueMode : {QueueMode::Linear, QueueMode::WakeupOrdered}) {
+        for (const int numCallbacks : {10, 50, 100, 200}) {
+            b->Args({static_cast<int>(queueMode), numCallbacks});
+        }
+    }
+}
+
+// Cost of rescheduling one callback while the others stay armed.
+void BM_VSyncDispatch_schedule(benchmark::State& state) {
+    const size_t numCallbacks = static_cast<size_t>(state.range(1));
+    DispatchFixture fixture(static_cast<QueueMode>(state.range(0)), numCallbacks);
+    fixture.scheduleAll();
+
+    size_t i = 0;
+    for (auto _ : state) {
+        fixture.schedule(i);
+        i = (i + 1) % numCallbacks;
+    }
+}
+BENCHMARK(BM_VSyncDispatch_schedule)->Apply(QueueModesAndCallbackCounts);
+
+// Cost of cancelling and rearming one callback while the others stay armed.
+void BM_VSyncDispatch_cancelAndSchedule(benchmark::State& state) {
+    const size_t numCallbacks = static_cast<size_t>(state.range(1));
+    DispatchFixture fixture(static_cast<QueueMode>(state.range(0)), numCallbacks);
+    fixture.scheduleAll();
+
+    size_t i = 0;
+    for (auto _ : state) {
+        fixture.dispatch->cancel(fixture.tokens[i]);
+        fixture.schedule(i);
+        i = (i + 1) % numCallbacks;
+    }
+}
+BENCHMARK(BM_VSyncDispatch_cancelAndSchedule)->Apply(QueueModesAndCallbackCounts);
+
+// Cost of a wakeup, including dispatching the due callbacks and rearming the timer. Callbacks
+// reschedule themselves, so the queue stays fully armed.
+void BM_VSyncDispatch_wakeup(benchmark::State& state) {
+    DispatchFixture fixture(static_cast<QueueMode>(state.range(0)),
+                            static_cast<size_t>(state.range(1)));
+    fixture.scheduleAll();
+
+    for (auto _ : state) {
+        if (!fixture.timeKeeper->fireAlarm()) {
+            state.SkipWithError("No alarm armed");
+            break;
+        }
+    }
+}
+BENCHMARK(BM_VSyncDispatch_wakeup)->Apply(QueueModesAndCallbackCounts);
+
+} // namespace
+} // namespace android::scheduler
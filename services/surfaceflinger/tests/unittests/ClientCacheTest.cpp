@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "ClientCacheTest"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <binder/Binder.h>
+#include <renderengine/mock/RenderEngine.h>
+
+#include "ClientCache.h"
+
+namespace android {
+namespace {
+
+// Counts the buffers mapped into RenderEngine, which the mock does not expose.
+class CountingRenderEngine : public renderengine::mock::RenderEngine {
+public:
+    size_t mappedBuffers = 0;
+    size_t unmappedBuffers = 0;
+
+protected:
+    void mapExternalTextureBuffer(const sp<GraphicBuffer>&, bool) override { mappedBuffers++; }
+    void unmapExternalTextureBuffer(sp<GraphicBuffer>&&) override { unmappedBuffers++; }
+};
+
+class ClientCacheTest : public testing::Test {
+protected:
+    ClientCacheTest() { mCache.setRenderEngine(&mRenderEngine); }
+
+    CountingRenderEngine mRenderEngine;
+    ClientCache mCache;
+    sp<IBinder> mProcessA = sp<BBinder>::make();
+    sp<IBinder> mProcessB = sp<BBinder>::make();
+    sp<GraphicBuffer> mBuffer = sp<GraphicBuffer>::make();
+};
+
+TEST_F(ClientCacheTest, sharesTextureForSameBufferAcrossProcesses) {
+    const auto textureA = mCache.add({mProcessA, 1}, mBuffer);
+    const auto textureB = mCache.add({mProcessB, 7}, mBuffer);
+    ASSERT_TRUE(textureA.has_value());
+    ASSERT_TRUE(textureB.has_value());
+    EXPECT_EQ(*textureA, *textureB);
+    EXPECT_EQ(1u, mRenderEngine.mappedBuffers);
+
+    EXPECT_EQ(*textureA, mCache.get({mProcessA, 1}));
+    EXPECT_EQ(*textureA, mCache.get({mProcessB, 7}));
+}
+
+TEST_F(ClientCacheTest, sharedTextureIsReleasedWithLastCacheEntry) {
+    ASSERT_TRUE(mCache.add({mProcessA, 1}, mBuffer).has_value());
+    ASSERT_TRUE(mCache.add({mProcessB, 7}, mBuffer).has_value());
+
+    EXPECT_EQ(mBuffer->getId(), mCache.erase({mProcessA, 1})->getId());
+    EXPECT_EQ(0u, mRenderEngine.unmappedBuffers);
+    EXPECT_NE(nullptr, mCache.get({mProcessB, 7}));
+
+    EXPECT_EQ(mBuffer->getId(), mCache.erase({mProcessB, 7})->getId());
+    EXPECT_EQ(1u, mRenderEngine.unmappedBuffers);
+}
+
+TEST_F(ClientCacheTest, reimportsBufferAfterTextureIsReleased) {
+    ASSERT_TRUE(mCache.add({mProcessA, 1}, mBuffer).has_value());
+    mCache.erase({mProcessA, 1});
+    ASSERT_TRUE(mCache.add({mProcessA, 1}, mBuffer).has_value());
+
+    EXPECT_EQ(2u, mRenderEngine.mappedBuffers);
+    EXPECT_EQ(1u, mRenderEngine.unmappedBuffers);
+}
+
+TEST_F(ClientCacheTest, removeProcessOnlyRemovesItsEntries) {
+    ASSERT_TRUE(mCache.add({mProcessA, 1}, mBuffer).has_value());
+    ASSERT_TRUE(mCache.add({mProcessB, 7}, mBuffer).has_value());
+
+    mCache.removeProcess(mProcessA);
+    EXPECT_EQ(nullptr, mCache.get({mProcessA, 1}));
+    EXPECT_NE(nullptr, mCache.get({mProcessB, 7}));
+    EXPECT_EQ(0u, mRenderEngine.unmappedBuffers);
+}
+
+TEST_F(ClientCacheTest, distinctBuffersAreNotShared) {
+    const auto textureA = mCache.add({mProcessA, 1}, mBuffer);
+    const auto textureB = mCache.add({mProcessB, 1}, sp<GraphicBuffer>::make());
+    ASSERT_TRUE(textureA.has_value());
+    ASSERT_TRUE(textureB.has_value());
+    EXPECT_NE(*textureA, *textureB);
+    EXPECT_EQ(2u, mRenderEngine.mappedBuffers);
+}
+
+} // namespace
+} // namespace android
@@ -139,7 +139,7 @@ public:
         for (size_t i = 0; i < maxTokens; i++) {
             mTokenManager->generateTokenForPredictions({});
         }
-        EXPECT_EQ(getPredictions().size(), maxTokens);
+        EXPECT_EQ(getPredictionCount(), maxTokens);
     }
 
     SurfaceFrame& getSurfaceFrame(size_t displayFrameIdx, size_t surfaceFrameIdx) {
@@ -158,8 +158,15 @@ public:
                 a.presentTime == b.presentTime;
     }
 
-    const std::map<int64_t, TimelineItem>& getPredictions() const {
-        return mTokenManager->mPredictions;
+    size_t getPredictionCount() const { return mTokenManager->getPredictionCount(); }
+
+    size_t getAllocatedSurfaceFrameCount() const {
+        return mFrameTimeline->mSurfaceFramePool->getAllocatedBlockCount();
+    }
+
+    size_t getPooledDisplayFrameCount() const {
+        std::lock_guard<std::mutex> lock(mFrameTimeline->mMutex);
+        return mFrameTimeline->mDisplayFramePool.size();
     }
 
     uint32_t getNumberOfDisplayFrames() const {
@@ -193,7 +200,7 @@ public:
 
 TEST_F(FrameTimelineTest, tokenManagerRemovesStalePredictions) {
     int64_t token1 = mTokenManager->generateTokenForPredictions({0, 0, 0});
-    EXPECT_EQ(getPredictions().size(), 1u);
+    EXPECT_EQ(getPredictionCount(), 1u);
     flushTokens();
     int64_t token2 = mTokenManager->generateTokenForPredictions({10, 20, 30});
     std::optional<TimelineItem> predictions = mTokenManager->getPredictionsForToken(token1);
@@ -397,6 +404,57 @@ TEST_F(FrameTimelineTest, displayFramesSlidingWindowMovesAfterLimit) {
     EXPECT_EQ(compareTimelineItems(displayFrame0->getActuals(), TimelineItem(52, 57, 62)), true);
 }
 
+TEST_F(FrameTimelineTest, framesAreReusedOnceWindowIsFull) {
+    EXPECT_CALL(*mTimeStats, incrementJankyFrames(_)).Times(AtLeast(1));
+    mFrameTimeline->setMaxDisplayFrames(2);
+
+    int frameTimeFactor = 0;
+    const auto presentFrame = [&] {
+        auto presentFence = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
+        int64_t surfaceFrameToken = mTokenManager->generateTokenForPredictions(
+                {10 + frameTimeFactor, 20 + frameTimeFactor, 30 + frameTimeFactor});
+        int64_t sfToken = mTokenManager->generateTokenForPredictions(
+                {22 + frameTimeFactor, 26 + frameTimeFactor, 30 + frameTimeFactor});
+        FrameTimelineInfo ftInfo;
+        ftInfo.vsyncId = surfaceFrameToken;
+        ftInfo.inputEventId = sInputEventId;
+        auto surfaceFrame =
+                mFrameTimeline->createSurfaceFrameForToken(ftInfo, sPidOne, sUidOne, sLayerIdOne,
+                                                           sLayerNameOne, sLayerNameOne,
+                                                           /*isBuffer*/ true, sGameMode);
+        mFrameTimeline->setSfWakeUp(sfToken, 22 + frameTimeFactor, RR_11, RR_11);
+        surfaceFrame->setPresentState(SurfaceFrame::PresentState::Presented);
+        mFrameTimeline->addSurfaceFrame(std::move(surfaceFrame));
+        mFrameTimeline->setSfPresent(27 + frameTimeFactor, presentFence);
+        presentFence->signalForTest(32 + frameTimeFactor);
+        frameTimeFactor += 30;
+    };
+
+    // Fill the window and let a few frames age out of it.
+    for (int i = 0; i < 4; i++) {
+        presentFrame();
+    }
+    const size_t allocatedSurfaceFrames = getAllocatedSurfaceFrameCount();
+
+    for (int i = 0; i < 10; i++) {
+        presentFrame();
+        // The DisplayFrame that aged out is immediately reused as the current one.
+        EXPECT_EQ(getPooledDisplayFrameCount(), 0u);
+    }
+    EXPECT_EQ(getAllocatedSurfaceFrameCount(), allocatedSurfaceFrames);
+    EXPECT_EQ(getNumberOfDisplayFrames(), 2u);
+
+    // Recycled frames start from a clean state. The newest frame's present fence is only read
+    // on the next present, so check the one before it.
+    auto displayFrame = getDisplayFrame(0);
+    EXPECT_EQ(displayFrame->getSurfaceFrames().size(), 1u);
+    EXPECT_EQ(compareTimelineItems(displayFrame->getActuals(),
+                                   TimelineItem(22 + frameTimeFactor - 60,
+                                                27 + frameTimeFactor - 60,
+                                                32 + frameTimeFactor - 60)),
+              true);
+}
+
 TEST_F(FrameTimelineTest, surfaceFrameEndTimeAcquireFenceAfterQueue) {
     auto surfaceFrame = mFrameTimeline->createSurfaceFrameForToken({}, sPidOne, 0, sLayerIdOne,
                                                                    "acquireFenceAfterQueue",
@@ -32,6 +32,7 @@
 
 #include <chrono>
 #include <random>
+#include <thread>
 #include <unordered_set>
 
 #include "libsurfaceflinger_unittest_main.h"
@@ -780,6 +781,61 @@ TEST_F(TimeStatsTest, canInsertUnorderedLayerTimeStats) {
     }
 }
 
+TEST_F(TimeStatsTest, canInsertLayerTimeStatsFromMultipleThreads) {
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    // More layers than there are shards, so that threads share shards as well as the stats pool.
+    constexpr int32_t kNumThreads = 4;
+    constexpr int32_t kLayersPerThread = 8;
+    constexpr uint64_t kNumFrames = 20;
+    std::vector<std::thread> threads;
+    for (int32_t t = 0; t < kNumThreads; t++) {
+        threads.emplace_back([&, t] {
+            for (uint64_t frameNumber = 1; frameNumber <= kNumFrames; frameNumber++) {
+                for (int32_t i = 0; i < kLayersPerThread; i++) {
+                    insertTimeRecord(NORMAL_SEQUENCE, t * kLayersPerThread + i, frameNumber,
+                                     frameNumber * 1000000);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(kNumThreads * kLayersPerThread, globalProto.stats_size());
+    for (const SFTimeStatsLayerProto& layerProto : globalProto.stats()) {
+        // The first frame of each layer has no previous present to compare against.
+        EXPECT_EQ(kNumFrames - 1, layerProto.total_frames()) << layerProto.layer_name();
+    }
+}
+
+TEST_F(TimeStatsTest, layersAdmittedFromMultipleThreadsStayWithinTheLimit) {
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    // Together the threads post the first buffer of more layers than can be tracked.
+    constexpr int32_t kNumThreads = 8;
+    constexpr int32_t kLayersPerThread = 50;
+    std::vector<std::thread> threads;
+    for (int32_t t = 0; t < kNumThreads; t++) {
+        threads.emplace_back([&, t] {
+            for (int32_t i = 0; i < kLayersPerThread; i++) {
+                const int32_t id = t * kLayersPerThread + i;
+                mTimeStats->setPostTime(id, 1, genLayerName(id), UID_0, 1000000, kGameMode);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_THAT(mTimeStats->miniDump(),
+                HasSubstr("Number of layers currently being tracked is 200\n"));
+}
+
 TEST_F(TimeStatsTest, recordRefreshRateNewConfigs) {
     EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
 
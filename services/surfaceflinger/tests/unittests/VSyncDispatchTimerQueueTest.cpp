@@ -196,7 +196,9 @@ public:
 
 class VSyncDispatchTimerQueueTest : public testing::Test {
 protected:
-    std::unique_ptr<TimeKeeper> createTimeKeeper() {
+    std::unique_ptr<TimeKeeper> createTimeKeeper() { return createTimeKeeper(mMockClock); }
+
+    static std::unique_ptr<TimeKeeper> createTimeKeeper(TimeKeeper& clock) {
         class TimeKeeperWrapper : public TimeKeeper {
         public:
             TimeKeeperWrapper(TimeKeeper& control) : mControllableClock(control) {}
@@ -213,7 +215,7 @@ protected:
         private:
             TimeKeeper& mControllableClock;
         };
-        return std::make_unique<TimeKeeperWrapper>(mMockClock);
+        return std::make_unique<TimeKeeperWrapper>(clock);
     }
 
     ~VSyncDispatchTimerQueueTest() {
@@ -1220,6 +1222,153 @@ TEST_F(VSyncDispatchTimerQueueTest, dontskipAVsyc) {
     EXPECT_THAT(cb.mReadyTime[0], Eq(1000));
 }
 
+class VSyncDispatchTimerQueueWakeupOrderedTest : public VSyncDispatchTimerQueueTest {
+protected:
+    VSyncDispatchTimerQueueWakeupOrderedTest() {
+        mDispatch = std::make_shared<
+                VSyncDispatchTimerQueue>(createTimeKeeper(), mStubTracker, mDispatchGroupThreshold,
+                                         mVsyncMoveThreshold,
+                                         VSyncDispatchTimerQueue::QueueMode::WakeupOrdered);
+    }
+};
+
+TEST_F(VSyncDispatchTimerQueueWakeupOrderedTest, dispatchesInWakeupOrder) {
+    Sequence seq;
+    EXPECT_CALL(mMockClock, alarmAt(_, 900)).InSequence(seq);
+    EXPECT_CALL(mMockClock, alarmAt(_, 700)).InSequence(seq);
+    EXPECT_CALL(mMockClock, alarmAt(_, 800)).InSequence(seq);
+    EXPECT_CALL(mMockClock, alarmAt(_, 900)).InSequence(seq);
+
+    CountingCallback cb0(mDispatch);
+    CountingCallback cb1(mDispatch);
+    CountingCallback cb2(mDispatch);
+    mDispatch->schedule(cb0, {.workDuration = 100, .readyDuration = 0, .lastVsync = mPeriod});
+    mDispatch->schedule(cb1, {.workDuration = 300, .readyDuration = 0, .lastVsync = mPeriod});
+    mDispatch->schedule(cb2, {.workDuration = 200, .readyDuration = 0, .lastVsync = mPeriod});
+
+    advanceToNextCallback();
+    EXPECT_THAT(cb0.mCalls.size(), Eq(0));
+    ASSERT_THAT(cb1.mCalls.size(), Eq(1));
+    EXPECT_THAT(cb2.mCalls.size(), Eq(0));
+    EXPECT_THAT(cb1.mWakeupTime[0], Eq(700));
+
+    advanceToNextCallback();
+    EXPECT_THAT(cb0.mCalls.size(), Eq(0));
+    ASSERT_THAT(cb2.mCalls.size(), Eq(1));
+    EXPECT_THAT(cb2.mWakeupTime[0], Eq(800));
+
+    advanceToNextCallback();
+    ASSERT_THAT(cb0.mCalls.size(), Eq(1));
+    EXPECT_THAT(cb0.mCalls[0], Eq(mPeriod));
+    EXPECT_THAT(cb0.mWakeupTime[0], Eq(900));
+}
+
+TEST_F(VSyncDispatchTimerQueueWakeupOrderedTest, rearmsWhenCancelledAndIsNextScheduled) {
+    Sequence seq;
+    EXPECT_CALL(mMockClock, alarmAt(_, 600)).InSequence(seq);
+    EXPECT_CALL(mMockClock, alarmAt(_, 400)).InSequence(seq);
+    EXPECT_CALL(mMockClock, alarmAt(_, 600)).InSequence(seq);
+
+    CountingCallback cb0(mDispatch);
+    CountingCallback cb1(mDispatch);
+    mDispatch->schedule(cb0, {.workDuration = 400, .readyDuration = 0, .lastVsync = mPeriod});
+    mDispatch->schedule(cb1, {.workDuration = 600, .readyDuration = 0, .lastVsync = mPeriod});
+    EXPECT_EQ(mDispatch->cancel(cb1), CancelResult::Cancelled);
+
+    advanceToNextCallback();
+    EXPECT_THAT(cb0.mCalls.size(), Eq(1));
+    EXPECT_THAT(cb1.mCalls.size(), Eq(0));
+}
+
+TEST_F(VSyncDispatchTimerQueueWakeupOrderedTest, groupsCallbacksWithinTimerSlack) {
+    EXPECT_CALL(mMockClock, alarmAt(_, 900));
+
+    CountingCallback cb0(mDispatch);
+    CountingCallback cb1(mDispatch);
+    mDispatch->schedule(cb0, {.workDuration = 100, .readyDuration = 0, .lastVsync = mPeriod});
+    mDispatch->schedule(cb1, {.workDuration = 98, .readyDuration = 0, .lastVsync = mPeriod});
+
+    advanceToNextCallback();
+    EXPECT_THAT(cb0.mCalls.size(), Eq(1));
+    EXPECT_THAT(cb1.mCalls.size(), Eq(1));
+}
+
+TEST_F(VSyncDispatchTimerQueueWakeupOrderedTest, unregisteredCallbackIsNotDispatched) {
+    Sequence seq;
+    EXPECT_CALL(mMockClock, alarmAt(_, 700)).InSequence(seq);
+    EXPECT_CALL(mMockClock, alarmAt(_, 900)).InSequence(seq);
+
+    CountingCallback cb0(mDispatch);
+    {
+        CountingCallback cb1(mDispatch);
+        mDispatch->schedule(cb1, {.workDuration = 300, .readyDuration = 0, .lastVsync = mPeriod});
+        mDispatch->schedule(cb0, {.workDuration = 100, .readyDuration = 0, .lastVsync = mPeriod});
+    }
+
+    // The stale 700 wakeup dispatches nothing and moves the timer to the remaining callback.
+    advanceToNextCallback();
+    EXPECT_THAT(cb0.mCalls.size(), Eq(0));
+
+    advanceToNextCallback();
+    EXPECT_THAT(cb0.mCalls.size(), Eq(1));
+}
+
+// Drives the same schedule through both queue modes and expects every callback to be dispatched
+// for the same vsyncs at the same wakeup times.
+TEST_F(VSyncDispatchTimerQueueTest, wakeupOrderedQueueMatchesLinearQueue) {
+    constexpr size_t kNumCallbacks = 20;
+    constexpr size_t kNumWakeups = 100;
+
+    const auto run = [&](VSyncDispatchTimerQueue::QueueMode queueMode) {
+        NiceMock<ControllableClock> clock;
+        auto dispatch =
+                std::make_shared<VSyncDispatchTimerQueue>(createTimeKeeper(clock), mStubTracker,
+                                                          mDispatchGroupThreshold,
+                                                          mVsyncMoveThreshold, queueMode);
+        std::vector<std::unique_ptr<CountingCallback>> callbacks;
+        std::vector<size_t> handledCalls(kNumCallbacks, 0);
+        for (size_t i = 0; i < kNumCallbacks; i++) {
+            callbacks.push_back(std::make_unique<CountingCallback>(dispatch));
+        }
+
+        const auto workDuration = [](size_t i) { return static_cast<nsecs_t>(50 + i * 137 % 900); };
+        for (size_t i = 0; i < kNumCallbacks; i++) {
+            dispatch->schedule(*callbacks[i],
+                               {.workDuration = workDuration(i),
+                                .readyDuration = 0,
+                                .lastVsync = mPeriod});
+        }
+
+        for (size_t wakeup = 0; wakeup < kNumWakeups; wakeup++) {
+            clock.advanceToNextCallback();
+            for (size_t i = 0; i < kNumCallbacks; i++) {
+                auto& callback = *callbacks[i];
+                if (callback.mCalls.size() == handledCalls[i]) {
+                    continue;
+                }
+                handledCalls[i] = callback.mCalls.size();
+                dispatch->schedule(callback,
+                                   {.workDuration = workDuration(i),
+                                    .readyDuration = 0,
+                                    .lastVsync = callback.mCalls.back() + mPeriod});
+            }
+        }
+
+        std::vector<std::vector<nsecs_t>> dispatched;
+        for (const auto& callback : callbacks) {
+            dispatched.push_back(callback->mCalls);
+            dispatched.push_back(callback->mWakeupTime);
+        }
+        return dispatched;
+    };
+
+    const auto linear = run(VSyncDispatchTimerQueue::QueueMode::Linear);
+    const auto wakeupOrdered = run(VSyncDispatchTimerQueue::QueueMode::WakeupOrdered);
+    ASSERT_THAT(linear.size(), Eq(2 * kNumCallbacks));
+    EXPECT_THAT(linear.front().size(), Gt(1));
+    EXPECT_THAT(wakeupOrdered, Eq(linear));
+}
+
 class VSyncDispatchTimerQueueEntryTest : public testing::Test {
 protected:
     nsecs_t const mPeriod = 1000;